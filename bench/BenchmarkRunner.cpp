@@ -0,0 +1,145 @@
+/**
+ *  This file is part of ltp-text-detector.
+ *  Copyright (C) 2013 Michael Opitz
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "BenchmarkRunner.h"
+
+#include <boost/timer/timer.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include <sys/resource.h>
+
+#include <text_detector/Instrumentation.h>
+
+namespace TextDetector {
+
+BenchmarkRunner::BenchmarkRunner(std::ostream &os, Format format,
+    int min_iterations, double min_seconds)
+: _os(os), 
+  _format(format), 
+  _min_iterations(std::max(1, min_iterations)),
+  _min_seconds(min_seconds),
+  _header_written(false) {}
+
+/**
+ *  Reads a value in kB from /proc/self/status, returns -1 if not available
+ */
+static long read_proc_status(const std::string &key)
+{
+    std::ifstream ifs("/proc/self/status");
+    std::string line;
+    while (std::getline(ifs, line)) {
+        if (line.compare(0, key.size(), key) == 0) {
+            std::stringstream ss(line.substr(key.size() + 1));
+            long value;
+            if (ss >> value) return value;
+        }
+    }
+    return -1;
+}
+
+long BenchmarkRunner::reset_peak_rss()
+{
+    // resets VmHWM on Linux >= 4.0, otherwise the peak is the process peak
+    std::ofstream ofs("/proc/self/clear_refs");
+    if (ofs) ofs << "5" << std::endl;
+    return read_proc_status("VmRSS");
+}
+
+long BenchmarkRunner::peak_rss()
+{
+    long hwm = read_proc_status("VmHWM");
+    if (hwm >= 0) return hwm;
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+BenchmarkResult BenchmarkRunner::run(
+    const std::string &benchmark, 
+    const std::string &input, 
+    double pixels,
+    const std::function<void ()> &f)
+{
+    BenchmarkResult result;
+    result.benchmark = benchmark;
+    result.input = input;
+
+    reset_peak_rss();
+    f();
+
+    boost::timer::cpu_timer total;
+    while (int(result.latencies.size()) < _min_iterations ||
+           total.elapsed().wall / 1.0e9 < _min_seconds) {
+        boost::timer::cpu_timer t;
+        f();
+        result.latencies.push_back(t.elapsed().wall / 1.0e6);
+    }
+
+    double seconds = 0.0;
+    for (double l : result.latencies) seconds += l / 1000.0;
+
+    result.iterations = result.latencies.size();
+    result.throughput = result.iterations / std::max(seconds, 1e-12);
+    result.mpixels_per_second = result.throughput * pixels / 1.0e6;
+    result.peak_rss_kb = peak_rss();
+
+    write(result);
+    return result;
+}
+
+void BenchmarkRunner::write(const BenchmarkResult &result)
+{
+    std::vector<double> sorted(result.latencies);
+    std::sort(sorted.begin(), sorted.end());
+    double mean = 0.0;
+    for (double l : sorted) mean += l / sorted.size();
+
+    _os << std::fixed << std::setprecision(3);
+    if (_format == JSON_LINES) {
+        _os << "{\"benchmark\":\"" << result.benchmark << "\""
+            << ",\"input\":\"" << result.input << "\""
+            << ",\"iterations\":" << result.iterations
+            << ",\"mean_ms\":" << mean
+            << ",\"p50_ms\":" << percentile(sorted, 50)
+            << ",\"p95_ms\":" << percentile(sorted, 95)
+            << ",\"p99_ms\":" << percentile(sorted, 99)
+            << ",\"max_ms\":" << sorted.back()
+            << ",\"throughput_per_s\":" << result.throughput
+            << ",\"mpixels_per_s\":" << result.mpixels_per_second
+            << ",\"peak_rss_kb\":" << result.peak_rss_kb
+            << "}" << std::endl;
+    } else {
+        if (!_header_written) {
+            _os << "benchmark,input,iterations,mean_ms,p50_ms,p95_ms,p99_ms,max_ms,"
+                << "throughput_per_s,mpixels_per_s,peak_rss_kb" << std::endl;
+            _header_written = true;
+        }
+        _os << result.benchmark << "," << result.input << "," 
+            << result.iterations << "," << mean << ","
+            << percentile(sorted, 50) << "," << percentile(sorted, 95) << ","
+            << percentile(sorted, 99) << "," << sorted.back() << ","
+            << result.throughput << "," << result.mpixels_per_second << ","
+            << result.peak_rss_kb << std::endl;
+    }
+}
+
+}
@@ -0,0 +1,96 @@
+/**
+ *  This file is part of ltp-text-detector.
+ *  Copyright (C) 2013 Michael Opitz
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef BENCHMARKRUNNER_H
+
+#define BENCHMARKRUNNER_H
+
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace TextDetector {
+
+/**
+ *  The measurements of a single benchmark on a single input.
+ */
+struct BenchmarkResult
+{
+    std::string benchmark;
+    std::string input;
+    int iterations;
+    //! Latencies of all iterations in ms
+    std::vector<double> latencies;
+    //! Iterations per second
+    double throughput;
+    //! Megapixels per second
+    double mpixels_per_second;
+    //! Peak resident set size in KiB while running the benchmark
+    long peak_rss_kb;
+};
+
+/**
+ *  Runs a function repeatedly and reports the latency percentiles, 
+ *  throughput and peak RSS as JSON lines or CSV.
+ */
+class BenchmarkRunner
+{
+public:
+    enum Format { JSON_LINES, CSV };
+
+    /**
+     *  @param os is the stream the results are written to
+     *  @param format is the output format
+     *  @param min_iterations is the minimum number of timed iterations
+     *  @param min_seconds is the minimum total time of the timed iterations
+     */
+    BenchmarkRunner(std::ostream &os, Format format = JSON_LINES,
+        int min_iterations = 5, double min_seconds = 1.0);
+    ~BenchmarkRunner() {}
+
+    /**
+     *  Runs f once untimed as warm up and then at least min_iterations
+     *  times until min_seconds have passed.
+     *
+     *  @param benchmark is the name of the benchmark (i.e. the stage)
+     *  @param input is the name of the input
+     *  @param pixels is the number of pixels processed per iteration
+     */
+    BenchmarkResult run(
+        const std::string &benchmark, 
+        const std::string &input, 
+        double pixels,
+        const std::function<void ()> &f);
+
+    //! Resets the peak RSS (if supported) and returns the current RSS in KiB
+    static long reset_peak_rss();
+    //! Returns the peak RSS in KiB
+    static long peak_rss();
+private:
+    void write(const BenchmarkResult &result);
+
+    std::ostream &_os;
+    Format _format;
+    int _min_iterations;
+    double _min_seconds;
+    bool _header_written;
+};
+
+}
+
+#endif /* end of include guard: BENCHMARKRUNNER_H */
@@ -0,0 +1,171 @@
+/**
+ *  This file is part of ltp-text-detector.
+ *  Copyright (C) 2013 Michael Opitz
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "SyntheticCorpus.h"
+
+#include <algorithm>
+#include <sstream>
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+namespace TextDetector {
+
+static const char *WORDS[] = {
+    "the", "quick", "brown", "fox", "jumps", "over", "lazy", "dog",
+    "EXIT", "Station", "OPEN", "24h", "Coffee", "Main", "Street", "SALE",
+    "Parking", "No", "Entry", "Pharmacy", "Bakery", "Hotel", "Taxi", "STOP",
+    "2013", "Platform", "9", "Tickets", "Welcome", "Museum", "Bank", "Pizza",
+    "Library", "North", "South", "Information", "Airport", "Bus", "Line", "42"
+};
+static const int N_WORDS = sizeof(WORDS) / sizeof(WORDS[0]);
+
+static const int FONTS[] = {
+    cv::FONT_HERSHEY_SIMPLEX,
+    cv::FONT_HERSHEY_DUPLEX,
+    cv::FONT_HERSHEY_COMPLEX,
+    cv::FONT_HERSHEY_TRIPLEX,
+    cv::FONT_HERSHEY_PLAIN
+};
+static const int N_FONTS = sizeof(FONTS) / sizeof(FONTS[0]);
+
+void SyntheticCorpus::draw_background(cv::RNG &rng, cv::Mat &img) const
+{
+    // value noise with several octaves
+    cv::Mat noise(img.rows, img.cols, CV_32FC3, cv::Scalar::all(0.0f));
+    float weight = 0.5f;
+    for (int cells = 4; cells <= 64; cells *= 2) {
+        int cells_y = std::max(2, cells * img.rows / img.cols);
+        cv::Mat small(cells_y, cells, CV_32FC3);
+        rng.fill(small, cv::RNG::UNIFORM, cv::Scalar::all(-1.0f), cv::Scalar::all(1.0f));
+        cv::Mat big;
+        cv::resize(small, big, img.size(), 0, 0, cv::INTER_CUBIC);
+        noise += big * weight;
+        weight *= 0.5f;
+    }
+
+    cv::Scalar base(rng.uniform(30, 225), rng.uniform(30, 225), rng.uniform(30, 225));
+    float amplitude = rng.uniform(20.0f, 70.0f);
+    cv::Mat bg = noise * amplitude + base;
+    bg.convertTo(img, CV_8UC3);
+
+    // clutter, which produces non-text MSERs
+    int n_clutter = rng.uniform(5, 30);
+    for (int i = 0; i < n_clutter; i++) {
+        cv::Point p1(rng.uniform(0, img.cols), rng.uniform(0, img.rows));
+        cv::Scalar color(rng.uniform(0, 256), rng.uniform(0, 256), rng.uniform(0, 256));
+        if (rng.uniform(0, 2)) {
+            cv::Point p2(rng.uniform(0, img.cols), rng.uniform(0, img.rows));
+            cv::line(img, p1, p2, color, rng.uniform(1, 6));
+        } else {
+            cv::Size axes(rng.uniform(5, 1 + img.cols / 8), rng.uniform(5, 1 + img.rows / 8));
+            int thickness = rng.uniform(0, 4);
+            cv::ellipse(img, p1, axes, rng.uniform(0, 180), 0, 360, color, thickness == 0 ? -1 : thickness);
+        }
+    }
+}
+
+SyntheticImage SyntheticCorpus::generate(const cv::Size &size, int n_lines, int index) const
+{
+    // every image has its own random stream
+    uint64 state = _seed;
+    state = state * 1000003u + size.width;
+    state = state * 1000003u + size.height;
+    state = state * 1000003u + n_lines;
+    state = state * 1000003u + index;
+    cv::RNG rng(state == 0 ? 1 : state);
+
+    SyntheticImage result;
+    std::stringstream ss;
+    ss << size.width << "x" << size.height << "_d" << n_lines << "_" << index;
+    result.name = ss.str();
+    result.image = cv::Mat(size, CV_8UC3);
+    result.text_mask = cv::Mat(size, CV_8UC1, cv::Scalar(0));
+
+    draw_background(rng, result.image);
+    cv::Scalar mean = cv::mean(result.image);
+    bool dark_text = (mean[0] + mean[1] + mean[2]) / 3 > 128;
+
+    int slot = size.height / std::max(1, n_lines);
+    for (int l = 0; l < n_lines; l++) {
+        int font = FONTS[rng.uniform(0, N_FONTS)];
+        int thickness = rng.uniform(1, 4);
+        int baseline = 0;
+        cv::Size ref = cv::getTextSize("Ag", font, 1.0, thickness, &baseline);
+        int target_height = std::max(8, std::min(120, int(slot * rng.uniform(0.35f, 0.7f))));
+        double scale = double(target_height) / (ref.height + baseline);
+
+        cv::Scalar color = dark_text ?
+            cv::Scalar(rng.uniform(0, 60), rng.uniform(0, 60), rng.uniform(0, 60)) :
+            cv::Scalar(rng.uniform(195, 256), rng.uniform(195, 256), rng.uniform(195, 256));
+
+        int y = l * slot + (slot + target_height) / 2;
+        int x = rng.uniform(0, std::max(1, size.width / 4));
+        int space = cv::getTextSize(" ", font, scale, thickness, &baseline).width;
+        while (x < size.width) {
+            const char *word = WORDS[rng.uniform(0, N_WORDS)];
+            cv::Size ts = cv::getTextSize(word, font, scale, thickness, &baseline);
+            if (x + ts.width >= size.width) break;
+
+            cv::putText(result.image, word, cv::Point(x, y), font, scale, color, thickness, CV_AA);
+            cv::putText(result.text_mask, word, cv::Point(x, y), font, scale, cv::Scalar(255), thickness, 8);
+            result.words.push_back(
+                cv::Rect(x, y - ts.height, ts.width, ts.height + baseline) & 
+                cv::Rect(0, 0, size.width, size.height));
+            result.texts.push_back(word);
+
+            x += ts.width + space * rng.uniform(1, 4);
+        }
+    }
+
+    return result;
+}
+
+std::vector<SyntheticImage> SyntheticCorpus::generate_all(
+    const std::vector<cv::Size> &sizes,
+    const std::vector<int> &densities,
+    int images_per_config) const
+{
+    std::vector<SyntheticImage> result;
+    for (const cv::Size &size : sizes) {
+        for (int density : densities) {
+            for (int i = 0; i < images_per_config; i++) {
+                result.push_back(generate(size, density, i));
+            }
+        }
+    }
+    return result;
+}
+
+std::vector<cv::Size> SyntheticCorpus::default_sizes()
+{
+    std::vector<cv::Size> sizes;
+    sizes.push_back(cv::Size(640, 480));
+    sizes.push_back(cv::Size(1280, 720));
+    sizes.push_back(cv::Size(1920, 1080));
+    return sizes;
+}
+
+std::vector<int> SyntheticCorpus::default_densities()
+{
+    std::vector<int> densities;
+    densities.push_back(2);
+    densities.push_back(8);
+    densities.push_back(20);
+    return densities;
+}
+
+}
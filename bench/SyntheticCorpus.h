@@ -0,0 +1,88 @@
+/**
+ *  This file is part of ltp-text-detector.
+ *  Copyright (C) 2013 Michael Opitz
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SYNTHETICCORPUS_H
+
+#define SYNTHETICCORPUS_H
+
+#include <string>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+namespace TextDetector {
+
+/**
+ *  A generated image with its ground truth.
+ */
+struct SyntheticImage
+{
+    //! Unique name, e.g. 1280x720_d8_0
+    std::string name;
+    //! The RGB image
+    cv::Mat image;
+    //! 255 on the text pixels, 0 otherwise
+    cv::Mat text_mask;
+    //! Bounding boxes of the words
+    std::vector<cv::Rect> words;
+    //! The text of each word
+    std::vector<std::string> texts;
+};
+
+/**
+ *  Generates a deterministic corpus of text lines rendered with cv::putText
+ *  on procedurally textured backgrounds. The same seed always yields the 
+ *  same images, independent of the order in which they are generated, so
+ *  benchmarks run on different machines see identical inputs.
+ */
+class SyntheticCorpus
+{
+public:
+    SyntheticCorpus(unsigned int seed = 42) : _seed(seed) {}
+    ~SyntheticCorpus() {}
+
+    /**
+     *  Generates a single image.
+     *
+     *  @param size is the resolution of the image
+     *  @param n_lines is the number of text lines (the text density)
+     *  @param index distinguishes images with the same size and density
+     */
+    SyntheticImage generate(const cv::Size &size, int n_lines, int index) const;
+
+    /**
+     *  Generates images_per_config images for every combination of 
+     *  resolution and density.
+     */
+    std::vector<SyntheticImage> generate_all(
+        const std::vector<cv::Size> &sizes,
+        const std::vector<int> &densities,
+        int images_per_config) const;
+
+    //! The default resolutions (VGA, 720p, 1080p)
+    static std::vector<cv::Size> default_sizes();
+    //! The default densities (text lines per image)
+    static std::vector<int> default_densities();
+private:
+    void draw_background(cv::RNG &rng, cv::Mat &img) const;
+
+    unsigned int _seed;
+};
+
+}
+
+#endif /* end of include guard: SYNTHETICCORPUS_H */
@@ -0,0 +1,385 @@
+/**
+ *  This file is part of ltp-text-detector.
+ *  Copyright (C) 2013 Michael Opitz
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+#include <boost/algorithm/string.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include <text_detector/AdaboostClassifier.h>
+#include <text_detector/CCGroup.h>
+#include <text_detector/CCUtils.h>
+#include <text_detector/config.h>
+#include <text_detector/ConfigurationManager.h>
+#include <text_detector/ConnectedComponentGrouper.h>
+#include <text_detector/CRFLinConnectedComponentFilterer.h>
+#include <text_detector/CRFRFConnectedComponentFilterer.h>
+#include <text_detector/HardPPWordSplitter.h>
+#include <text_detector/LTPComputer.h>
+#include <text_detector/ModelManager.h>
+#include <text_detector/MserDetector.h>
+#include <text_detector/MserTree.h>
+#include <text_detector/SimpleWordSplitter.h>
+#include <text_detector/SoftPPWordSplitter.h>
+#include <text_detector/mser.h>
+
+#include "BenchmarkRunner.h"
+#include "SyntheticCorpus.h"
+
+namespace po = boost::program_options;
+namespace fs = boost::filesystem;
+using namespace TextDetector;
+
+/**
+ *  The inputs of all stages of a single image. The text mask of the 
+ *  synthetic image replaces the classifiers, such that grouping and word
+ *  splitting can be measured without trained models.
+ */
+struct StageFixture
+{
+    cv::Mat image;
+    cv::Mat gray;
+    cv::Mat gradient;
+    cv::Mat swt1, swt2;
+    std::vector<MSER::Region> regions[2];
+    std::vector<MserElement> elements;
+    std::vector<double> probs;
+    std::vector<std::vector<double> > per_classifier_probs;
+    cv::Mat unary_features;
+    //! Components after the tree pruning
+    std::vector<std::pair<int, std::vector<cv::Point> > > comps;
+    //! Components which overlap with the text (what the CRF should keep)
+    std::vector<std::pair<int, std::vector<cv::Point> > > text_comps;
+    std::vector<CCGroup> groups;
+};
+
+//! Same parameters as in MserExtractorFast
+static MSER create_mser(const cv::Mat &gray)
+{
+    return MSER(false, 3, 10.0 / (gray.rows * gray.cols), 1.0, 0.50, 0.20);
+}
+
+static std::vector<cv::Point> region_pixels(const cv::Mat &gray, const MSER::Region &region, bool inverse)
+{
+    int y = region.pixel_ / gray.cols;
+    int x = region.pixel_ % gray.cols;
+    int level = gray.at<unsigned char>(y, x);
+    cv::Mat roi = gray.rowRange(region.start_y_, region.end_y_ + 1).colRange(region.start_x_, region.end_x_ + 1);
+    cv::Mat bin = inverse ? roi <= level : roi >= level;
+    bin = bin - 128;
+    cv::floodFill(bin, cv::Point(x - region.start_x_, y - region.start_y_), 255, 0, cv::Scalar(), cv::Scalar(), 4);
+
+    std::vector<cv::Point> pixels;
+    for (int i = 0; i < bin.rows; i++) {
+        for (int j = 0; j < bin.cols; j++) {
+            if (bin.at<unsigned char>(i, j) == 255) 
+                pixels.push_back(cv::Point(j + region.start_x_, i + region.start_y_));
+        }
+    }
+    return pixels;
+}
+
+static void create_fixture(
+    const std::shared_ptr<ConfigurationManager> &config,
+    const SyntheticImage &img, StageFixture &fx)
+{
+    fx.image = img.image;
+    cv::cvtColor(img.image, fx.gray, CV_RGB2GRAY);
+    fx.gradient = compute_gradient(img.image);
+    compute_swt(fx.gray, fx.swt1, fx.swt2);
+
+    MSER mser(create_mser(fx.gray));
+    cv::Mat inv = 255 - fx.gray;
+    mser(fx.gray.ptr<uint8_t>(0, 0), fx.gray.cols, fx.gray.rows, fx.regions[0]);
+    mser(inv.ptr<uint8_t>(0, 0), fx.gray.cols, fx.gray.rows, fx.regions[1]);
+
+    int n = fx.regions[0].size() + fx.regions[1].size();
+    std::vector<std::vector<cv::Point> > pixels(n);
+    std::vector<cv::Vec4i> hierarchy(n);
+    fx.elements.resize(n);
+    fx.probs.resize(n);
+    fx.per_classifier_probs.resize(n);
+
+    for (int j = 0; j < 2; j++) {
+        int offset = j == 0 ? 0 : fx.regions[0].size();
+        std::unordered_map<int, int> uid_to_index;
+        for (size_t i = 0; i < fx.regions[j].size(); i++) {
+            uid_to_index[fx.regions[j][i].uid_] = i + offset;
+        }
+        #pragma omp parallel for
+        for (size_t i = 0; i < fx.regions[j].size(); i++) {
+            const MSER::Region &r = fx.regions[j][i];
+            pixels[i + offset] = region_pixels(fx.gray, r, j == 0);
+            hierarchy[i + offset] = cv::Vec4i(i + offset, -1, -1, 
+                r.parent_uid_ == -1 ? -1 : uid_to_index.at(r.parent_uid_));
+
+            // the fraction of text pixels replaces the classifier
+            int n_text = 0;
+            for (const cv::Point &p : pixels[i + offset]) {
+                n_text += img.text_mask.at<unsigned char>(p) > 0;
+            }
+            double prob = pixels[i + offset].empty() ? 0.0 : double(n_text) / pixels[i + offset].size();
+            fx.probs[i + offset] = prob;
+            fx.per_classifier_probs[i + offset] = std::vector<double>(2, prob);
+
+            MserElement el(-1, -1, -1, pixels[i + offset]);
+            el.compute_features(fx.image, fx.gradient, fx.swt1, fx.swt2);
+            fx.elements[i + offset] = el;
+        }
+    }
+
+    fx.unary_features = cv::Mat(n, N_UNARY_FEATURES, CV_32FC1, cv::Scalar(0.0));
+    for (int i = 0; i < n; i++) {
+        fx.elements[i].get_unary_features().copyTo(fx.unary_features.row(i));
+    }
+
+    std::vector<cv::Rect> rects(n);
+    for (int i = 0; i < n; i++) {
+        rects[i] = fx.elements[i].get_bounding_rect();
+    }
+    FlatMserTree tree(rects, fx.probs, hierarchy);
+    tree.linearize();
+    tree.accumulate();
+    const std::vector<int> &idxs = tree.get_accumulated_indices();
+    for (size_t i = 0; i < idxs.size(); i++) {
+        if (fx.probs[idxs[i]] <= 0.0) continue;
+        fx.comps.push_back(std::make_pair(idxs[i], std::move(pixels[idxs[i]])));
+        if (fx.probs[idxs[i]] >= 0.5)
+            fx.text_comps.push_back(fx.comps.back());
+    }
+
+    ConnectedComponentGrouper grouper(config);
+    grouper(fx.image, fx.gradient, fx.probs, fx.elements, fx.text_comps, fx.groups);
+}
+
+static std::vector<cv::Size> parse_sizes(const std::string &s)
+{
+    std::vector<std::string> parts;
+    boost::split(parts, s, boost::is_any_of(","));
+    std::vector<cv::Size> sizes;
+    for (const std::string &p : parts) {
+        int w, h;
+        char x;
+        std::stringstream ss(p);
+        if (!(ss >> w >> x >> h) || x != 'x') 
+            throw std::runtime_error("invalid size: " + p);
+        sizes.push_back(cv::Size(w, h));
+    }
+    return sizes;
+}
+
+static std::vector<int> parse_ints(const std::string &s)
+{
+    std::vector<std::string> parts;
+    boost::split(parts, s, boost::is_any_of(","));
+    std::vector<int> result;
+    for (const std::string &p : parts) {
+        result.push_back(std::stoi(p));
+    }
+    return result;
+}
+
+int main(int argc, const char *argv[])
+{
+    try {
+        po::options_description desc("Allowed options");
+        desc.add_options()
+            ("help,h", "print this help message")
+            ("config,c", po::value<std::string>()->default_value("config_11.yml"), "path to config file")
+            ("model,m", po::value<std::string>(), "path to the adaboost model (enables adaboost and detector)")
+            ("stages,s", po::value<std::string>()->default_value("all"), 
+             "comma separated list of: ltp, adaboost, swt, mser, features, crf, grouper, splitter, detector")
+            ("sizes", po::value<std::string>()->default_value("640x480,1280x720,1920x1080"), "resolutions of the corpus")
+            ("densities", po::value<std::string>()->default_value("2,8,20"), "text lines per image")
+            ("images", po::value<int>()->default_value(1), "images per resolution and density")
+            ("seed", po::value<unsigned int>()->default_value(42), "seed of the corpus")
+            ("min-iterations", po::value<int>()->default_value(5), "minimum number of timed iterations")
+            ("min-time", po::value<double>()->default_value(1.0), "minimum time per benchmark in seconds")
+            ("threads", po::value<int>()->default_value(0), "number of OpenMP threads (0 = default)")
+            ("format", po::value<std::string>()->default_value("jsonl"), "output format (jsonl or csv)")
+            ("output,o", po::value<std::string>(), "output file (defaults to stdout)")
+        ;
+
+        po::variables_map vm;
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+
+        if (vm.count("help")) {
+            std::cout << desc << std::endl;
+            return 0;
+        }
+
+        po::notify(vm);
+
+        std::shared_ptr<ConfigurationManager> config(
+            new ConfigurationManager(vm["config"].as<std::string>()));
+
+#ifdef _OPENMP
+        if (vm["threads"].as<int>() > 0)
+            omp_set_num_threads(vm["threads"].as<int>());
+#endif
+
+        std::vector<std::string> stages;
+        boost::split(stages, vm["stages"].as<std::string>(), boost::is_any_of(","));
+        auto enabled = [&stages] (const std::string &stage) {
+            return std::find(stages.begin(), stages.end(), "all") != stages.end() ||
+                   std::find(stages.begin(), stages.end(), stage) != stages.end();
+        };
+
+        std::ofstream ofs;
+        if (vm.count("output")) 
+            ofs.open(vm["output"].as<std::string>().c_str());
+        std::ostream &out = ofs.is_open() ? static_cast<std::ostream &>(ofs) : std::cout;
+        BenchmarkRunner runner(out,
+            vm["format"].as<std::string>() == "csv" ? BenchmarkRunner::CSV : BenchmarkRunner::JSON_LINES,
+            vm["min-iterations"].as<int>(), 
+            vm["min-time"].as<double>());
+
+        // the trained models are optional
+        std::shared_ptr<AdaboostClassifier> adaboost;
+        if (vm.count("model"))
+            adaboost.reset(new AdaboostClassifier(vm["model"].as<std::string>()));
+
+        std::shared_ptr<ModelManager> models;
+        if (config->get_crf_model_file() != "" && fs::exists(config->get_crf_model_file())) {
+            models.reset(new ModelManager(config));
+        } else if (enabled("crf") || enabled("detector")) {
+            std::cerr << "No CRF model in the config, skipping crf and detector" << std::endl;
+        }
+
+        SyntheticCorpus corpus(vm["seed"].as<unsigned int>());
+        std::vector<cv::Size> sizes(parse_sizes(vm["sizes"].as<std::string>()));
+        std::vector<int> densities(parse_ints(vm["densities"].as<std::string>()));
+
+        for (const cv::Size &size : sizes) {
+            for (int density : densities) {
+                for (int idx = 0; idx < vm["images"].as<int>(); idx++) {
+                    SyntheticImage img(corpus.generate(size, density, idx));
+                    const double pixels = double(size.width) * size.height;
+
+                    StageFixture fx;
+                    create_fixture(config, img, fx);
+
+                    if (enabled("ltp")) {
+                        LTPComputer ltp;
+                        runner.run("ltp", img.name, pixels, [&] () {
+                            cv::Mat m = ltp.compute(fx.image);
+                        });
+                    }
+                    if (enabled("adaboost") && adaboost) {
+                        runner.run("adaboost_single_scale", img.name, pixels, [&] () {
+                            cv::Mat response;
+                            adaboost->detect_single_scale(fx.image, response);
+                        });
+                    }
+                    if (enabled("swt")) {
+                        runner.run("swt", img.name, pixels, [&] () {
+                            cv::Mat swt1, swt2;
+                            compute_swt(fx.gray, swt1, swt2);
+                        });
+                    }
+                    if (enabled("mser")) {
+                        cv::Mat inv = 255 - fx.gray;
+                        runner.run("mser", img.name, pixels, [&] () {
+                            std::vector<MSER::Region> regions[2];
+                            MSER mser(create_mser(fx.gray));
+                            mser(fx.gray.ptr<uint8_t>(0, 0), fx.gray.cols, fx.gray.rows, regions[0]);
+                            mser(inv.ptr<uint8_t>(0, 0), fx.gray.cols, fx.gray.rows, regions[1]);
+                        });
+                    }
+                    if (enabled("features")) {
+                        runner.run("compute_features", img.name, pixels, [&] () {
+                            std::vector<MserElement> elements(fx.elements);
+                            #pragma omp parallel for
+                            for (size_t i = 0; i < elements.size(); i++) {
+                                elements[i].compute_features(fx.image, fx.gradient, fx.swt1, fx.swt2);
+                            }
+                        });
+                    }
+                    // the labeler of the config only fits the CRF it was trained for
+                    if (enabled("crf") && models && 
+                        config->get_classification_model() == ConfigurationManager::CLASSIFICATION_MODEL_CRF_LIN) {
+                        runner.run("crf_lin", img.name, pixels, [&] () {
+                            std::vector<MserElement> elements(fx.elements);
+                            CRFLinConnectedComponentFilterer filter(
+                                fx.image, fx.gradient, fx.unary_features, models->get_graph_labeler());
+                            filter.filter_compontents(fx.comps, elements, fx.per_classifier_probs);
+                        });
+                    } else if (enabled("crf") && models &&
+                        config->get_classification_model() == ConfigurationManager::CLASSIFICATION_MODEL_CRF_RF) {
+                        runner.run("crf_rf", img.name, pixels, [&] () {
+                            std::vector<MserElement> elements(fx.elements);
+                            CRFRFConnectedComponentFilterer filter(
+                                fx.image, fx.gradient, models->get_graph_labeler(),
+                                models->get_pairwise_1_1_classifier(),
+                                models->get_pairwise_1_0_classifier(),
+                                models->get_pairwise_0_0_classifier());
+                            filter.filter_compontents(fx.comps, elements, fx.per_classifier_probs);
+                        });
+                    }
+                    if (enabled("grouper")) {
+                        runner.run("grouper", img.name, pixels, [&] () {
+                            std::vector<CCGroup> groups;
+                            ConnectedComponentGrouper grouper(config);
+                            grouper(fx.image, fx.gradient, fx.probs, fx.elements, fx.text_comps, groups);
+                        });
+                    }
+                    if (enabled("splitter")) {
+                        bool single = config->allow_single_letters();
+                        runner.run("split_hard_pp", img.name, pixels, [&] () {
+                            HardPPWordSplitter(single, false).split_all(fx.groups);
+                        });
+                        runner.run("split_soft_pp", img.name, pixels, [&] () {
+                            SoftPPWordSplitter(single, false).split_all(fx.groups);
+                        });
+                        runner.run("split_simple", img.name, pixels, [&] () {
+                            SimplePPWordSplitter(single, false).split_all(fx.groups);
+                        });
+                    }
+                    if (enabled("detector") && models && adaboost) {
+                        MserDetector detector(config);
+                        runner.run("detector", img.name, pixels, [&] () {
+                            cv::Mat response, result_image;
+                            adaboost->detect(fx.image, response);
+                            cv::Mat mask = response > (config->get_threshold() * 255);
+                            detector(fx.image, result_image, mask);
+                        });
+                    }
+                }
+            }
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
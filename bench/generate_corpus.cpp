@@ -0,0 +1,125 @@
+/**
+ *  This file is part of ltp-text-detector.
+ *  Copyright (C) 2013 Michael Opitz
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+#include <boost/algorithm/string.hpp>
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+#include "SyntheticCorpus.h"
+
+namespace po = boost::program_options;
+namespace fs = boost::filesystem;
+
+/**
+ *  Writes the synthetic corpus to disk, such that the full pipeline 
+ *  (e.g. bin/detect --stats) can be benchmarked on it. The ground truth is 
+ *  written in the ICDAR 2011 format (gt_<name>.txt).
+ */
+int main(int argc, const char *argv[])
+{
+    try {
+        po::options_description desc("Allowed options");
+        desc.add_options()
+            ("help,h", "print this help message")
+            ("output,o", po::value<std::string>()->required(), "output directory")
+            ("sizes", po::value<std::string>()->default_value("640x480,1280x720,1920x1080"), "resolutions of the corpus")
+            ("densities", po::value<std::string>()->default_value("2,8,20"), "text lines per image")
+            ("images", po::value<int>()->default_value(5), "images per resolution and density")
+            ("seed", po::value<unsigned int>()->default_value(42), "seed of the corpus")
+            ("masks", "also write the text masks")
+        ;
+
+        po::variables_map vm;
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+
+        if (vm.count("help")) {
+            std::cout << desc << std::endl;
+            return 0;
+        }
+
+        po::notify(vm);
+
+        std::vector<std::string> parts;
+        std::vector<cv::Size> sizes;
+        boost::split(parts, vm["sizes"].as<std::string>(), boost::is_any_of(","));
+        for (const std::string &p : parts) {
+            int w, h;
+            char x;
+            std::stringstream ss(p);
+            if (!(ss >> w >> x >> h) || x != 'x') {
+                std::cerr << "Error: invalid size " << p << std::endl;
+                return 1;
+            }
+            sizes.push_back(cv::Size(w, h));
+        }
+        std::vector<int> densities;
+        boost::split(parts, vm["densities"].as<std::string>(), boost::is_any_of(","));
+        for (const std::string &p : parts) {
+            densities.push_back(std::stoi(p));
+        }
+
+        fs::path output_dir(vm["output"].as<std::string>());
+        if (!fs::is_directory(output_dir)) {
+            fs::create_directories(output_dir);
+        }
+
+        TextDetector::SyntheticCorpus corpus(vm["seed"].as<unsigned int>());
+        int n = 0;
+        for (const cv::Size &size : sizes) {
+            for (int density : densities) {
+                for (int i = 0; i < vm["images"].as<int>(); i++) {
+                    TextDetector::SyntheticImage img(corpus.generate(size, density, i));
+
+                    fs::path img_path(output_dir);
+                    img_path /= img.name + ".png";
+                    cv::imwrite(img_path.generic_string(), img.image);
+
+                    if (vm.count("masks")) {
+                        fs::path mask_path(output_dir);
+                        mask_path /= img.name + "_mask.png";
+                        cv::imwrite(mask_path.generic_string(), img.text_mask);
+                    }
+
+                    fs::path gt_path(output_dir);
+                    gt_path /= "gt_" + img.name + ".txt";
+                    std::ofstream ofs(gt_path.generic_string());
+                    for (size_t w = 0; w < img.words.size(); w++) {
+                        const cv::Rect &r = img.words[w];
+                        ofs << r.x << ", " << r.y << ", " << r.x + r.width - 1 << ", " 
+                            << r.y + r.height - 1 << ", \"" << img.texts[w] << "\"" << std::endl;
+                    }
+                    n++;
+                }
+            }
+        }
+        std::cout << "Wrote " << n << " images to " << output_dir << std::endl;
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,60 @@
+"""
+Compares the throughput of two runs of bench/bench_stages (jsonl output),
+e.g. of the default and the PGO build (see scripts/pgo_build.sh).
+
+Usage: python3 compare_bench.py baseline.jsonl optimized.jsonl
+"""
+import json
+import math
+import sys
+
+
+def load(filename):
+    results = {}
+    with open(filename) as f:
+        for line in f:
+            line = line.strip()
+            if not line:
+                continue
+            r = json.loads(line)
+            results[(r['benchmark'], r['input'])] = r
+    return results
+
+
+def main():
+    if len(sys.argv) != 3:
+        print(__doc__.strip())
+        return 1
+    baseline = load(sys.argv[1])
+    optimized = load(sys.argv[2])
+
+    keys = sorted(k for k in baseline if k in optimized)
+    if not keys:
+        print('Error: the runs have no common benchmarks')
+        return 1
+
+    print('%-12s %-28s %12s %12s %8s' % ('stage', 'input', 'base [1/s]', 'opt [1/s]', 'speedup'))
+    speedups = {}
+    for k in keys:
+        b = baseline[k]['throughput_per_s']
+        o = optimized[k]['throughput_per_s']
+        s = o / b if b > 0 else float('nan')
+        speedups.setdefault(k[0], []).append(s)
+        print('%-12s %-28s %12.3f %12.3f %7.3fx' % (k[0], k[1], b, o, s))
+
+    # geometric mean of the speedups of a stage over all inputs
+    print('')
+    print('%-12s %8s' % ('stage', 'speedup'))
+    all_speedups = []
+    for stage in sorted(speedups):
+        valid = [s for s in speedups[stage] if s > 0]
+        all_speedups.extend(valid)
+        if valid:
+            print('%-12s %7.3fx' % (stage, math.exp(sum(math.log(s) for s in valid) / len(valid))))
+    if all_speedups:
+        print('%-12s %7.3fx' % ('all', math.exp(sum(math.log(s) for s in all_speedups) / len(all_speedups))))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,72 @@
+#!/bin/bash
+# Builds the project with link time and profile guided optimization and
+# compares the throughput of the stages with the default build.
+#
+#   1. default build in $DEFAULT_DIR (the baseline of the report)
+#   2. instrumented LTO build in $PGO_DIR, the training workload (bench_stages
+#      on the synthetic corpus with seed 42) writes the profile
+#   3. LTO build in $PGO_DIR with the profile
+#   4. both builds run bench_stages on a corpus with a different seed, 
+#      scripts/compare_bench.py writes the report to $PGO_DIR/pgo_report.txt
+#
+# Run from the root of the project, which must contain the config and the 
+# models: ./scripts/pgo_build.sh [-c config_11.yml] [-m models/model_boost.txt]
+set -e
+
+CONFIG=config_11.yml
+MODEL=models/model_boost.txt
+JOBS=$(nproc)
+DEFAULT_DIR=build-default
+PGO_DIR=build-pgo
+EVAL_SEED=1234
+
+while getopts "c:m:j:d:p:" opt; do
+    case $opt in
+        c) CONFIG=$OPTARG ;;
+        m) MODEL=$OPTARG ;;
+        j) JOBS=$OPTARG ;;
+        d) DEFAULT_DIR=$OPTARG ;;
+        p) PGO_DIR=$OPTARG ;;
+        *) echo "Usage: $0 [-c config] [-m model] [-j jobs] [-d default build dir] [-p pgo build dir]"; exit 1 ;;
+    esac
+done
+
+ROOT=$(pwd)
+MODEL_ARGS=""
+if [ -f "$MODEL" ]; then
+    MODEL_ARGS="-m $MODEL"
+else
+    echo "Warning: $MODEL not found, the adaboost and detector stages are skipped"
+fi
+
+configure_and_build() {
+    local dir=$1
+    shift
+    mkdir -p "$dir"
+    (cd "$dir" && cmake "$ROOT" -DBENCHMARKS=ON "$@" && make -j"$JOBS")
+}
+
+run_bench() {
+    "$1/bench/bench_stages" -c "$CONFIG" $MODEL_ARGS --seed "$2" -o "$3"
+}
+
+echo "=== default build"
+configure_and_build "$DEFAULT_DIR" -DLTO=OFF -DPGO=
+
+echo "=== instrumented build"
+configure_and_build "$PGO_DIR" -DLTO=ON -DPGO=GENERATE
+PROFILE_DIR=$(cd "$PGO_DIR" && pwd)/pgo-profile
+rm -rf "$PROFILE_DIR"
+
+echo "=== training workload"
+run_bench "$PGO_DIR" 42 "$PGO_DIR/bench_training.jsonl"
+
+echo "=== optimized build"
+configure_and_build "$PGO_DIR" -DLTO=ON -DPGO=USE
+
+echo "=== evaluation"
+run_bench "$DEFAULT_DIR" "$EVAL_SEED" "$PGO_DIR/bench_default.jsonl"
+run_bench "$PGO_DIR" "$EVAL_SEED" "$PGO_DIR/bench_pgo.jsonl"
+
+python3 "$ROOT/scripts/compare_bench.py" "$PGO_DIR/bench_default.jsonl" "$PGO_DIR/bench_pgo.jsonl" \
+    | tee "$PGO_DIR/pgo_report.txt"
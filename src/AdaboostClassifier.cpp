@@ -39,10 +39,10 @@ AdaboostClassifier::AdaboostClassifier(const std::string &model_path, float scal
     ia >> *_clf;
 }
 
-void AdaboostClassifier::detect(const cv::Mat &image, cv::Mat &response)
+void AdaboostClassifier::detect(const cv::Mat &image, cv::Mat &response, AdaboostResponses *debug)
 {
     std::list<cv::Mat> fps;
-    bootstrap(image, response, fps, 0.1f, false);
+    bootstrap(image, response, fps, 0.1f, false, debug);
 }
 
 void AdaboostClassifier::detect_single_scale(const cv::Mat &image, cv::Mat &response)
@@ -51,15 +51,13 @@ void AdaboostClassifier::detect_single_scale(const cv::Mat &image, cv::Mat &resp
     bootstrap_single_scale(image, response, fps, 0, 0.1f, false);
 }
 
-void AdaboostClassifier::bootstrap(const cv::Mat &image, cv::Mat &response, std::list<cv::Mat> &false_positives, float thresh, bool sample_false_positives)
+void AdaboostClassifier::bootstrap(const cv::Mat &image, cv::Mat &response, std::list<cv::Mat> &false_positives, float thresh, bool sample_false_positives, AdaboostResponses *debug)
 {
     // classify each scale...
     cv::Size original_size(image.cols, image.rows);
     std::vector<cv::Mat> results;
     cv::Mat img = image;
     for (int i = 0; i < _num_scales; ++i) {
-
-        std::cout << "scale: " << i << std::endl;
         if (img.rows <= _window_height || img.cols <= _window_width) break;
 
         cv::Mat result;
@@ -86,6 +84,12 @@ void AdaboostClassifier::bootstrap(const cv::Mat &image, cv::Mat &response, std:
     cv::minMaxIdx(response, &min, &max);
     cv::multiply(response, cv::Scalar::all(255.0/max), response);
     response.convertTo(response, CV_8UC1);
+
+    if (debug) {
+        debug->scale_responses = results;
+        debug->min = min;
+        debug->max = max;
+    }
 }
 
 void AdaboostClassifier::bootstrap_single_scale(
@@ -17,7 +17,6 @@
  */
 #include <text_detector/BinaryMaskExtractor.h>
 
-#include <boost/timer/timer.hpp>
 #include <opencv2/core/core.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 #include <stddef.h>
@@ -27,10 +26,12 @@
 #include <text_detector/config.h>
 #include <text_detector/ConfigurationManager.h>
 #include <text_detector/ConnectedComponentClassifier.h>
+#include <text_detector/Instrumentation.h>
 
 namespace TextDetector {
 
 BinaryMaskExtractor::BinaryMaskExtractor(
+        const DetectorContext &context,
         const cv::Mat &image_color,
         const cv::Mat &image_gray,
         const cv::Mat &mask,
@@ -42,12 +43,13 @@ BinaryMaskExtractor::BinaryMaskExtractor(
    _mask(mask),
    _gradient_image(gradient_image),
    _classifier(clf),
-   _uid_offset(uid_offset) {}
+   _uid_offset(uid_offset),
+   _context(context) {}
 
 void BinaryMaskExtractor::compute_features(const cv::Mat& swt1,
 		const cv::Mat& swt2, MserElement& el) const {
 	el.compute_features(_image_color, _gradient_image, swt1, swt2);
-	if (ConfigurationManager::instance()->get_preclassification_model()
+	if (_context.config->get_preclassification_model()
 			== ConfigurationManager::PRE_CLASSIFICATION_MODEL_CNN)
 		el.compute_hog_features(_image_gray);
 }
@@ -89,9 +91,8 @@ void BinaryMaskExtractor::extract(
     std::vector<MserElement> &all_elements
 )
 {
-    boost::timer::cpu_timer t; 
-    t.start(); 
-    
+    ScopedStageTimer swt_timer("swt");
+
     probs.clear();
     per_classifier_probs.clear();
     comps.clear();
@@ -99,10 +100,9 @@ void BinaryMaskExtractor::extract(
 
     cv::Mat swt1, swt2;
     compute_swt(_image_gray, swt1, swt2);
-    if (ConfigurationManager::instance()->verbose())
-        std::cout << "Computed SWT in: " << boost::timer::format(t.elapsed(), 5, "%w") << std::endl;
-    
-    t.start(); 
+    swt_timer.stop();
+
+    ScopedStageTimer contour_timer("mser");
 
     std::vector<std::vector<cv::Point> > msers;
     std::vector<cv::Vec4i> hierarchy;
@@ -110,19 +110,15 @@ void BinaryMaskExtractor::extract(
     _image_gray.copyTo(contour_img);
     contour_img = 255 - contour_img;
     cv::findContours(contour_img, msers, hierarchy, CV_RETR_CCOMP, CV_CHAIN_APPROX_NONE);
-    
-    if (ConfigurationManager::instance()->verbose())
-        std::cout << "Extracted "
-        		  << msers.size()
-        		  << " Contours in "
-        		  << boost::timer::format(t.elapsed(), 5, "%w") << std::endl;
-
-    if (ConfigurationManager::instance()->keep_unary_features())
+    contour_timer.stop();
+    count_stat("msers", msers.size());
+
+    if (_context.config->keep_unary_features())
         unary_features = cv::Mat(msers.size(), N_UNARY_FEATURES, CV_32FC1, cv::Scalar(0.0));
 
     all_elements.clear();
 
-    t.start();
+    ScopedStageTimer classify_timer("classify");
     std::vector<std::vector<cv::Point> > regions;
     for (int i = 0; i >= 0;  i = hierarchy[i][0]) {
 
@@ -145,9 +141,7 @@ void BinaryMaskExtractor::extract(
         all_elements.push_back(el);
     }
 
-    if (ConfigurationManager::instance()->verbose())
-        std::cout << "Classified CCs in "
-        		  << boost::timer::format(t.elapsed(), 5, "%w") << std::endl;
+    classify_timer.stop();
 
     std::vector<std::vector<cv::Point> > components = regions;
 
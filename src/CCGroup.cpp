@@ -21,8 +21,8 @@
 
 namespace TextDetector {
 
-CC::CC(int idx, int feature_idx, const std::vector<cv::Point> &img)
-: id(idx), feature_id(feature_idx), pixels(img)
+CC::CC(int idx, int feature_idx, const std::vector<cv::Point> &img, double p)
+: id(idx), feature_id(feature_idx), pixels(&img), prob(p)
 {
     int x_min = INT_MAX;
     int x_max = INT_MIN;
@@ -45,7 +45,7 @@ CC::CC(int idx, int feature_idx, const std::vector<cv::Point> &img)
     centroid = cv::Vec2f(float(sum_x) / img.size(), float(sum_y) / img.size());
 }
 
-bool CC::can_link(const CC &rhs) const
+bool CC::can_link(const CC &rhs, const ConfigurationManager &config) const
 {
     float dist_thresh = 2 * std::min(std::max(rect.height, rect.width), std::max(rhs.rect.height, rhs.rect.width));
 
@@ -79,8 +79,8 @@ bool CC::can_link(const CC &rhs) const
     //cv::imshow("GRP2", img2);
     //cv::waitKey(0);
 
-    return ver_overlap > ConfigurationManager::instance()->get_minimum_vertical_overlap() && 
-           height_ratio <= ConfigurationManager::instance()->get_maximum_height_ratio();
+    return ver_overlap > config.get_minimum_vertical_overlap() && 
+           height_ratio <= config.get_maximum_height_ratio();
 }
 
 float CC::distance(const CC &rhs) const
@@ -92,18 +92,27 @@ float CC::distance(const CC &rhs) const
 
 void CC::draw(cv::Mat img) const
 {
-    for (cv::Point p : pixels) {
+    for (const cv::Point &p : *pixels) {
         img.at<unsigned char>(p.y, p.x) = 255;
     }
 }
 
-float CCGroup::distance(const CCGroup &grp, const cv::Mat &distance_matrix) const
+CCGroup::CCGroup(const std::shared_ptr<const CCStore> &store, int idx)
+: ccs(1, idx), _store(store), _rect((*store)[idx].rect),
+  _bounding_box_area((*store)[idx].rect.area()), _prob_sum((*store)[idx].prob)
+{
+}
+
+float CCGroup::distance(const CCGroup &grp, const cv::Mat &distance_matrix,
+    const ConfigurationManager &config) const
 {
     float min = FLT_MAX;
     for (size_t i = 0; i < ccs.size(); i++) {
+        const CC &c_i = cc(i);
         for (size_t j = 0; j < grp.ccs.size(); j++) {
-            if (ccs[i].can_link(grp.ccs[j])) {
-                float d = distance_matrix.at<float>(ccs[i].id, grp.ccs[j].id);
+            const CC &c_j = grp.cc(j);
+            if (c_i.can_link(c_j, config)) {
+                float d = distance_matrix.at<float>(c_i.id, c_j.id);
                 min = std::min(min, d);
             }
         }
@@ -115,11 +124,11 @@ bool CCGroup::is_overlapping_component_bbx(const CCGroup &grp, float thresh) con
 {
     for (int i = 0; i < ccs.size(); i++) {
         for (int j = 0; j < grp.ccs.size(); j++) {
-            if (ccs[i].id == grp.ccs[j].id) continue;
-            cv::Rect intersect = ccs[i].rect & grp.ccs[j].rect;
-            cv::Rect u = ccs[i].rect | grp.ccs[j].rect;
-            float a1 = ccs[i].rect.width * ccs[i].rect.height;
-            float a2 = grp.ccs[j].rect.width * grp.ccs[j].rect.height;
+            if (ccs[i] == grp.ccs[j]) continue;
+            const cv::Rect &r_i = cc(i).rect;
+            const cv::Rect &r_j = grp.cc(j).rect;
+            cv::Rect intersect = r_i & r_j;
+            cv::Rect u = r_i | r_j;
             float a_intersect = intersect.width * intersect.height;
             float a_union = u.width * u.height;
             if (a_intersect / a_union > thresh) {
@@ -135,7 +144,7 @@ bool CCGroup::share_elements(const CCGroup &grp) const
     int nshared = 0;
     for (int i = 0; i < ccs.size(); i++) {
         for (int j = 0; j < grp.ccs.size(); j++) {
-            if (ccs[i].id == grp.ccs[j].id) {
+            if (ccs[i] == grp.ccs[j]) {
                 nshared++;
             }
         }
@@ -148,7 +157,7 @@ bool CCGroup::eq(const CCGroup &grp) const
     for (int i = 0; i < ccs.size(); i++) {
         bool found = false;
         for (int j = 0; j < grp.ccs.size(); j++) {
-            if (ccs[i].id == grp.ccs[j].id) {
+            if (ccs[i] == grp.ccs[j]) {
                 found = true;
                 break;
             }
@@ -167,21 +176,18 @@ bool CCGroup::can_link(const CCGroup &grp, const cv::Mat &distance_matrix) const
 
 void CCGroup::link(const CCGroup &grp)
 {
-    //ccs.reserve(ccs.size() + grp.ccs.size());
+    if (!_store) _store = grp._store;
+    ccs.reserve(ccs.size() + grp.ccs.size());
     for (size_t i = 0; i < grp.ccs.size(); i++) {
-        int id = grp.ccs[i].id;
-        if (std::find_if(ccs.begin(), ccs.end(), [id] (const CC &cc) -> bool { return cc.id == id; }) == ccs.end())
-            ccs.push_back(grp.ccs[i]);
-    }
-}
-
-float CCGroup::get_bounding_box_area() const
-{
-    float result = 0.0f;
-    for (CC c : ccs) {
-        result += c.rect.width * c.rect.height;
+        int id = grp.ccs[i];
+        if (std::find(ccs.begin(), ccs.end(), id) == ccs.end()) {
+            const CC &c = grp.cc(i);
+            _rect = ccs.empty() ? c.rect : (_rect | c.rect);
+            _bounding_box_area += c.rect.area();
+            _prob_sum += c.prob;
+            ccs.push_back(id);
+        }
     }
-    return result;
 }
 
 
@@ -189,24 +195,15 @@ float CCGroup::get_intersection_area(const CCGroup &grp) const
 {
     // intersect each own character w/ each character from grp
     float result = 0.0f;
-    for (CC c_i : ccs) {
-        for (CC c_j : grp.ccs) {
-            cv::Rect intersection = c_i.rect & c_j.rect;
+    for (size_t i = 0; i < ccs.size(); i++) {
+        for (size_t j = 0; j < grp.ccs.size(); j++) {
+            cv::Rect intersection = cc(i).rect & grp.cc(j).rect;
             result += intersection.width * intersection.height;
         }
     }
     return result;
 }
 
-cv::Rect CCGroup::get_rect() const
-{
-    cv::Rect result = ccs[0].rect;
-    for (size_t i = 1; i < ccs.size(); i++) {
-        result = result | ccs[i].rect;
-    }
-    return result;
-}
-
 bool CCGroup::is_significant_member(int idx) const
 {
     cv::Rect my_rect = get_rect();
@@ -224,10 +221,10 @@ cv::Rect CCGroup::get_rect_without_element(int leave_out) const
     int start = 0;
     if (leave_out == 0)
         start = 1;
-    cv::Rect result = ccs[start].rect;
+    cv::Rect result = cc(start).rect;
     for (size_t i = start+1; i < ccs.size(); i++) {
         if (leave_out == i) continue;
-        result = result | ccs[i].rect;
+        result = result | cc(i).rect;
     }
     return result;
 }
@@ -238,7 +235,7 @@ std::vector<size_t> CCGroup::sorted_cc_indices() const
     for (size_t i = 0; i < ccs.size(); i++) results[i] = i;
 
     std::sort(results.begin(), results.end(), [this] (size_t a, size_t b) -> bool {
-        return ccs[a].rect.x < ccs[b].rect.x;
+        return cc(a).rect.x < cc(b).rect.x;
     });
     return results;
 }
@@ -248,11 +245,7 @@ cv::Size CCGroup::group_size() const
     if (ccs.empty())
         return cv::Size(0,0);
 
-    cv::Point pt(ccs[0].rect.br());
-    for (size_t i = 1; i < ccs.size(); i++) {
-        pt.x = std::max(ccs[i].rect.br().x, pt.x);
-        pt.y = std::max(ccs[i].rect.br().y, pt.y);
-    }
+    cv::Point pt(_rect.br());
     return cv::Size(pt.x+1, pt.y+1);
 }
 
@@ -260,8 +253,8 @@ cv::Mat CCGroup::get_image() const
 {
     cv::Size size(group_size());
     cv::Mat img(size.height, size.width, CV_8UC3, cv::Scalar(255,255,255));
-    for (CC c : ccs) {
-        for (cv::Point p : c.pixels) {
+    for (size_t i = 0; i < ccs.size(); i++) {
+        for (const cv::Point &p : *cc(i).pixels) {
             img.at<cv::Vec3b>(p.y, p.x) = cv::Vec3b(0,0,0);
         }
     }
@@ -271,20 +264,11 @@ cv::Mat CCGroup::get_image() const
 cv::Mat CCGroup::get_image(const cv::Size &size) const
 {
     cv::Mat img(size.height, size.width, CV_8UC1, cv::Scalar(0));
-    for (CC c : ccs) 
-        c.draw(img); 
+    for (size_t i = 0; i < ccs.size(); i++)
+        cc(i).draw(img); 
     return img;
 }
 
-float CCGroup::calculate_probability(const std::vector<double> &probs) const
-{
-    float result = 0.0f;
-    for (CC cc : ccs) {
-        result += probs[cc.feature_id];
-    }
-    return result / ccs.size();
-}
-
 bool CCGroup::is_overlapping(const CCGroup &other_group, float thresh) const
 {
     cv::Rect my_rect = get_rect();
@@ -306,7 +290,7 @@ bool CCGroup::contains(const CCGroup &other_group) const
     for (size_t i = 0; i < other_group.ccs.size(); i++) {
         bool found = false;
         for (size_t j = 0; j < ccs.size(); j++) {
-            if (other_group.ccs[i].id == ccs[j].id) {
+            if (other_group.ccs[i] == ccs[j]) {
                 found = true;
                 break;
             }
@@ -316,16 +300,16 @@ bool CCGroup::contains(const CCGroup &other_group) const
     return true;
 }
 
-cv::Mat CCGroup::draw(const cv::Size &image_size, const std::vector<double> &probs, const cv::Mat &input, bool show) const
+cv::Mat CCGroup::draw(const cv::Size &image_size, const cv::Mat &input, bool show) const
 {
     cv::Mat result(input);
     if (result.empty()) {
         result = cv::Mat(image_size.height, image_size.width, CV_8UC3, cv::Scalar(255,255,255));
     } 
-    for (CC c : ccs) {
-        float prob = probs[c.feature_id];
-        int greenish = 255 * prob;
-        for (cv::Point px : c.pixels) {
+    for (size_t i = 0; i < ccs.size(); i++) {
+        const CC &c = cc(i);
+        int greenish = 255 * c.prob;
+        for (const cv::Point &px : *c.pixels) {
             result.at<cv::Vec3b>(px.y, px.x) = cv::Vec3b(0, greenish, 255-greenish);
         }
     }
@@ -23,6 +23,7 @@
 #include <opencv2/objdetect/objdetect.hpp>
 #include <opencv2/highgui/highgui.hpp>
 #include <text_detector/config.h>
+#include <text_detector/CpuDispatch.h>
 
 namespace TextDetector {
 
@@ -50,6 +51,24 @@ std::vector<cv::Point> load_pixels(const fs::path &path)
     return result;
 }
 
+std::vector<PixelRun> encode_pixel_runs(const std::vector<cv::Point> &pixels)
+{
+    std::vector<PixelRun> runs;
+    for (size_t i = 0; i < pixels.size(); i++) {
+        const cv::Point &p = pixels[i];
+        if (!runs.empty()) {
+            PixelRun &last = runs.back();
+            if (last.y == p.y && last.x + int32_t(last.length) == p.x) {
+                last.length++;
+                continue;
+            }
+        }
+        PixelRun run = { p.x, p.y, 1 };
+        runs.push_back(run);
+    }
+    return runs;
+}
+
 static std::vector<int>
 lookup_neighbors(
 	const std::vector<std::vector<int> > &lookup_table,
@@ -709,31 +728,36 @@ cv::Mat compute_gradient_single_chan(const cv::Mat &img)
     }
 
 
-    std::vector<float> dbuf(img.cols * 2); // dx, dy
+    // the inner pixels are computed by the kernel, the first and the last
+    // column use the border interpolation of xmap
+    const CpuKernels &kernels = get_cpu_kernels();
+    const int cn = img.channels();
     for (int i = 0; i < img.rows; i++) {
         const uchar* img_ptr  = img.data + img.step*ymap[i];
         const uchar* prev_ptr = img.data + img.step*ymap[i-1];
         const uchar* next_ptr = img.data + img.step*ymap[i+1];
         float *grad_ptr = result.ptr<float>(i);
-        if (img.channels() == 1) {
-            for (int j = 0; j < img.cols; j++) {
-                int x1 = xmap[j];
-                // dx
-                dbuf[j] = static_cast<float>(img_ptr[xmap[j+1]]) - 
-                          static_cast<float>(img_ptr[xmap[j-1]]);
-                // dy
-                dbuf[j+img.cols] =
-                    static_cast<float>(next_ptr[x1]) - 
-                    static_cast<float>(prev_ptr[x1]);
-            }
-        } else {
-            // stride of 3
-            for (int j = 0; j < img.cols; j++) {
-                int x1 = xmap[j];
+        if (img.cols > 2) {
+            if (cn == 1)
+                kernels.gradient_magnitude_c1(prev_ptr + 1, img_ptr + 1, next_ptr + 1, img.cols - 2, grad_ptr + 1);
+            else
+                kernels.gradient_magnitude_c3(prev_ptr + 3, img_ptr + 3, next_ptr + 3, img.cols - 2, grad_ptr + 1);
+        }
+
+        for (int j = 0; j < img.cols; j += std::max(1, img.cols - 1)) {
+            int x1 = xmap[j];
+            float dx0, dy0;
+            if (cn == 1) {
+                dx0 = static_cast<float>(img_ptr[xmap[j+1]]) - 
+                      static_cast<float>(img_ptr[xmap[j-1]]);
+                dy0 = static_cast<float>(next_ptr[x1]) - 
+                      static_cast<float>(prev_ptr[x1]);
+            } else {
+                // stride of 3
                 const uchar *p2 = img_ptr + xmap[j+1];
                 const uchar *p0 = img_ptr + xmap[j-1];
 
-                float dx0, dy0, dx, dy, mag0, mag;
+                float dx, dy, mag0, mag;
 
                 dx0 = p2[2] - p0[2];
                 dy0 = next_ptr[x1+2] - prev_ptr[x1+2];
@@ -756,15 +780,8 @@ cv::Mat compute_gradient_single_chan(const cv::Mat &img)
                     dx0 = dx;
                     dy0 = dy;
                 }
-
-                dbuf[j] = dx0;
-                dbuf[j + img.cols] = dy0;
             }
-        }
-
-        for (int j = 0; j < img.cols; j++) {
-            *grad_ptr = std::sqrt(dbuf[j]*dbuf[j] + dbuf[j+img.cols] * dbuf[j+img.cols]);
-            ++grad_ptr;
+            grad_ptr[j] = std::sqrt(dx0*dx0 + dy0*dy0);
         }
     }
 
@@ -793,6 +810,48 @@ void MserElement::draw(cv::Mat &img, const cv::Vec3b &color)
     }
 }
 
+std::vector<float> MserElement::get_raw_features() const
+{
+    float values[] = {
+        _aspect, _area_ratio, _gradient, _compactness, _ellipse_compactness,
+        _bb_compactness, _euler, _hull_ratio, _crossings_top, 
+        _crossings_middle, _crossings_bottom, _swt_stddev, _swt_mean,
+        _hull_perimeter_ratio, _ellipse_area_ratio, _ellipse_ratio,
+        _hole_area_ratio,
+        _ellipse.center.x, _ellipse.center.y, 
+        _ellipse.size.width, _ellipse.size.height, _ellipse.angle
+    };
+    return std::vector<float>(values, values + sizeof(values) / sizeof(float));
+}
+
+bool MserElement::set_raw_features(const std::vector<float> &f)
+{
+    if (f.size() != 22)
+        return false;
+    int i = 0;
+    _aspect = f[i++];
+    _area_ratio = f[i++];
+    _gradient = f[i++];
+    _compactness = f[i++];
+    _ellipse_compactness = f[i++];
+    _bb_compactness = f[i++];
+    _euler = f[i++];
+    _hull_ratio = f[i++];
+    _crossings_top = f[i++];
+    _crossings_middle = f[i++];
+    _crossings_bottom = f[i++];
+    _swt_stddev = f[i++];
+    _swt_mean = f[i++];
+    _hull_perimeter_ratio = f[i++];
+    _ellipse_area_ratio = f[i++];
+    _ellipse_ratio = f[i++];
+    _hole_area_ratio = f[i++];
+    _ellipse.center = cv::Point2f(f[i], f[i+1]);
+    _ellipse.size = cv::Size2f(f[i+2], f[i+3]);
+    _ellipse.angle = f[i+4];
+    return true;
+}
+
 cv::Mat MserElement::get_unary_features() const 
 {
     cv::Mat result(1, N_UNARY_FEATURES, CV_32FC1);
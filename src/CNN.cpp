@@ -17,13 +17,13 @@
  */
 #include <text_detector/CNN.h>
 #include <text_detector/cnpy.h>
+#include <text_detector/CpuDispatch.h>
 
 #include <iostream>
 #include <cstring>
 #include <opencv2/ml/ml.hpp>
 #include <opencv2/highgui/highgui.hpp>
 
-//#include <xmmintrin.h>
 namespace TextDetector {
 
 ConvLayer::ConvLayer(const cv::MatND &weights, const cv::MatND &biases, int pad, int pool_size, int pool_stride)
@@ -37,14 +37,14 @@ ConvLayer::~ConvLayer() {}
  * and stores the result in result at position (row, col, output_feature_map)
  */
 static inline void
-do_conv_mult(const cv::MatND &input, const cv::MatND &kernel, cv::MatND &result, int row, int col, int image_stack, int nfeature_maps, int pad)
+do_conv_mult(const CpuKernels &kernels, const cv::MatND &input, const cv::MatND &kernel, cv::MatND &result, int row, int col, int image_stack, int nfeature_maps, int pad)
 {
     const int kernel_half_h = kernel.size[1]/2;
     const int kernel_half_w = kernel.size[2]/2;
 
     const float *kernel_ptr = (const float*)kernel.data;
     const float *image_ptr = (const float*) input.data;
-    float *result_ptr = (float *)result.data;
+    float *result_ptr = (float *)result.data + (row - kernel_half_h) * result.step[0] / 4 + (col - kernel_half_w) * result.step[1]/4;
 
     for (int i = -kernel_half_h; i <= kernel_half_h; i++) {
         const int y = row + i - pad;
@@ -53,23 +53,12 @@ do_conv_mult(const cv::MatND &input, const cv::MatND &kernel, cv::MatND &result,
             const float image_value = (y >= 0 && y < input.size[0] && x >= 0 && x < input.size[1]) ? 
                 *(image_ptr + input.step[0]/4 * y + input.step[1]/4 * x + image_stack) :
                 0.0f;
-            //for (int output_feature_map = 0; output_feature_map < nfeature_maps; output_feature_map++) {
-            //const __m128 scalar = _mm_set1_ps(image_value);
-            for (int output_feature_map = 0; output_feature_map < nfeature_maps; output_feature_map++) {
-                //int kernel_idx[] = {image_stack, i+kernel_half_h, j+kernel_half_w, output_feature_map};
-                //const float image_value = input.at<float>(row+i, col+j, image_stack);
-                //const float kernel_value = kernel.at<float>(kernel_idx);
-                //result.at<float>(row - kernel_half_h, col - kernel_half_w, output_feature_map) += image_value * kernel_value;
-                //__m128 kernvals = _mm_load_ps(kernel_ptr + kernel.step[0]/4 * image_stack + kernel.step[1]/4 * (i+kernel_half_h) + kernel.step[2]/4 * (j+kernel_half_w) +  output_feature_map);
-                //__m128 resultvals = _mm_load_ps(result_ptr + (row - kernel_half_h) * result.step[0] / 4 + (col - kernel_half_w) * result.step[1]/4 + output_feature_map);
-
-                //kernvals = _mm_mul_ps(kernvals, scalar);
-                //resultvals = _mm_add_ps(resultvals, kernvals);
-                //_mm_store_ps(result_ptr + (row - kernel_half_h) * result.step[0] / 4 + (col - kernel_half_w) * result.step[1]/4 + output_feature_map, resultvals);
-
-                const float kernel_value = *(kernel_ptr + kernel.step[0]/4 * image_stack + kernel.step[1]/4 * (i+kernel_half_h) + kernel.step[2]/4 * (j+kernel_half_w) +  output_feature_map);
-                *(result_ptr + (row - kernel_half_h) * result.step[0] / 4 + (col - kernel_half_w) * result.step[1]/4 + output_feature_map) += image_value * kernel_value;
-            }
+            // result(row, col, :) += image_value * kernel(image_stack, i, j, :)
+            kernels.axpy(
+                image_value,
+                kernel_ptr + kernel.step[0]/4 * image_stack + kernel.step[1]/4 * (i+kernel_half_h) + kernel.step[2]/4 * (j+kernel_half_w),
+                result_ptr,
+                nfeature_maps);
         }
     }
 }
@@ -85,6 +74,7 @@ cv::MatND ConvLayer::fprop(const cv::MatND &input) const
     const int image_max_w = input.size[1] + 2*_pad - _weights.size[2]/2;
     const int n_stacks = (input.dims > 2 ? input.size[2] : 1);
     // weights have shape (image, kernel-rows, kernel-cols, output-feature-maps)
+    const CpuKernels &kernels = get_cpu_kernels();
     int sizes[] = { input.size[0] - _weights.size[1] + 1 + 2*_pad, input.size[1] - _weights.size[2] + 1 + 2*_pad, _weights.size[3] };
     cv::MatND result(3, sizes, CV_32FC1, cv::Scalar(0.0f));
     // each of our results consists of several convolutions from the inputs
@@ -100,7 +90,7 @@ cv::MatND ConvLayer::fprop(const cv::MatND &input) const
                 if (col < 0) continue;
                 // foreach stack
                 for (int stack = 0; stack < n_stacks; stack++) {
-                    do_conv_mult(input, _weights, result, row, col, stack, result.size[2], _pad);
+                    do_conv_mult(kernels, input, _weights, result, row, col, stack, result.size[2], _pad);
                 }
             }
         }
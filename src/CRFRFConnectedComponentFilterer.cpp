@@ -18,8 +18,8 @@
 #include <text_detector/CRFRFConnectedComponentFilterer.h>
 
 #include <text_detector/ConfigurationManager.h>
+#include <text_detector/Instrumentation.h>
 #include <numeric>
-#include <boost/timer/timer.hpp>
 
 namespace TextDetector {
 
@@ -51,8 +51,7 @@ CRFRFConnectedComponentFilterer::filter_compontents(
 
     // set the data for each node
 
-    boost::timer::cpu_timer t;
-    t.start();
+    ScopedStageTimer unary_timer("crf_unary");
     for (size_t i = 0; i < comps.size(); i++) {
         node_vector_type data;
         data(0,0) = 1; // bias
@@ -62,12 +61,11 @@ CRFRFConnectedComponentFilterer::filter_compontents(
         graph.node(i).data = data;
     }
 
-    if (ConfigurationManager::instance()->verbose())
-        std::cout << "Finished unary features: " << boost::timer::format(t.elapsed(), 5, "%w") << std::endl;
+    unary_timer.stop();
 
     // dists is an adjacency list where the first element in the pair is the distance to element and the 
     // second element in the pair is the index of the mser-element
-    t.start();
+    ScopedStageTimer distance_timer("crf_pairwise_distances");
     std::vector<std::vector<std::pair<float, int> > > dists;
     dists.resize(comps.size());
 
@@ -96,9 +94,9 @@ CRFRFConnectedComponentFilterer::filter_compontents(
         });
     }
 
-    if (ConfigurationManager::instance()->verbose())
-        std::cout << "Finished pairwise distances in " << boost::timer::format(t.elapsed(), 5, "%w") << std::endl;
-    t.start();
+    distance_timer.stop();
+
+    ScopedStageTimer pairwise_timer("crf_pairwise_features");
 
     // an adjacency matrix
     cv::Mat adj(comps.size(), comps.size(), CV_8UC1, cv::Scalar(0));
@@ -174,17 +172,15 @@ CRFRFConnectedComponentFilterer::filter_compontents(
             dlib::edge(graph, idx_i, idx_j) = data;
         }
     }
-    if (ConfigurationManager::instance()->verbose())
-        std::cout << "Finished pairwise features in " << boost::timer::format(t.elapsed(), 5, "%w") << std::endl;
+    pairwise_timer.stop();
 
     adj.release();
     probs.release();
     dists.clear();
     // inference!
+    ScopedStageTimer inference_timer("crf_inference");
     std::vector<bool> labels = _labeler(graph);
-
-    if (ConfigurationManager::instance()->verbose())
-        std::cout << "Finished inference" << std::endl;
+    inference_timer.stop();
 
     std::vector<std::pair<int, std::vector<cv::Point> > > result; 
     result.reserve(comps.size());
@@ -192,6 +188,7 @@ CRFRFConnectedComponentFilterer::filter_compontents(
         if (labels[i])
             result.push_back(comps[i]);
     }
+    set_stat("crf_components", result.size());
 
     return result;
 }
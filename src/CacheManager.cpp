@@ -16,102 +16,550 @@
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include <text_detector/CacheManager.h>
+#include <text_detector/CCUtils.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <fstream>
+#include <stdexcept>
 #include <boost/filesystem.hpp>
-#include <boost/archive/text_iarchive.hpp>
-#include <boost/archive/text_oarchive.hpp>
-#include <boost/serialization/base_object.hpp>
-#include <boost/serialization/utility.hpp>
-#include <boost/serialization/list.hpp>
-#include <boost/serialization/vector.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
 namespace fs = boost::filesystem;
+namespace ipc = boost::interprocess;
 
+/*
+ *  Layout of a cache file (all values in host byte order):
+ *
+ *  CacheHeader
+ *  n_probs    x (uint32 count, double[prob_width])       probability records
+ *  n_features x (uint32 count, float[feature_width])     feature records
+ *  n_mser_sets x MserSetRecord                           one set per channel
+ *  MserIndexRecord for every MSER of every set
+ *  PixelRun data of all MSERs
+ *
+ *  A record with count 0 is an empty entry. The pixels of an MSER are 
+ *  stored as runs of horizontally adjacent points in their original order.
+ */
+namespace {
 
-std::shared_ptr<CacheManager> CacheManager::_instance;
-CacheManager::CacheManager(const std::string &dirname)
-: _dirname(dirname)
-{}
+const char CACHE_MAGIC[8] = { 'L', 'T', 'P', 'C', 'A', 'C', 'H', 'E' };
+const uint32_t CACHE_VERSION = 1;
 
-void CacheManager::load_image(const std::string &image_name)
+struct CacheHeader
 {
-    fs::path p(_dirname);
-    p += "/";
-    p += image_name;
-    p += ".txt";
+    char magic[8];
+    uint32_t version;
+    uint32_t n_probs;
+    uint32_t prob_width;
+    uint32_t n_features;
+    uint32_t feature_width;
+    uint32_t n_mser_sets;
+    uint64_t prob_offset;
+    uint64_t feature_offset;
+    uint64_t mser_set_offset;
+};
 
-    _cache.clear();
-    _feature_cache.clear();
-    _msers.clear();
-    _hierarchy.clear();
-    _uid_offsets.clear();
+struct MserSetRecord
+{
+    int32_t uid_offset;
+    uint32_t n_msers;
+    //! Offset of the first MserIndexRecord of the set
+    uint64_t index_offset;
+};
+
+struct MserIndexRecord
+{
+    //! Offset of the first PixelRun of the MSER
+    uint64_t data_offset;
+    uint32_t n_points;
+    uint32_t n_runs;
+    int32_t hierarchy[4];
+};
 
-    if (!fs::exists(p.generic_string())) return;
+using TextDetector::PixelRun;
 
-    std::ifstream ifs(p.generic_string());
-    boost::archive::text_iarchive ia(ifs);
-    ia & _cache;
-    ia & _feature_cache;
-    ia & _msers;
-    ia & _hierarchy;
-    ia & _uid_offsets;
+//! Returns true if the entry was set and is not only in the mapped file
+template <class T>
+bool has_new_entry(const std::vector<std::vector<T> > &entries, int i)
+{
+    return i >= 0 && size_t(i) < entries.size() && !entries[i].empty();
+}
+
+template <class T>
+void write_value(std::ofstream &ofs, const T &value)
+{
+    ofs.write(reinterpret_cast<const char *>(&value), sizeof(T));
 }
 
-void CacheManager::save_image(const std::string &image_name)
+}
+
+/**
+ *  A read-only mapping of a cache file. All reads are bounds checked.
+ */
+struct CacheFile::MappedFile
+{
+    MappedFile(const std::string &filename)
+    : mapping(filename.c_str(), ipc::read_only),
+      region(mapping, ipc::read_only),
+      data(static_cast<const char *>(region.get_address())),
+      size(region.get_size())
+    {
+        header = read<CacheHeader>(0);
+        if (std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 ||
+            header.version != CACHE_VERSION)
+            throw std::runtime_error("Invalid cache file " + filename);
+        check(header.prob_offset, uint64_t(header.n_probs) * prob_record_size());
+        check(header.feature_offset, uint64_t(header.n_features) * feature_record_size());
+        check(header.mser_set_offset, uint64_t(header.n_mser_sets) * sizeof(MserSetRecord));
+    }
+
+    void check(uint64_t offset, uint64_t length) const
+    {
+        if (offset > size || length > size - offset)
+            throw std::runtime_error("Truncated cache file");
+    }
+
+    template <class T>
+    T read(uint64_t offset) const
+    {
+        check(offset, sizeof(T));
+        T value;
+        std::memcpy(&value, data + offset, sizeof(T));
+        return value;
+    }
+
+    uint64_t prob_record_size() const 
+    { 
+        return sizeof(uint32_t) + uint64_t(header.prob_width) * sizeof(double); 
+    }
+    uint64_t feature_record_size() const 
+    { 
+        return sizeof(uint32_t) + uint64_t(header.feature_width) * sizeof(float); 
+    }
+
+    //! Returns the number of values of the record at offset (0 if empty)
+    template <class T>
+    uint32_t record_count(uint64_t offset, uint32_t width) const
+    {
+        uint32_t count = read<uint32_t>(offset);
+        if (count > width)
+            throw std::runtime_error("Corrupt cache record");
+        return count;
+    }
+
+    template <class T>
+    std::vector<T> read_record(uint64_t offset, uint32_t width) const
+    {
+        std::vector<T> values(record_count<T>(offset, width));
+        if (!values.empty()) {
+            check(offset + sizeof(uint32_t), values.size() * sizeof(T));
+            std::memcpy(&values[0], data + offset + sizeof(uint32_t), values.size() * sizeof(T));
+        }
+        return values;
+    }
+
+    bool has_prob(int i) const
+    {
+        return i >= 0 && uint32_t(i) < header.n_probs &&
+            record_count<double>(header.prob_offset + i * prob_record_size(), header.prob_width) > 0;
+    }
+    bool has_feature(int i) const
+    {
+        return i >= 0 && uint32_t(i) < header.n_features &&
+            record_count<float>(header.feature_offset + i * feature_record_size(), header.feature_width) > 0;
+    }
+    std::vector<double> prob(int i) const
+    {
+        if (!has_prob(i)) throw std::out_of_range("No cache entry");
+        return read_record<double>(header.prob_offset + i * prob_record_size(), header.prob_width);
+    }
+    std::vector<float> feature(int i) const
+    {
+        if (!has_feature(i)) throw std::out_of_range("No cache entry");
+        return read_record<float>(header.feature_offset + i * feature_record_size(), header.feature_width);
+    }
+
+    MserSetRecord mser_set(uint32_t i) const
+    {
+        return read<MserSetRecord>(header.mser_set_offset + i * sizeof(MserSetRecord));
+    }
+
+    //! Returns the index of the set with the uid offset or -1
+    int find_mser_set(int uid_offset) const
+    {
+        for (uint32_t i = 0; i < header.n_mser_sets; i++) {
+            if (mser_set(i).uid_offset == uid_offset) return i;
+        }
+        return -1;
+    }
+
+    //! Decodes the MSERs of a set
+    void read_msers(uint32_t set, 
+        std::vector<std::vector<cv::Point> > &msers,
+        std::vector<cv::Vec4i> &hierarchy) const
+    {
+        MserSetRecord s = mser_set(set);
+        check(s.index_offset, uint64_t(s.n_msers) * sizeof(MserIndexRecord));
+        msers.assign(s.n_msers, std::vector<cv::Point>());
+        hierarchy.resize(s.n_msers);
+        for (uint32_t i = 0; i < s.n_msers; i++) {
+            MserIndexRecord r = read<MserIndexRecord>(s.index_offset + i * sizeof(MserIndexRecord));
+            hierarchy[i] = cv::Vec4i(r.hierarchy[0], r.hierarchy[1], r.hierarchy[2], r.hierarchy[3]);
+            check(r.data_offset, uint64_t(r.n_runs) * sizeof(PixelRun));
+            std::vector<cv::Point> &pixels = msers[i];
+            pixels.reserve(r.n_points);
+            for (uint32_t j = 0; j < r.n_runs; j++) {
+                PixelRun run = read<PixelRun>(r.data_offset + j * sizeof(PixelRun));
+                if (pixels.size() + run.length > r.n_points)
+                    throw std::runtime_error("Corrupt cache record");
+                for (uint32_t k = 0; k < run.length; k++) {
+                    pixels.push_back(cv::Point(run.x + k, run.y));
+                }
+            }
+        }
+    }
+
+    ipc::file_mapping mapping;
+    ipc::mapped_region region;
+    const char *data;
+    uint64_t size;
+    CacheHeader header;
+};
+
+CacheKey &CacheKey::add(const void *data, size_t size)
 {
-    fs::path p(_dirname);
-    p += "/";
-    p += image_name;
-    p += ".txt";
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; i++) {
+        _hash ^= bytes[i];
+        _hash *= 1099511628211ULL;
+    }
+    return *this;
+}
 
-    std::ofstream ofs(p.generic_string());
-    boost::archive::text_oarchive oa(ofs);
-    oa & _cache;
-    oa & _feature_cache;
-    oa & _msers;
-    oa & _hierarchy;
-    oa & _uid_offsets;
+CacheKey &CacheKey::add(const std::string &s)
+{
+    add(int64_t(s.size()));
+    return add(s.data(), s.size());
+}
 
+CacheKey &CacheKey::add(const cv::Mat &m)
+{
+    add(int64_t(m.type()));
+    add(int64_t(m.rows));
+    add(int64_t(m.cols));
+    size_t row_size = m.cols * m.elemSize();
+    for (int y = 0; y < m.rows; y++) {
+        add(m.ptr(y), row_size);
+    }
+    return *this;
+}
+
+CacheKey &CacheKey::add_file(const std::string &path)
+{
+    add(path);
+    if (fs::is_directory(path)) {
+        std::vector<std::string> files;
+        for (fs::recursive_directory_iterator it(path), end; it != end; ++it) {
+            if (fs::is_regular_file(it->path()))
+                files.push_back(it->path().generic_string());
+        }
+        std::sort(files.begin(), files.end());
+        for (size_t i = 0; i < files.size(); i++) {
+            add_file(files[i]);
+        }
+        return *this;
+    }
+    std::ifstream ifs(path.c_str(), std::ios::binary);
+    char buffer[1 << 16];
+    while (ifs) {
+        ifs.read(buffer, sizeof(buffer));
+        add(buffer, ifs.gcount());
+    }
+    return *this;
+}
+
+std::string CacheKey::str() const
+{
+    static const char digits[] = "0123456789abcdef";
+    std::string s(16, '0');
+    for (int i = 0; i < 16; i++) {
+        s[15 - i] = digits[(_hash >> (4 * i)) & 0xf];
+    }
+    return s;
+}
+
+CacheFile::CacheFile(const std::string &filename)
+: _filename(filename), _modified(false)
+{
+    if (fs::exists(filename) && fs::file_size(filename) > 0) {
+        try {
+            _mapped.reset(new MappedFile(filename));
+        } catch (const std::exception &e) {
+            // a truncated or corrupt file is a miss, the entries are 
+            // recomputed and the file is replaced by save()
+            std::cerr << "Warning: ignoring cache file " << filename << ": " << e.what() << std::endl;
+            boost::system::error_code ec;
+            fs::remove(filename, ec);
+        }
+    }
+}
+
+CacheFile::~CacheFile()
+{}
+
+void CacheFile::save()
+{
+    if (!_modified)
+        return;
+
+    fs::path p(_filename);
+    fs::path tmp(p);
+    tmp += "." + fs::unique_path().generic_string() + ".tmp";
+    try {
+        fs::create_directories(p.parent_path());
+    } catch (const fs::filesystem_error &) {
+        // another thread might have created it concurrently
+        if (!fs::is_directory(p.parent_path()))
+            throw;
+    }
+
+    // merge the mapped and the new entries
+    uint32_t n_probs = _cache.size();
+    uint32_t n_features = _feature_cache.size();
+    if (_mapped) {
+        n_probs = std::max(n_probs, _mapped->header.n_probs);
+        n_features = std::max(n_features, _mapped->header.n_features);
+    }
+    std::vector<std::vector<double> > probs(n_probs);
+    uint32_t prob_width = 0;
+    for (uint32_t i = 0; i < n_probs; i++) {
+        if (has_entry(i)) probs[i] = query(i);
+        prob_width = std::max(prob_width, uint32_t(probs[i].size()));
+    }
+    std::vector<std::vector<float> > features(n_features);
+    uint32_t feature_width = 0;
+    for (uint32_t i = 0; i < n_features; i++) {
+        if (has_feature_entry(i)) features[i] = query_feature(i);
+        feature_width = std::max(feature_width, uint32_t(features[i].size()));
+    }
+
+    std::vector<int> uid_offsets(_uid_offsets);
+    std::vector<std::vector<std::vector<cv::Point> > > msers(_msers);
+    std::vector<std::vector<cv::Vec4i> > hierarchies(_hierarchy);
+    if (_mapped) {
+        for (uint32_t i = 0; i < _mapped->header.n_mser_sets; i++) {
+            MserSetRecord s = _mapped->mser_set(i);
+            if (std::find(uid_offsets.begin(), uid_offsets.end(), s.uid_offset) != uid_offsets.end())
+                continue;
+            std::vector<std::vector<cv::Point> > set_msers;
+            std::vector<cv::Vec4i> set_hierarchy;
+            try {
+                _mapped->read_msers(i, set_msers, set_hierarchy);
+            } catch (const std::exception &) {
+                // corrupt sets are dropped
+                continue;
+            }
+            uid_offsets.push_back(s.uid_offset);
+            msers.push_back(set_msers);
+            hierarchies.push_back(set_hierarchy);
+        }
+    }
+
+    CacheHeader header;
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.n_probs = n_probs;
+    header.prob_width = prob_width;
+    header.n_features = n_features;
+    header.feature_width = feature_width;
+    header.n_mser_sets = uid_offsets.size();
+    header.prob_offset = sizeof(CacheHeader);
+    header.feature_offset = header.prob_offset + 
+        uint64_t(n_probs) * (sizeof(uint32_t) + uint64_t(prob_width) * sizeof(double));
+    header.mser_set_offset = header.feature_offset + 
+        uint64_t(n_features) * (sizeof(uint32_t) + uint64_t(feature_width) * sizeof(float));
+
+    std::vector<std::vector<std::vector<PixelRun> > > runs(msers.size());
+    uint64_t index_offset = header.mser_set_offset + uid_offsets.size() * sizeof(MserSetRecord);
+    uint64_t data_offset = index_offset;
+    for (size_t s = 0; s < msers.size(); s++) {
+        data_offset += msers[s].size() * sizeof(MserIndexRecord);
+        runs[s].resize(msers[s].size());
+        for (size_t i = 0; i < msers[s].size(); i++) {
+            runs[s][i] = TextDetector::encode_pixel_runs(msers[s][i]);
+        }
+    }
+
+    std::ofstream ofs(tmp.generic_string().c_str(), std::ios::binary);
+    if (!ofs)
+        throw std::runtime_error("Could not write cache " + tmp.generic_string());
+    write_value(ofs, header);
+    for (uint32_t i = 0; i < n_probs; i++) {
+        write_value(ofs, uint32_t(probs[i].size()));
+        probs[i].resize(prob_width, 0.0);
+        if (prob_width)
+            ofs.write(reinterpret_cast<const char *>(&probs[i][0]), prob_width * sizeof(double));
+    }
+    for (uint32_t i = 0; i < n_features; i++) {
+        write_value(ofs, uint32_t(features[i].size()));
+        features[i].resize(feature_width, 0.0f);
+        if (feature_width)
+            ofs.write(reinterpret_cast<const char *>(&features[i][0]), feature_width * sizeof(float));
+    }
+    for (size_t s = 0; s < msers.size(); s++) {
+        MserSetRecord record = { uid_offsets[s], uint32_t(msers[s].size()), index_offset };
+        write_value(ofs, record);
+        index_offset += msers[s].size() * sizeof(MserIndexRecord);
+    }
+    for (size_t s = 0; s < msers.size(); s++) {
+        for (size_t i = 0; i < msers[s].size(); i++) {
+            const cv::Vec4i h = i < hierarchies[s].size() ? hierarchies[s][i] : cv::Vec4i(-1, -1, -1, -1);
+            MserIndexRecord record = { data_offset, uint32_t(msers[s][i].size()), 
+                uint32_t(runs[s][i].size()), { h[0], h[1], h[2], h[3] } };
+            write_value(ofs, record);
+            data_offset += runs[s][i].size() * sizeof(PixelRun);
+        }
+    }
+    for (size_t s = 0; s < msers.size(); s++) {
+        for (size_t i = 0; i < msers[s].size(); i++) {
+            if (!runs[s][i].empty())
+                ofs.write(reinterpret_cast<const char *>(&runs[s][i][0]), 
+                    runs[s][i].size() * sizeof(PixelRun));
+        }
+    }
+    ofs.close();
+    if (!ofs)
+        throw std::runtime_error("Could not write cache " + tmp.generic_string());
+
+    // the old mapping has to be released before the file is replaced
+    _mapped.reset();
     _cache.clear();
     _feature_cache.clear();
     _msers.clear();
     _hierarchy.clear();
     _uid_offsets.clear();
+    _modified = false;
+    fs::rename(tmp, p);
+    _mapped.reset(new MappedFile(_filename));
 }
 
-bool CacheManager::has_entry(int i) const { 
-    return _cache.size() > i && !_cache[i].empty(); 
+bool CacheFile::has_entry(int i) const { 
+    if (has_new_entry(_cache, i))
+        return true;
+    try {
+        return _mapped && _mapped->has_prob(i);
+    } catch (const std::exception &e) {
+        std::cerr << "Warning: ignoring cache entry of " << _filename << ": " << e.what() << std::endl;
+        return false;
+    }
 }
 
-std::vector<double> CacheManager::query(int cc_id) const
+std::vector<double> CacheFile::query(int cc_id) const
 {
-    return _cache.at(cc_id);
+    if (has_new_entry(_cache, cc_id))
+        return _cache[cc_id];
+    if (!_mapped)
+        return _cache.at(cc_id);
+    return _mapped->prob(cc_id);
 }
 
-std::vector<float> CacheManager::query_feature(int cc_id) const
+std::vector<float> CacheFile::query_feature(int cc_id) const
 {
-    return _feature_cache.at(cc_id);
+    if (has_new_entry(_feature_cache, cc_id))
+        return _feature_cache[cc_id];
+    if (!_mapped)
+        return _feature_cache.at(cc_id);
+    return _mapped->feature(cc_id);
 }
 
-void CacheManager::set(int cc_id, const std::vector<double> &v)
+void CacheFile::set(int cc_id, const std::vector<double> &v)
 {
     if (_cache.size() <= cc_id) {
         _cache.resize((cc_id+1) * 2);
     }
     _cache[cc_id] = v;
+    _modified = true;
 }
 
-void CacheManager::set_feature(int cc_id, const std::vector<float> &f)
+void CacheFile::set_feature(int cc_id, const std::vector<float> &f)
 {
     if (_feature_cache.size() <= cc_id) {
         _feature_cache.resize((cc_id+1)*2);
     }
     _feature_cache[cc_id] = f;
+    _modified = true;
+}
+
+bool CacheFile::has_feature_entry(int cc_id) const
+{
+    if (has_new_entry(_feature_cache, cc_id))
+        return true;
+    try {
+        return _mapped && _mapped->has_feature(cc_id);
+    } catch (const std::exception &e) {
+        std::cerr << "Warning: ignoring cache entry of " << _filename << ": " << e.what() << std::endl;
+        return false;
+    }
 }
 
-bool CacheManager::has_feature_entry(int cc_id) const
+void CacheFile::set_msers(
+    const std::vector<std::vector<cv::Point> > &msers, 
+    const std::vector<cv::Vec4i> &hierarchy, 
+    int uid_offset) 
 {
-    return _feature_cache.size() > cc_id && !_feature_cache[cc_id].empty();
+    auto it = std::find(_uid_offsets.begin(), _uid_offsets.end(), uid_offset);
+    if (it == _uid_offsets.end()) {
+        _uid_offsets.push_back(uid_offset);
+        _msers.push_back(msers);
+        _hierarchy.push_back(hierarchy);
+    } else {
+        int idx = std::distance(_uid_offsets.begin(), it);
+        _msers[idx] = msers;
+        _hierarchy[idx] = hierarchy;
+    }
+    _modified = true;
+}
+
+bool CacheFile::get_msers(
+    std::vector<std::vector<cv::Point> > &msers, 
+    std::vector<cv::Vec4i> &hierarchy, 
+    int uid_offset) const
+{
+    auto it = std::find(_uid_offsets.begin(), _uid_offsets.end(), uid_offset);
+    if (it != _uid_offsets.end()) {
+        int idx = std::distance(_uid_offsets.begin(), it);
+        msers = _msers[idx];
+        hierarchy = _hierarchy[idx];
+        return true;
+    }
+    if (!_mapped)
+        return false;
+    try {
+        int set = _mapped->find_mser_set(uid_offset);
+        if (set < 0)
+            return false;
+        _mapped->read_msers(set, msers, hierarchy);
+    } catch (const std::exception &e) {
+        std::cerr << "Warning: ignoring cache entry of " << _filename << ": " << e.what() << std::endl;
+        msers.clear();
+        hierarchy.clear();
+        return false;
+    }
+    return true;
 }
 
 
+CacheManager::CacheManager(const std::string &dirname)
+: _dirname(dirname)
+{}
+
+std::shared_ptr<CacheFile> CacheManager::open(const std::string &stage, const CacheKey &key) const
+{
+    std::string name = key.str();
+    fs::path dir(_dirname);
+    dir /= stage;
+    dir /= name.substr(0, 2);
+    return std::make_shared<CacheFile>((dir / (name + ".cache")).generic_string());
+}
@@ -0,0 +1,122 @@
+/**
+ *  This file is part of ltp-text-detector.
+ *  Copyright (C) 2013 Michael Opitz
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <text_detector/ComponentDeduplicator.h>
+
+#include <cassert>
+
+namespace TextDetector {
+
+size_t ComponentSignatureHash::operator()(const ComponentSignature &s) const
+{
+    size_t h = 0;
+    int values[] = { s.x0, s.y0, s.x1, s.y1, s.fill, s.pattern };
+    for (size_t i = 0; i < sizeof(values) / sizeof(int); i++) {
+        h = h * 1000003u ^ size_t(values[i]);
+    }
+    return h;
+}
+
+ComponentSignature ComponentDeduplicator::signature(const std::vector<cv::Point> &pixels, const cv::Rect &rect)
+{
+    ComponentSignature s;
+    s.x0 = rect.x / 2;
+    s.y0 = rect.y / 2;
+    s.x1 = (rect.x + rect.width) / 2;
+    s.y1 = (rect.y + rect.height) / 2;
+    s.fill = 0;
+    s.pattern = 0;
+    if (rect.width <= 0 || rect.height <= 0)
+        return s;
+    s.fill = (8 * pixels.size()) / (rect.width * rect.height);
+
+    // a cell of the 4x4 pattern is set if more than half of it is covered
+    int counts[16] = { 0 };
+    for (size_t i = 0; i < pixels.size(); i++) {
+        int cx = (pixels[i].x - rect.x) * 4 / rect.width;
+        int cy = (pixels[i].y - rect.y) * 4 / rect.height;
+        counts[cy * 4 + cx]++;
+    }
+    for (int cy = 0; cy < 4; cy++) {
+        int cell_height = ((cy + 1) * rect.height + 3) / 4 - (cy * rect.height + 3) / 4;
+        for (int cx = 0; cx < 4; cx++) {
+            int cell_width = ((cx + 1) * rect.width + 3) / 4 - (cx * rect.width + 3) / 4;
+            if (2 * counts[cy * 4 + cx] > cell_width * cell_height)
+                s.pattern |= 1 << (cy * 4 + cx);
+        }
+    }
+    return s;
+}
+
+std::vector<int> ComponentDeduplicator::assign(
+    const std::vector<std::vector<cv::Point> > &pixels,
+    const std::vector<MserElement> &elements,
+    const std::vector<int> &trees,
+    const std::vector<char> &valid,
+    int uid_offset)
+{
+    assert(pixels.size() == elements.size());
+    assert(elements.size() == trees.size() && elements.size() == valid.size());
+
+    std::vector<ComponentSignature> signatures(elements.size());
+    #pragma omp parallel for
+    for (int i = 0; i < int(elements.size()); i++) {
+        if (valid[i])
+            signatures[i] = signature(pixels[i], elements[i].get_bounding_rect());
+    }
+
+    // sequential, so the first component of a signature is the representative
+    std::vector<int> representatives(elements.size(), -1);
+    for (size_t i = 0; i < elements.size(); i++) {
+        if (!valid[i])
+            continue;
+        int uid = uid_offset + i;
+        int tree = uid_offset + trees[i];
+        auto it = _representatives.find(signatures[i]);
+        if (it == _representatives.end()) {
+            Representative r = { uid, tree };
+            _representatives.insert(std::make_pair(signatures[i], r));
+            _results[uid];
+        } else if (it->second.tree != tree) {
+            representatives[i] = it->second.uid;
+            _duplicates[uid] = it->second.uid;
+        }
+    }
+    return representatives;
+}
+
+void ComponentDeduplicator::set_result(int uid, const MserElement &el, double prob,
+    const std::vector<double> &per_classifier_probs)
+{
+    auto it = _results.find(uid);
+    if (it == _results.end())
+        return;
+    it->second.features = el.get_raw_features();
+    it->second.prob = prob;
+    it->second.per_classifier_probs = per_classifier_probs;
+}
+
+void ComponentDeduplicator::get_result(int representative, MserElement &el, double &prob,
+    std::vector<double> &per_classifier_probs) const
+{
+    const Result &r = _results.at(representative);
+    el.set_raw_features(r.features);
+    prob = r.prob;
+    per_classifier_probs = r.per_classifier_probs;
+}
+
+}
@@ -20,7 +20,6 @@
 #include <opencv2/ml/ml.hpp>
 
 namespace TextDetector {
-std::shared_ptr<ConfigurationManager> ConfigurationManager::_instance;
 
 ConfigurationManager::ConfigurationManager(const std::string &filename)
 : _config_filename(filename)
@@ -52,6 +51,7 @@ ConfigurationManager::ConfigurationManager(const std::string &filename)
     fs["set_gt_prop_to_one"] >> _set_gt_prop_to_one;
     fs["include_binary_masks"] >> _include_binary_masks;
     fs["ignore_grouping_svm"] >> _ignore_grouping_svm;
+    fs["deduplicate_channels"] >> _deduplicate_channels;
     fs["min_group_size"] >> _min_group_size;
     if (_min_group_size <= 0) 
         _min_group_size = 3;
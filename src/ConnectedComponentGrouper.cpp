@@ -17,30 +17,32 @@
  */
 #include <text_detector/ConnectedComponentGrouper.h>
 
-#include <boost/timer/timer.hpp>
-
 #include <text_detector/CCUtils.h>
+#include <text_detector/Instrumentation.h>
 #include <text_detector/UnionFind.h>
 
 namespace TextDetector {
 
-void ConnectedComponentGrouper::create_initial_groups(
+std::shared_ptr<const CCStore> ConnectedComponentGrouper::create_initial_groups(
 		const std::vector<std::pair<int, std::vector<cv::Point> > >& comps,
-		const std::vector<MserElement>& all_elements, std::vector<CC>& ccs,
-		std::vector<CCGroup>& groups,
-		std::vector<MserElement>& elements) const {
+		const std::vector<double> &probs,
+		std::vector<CCGroup>& groups) const {
+	std::shared_ptr<CCStore> ccs(new CCStore());
+	ccs->reserve(comps.size());
+	for (int i = 0; i < comps.size(); i++) {
+		ccs->push_back(CC(i, comps[i].first, comps[i].second,
+			probs[comps[i].first]));
+	}
+
+	groups.reserve(groups.size() + comps.size());
 	for (int i = 0; i < comps.size(); i++) {
-		CC cc(i, comps[i].first, comps[i].second);
-		ccs.push_back(cc);
-		CCGroup ccg;
-		ccg.ccs.push_back(cc);
-		groups.push_back(ccg);
-		elements.push_back(all_elements[comps[i].first]);
+		groups.push_back(CCGroup(ccs, i));
 	}
+	return ccs;
 }
 
-void ConnectedComponentGrouper::fill_distance_matrix(const std::vector<CC>& ccs,
-		const std::vector<MserElement>& elements, const cv::Mat& train_image,
+void ConnectedComponentGrouper::fill_distance_matrix(const CCStore& ccs,
+		const std::vector<MserElement>& all_elements, const cv::Mat& train_image,
 		const cv::Mat& gradient_image,
 		cv::Mat& distance_matrix) const {
 
@@ -61,11 +63,11 @@ void ConnectedComponentGrouper::fill_distance_matrix(const std::vector<CC>& ccs,
 
     #pragma omp parallel for
 	for (int i = 0; i < ccs.size(); i++) {
-		const MserElement &el1 = elements[i];
+		const MserElement &el1 = all_elements[ccs[i].feature_id];
 		for (int j = i + 1; j < ccs.size(); j++) {
 			if (i == j)
 				continue;
-			const MserElement &el2 = elements[j];
+			const MserElement &el2 = all_elements[ccs[j].feature_id];
 			cv::Vec2f diff = el1.get_centroid() - el2.get_centroid();
 			double dist = sqrt(diff[0] * diff[0] + diff[1] * diff[1]);
 
@@ -83,7 +85,7 @@ void ConnectedComponentGrouper::fill_distance_matrix(const std::vector<CC>& ccs,
 				float val = -(f2.dot(w) + bias);
 				distance_matrix.at<float>(i, j) = val;
 				distance_matrix.at<float>(j, i) = val;
-				if (ConfigurationManager::instance()->ignore_grouping_svm()) {
+				if (_config->ignore_grouping_svm()) {
 					distance_matrix.at<float>(i, j) = -100;
 					distance_matrix.at<float>(j, i) = -100;
 				}
@@ -104,7 +106,7 @@ void ConnectedComponentGrouper::merge_components(
 		int any_found = 0;
 		for (size_t i = 0; i < groups.size(); i++) {
 			for (size_t j = i + 1; j < groups.size(); j++) {
-				float dist = groups[i].distance(groups[j], distance_matrix);
+				float dist = groups[i].distance(groups[j], distance_matrix, *_config);
 				if (dist < _distance_threshold) {
 					{
 						groupings.union_set(i, j);
@@ -132,25 +134,27 @@ void ConnectedComponentGrouper::merge_components(
 				continue;
 			}
 			groups[set_id].link(groups[i]);
-			std::vector<CCGroup> grp;
-			grp.push_back(groups[set_id]);
 		}
-		std::vector<CCGroup> new_groups;
-		new_groups.reserve(n_roots);
+		// compact the root groups in place
+		size_t n = 0;
 		for (size_t i = 0; i < groups.size(); i++) {
-			if (root_groups[i])
-				new_groups.push_back(groups[i]);
+			if (!root_groups[i])
+				continue;
+			if (n != i)
+				groups[n] = std::move(groups[i]);
+			n++;
 		}
-		groups = new_groups;
+		assert(n == n_roots);
+		groups.erase(groups.begin() + n, groups.end());
 	}
 }
 
 void ConnectedComponentGrouper::prune_low_probability_groups(
-    const std::vector<double> &probs, std::vector<CCGroup> &groups) const
+    std::vector<CCGroup> &groups) const
 {
-    float group_threshold = ConfigurationManager::instance()->get_word_group_threshold();
-    int min_group_size = ConfigurationManager::instance()->get_min_group_size() - 1;
-    groups.erase(std::remove_if(groups.begin(), groups.end(), [&probs, group_threshold, min_group_size] (const CCGroup &g) -> bool {
+    float group_threshold = _config->get_word_group_threshold();
+    int min_group_size = _config->get_min_group_size() - 1;
+    groups.erase(std::remove_if(groups.begin(), groups.end(), [group_threshold, min_group_size] (const CCGroup &g) -> bool {
         float proba = 0.0f;
         // groups of size 2 are erased
         if (g.ccs.size() <= min_group_size) return true;
@@ -161,16 +165,17 @@ void ConnectedComponentGrouper::prune_low_probability_groups(
         // or without the component the enclosing bounding box will get smaller
         int num_ccs = 0;
         for (size_t i = 0; i < g.ccs.size(); i++) {
-            if (probs[g.ccs[i].feature_id] < group_threshold) {
+            double prob = g.cc(i).prob;
+            if (prob < group_threshold) {
                 // check if it is fully contained in the bounding rect of the group
                 // and it is not touching any edges
                 if (g.is_significant_member(i)) {
                     num_ccs++;
-                    proba += probs[g.ccs[i].feature_id];
+                    proba += prob;
                 }
             } else {
                 num_ccs++;
-                proba += probs[g.ccs[i].feature_id];
+                proba += prob;
             }
         }
 
@@ -185,14 +190,14 @@ void ConnectedComponentGrouper::prune_low_probability_groups(
 }
 
 void ConnectedComponentGrouper::prune_overlapping_groups(
-	const std::vector<double> &probs,
     std::vector<CCGroup> &groups) const
 {
-    std::vector<int> to_remove;
+    std::vector<char> to_remove(groups.size(), 0);
+    int n_removed = 0;
     for (int i = 0; i < groups.size(); i++) {
         cv::Rect r_i = groups[i].get_rect();
         float a_i = groups[i].get_bounding_box_area();
-        float prob_i = groups[i].calculate_probability(probs);
+        float prob_i = groups[i].calculate_probability();
 
         for (int j = i+1; j < groups.size(); j++) {
             if (i == j) continue;
@@ -202,18 +207,20 @@ void ConnectedComponentGrouper::prune_overlapping_groups(
             cv::Rect intersect = r_i & r_j;
             float area_intersect = intersect.width * intersect.height;
             if (area_intersect > 0) {
-                float prob_j = groups[j].calculate_probability(probs);
+                float prob_j = groups[j].calculate_probability();
                 float a_both = groups[i].get_intersection_area(groups[j]);
                 if (prob_i < prob_j) {
                     // it is intersecting more w/ group i
                     if (a_both / a_i > _overlap_threshold) {
-                        to_remove.push_back(i);
+                        n_removed += !to_remove[i];
+                        to_remove[i] = 1;
                         break;
                     }
                 } else {
                     // it is intersecting more w/ group j
                     if (a_both / a_j > _overlap_threshold) {
-                        to_remove.push_back(j);
+                        n_removed += !to_remove[j];
+                        to_remove[j] = 1;
                         continue;
                     }
                 }
@@ -221,19 +228,18 @@ void ConnectedComponentGrouper::prune_overlapping_groups(
         }
     }
 
-    if (to_remove.size() > 0) {
-        if (ConfigurationManager::instance()->verbose())
-            std::cout << "Removing: " << to_remove.size() << " Textlines" << std::endl;
-    }
+    set_stat("overlapping_textlines", n_removed);
 
-    std::vector<CCGroup> new_groups;
-    new_groups.reserve(groups.size());
-    for (int i = 0; i < groups.size(); i++) {
-        if (std::find(to_remove.begin(), to_remove.end(), i) == to_remove.end()) {
-            new_groups.push_back(groups[i]);
-        }
+    // erase the removed groups in place
+    size_t n = 0;
+    for (size_t i = 0; i < groups.size(); i++) {
+        if (to_remove[i])
+            continue;
+        if (n != i)
+            groups[n] = std::move(groups[i]);
+        n++;
     }
-    groups = new_groups;
+    groups.erase(groups.begin() + n, groups.end());
 }
 
 void ConnectedComponentGrouper::operator()(
@@ -245,38 +251,28 @@ void ConnectedComponentGrouper::operator()(
         std::vector<CCGroup> &groups) const
 {
 
-    std::vector<MserElement> elements;
-    elements.reserve(comps.size());
-    std::vector<CC> ccs;
-	create_initial_groups(comps, all_elements, ccs, groups, elements);
+    std::shared_ptr<const CCStore> store(
+        create_initial_groups(comps, probs, groups));
+    const CCStore &ccs = *store;
 
     cv::Mat distance_matrix(
         std::max(1, static_cast<int>(ccs.size())),
         std::max(1, static_cast<int>(ccs.size())), CV_32FC1);
 
-    if (ConfigurationManager::instance()->verbose()) {
-        std::cout << "Computing distances for: " << ccs.size()
-        		  << " connected compontents!" << std::endl;
-    }
-    boost::timer::cpu_timer t;
-    t.start();
-	fill_distance_matrix(ccs, elements, train_image,
+    ScopedStageTimer distance_timer("group_distances");
+	fill_distance_matrix(ccs, all_elements, train_image,
 		gradient_image, distance_matrix);
+    distance_timer.stop();
 
-    if (ConfigurationManager::instance()->verbose()) {
-        std::cout << "Computed distance-matrix in " <<
-            boost::timer::format(t.elapsed(), 5, "%w") << std::endl;
-    }
-
-    t.start();
+    ScopedStageTimer merge_timer("group_merge");
 	merge_components(distance_matrix, groups);
+    merge_timer.stop();
 
-    if (ConfigurationManager::instance()->verbose()) {
-        std::cout << "Grouped components in: " << boost::timer::format(t.elapsed(), 5, "%w") << std::endl;
-    }
-
-    prune_low_probability_groups(probs, groups);
-    prune_overlapping_groups(probs, groups);
+    ScopedStageTimer prune_timer("group_prune");
+    prune_low_probability_groups(groups);
+    prune_overlapping_groups(groups);
+    prune_timer.stop();
+    set_stat("groups", groups.size());
 
     //show_groups_color(groups, cv::Size(train_image.cols, train_image.rows), probs, true);
     //show_groups(groups, cv::Size(train_image.cols, train_image.rows), true);
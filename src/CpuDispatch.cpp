@@ -0,0 +1,132 @@
+/**
+ *  This file is part of ltp-text-detector.
+ *  Copyright (C) 2013 Michael Opitz
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <text_detector/CpuDispatch.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+namespace TextDetector {
+
+namespace {
+
+struct CpuVariant
+{
+    const char *name;
+    const CpuKernels *kernels;
+    bool (*supported)();
+};
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+bool supports_sse42()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt");
+}
+
+bool supports_avx2()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+}
+
+bool supports_avx512()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx512f") && 
+        __builtin_cpu_supports("avx512bw") && 
+        __builtin_cpu_supports("avx512vl");
+}
+#else
+bool supports_sse42() { return false; }
+bool supports_avx2() { return false; }
+bool supports_avx512() { return false; }
+#endif
+
+bool supports_generic() { return true; }
+
+const int n_variants = 4;
+
+//! Returns the variants from the lowest to the highest instruction set
+const CpuVariant *get_variants()
+{
+    static const CpuVariant variants[n_variants] = {
+        { "generic", cpu_kernels_generic, &supports_generic },
+        { "sse4.2", cpu_kernels_sse42, &supports_sse42 },
+        { "avx2", cpu_kernels_avx2, &supports_avx2 },
+        { "avx512", cpu_kernels_avx512, &supports_avx512 }
+    };
+    return variants;
+}
+
+//! Returns the index of the highest variant allowed by TEXT_DETECTOR_CPU_DISPATCH
+int max_variant()
+{
+    const char *limit = std::getenv("TEXT_DETECTOR_CPU_DISPATCH");
+    if (!limit || !*limit)
+        return n_variants - 1;
+    const CpuVariant *variants = get_variants();
+    for (int i = 0; i < n_variants; i++) {
+        if (std::strcmp(variants[i].name, limit) == 0)
+            return i;
+    }
+    return n_variants - 1;
+}
+
+int select_variant()
+{
+    const CpuVariant *variants = get_variants();
+    for (int i = max_variant(); i > 0; i--) {
+        if (variants[i].kernels && variants[i].supported())
+            return i;
+    }
+    return 0;
+}
+
+int selected_variant()
+{
+    static const int selected = select_variant();
+    return selected;
+}
+
+}
+
+const CpuKernels &get_cpu_kernels()
+{
+    static const CpuKernels &kernels = *get_variants()[selected_variant()].kernels;
+    return kernels;
+}
+
+std::string describe_cpu_dispatch()
+{
+    std::stringstream ss;
+    const CpuVariant *variants = get_variants();
+    const int selected = selected_variant();
+    for (int i = 0; i < n_variants; i++) {
+        ss << variants[i].name << ": " 
+           << (variants[i].kernels ? "compiled" : "not compiled") << ", "
+           << (variants[i].supported() ? "supported" : "not supported")
+           << (i == selected ? " (selected)" : "") << std::endl;
+    }
+    const char *limit = std::getenv("TEXT_DETECTOR_CPU_DISPATCH");
+    if (limit && *limit)
+        ss << "TEXT_DETECTOR_CPU_DISPATCH=" << limit << std::endl;
+    return ss.str();
+}
+
+}
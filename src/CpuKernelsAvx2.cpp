@@ -0,0 +1,36 @@
+/**
+ *  This file is part of ltp-text-detector.
+ *  Copyright (C) 2013 Michael Opitz
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <text_detector/CpuDispatch.h>
+
+// compiled with AVX2 and FMA (see CMakeLists.txt), empty otherwise
+#if defined(__AVX2__) && defined(__FMA__)
+#include <text_detector/CpuKernelsImpl.h>
+
+namespace TextDetector {
+
+static const CpuKernels kernels = CPU_KERNELS("avx2");
+const CpuKernels *const cpu_kernels_avx2 = &kernels;
+
+}
+#else
+namespace TextDetector {
+
+const CpuKernels *const cpu_kernels_avx2 = 0;
+
+}
+#endif
@@ -0,0 +1,155 @@
+/**
+ *  This file is part of ltp-text-detector.
+ *  Copyright (C) 2013 Michael Opitz
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <text_detector/DetectionService.h>
+#include <text_detector/CacheManager.h>
+#include <text_detector/ConfigurationManager.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace TextDetector {
+
+DetectionService::DetectionService(
+    const std::shared_ptr<ConfigurationManager> &config,
+    const std::string &model_file,
+    int workers,
+    int queue_size,
+    int omp_threads)
+    : _config(config), 
+      _detector(DetectorContext(config, config->has_cache() ? 
+          std::make_shared<CacheManager>(config->get_cache_directory()) : 
+          std::shared_ptr<CacheManager>())),
+      _clf(model_file), 
+      _queue(std::max(1, queue_size)), _served(0)
+{
+    workers = std::max(1, workers);
+    if (omp_threads <= 0) {
+        omp_threads = std::max(1, int(std::thread::hardware_concurrency()) / workers);
+    }
+    for (int i = 0; i < workers; i++) {
+        _workers.push_back(std::thread(&DetectionService::work, this, omp_threads));
+    }
+}
+
+DetectionService::~DetectionService()
+{
+    _queue.close();
+    for (std::thread &t : _workers) {
+        t.join();
+    }
+}
+
+DetectionResult DetectionService::detect(const cv::Mat &image, const std::string &name)
+{
+    if (image.empty() || image.type() != CV_8UC3)
+        throw std::runtime_error("Expected a non-empty CV_8UC3 image");
+
+    RequestPtr request(new Request());
+    request->image = image;
+    request->name = name;
+    std::future<DetectionResult> result = request->result.get_future();
+    if (!_queue.push(request))
+        throw std::runtime_error("The detection service is shutting down");
+    return result.get();
+}
+
+unsigned long long DetectionService::served() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _served;
+}
+
+void DetectionService::work(int omp_threads)
+{
+#ifdef _OPENMP
+    omp_set_num_threads(omp_threads);
+#endif
+    RequestPtr request;
+    while (_queue.pop(request)) {
+        DetectionResult result;
+        result.stats = ImageStats(request->name, _config->verbose());
+        result.stats.add_time("queue", request->timer.elapsed().wall / 1.0e6);
+        try {
+            {
+            ScopedImageStats scope(&result.stats);
+            result.words = run_detection(*_config, _clf, _detector, request->image);
+            }
+            result.stats.add_time("total", request->timer.elapsed().wall / 1.0e6);
+            {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _served++;
+            }
+            request->result.set_value(std::move(result));
+        } catch (...) {
+            request->result.set_exception(std::current_exception());
+        }
+        request.reset();
+    }
+}
+
+std::vector<DetectedWord> run_detection(
+    const ConfigurationManager &config,
+    AdaboostClassifier &clf,
+    const MserDetector &detector,
+    const cv::Mat &image)
+{
+    cv::Mat response;
+    cv::Mat mask;
+    {
+    ScopedStageTimer timer("stage_response");
+    if (config.ignore_responses()) {
+        mask = cv::Mat(image.rows, image.cols, CV_8UC1, cv::Scalar(255));
+    } else {
+        clf.detect(image, response);
+        mask = response > (config.get_threshold() * 255);
+    }
+    }
+
+    ExtractedComponents components;
+    {
+    ScopedStageTimer timer("stage_cc");
+    detector.extract_components(image, mask, cv::Mat(), components);
+    }
+
+    std::vector<cv::Rect> words;
+    {
+    ScopedStageTimer timer("stage_group");
+    cv::Mat result_image;
+    words = detector.detect_words(image, components, result_image);
+    }
+
+    std::vector<DetectedWord> detected;
+    cv::Rect bounds(0, 0, image.cols, image.rows);
+    for (const cv::Rect &r : words) {
+        DetectedWord word;
+        word.box = r;
+        word.score = 1.0;
+        cv::Rect inside = r & bounds;
+        if (!response.empty() && inside.area() > 0) {
+            word.score = cv::mean(response(inside))[0] / 255.0;
+        }
+        detected.push_back(word);
+    }
+    return detected;
+}
+
+}
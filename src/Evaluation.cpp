@@ -0,0 +1,252 @@
+/**
+ *  This file is part of ltp-text-detector.
+ *  Copyright (C) 2013 Michael Opitz
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <text_detector/Evaluation.h>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/xml_parser.hpp>
+
+namespace TextDetector {
+
+static double safe_div(double a, double b)
+{
+    return b > 0.0 ? a / b : 0.0;
+}
+
+static double f_measure(double p, double r)
+{
+    return p + r > 0.0 ? 2.0 * p * r / (p + r) : 0.0;
+}
+
+void EvaluationResult::add(const EvaluationResult &other)
+{
+    n_gt += other.n_gt;
+    n_detections += other.n_detections;
+    deteval_recall_sum += other.deteval_recall_sum;
+    deteval_precision_sum += other.deteval_precision_sum;
+    icdar2003_recall_sum += other.icdar2003_recall_sum;
+    icdar2003_precision_sum += other.icdar2003_precision_sum;
+}
+
+double EvaluationResult::deteval_recall() const { return safe_div(deteval_recall_sum, n_gt); }
+double EvaluationResult::deteval_precision() const { return safe_div(deteval_precision_sum, n_detections); }
+double EvaluationResult::deteval_f() const { return f_measure(deteval_precision(), deteval_recall()); }
+double EvaluationResult::icdar2003_recall() const { return safe_div(icdar2003_recall_sum, n_gt); }
+double EvaluationResult::icdar2003_precision() const { return safe_div(icdar2003_precision_sum, n_detections); }
+double EvaluationResult::icdar2003_f() const { return f_measure(icdar2003_precision(), icdar2003_recall()); }
+
+static double area(const cv::Rect &r)
+{
+    return double(r.width) * r.height;
+}
+
+/**
+ *  ICDAR 2003 match: intersection over the minimum bounding box of both
+ */
+static double icdar2003_match(const cv::Rect &r1, const cv::Rect &r2)
+{
+    double bb = area(r1 | r2);
+    return bb > 0.0 ? area(r1 & r2) / bb : 0.0;
+}
+
+EvaluationResult evaluate_image(
+    const std::vector<cv::Rect> &gt,
+    const std::vector<cv::Rect> &detections,
+    const DetEvalParameters &params)
+{
+    EvaluationResult result;
+    const int n_gt = gt.size();
+    const int n_det = detections.size();
+    result.n_gt = n_gt;
+    result.n_detections = n_det;
+
+    // ICDAR 2003: best match per box
+    for (int i = 0; i < n_gt; i++) {
+        double best = 0.0;
+        for (int j = 0; j < n_det; j++) 
+            best = std::max(best, icdar2003_match(gt[i], detections[j]));
+        result.icdar2003_recall_sum += best;
+    }
+    for (int j = 0; j < n_det; j++) {
+        double best = 0.0;
+        for (int i = 0; i < n_gt; i++) 
+            best = std::max(best, icdar2003_match(gt[i], detections[j]));
+        result.icdar2003_precision_sum += best;
+    }
+
+    // DetEval: sigma is the area recall, tau the area precision
+    std::vector<double> sigma(n_gt * n_det), tau(n_gt * n_det);
+    for (int i = 0; i < n_gt; i++) {
+        for (int j = 0; j < n_det; j++) {
+            double inter = area(gt[i] & detections[j]);
+            sigma[i * n_det + j] = safe_div(inter, area(gt[i]));
+            tau[i * n_det + j] = safe_div(inter, area(detections[j]));
+        }
+    }
+    auto S = [&] (int i, int j) { return sigma[i * n_det + j]; };
+    auto T = [&] (int i, int j) { return tau[i * n_det + j]; };
+    auto matches = [&] (int i, int j) { 
+        return S(i, j) >= params.area_recall && T(i, j) >= params.area_precision; 
+    };
+
+    std::vector<char> gt_used(n_gt, 0), det_used(n_det, 0);
+
+    // one-to-one: the only match in its row and column
+    for (int i = 0; i < n_gt; i++) {
+        int n_row = 0, match = -1;
+        for (int j = 0; j < n_det; j++) {
+            if (matches(i, j)) {
+                n_row++;
+                match = j;
+            }
+        }
+        if (n_row != 1 || det_used[match]) continue;
+
+        int n_col = 0;
+        for (int k = 0; k < n_gt; k++) {
+            if (matches(k, match)) n_col++;
+        }
+        if (n_col != 1) continue;
+
+        gt_used[i] = det_used[match] = 1;
+        result.deteval_recall_sum += 1.0;
+        result.deteval_precision_sum += 1.0;
+    }
+
+    // one-to-many: a ground truth box split into several detections
+    for (int i = 0; i < n_gt; i++) {
+        if (gt_used[i]) continue;
+        std::vector<int> dets;
+        double covered = 0.0;
+        for (int j = 0; j < n_det; j++) {
+            if (det_used[j] || T(i, j) < params.area_precision) continue;
+            dets.push_back(j);
+            covered += S(i, j);
+        }
+        if (dets.size() < 2 || covered < params.area_recall) continue;
+
+        gt_used[i] = 1;
+        for (int j : dets) det_used[j] = 1;
+        result.deteval_recall_sum += params.split_penalty;
+        result.deteval_precision_sum += params.split_penalty * dets.size();
+    }
+
+    // many-to-one: several ground truth boxes in a single detection
+    for (int j = 0; j < n_det; j++) {
+        if (det_used[j]) continue;
+        std::vector<int> gts;
+        double covered = 0.0;
+        for (int i = 0; i < n_gt; i++) {
+            if (gt_used[i] || S(i, j) < params.area_recall) continue;
+            gts.push_back(i);
+            covered += T(i, j);
+        }
+        if (gts.size() < 2 || covered < params.area_precision) continue;
+
+        det_used[j] = 1;
+        for (int i : gts) gt_used[i] = 1;
+        result.deteval_recall_sum += params.merge_penalty * gts.size();
+        result.deteval_precision_sum += params.merge_penalty;
+    }
+
+    // the remaining matching pairs, which were ambiguous in the first pass
+    for (int i = 0; i < n_gt; i++) {
+        for (int j = 0; j < n_det && !gt_used[i]; j++) {
+            if (det_used[j] || !matches(i, j)) continue;
+            gt_used[i] = det_used[j] = 1;
+            result.deteval_recall_sum += 1.0;
+            result.deteval_precision_sum += 1.0;
+        }
+    }
+
+    return result;
+}
+
+std::vector<cv::Rect> read_detection_boxes(const std::string &filename)
+{
+    std::ifstream ifs(filename.c_str());
+    if (!ifs)
+        throw std::runtime_error("Could not read " + filename);
+
+    std::vector<cv::Rect> boxes;
+    std::string line;
+    while (std::getline(ifs, line)) {
+        std::replace(line.begin(), line.end(), ',', ' ');
+        std::stringstream ss(line);
+        cv::Rect r;
+        if (ss >> r.x >> r.y >> r.width >> r.height) 
+            boxes.push_back(r);
+    }
+    return boxes;
+}
+
+std::vector<cv::Rect> read_icdar_gt(const std::string &filename)
+{
+    std::ifstream ifs(filename.c_str());
+    if (!ifs)
+        throw std::runtime_error("Could not read " + filename);
+
+    std::vector<cv::Rect> boxes;
+    std::string line;
+    while (std::getline(ifs, line)) {
+        // the transcription may contain commas, only the first four fields are used
+        std::string coords = line.substr(0, line.find('"'));
+        std::replace(coords.begin(), coords.end(), ',', ' ');
+        std::stringstream ss(coords);
+        int x1, y1, x2, y2;
+        if (ss >> x1 >> y1 >> x2 >> y2)
+            boxes.push_back(cv::Rect(x1, y1, x2 - x1 + 1, y2 - y1 + 1));
+    }
+    return boxes;
+}
+
+std::map<std::string, std::vector<cv::Rect> > read_deteval_gt(const std::string &filename)
+{
+    namespace pt = boost::property_tree;
+    pt::ptree tree;
+    pt::read_xml(filename, tree);
+
+    std::map<std::string, std::vector<cv::Rect> > result;
+    for (const pt::ptree::value_type &image : tree.get_child("tagset")) {
+        if (image.first != "image") continue;
+        std::string name = boost::filesystem::path(
+            image.second.get<std::string>("imageName")).stem().generic_string();
+
+        std::vector<cv::Rect> &boxes = result[name];
+        boost::optional<const pt::ptree &> rects = 
+            image.second.get_child_optional("taggedRectangles");
+        if (!rects) continue;
+        for (const pt::ptree::value_type &rect : *rects) {
+            if (rect.first != "taggedRectangle") continue;
+            boxes.push_back(cv::Rect(
+                int(rect.second.get<double>("<xmlattr>.x")),
+                int(rect.second.get<double>("<xmlattr>.y")),
+                int(rect.second.get<double>("<xmlattr>.width")),
+                int(rect.second.get<double>("<xmlattr>.height"))));
+        }
+    }
+    return result;
+}
+
+}
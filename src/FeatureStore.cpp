@@ -0,0 +1,376 @@
+/**
+ *  This file is part of ltp-text-detector.
+ *  Copyright (C) 2013 Michael Opitz
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <text_detector/FeatureStore.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+namespace fs = boost::filesystem;
+namespace ipc = boost::interprocess;
+
+/*
+ *  Layout of a packed feature file (all values in host byte order):
+ *
+ *  FeatureHeader
+ *  cols x float[rows]      the columns of the matrix
+ *
+ *  Layout of a row file:
+ *
+ *  RowHeader
+ *  n x float[cols]         the rows, n follows from the file size
+ */
+namespace {
+
+const char FEATURE_MAGIC[8] = { 'L', 'T', 'P', 'F', 'E', 'A', 'T', '\0' };
+const uint32_t FEATURE_VERSION = 1;
+
+struct FeatureHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t cols;
+    uint64_t rows;
+    uint64_t data_offset;
+};
+
+const char ROW_MAGIC[8] = { 'L', 'T', 'P', 'R', 'O', 'W', 'S', '\0' };
+const uint32_t ROW_VERSION = 1;
+
+struct RowHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t cols;
+};
+
+bool has_magic(const std::string &filename, const char *magic)
+{
+    std::ifstream ifs(filename.c_str(), std::ios::binary);
+    char buf[8];
+    return ifs.read(buf, sizeof(buf)) && std::memcmp(buf, magic, sizeof(buf)) == 0;
+}
+
+/**
+ *  Reads the header of a row file and returns the number of complete rows,
+ *  throws std::runtime_error.
+ */
+uint64_t read_row_header(const std::string &filename, RowHeader &header)
+{
+    std::ifstream ifs(filename.c_str(), std::ios::binary);
+    if (!ifs.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, ROW_MAGIC, sizeof(ROW_MAGIC)) != 0 ||
+        header.version != ROW_VERSION || header.cols == 0)
+        throw std::runtime_error("Invalid feature row file " + filename);
+    return (fs::file_size(filename) - sizeof(header)) / (uint64_t(header.cols) * sizeof(float));
+}
+
+//! Number of rows which are transposed at once
+const int BLOCK_ROWS = 256;
+
+inline bool is_blank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+/**
+ *  Parses the values of the line starting at begin into row. Returns the 
+ *  number of values, which is larger than cols if the line is too long.
+ *  The line must be terminated by '\n' or '\0'.
+ */
+int parse_line(const char *begin, float *row, int cols)
+{
+    const char *p = begin;
+    int n = 0;
+    while (true) {
+        while (is_blank(*p)) p++;
+        if (*p == '\n' || *p == '\0')
+            return n;
+
+        char *end;
+        float value = std::strtof(p, &end);
+        if (end == p)
+            return -1;
+        if (n < cols)
+            row[n] = value;
+        n++;
+
+        p = end;
+        while (is_blank(*p)) p++;
+        if (*p == ',')
+            p++;
+        else if (*p != '\n' && *p != '\0')
+            return -1;
+    }
+}
+
+}
+
+namespace TextDetector {
+
+struct FeatureStore::MappedFile
+{
+    MappedFile(const std::string &filename)
+    : mapping(filename.c_str(), ipc::read_only),
+      region(mapping, ipc::read_only),
+      data(static_cast<const char *>(region.get_address())),
+      size(region.get_size())
+    {}
+
+    ipc::file_mapping mapping;
+    ipc::mapped_region region;
+    const char *data;
+    uint64_t size;
+};
+
+FeatureStore::FeatureStore(const std::string &filename)
+: _data(0), _rows(0), _cols(0)
+{
+    if (!is_packed(filename)) {
+        cv::Mat features = FeatureRowWriter::is_row_file(filename) ? 
+            read_feature_rows(filename) : read_feature_csv(filename);
+        _rows = features.rows;
+        _cols = features.cols;
+        _columns.resize(size_t(_rows) * _cols);
+        #pragma omp parallel for
+        for (int j = 0; j < _cols; j++) {
+            float *column = &_columns[size_t(j) * _rows];
+            for (int i = 0; i < _rows; i++) {
+                column[i] = features.at<float>(i, j);
+            }
+        }
+        _data = _columns.empty() ? 0 : &_columns[0];
+        return;
+    }
+
+    _mapped.reset(new MappedFile(filename));
+    FeatureHeader header;
+    if (_mapped->size < sizeof(header))
+        throw std::runtime_error("Truncated feature file " + filename);
+    std::memcpy(&header, _mapped->data, sizeof(header));
+    if (header.version != FEATURE_VERSION || header.rows > uint64_t(INT_MAX) || 
+        header.cols > uint32_t(INT_MAX))
+        throw std::runtime_error("Invalid feature file " + filename);
+
+    // the header is not trusted, the size of the data must not overflow
+    size_t rows = header.rows, cols = header.cols;
+    if (rows > SIZE_MAX / sizeof(float) || cols > SIZE_MAX / sizeof(float) ||
+        (cols != 0 && rows > SIZE_MAX / sizeof(float) / cols))
+        throw std::runtime_error("Invalid feature file " + filename);
+    size_t length = rows * cols * sizeof(float);
+    if (header.data_offset % sizeof(float) != 0 || header.data_offset > _mapped->size ||
+        length > _mapped->size - header.data_offset)
+        throw std::runtime_error("Truncated feature file " + filename);
+
+    _rows = header.rows;
+    _cols = header.cols;
+    _data = reinterpret_cast<const float *>(_mapped->data + header.data_offset);
+}
+
+FeatureStore::~FeatureStore()
+{}
+
+const float *FeatureStore::column(int col) const
+{
+    if (col < 0 || col >= _cols)
+        throw std::out_of_range("Invalid feature column");
+    return _data + size_t(col) * _rows;
+}
+
+cv::Mat FeatureStore::to_mat() const
+{
+    cv::Mat result(_rows, _cols, CV_32FC1);
+    // transpose blocks of rows, so that the reads of each column are
+    // sequential and the written rows stay in the cache
+    #pragma omp parallel for schedule(dynamic)
+    for (int start = 0; start < _rows; start += BLOCK_ROWS) {
+        int end = std::min(_rows, start + BLOCK_ROWS);
+        for (int j = 0; j < _cols; j++) {
+            const float *column = _data + size_t(j) * _rows;
+            for (int i = start; i < end; i++) {
+                result.at<float>(i, j) = column[i];
+            }
+        }
+    }
+    return result;
+}
+
+bool FeatureStore::is_packed(const std::string &filename)
+{
+    return has_magic(filename, FEATURE_MAGIC);
+}
+
+void FeatureStore::write(const cv::Mat &features, const std::string &filename)
+{
+    CV_Assert(features.type() == CV_32FC1);
+
+    const std::string tmp_filename = filename + ".tmp";
+    {
+        std::ofstream ofs(tmp_filename.c_str(), std::ios::binary);
+        if (!ofs)
+            throw std::runtime_error("Could not write feature file " + tmp_filename);
+
+        FeatureHeader header;
+        std::memcpy(header.magic, FEATURE_MAGIC, sizeof(FEATURE_MAGIC));
+        header.version = FEATURE_VERSION;
+        header.cols = features.cols;
+        header.rows = features.rows;
+        header.data_offset = sizeof(FeatureHeader);
+        ofs.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+        std::vector<float> column(features.rows);
+        for (int j = 0; j < features.cols; j++) {
+            for (int i = 0; i < features.rows; i++) {
+                column[i] = features.at<float>(i, j);
+            }
+            if (!column.empty())
+                ofs.write(reinterpret_cast<const char *>(&column[0]), column.size() * sizeof(float));
+        }
+        if (!ofs)
+            throw std::runtime_error("Could not write feature file " + tmp_filename);
+    }
+    fs::rename(tmp_filename, filename);
+}
+
+FeatureRowWriter::FeatureRowWriter(const std::string &filename, int cols)
+: _filename(filename), _cols(cols)
+{
+    CV_Assert(cols > 0);
+    if (fs::exists(filename) && fs::file_size(filename) > 0) {
+        RowHeader header;
+        uint64_t rows = read_row_header(filename, header);
+        if (int(header.cols) != cols)
+            throw std::runtime_error("Feature row file " + filename + " has a different number of columns");
+        // drop a partially written last row
+        fs::resize_file(filename, sizeof(header) + rows * cols * sizeof(float));
+        _ofs.open(filename.c_str(), std::ios::binary | std::ios::app);
+    } else {
+        _ofs.open(filename.c_str(), std::ios::binary | std::ios::trunc);
+        RowHeader header;
+        std::memcpy(header.magic, ROW_MAGIC, sizeof(ROW_MAGIC));
+        header.version = ROW_VERSION;
+        header.cols = cols;
+        _ofs.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    }
+    if (!_ofs)
+        throw std::runtime_error("Could not write feature row file " + filename);
+}
+
+void FeatureRowWriter::write(const cv::Mat &rows)
+{
+    CV_Assert(rows.type() == CV_32FC1 && (rows.empty() || rows.cols == _cols));
+    for (int i = 0; i < rows.rows; i++) {
+        _ofs.write(reinterpret_cast<const char *>(rows.ptr<float>(i)), _cols * sizeof(float));
+    }
+    if (!_ofs)
+        throw std::runtime_error("Could not write feature row file " + _filename);
+}
+
+void FeatureRowWriter::flush()
+{
+    _ofs.flush();
+}
+
+bool FeatureRowWriter::is_row_file(const std::string &filename)
+{
+    return has_magic(filename, ROW_MAGIC);
+}
+
+cv::Mat read_feature_rows(const std::string &filename)
+{
+    RowHeader header;
+    uint64_t rows = read_row_header(filename, header);
+    if (rows > uint64_t(INT_MAX))
+        throw std::runtime_error("Invalid feature row file " + filename);
+
+    cv::Mat result(int(rows), int(header.cols), CV_32FC1);
+    if (rows == 0)
+        return result;
+    ipc::file_mapping mapping(filename.c_str(), ipc::read_only);
+    ipc::mapped_region region(mapping, ipc::read_only, sizeof(header), rows * header.cols * sizeof(float));
+    std::memcpy(result.ptr<float>(0), region.get_address(), rows * header.cols * sizeof(float));
+    return result;
+}
+
+cv::Mat read_feature_csv(const std::string &filename)
+{
+    std::ifstream ifs(filename.c_str(), std::ios::binary);
+    if (!ifs)
+        throw std::runtime_error("Could not open feature file " + filename);
+
+    std::vector<char> buffer((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+    buffer.push_back('\0');
+
+    // find the non-empty lines
+    std::vector<size_t> lines;
+    for (size_t start = 0; start + 1 < buffer.size(); ) {
+        const char *begin = &buffer[start];
+        const char *end = static_cast<const char *>(std::memchr(begin, '\n', buffer.size() - 1 - start));
+        size_t length = end ? end - begin : buffer.size() - 1 - start;
+
+        size_t k = 0;
+        while (k < length && is_blank(begin[k])) k++;
+        if (k < length)
+            lines.push_back(start);
+        start += length + 1;
+    }
+    if (lines.empty())
+        throw std::runtime_error("Empty feature file " + filename);
+
+    int cols = parse_line(&buffer[lines[0]], 0, 0);
+    if (cols <= 0)
+        throw std::runtime_error("Invalid feature file " + filename);
+
+    cv::Mat result(lines.size(), cols, CV_32FC1);
+    int invalid_line = -1;
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (int i = 0; i < result.rows; i++) {
+        if (parse_line(&buffer[lines[i]], result.ptr<float>(i), cols) != cols) {
+            #pragma omp critical
+            if (invalid_line < 0 || i < invalid_line)
+                invalid_line = i;
+        }
+    }
+    if (invalid_line >= 0) {
+        std::stringstream msg;
+        msg << "Invalid row " << invalid_line + 1 << " in " << filename;
+        throw std::runtime_error(msg.str());
+    }
+    return result;
+}
+
+cv::Mat load_features(const std::string &filename)
+{
+    if (FeatureStore::is_packed(filename))
+        return FeatureStore(filename).to_mat();
+    if (FeatureRowWriter::is_row_file(filename))
+        return read_feature_rows(filename);
+    return read_feature_csv(filename);
+}
+
+}
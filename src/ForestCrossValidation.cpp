@@ -0,0 +1,135 @@
+/**
+ *  This file is part of ltp-text-detector.
+ *  Copyright (C) 2013 Michael Opitz
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <text_detector/ForestCrossValidation.h>
+
+#include <algorithm>
+
+#include <opencv2/ml/ml.hpp>
+
+namespace TextDetector {
+
+ForestFoldResult::ForestFoldResult()
+: ntrain(0), nmissclass_train(0), nholdout(0), nmissclass(0), nfalse_pos(0),
+  nfalse_neg(0), real_pos(0), real_neg(0), true_pos(0), true_neg(0)
+{}
+
+cv::Range get_holdout_range(int rows, int nfolds, int fold)
+{
+    int chunk_size = rows / nfolds;
+    int idx_start = fold * chunk_size;
+    int idx_end = std::min(rows - 1, idx_start + chunk_size - 1);
+    return cv::Range(idx_start, idx_end);
+}
+
+uint64_t get_fold_seed(int random_seed, const ForestParams &params, int fold)
+{
+    uint64_t seed = uint32_t(random_seed);
+    const int values[] = { params.ntrees, params.depth, params.nvars, fold };
+    for (int v : values) {
+        seed = seed * 1000003ULL ^ uint32_t(v);
+    }
+    return seed;
+}
+
+ForestFoldResult cross_validate_forest_fold(
+    const cv::Mat &samples, 
+    const cv::Mat &labels, 
+    const cv::Range &holdout, 
+    const ForestParams &params, 
+    float thresh,
+    uint64_t seed,
+    std::vector<float> *holdout_probs)
+{
+    CV_Assert(samples.type() == CV_32FC1 && labels.type() == CV_32FC1 && 
+        samples.rows == labels.rows);
+
+    ForestFoldResult result;
+    result.nholdout = holdout.end - holdout.start;
+    result.ntrain = samples.rows - result.nholdout;
+
+    cv::Mat train_idx(result.ntrain, 1, CV_32SC1);
+    for (int r = 0, idx = 0; r < samples.rows; ++r) {
+        if (r < holdout.start || r >= holdout.end) {
+            train_idx.at<int>(idx++, 0) = r;
+        }
+    }
+
+    // the forest draws from the (thread local) random number generator of 
+    // the thread, which would otherwise depend on the folds run before
+    cv::theRNG() = cv::RNG(seed);
+    cv::RandomTrees trees;
+    float priors[] = { 1.0f, params.prior };
+    cv::Mat vartype(samples.cols+1, 1, CV_8U);
+    vartype.setTo(cv::Scalar(CV_VAR_NUMERICAL));
+    vartype.at<uchar>(samples.cols, 0) = CV_VAR_CATEGORICAL;
+    trees.train(samples, CV_ROW_SAMPLE, labels, cv::Mat(), train_idx, vartype, cv::Mat(), CvRTParams(
+        params.depth,   // max depth
+        5,              // min sample count
+        0,              // rgression accuracy
+        false,          // use surrogates
+        15,             // max categories?!
+        priors,         // priors
+        false,          // calc var importace
+        params.nvars,   // nactiv vars?!
+        params.ntrees,  // max. no of trees
+        0.01f,          // forest accuracy,
+        CV_TERMCRIT_ITER | CV_TERMCRIT_EPS));
+
+    for (int i = 0; i < train_idx.rows; ++i) {
+        int r = train_idx.at<int>(i, 0);
+        float res = trees.predict_prob(samples.row(r));
+        res = res < thresh ? -1.0f : 1.0f;
+        if (res != labels.at<float>(r, 0)) {
+            ++result.nmissclass_train;
+        }
+    }
+
+    if (holdout_probs) 
+        holdout_probs->resize(result.nholdout);
+    for (int i = 0; i < result.nholdout; ++i) {
+        int r = holdout.start + i;
+        float res = trees.predict_prob(samples.row(r));
+        if (holdout_probs)
+            (*holdout_probs)[i] = res;
+        // text
+        res = res < thresh ? -1.0f : 1.0f;
+        float label = labels.at<float>(r, 0);
+        if (label > 0) {
+            result.real_pos++;
+            if (res > 0) {
+                result.true_pos++;
+            }
+        } else {
+            result.real_neg++;
+            if (res <= 0) {
+                result.true_neg++;
+            }
+        }
+        if (res != label) {
+            ++result.nmissclass;
+            if (res == 1 && label == -1) {
+                ++result.nfalse_pos;
+            } else {
+                ++result.nfalse_neg;
+            }
+        }
+    }
+    return result;
+}
+
+}
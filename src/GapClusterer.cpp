@@ -0,0 +1,81 @@
+/**
+ *  This file is part of ltp-text-detector.
+ *  Copyright (C) 2013 Michael Opitz
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <text_detector/GapClusterer.h>
+
+#include <algorithm>
+#include <numeric>
+
+namespace TextDetector {
+
+float GapClusterer::cluster(
+    const std::vector<float> &values,
+    std::vector<int> &labels,
+    float centers[2]) const
+{
+    const size_t n = values.size();
+    labels.assign(n, 0);
+    centers[0] = centers[1] = 0.0f;
+    if (n == 0) return 0.0f;
+
+    std::vector<size_t> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&values] (size_t a, size_t b) -> bool {
+        return values[a] < values[b];
+    });
+
+    double total = 0.0, total_sq = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        total += values[i];
+        total_sq += double(values[i]) * values[i];
+    }
+
+    // minimizing the within-cluster sum of squares is equal to maximizing
+    // S_l^2 / n_l + S_r^2 / n_r. Equal values are never split up.
+    size_t best_split = n;
+    double best_score = total * total / n;
+    double prefix = 0.0;
+    for (size_t k = 1; k < n; k++) {
+        prefix += values[order[k-1]];
+        if (values[order[k-1]] == values[order[k]]) continue;
+
+        double suffix = total - prefix;
+        double score = prefix * prefix / k + suffix * suffix / (n - k);
+        if (best_split == n || score > best_score) {
+            best_score = score;
+            best_split = k;
+        }
+    }
+
+    if (best_split == n) {
+        centers[0] = centers[1] = total / n;
+        return std::max(0.0, total_sq - best_score);
+    }
+
+    double left = 0.0;
+    for (size_t k = 0; k < best_split; k++) {
+        left += values[order[k]];
+    }
+    for (size_t k = best_split; k < n; k++) {
+        labels[order[k]] = 1;
+    }
+    centers[0] = left / best_split;
+    centers[1] = (total - left) / (n - best_split);
+    return std::max(0.0, total_sq - best_score);
+}
+
+}
@@ -16,6 +16,7 @@
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include <text_detector/HardPPWordSplitter.h>
+#include <text_detector/GapClusterer.h>
 
 namespace TextDetector {
 
@@ -32,14 +33,15 @@ HardPPWordSplitter::split(const CCGroup &grp)
     // generate a 1D-mask where the gaps between CCs are 0 and the 
     // components are 1
     std::vector<bool> collide(bb.width, false);
-    for (int i = 0; i < grp.ccs.size(); i++) {
-        for (int j = grp.ccs[i].rect.x; j < grp.ccs[i].rect.x + grp.ccs[i].rect.width; j++) {
+    for (int i = 0; i < grp.size(); i++) {
+        const cv::Rect &r = grp.cc(i).rect;
+        for (int j = r.x; j < r.x + r.width; j++) {
             collide[j-bb.x] = true;
         }
     }
 
-    std::vector<float> heights(grp.ccs.size(), 0.0);
-    std::transform(grp.ccs.begin(), grp.ccs.end(), heights.begin(), [] (const CC &c) -> float { return c.rect.height; });
+    std::vector<float> heights(grp.size(), 0.0);
+    for (size_t i = 0; i < grp.size(); i++) heights[i] = grp.cc(i).rect.height;
     float mean_height = cv::sum(heights)[0] / heights.size();
 
     // Now find the rects from this binary mask.
@@ -76,16 +78,10 @@ HardPPWordSplitter::split(const CCGroup &grp)
         dists.push_back(rects[i].tl().x - rects[i-1].br().x);
     }
 
-    //  kmeans
-    cv::Mat dist_mat(dists.size(), 1, CV_32FC1);
-    for (size_t i = 0; i < dists.size(); i++) {
-        dist_mat.at<float>(i,0) = dists[i];
-    }
-    cv::Mat centers;
-    cv::Mat labels;
-    if (_verbose)
-        std::cout << dist_mat << std::endl;
-    kmeans(dist_mat, 2, labels, cv::TermCriteria(CV_TERMCRIT_EPS+CV_TERMCRIT_ITER, 100, .01), 5, cv::KMEANS_PP_CENTERS, centers);
+    //  exact 2-means on the gaps
+    float centers[2];
+    std::vector<int> labels;
+    GapClusterer().cluster(dists, labels, centers);
 
     std::vector<float> cpy(dists);
     std::sort(cpy.begin(), cpy.end());
@@ -95,8 +91,8 @@ HardPPWordSplitter::split(const CCGroup &grp)
         median = median / 2.0f;
     }
 
-    float height = std::abs(centers.at<float>(0,0) - centers.at<float>(1,0)) / mean_height;
-    median = std::abs(centers.at<float>(0,0) - centers.at<float>(1,0)) / (median + 1e-10);
+    float height = std::abs(centers[0] - centers[1]) / mean_height;
+    median = std::abs(centers[0] - centers[1]) / (median + 1e-10);
     // liblinear: 92% ACC: (10-F)
     // ./train -v 10 -B 1 -w1 2 -c 100 dists_cleaned_2.dat   
     //if (median * 0.3719757435798741 + height * 0.8523389079247736 - -0.4203646300224174 < 0) {
@@ -105,9 +101,9 @@ HardPPWordSplitter::split(const CCGroup &grp)
    // if (median * 0.27647134 + height * 0.54699267 < 0.87536189) {
    //
 
-    if (ConfigurationManager::instance()->verbose()) {
+    if (_verbose) {
         std::cout << mean_height << std::endl;
-        std::cout << centers << std::endl;
+        std::cout << centers[0] << " " << centers[1] << std::endl;
         std::cout << median * 2.17066083 + height * 5.7493335 - 2.9716705 << std::endl;
     }
     //[[ 0.19387692  3.29258427]]
@@ -124,13 +120,13 @@ HardPPWordSplitter::split(const CCGroup &grp)
         return result;
     }
 
-    // get the index of the smallest center
-    int small_center = centers.at<float>(0,0) < centers.at<float>(1,0) ? 0 : 1;
+    // the first center is always the smallest one
+    const int small_center = 0;
 
     // count the distance to cluster assignments
     int cnt[2] = {0,0};
-    for (int i = 0; i < labels.rows; i++) {
-        cnt[labels.at<int>(i,0)]++;
+    for (size_t i = 0; i < labels.size(); i++) {
+        cnt[labels[i]]++;
     }
     // we have more word gaps than letter gaps -> don't split!
     if (cnt[small_center] < cnt[1-small_center]) {
@@ -145,7 +141,7 @@ HardPPWordSplitter::split(const CCGroup &grp)
     std::vector<cv::Rect> words;
     for (int i = 1; i < rects.size(); i++) {
         if (_allow_single_letters) {
-            if (labels.at<int>(i-1,0) == small_center) {
+            if (labels[i-1] == small_center) {
                 // extend the last rect
                 last_rect = last_rect | rects[i];
             } else {
@@ -154,10 +150,10 @@ HardPPWordSplitter::split(const CCGroup &grp)
                 last_rect = rects[i];
             }
         } else {
-            if (labels.at<int>(i-1,0) == small_center) {
+            if (labels[i-1] == small_center) {
                 // extend the last rect
                 last_rect = last_rect | rects[i];
-            } else if (i < labels.rows && labels.at<int>(i,0) == small_center) {
+            } else if (i < labels.size() && labels[i] == small_center) {
                 // do not extend it!
                 words.push_back(last_rect);
                 last_rect = rects[i];
@@ -0,0 +1,240 @@
+/**
+ *  This file is part of ltp-text-detector.
+ *  Copyright (C) 2013 Michael Opitz
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <text_detector/Instrumentation.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+namespace TextDetector {
+
+static thread_local ImageStats *current_stats = 0;
+
+ImageStats *ImageStats::current()
+{
+    return current_stats;
+}
+
+void ImageStats::set_current(ImageStats *stats)
+{
+    current_stats = stats;
+}
+
+template <class V>
+static void add_value(std::vector<std::pair<std::string, V> > &values, 
+    const std::string &key, V value, bool overwrite)
+{
+    for (size_t i = 0; i < values.size(); i++) {
+        if (values[i].first == key) {
+            values[i].second = overwrite ? value : values[i].second + value;
+            return;
+        }
+    }
+    values.push_back(std::make_pair(key, value));
+}
+
+void ImageStats::add_time(const std::string &stage, double ms)
+{
+    add_value(_times, stage, ms, false);
+}
+
+void ImageStats::add_count(const std::string &counter, long long value)
+{
+    add_value(_counts, counter, value, false);
+}
+
+void ImageStats::set_count(const std::string &counter, long long value)
+{
+    add_value(_counts, counter, value, true);
+}
+
+static std::string json_escape(const std::string &s)
+{
+    std::string result;
+    for (char c : s) {
+        if (c == '"' || c == '\\') result += '\\';
+        result += c;
+    }
+    return result;
+}
+
+void ImageStats::write_json(std::ostream &os) const
+{
+    // formatted locally to leave the flags of os untouched
+    std::ostringstream line;
+    line << "{\"image\":\"" << json_escape(_name) << "\",\"times_ms\":{";
+    for (size_t i = 0; i < _times.size(); i++) {
+        line << (i ? "," : "") << "\"" << json_escape(_times[i].first) << "\":" 
+             << std::fixed << std::setprecision(3) << _times[i].second;
+    }
+    line << "},\"counts\":{";
+    for (size_t i = 0; i < _counts.size(); i++) {
+        line << (i ? "," : "") << "\"" << json_escape(_counts[i].first) << "\":" 
+             << _counts[i].second;
+    }
+    line << "}}";
+    os << line.str() << std::endl;
+}
+
+void ScopedStageTimer::stop()
+{
+    if (_timer.is_stopped()) return;
+    _timer.stop();
+
+    double ms = _timer.elapsed().wall / 1.0e6;
+    ImageStats *stats = ImageStats::current();
+    if (!stats) return;
+    stats->add_time(_stage, ms);
+
+    if (stats->verbose()) {
+        std::cout << _stage << " in " 
+                  << boost::timer::format(_timer.elapsed(), 5, "%w") << std::endl;
+    }
+}
+
+void StatsCollector::add(const ImageStats &stats)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stats.push_back(stats);
+    if (_os && _format == JSON_LINES) {
+        stats.write_json(*_os);
+    }
+}
+
+/**
+ *  Returns the columns of all images in the order of their first occurrence
+ */
+template <class V>
+static std::vector<std::string> collect_keys(
+    const std::vector<ImageStats> &stats,
+    const std::vector<std::pair<std::string, V> > &(ImageStats::*values)() const)
+{
+    std::vector<std::string> keys;
+    for (const ImageStats &s : stats) {
+        for (const std::pair<std::string, V> &v : (s.*values)()) {
+            if (std::find(keys.begin(), keys.end(), v.first) == keys.end())
+                keys.push_back(v.first);
+        }
+    }
+    return keys;
+}
+
+template <class V>
+static bool find_value(
+    const std::vector<std::pair<std::string, V> > &values, 
+    const std::string &key, V &value)
+{
+    for (const std::pair<std::string, V> &v : values) {
+        if (v.first == key) {
+            value = v.second;
+            return true;
+        }
+    }
+    return false;
+}
+
+void StatsCollector::finish()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!_os || _format != CSV) return;
+
+    std::vector<std::string> time_keys(collect_keys(_stats, &ImageStats::times));
+    std::vector<std::string> count_keys(collect_keys(_stats, &ImageStats::counts));
+
+    std::ostringstream os;
+    os << "image";
+    for (const std::string &k : time_keys) os << "," << k << "_ms";
+    for (const std::string &k : count_keys) os << "," << k;
+    os << std::endl;
+
+    for (const ImageStats &s : _stats) {
+        os << s.name();
+        for (const std::string &k : time_keys) {
+            double v;
+            os << ",";
+            if (find_value(s.times(), k, v)) 
+                os << std::fixed << std::setprecision(3) << v;
+        }
+        for (const std::string &k : count_keys) {
+            long long v;
+            os << ",";
+            if (find_value(s.counts(), k, v)) 
+                os << v;
+        }
+        os << std::endl;
+    }
+    *_os << os.str() << std::flush;
+}
+
+double percentile(const std::vector<double> &sorted, double p)
+{
+    if (sorted.empty()) return 0.0;
+    size_t rank = size_t(std::ceil(p / 100.0 * sorted.size()));
+    return sorted[std::min(sorted.size(), std::max<size_t>(1, rank)) - 1];
+}
+
+static void write_summary_row(std::ostream &os, const std::string &name, 
+    std::vector<double> values)
+{
+    std::sort(values.begin(), values.end());
+    os << std::left << std::setw(24) << name << std::right
+       << std::setw(8) << values.size()
+       << std::fixed << std::setprecision(2)
+       << std::setw(12) << percentile(values, 50)
+       << std::setw(12) << percentile(values, 95)
+       << std::setw(12) << percentile(values, 99)
+       << std::setw(12) << (values.empty() ? 0.0 : values.back())
+       << std::endl;
+}
+
+void StatsCollector::write_summary(std::ostream &out) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    // formatted locally to leave the flags of out untouched
+    std::ostringstream os;
+    std::vector<std::string> time_keys(collect_keys(_stats, &ImageStats::times));
+    std::vector<std::string> count_keys(collect_keys(_stats, &ImageStats::counts));
+
+    os << std::left << std::setw(24) << "stage [ms] / counter" << std::right
+       << std::setw(8) << "n"
+       << std::setw(12) << "p50"
+       << std::setw(12) << "p95"
+       << std::setw(12) << "p99"
+       << std::setw(12) << "max" << std::endl;
+    for (const std::string &k : time_keys) {
+        std::vector<double> values;
+        for (const ImageStats &s : _stats) {
+            double v;
+            if (find_value(s.times(), k, v)) values.push_back(v);
+        }
+        write_summary_row(os, k, values);
+    }
+    for (const std::string &k : count_keys) {
+        std::vector<double> values;
+        for (const ImageStats &s : _stats) {
+            long long v;
+            if (find_value(s.counts(), k, v)) values.push_back(double(v));
+        }
+        write_summary_row(os, k, values);
+    }
+    out << os.str() << std::flush;
+}
+
+}
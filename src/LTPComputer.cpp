@@ -16,6 +16,7 @@
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include <text_detector/LTPComputer.h>
+#include <text_detector/CpuDispatch.h>
 
 #include <opencv2/imgproc/imgproc.hpp>
 #include <opencv2/highgui/highgui.hpp>
@@ -29,132 +30,61 @@ LTPComputer::LTPComputer(int maps)
 
 static cv::Mat gy(const cv::Mat &rgb_image)
 {
+    const CpuKernels &kernels = get_cpu_kernels();
     cv::Mat result(rgb_image.rows, rgb_image.cols, CV_32FC1, cv::Scalar(0.0f));
-    const unsigned char* ptr = (const unsigned char*)rgb_image.data;
-    float *result_ptr = (float*) result.data;
+    // the last row has no lower neighbour and stays 0
     #pragma omp parallel for
-    for (int i = 0; i < rgb_image.rows; i++) {
-        for (int j = 0; j < rgb_image.cols; j++) {
-            const float r1 = *(ptr + i * rgb_image.step[0] + j * rgb_image.step[1] + 0) / 255.0f;
-            const float g1 = *(ptr + i * rgb_image.step[0] + j * rgb_image.step[1] + 1) / 255.0f;
-            const float b1 = *(ptr + i * rgb_image.step[0] + j * rgb_image.step[1] + 2) / 255.0f;
-
-            const float r2 = (i+1) >= rgb_image.rows ? r1 : (*(ptr+(i+1) * rgb_image.step[0] + j * rgb_image.step[1] + 0) / 255.0f);
-            const float g2 = (i+1) >= rgb_image.rows ? g1 : (*(ptr+(i+1) * rgb_image.step[0] + j * rgb_image.step[1] + 1) / 255.0f);
-            const float b2 = (i+1) >= rgb_image.rows ? b1 : (*(ptr+(i+1) * rgb_image.step[0] + j * rgb_image.step[1] + 2) / 255.0f);
-
-            float max = std::abs(r1 - r2);
-            float maxval = r1 - r2;
-            if (std::abs(g1 - g2) > max) {
-                max = std::abs(g1 - g2);
-                maxval = g1 - g2;
-            }
-            if (std::abs(b1 - b2) > max) {
-                max = std::abs(b1 - b2);
-                maxval = b1 - b2;
-            }
-            *(result_ptr + i * result.step[0]/4 + j * result.step[1]/4) = maxval;
-        }
+    for (int i = 0; i < rgb_image.rows - 1; i++) {
+        kernels.max_channel_diff(rgb_image.ptr<uchar>(i), rgb_image.ptr<uchar>(i+1), 
+                                 rgb_image.cols, result.ptr<float>(i));
     }
     return result;
 }
 
 static cv::Mat gx(const cv::Mat &rgb_image)
 {
+    const CpuKernels &kernels = get_cpu_kernels();
     cv::Mat result(rgb_image.rows, rgb_image.cols, CV_32FC1, cv::Scalar(0.0f));
-    const unsigned char* ptr = (const unsigned char*)rgb_image.data;
-    float *result_ptr = (float*) result.data;
+    // the last column has no right neighbour and stays 0
     #pragma omp parallel for
     for (int i = 0; i < rgb_image.rows; i++) {
-        for (int j = 0; j < rgb_image.cols; j++) {
-            const float r1 = *(ptr + i * rgb_image.step[0] + j * rgb_image.step[1] + 0) / 255.0f;
-            const float g1 = *(ptr + i * rgb_image.step[0] + j * rgb_image.step[1] + 1) / 255.0f;
-            const float b1 = *(ptr + i * rgb_image.step[0] + j * rgb_image.step[1] + 2) / 255.0f;
-
-            const float r2 = (j+1) >= rgb_image.cols ? r1 : (*(ptr+i * rgb_image.step[0] + (j+1) * rgb_image.step[1] + 0) / 255.0f);
-            const float g2 = (j+1) >= rgb_image.cols ? g1 : (*(ptr+i * rgb_image.step[0] + (j+1) * rgb_image.step[1] + 1) / 255.0f);
-            const float b2 = (j+1) >= rgb_image.cols ? b1 : (*(ptr+i * rgb_image.step[0] + (j+1) * rgb_image.step[1] + 2) / 255.0f);
-
-            float max = std::abs(r1 - r2);
-            float maxval = r1 - r2;
-            if (std::abs(g1 - g2) > max) {
-                max = std::abs(g1 - g2);
-                maxval = g1 - g2;
-            }
-            if (std::abs(b1 - b2) > max) {
-                max = std::abs(b1 - b2);
-                maxval = b1 - b2;
-            }
-            *(result_ptr + i * result.step[0]/4 + j * result.step[1]/4) = maxval;
-        }
+        const uchar *row = rgb_image.ptr<uchar>(i);
+        kernels.max_channel_diff(row, row + 3, rgb_image.cols - 1, result.ptr<float>(i));
     }
     return result;
 }
 
 static cv::Mat gad(const cv::Mat &rgb_image) 
 {
+    const CpuKernels &kernels = get_cpu_kernels();
     cv::Mat result(rgb_image.rows, rgb_image.cols, CV_32FC1, cv::Scalar(0.0f));
-    const unsigned char* ptr = (const unsigned char*)rgb_image.data;
-    float *result_ptr = (float*) result.data;
+    const int last = rgb_image.cols - 1;
     #pragma omp parallel for
     for (int i = 0; i < rgb_image.rows; i++) {
-        for (int j = 0; j < rgb_image.cols; j++) {
-            // center (1)
-            const float r1 = *(ptr + i * rgb_image.step[0] + j * rgb_image.step[1] + 0) / 255.0f;
-            const float g1 = *(ptr + i * rgb_image.step[0] + j * rgb_image.step[1] + 1) / 255.0f;
-            const float b1 = *(ptr + i * rgb_image.step[0] + j * rgb_image.step[1] + 2) / 255.0f;
-
-            // diagonal to upper right
-            const float r2 = *(ptr+(MAX(0, i-1)) * rgb_image.step[0] + MIN(j+1, rgb_image.cols-1) * rgb_image.step[1] + 0) / 255.0f;
-            const float g2 = *(ptr+(MAX(0, i-1)) * rgb_image.step[0] + MIN(j+1, rgb_image.cols-1) * rgb_image.step[1] + 1) / 255.0f;
-            const float b2 = *(ptr+(MAX(0, i-1)) * rgb_image.step[0] + MIN(j+1, rgb_image.cols-1) * rgb_image.step[1] + 2) / 255.0f;
-
-            float max = std::abs(r1 - r2);
-            float maxval = r1 - r2;
-            if (std::abs(g1 - g2) > max) {
-                max = std::abs(g1 - g2);
-                maxval = g1 - g2;
-            }
-            if (std::abs(b1 - b2) > max) {
-                max = std::abs(b1 - b2);
-                maxval = b1 - b2;
-            }
-            *(result_ptr + i * result.step[0]/4 + j * result.step[1]/4) = maxval;
-        }
+        // center (1) and diagonal to upper right, clamped at the border
+        const uchar *row = rgb_image.ptr<uchar>(i);
+        const uchar *up = rgb_image.ptr<uchar>(MAX(0, i-1));
+        float *result_row = result.ptr<float>(i);
+        kernels.max_channel_diff(row, up + 3, last, result_row);
+        kernels.max_channel_diff(row + 3*last, up + 3*last, 1, result_row + last);
     }
     return result;
 }
 
 static cv::Mat gd(const cv::Mat &rgb_image) 
 {
+    const CpuKernels &kernels = get_cpu_kernels();
     cv::Mat result(rgb_image.rows, rgb_image.cols, CV_32FC1, cv::Scalar(0.0f));
-    const unsigned char* ptr = (const unsigned char*)rgb_image.data;
-    float *result_ptr = (float*) result.data;
+    const size_t pixel_step = rgb_image.step[1];
     #pragma omp parallel for
     for (int i = 0; i < rgb_image.rows; i++) {
-        for (int j = 0; j < rgb_image.cols; j++) {
-            // center (1)
-            const float r1 = *(ptr + i * rgb_image.step[0] + j * rgb_image.step[1] + 0) / 255.0f;
-            const float g1 = *(ptr + i * rgb_image.step[0] + j * rgb_image.step[1] + 1) / 255.0f;
-            const float b1 = *(ptr + i * rgb_image.step[0] + j * rgb_image.step[1] + 2) / 255.0f;
-
-            // diagonal to the upper left (-1)
-            const float r2 = *(ptr+(MAX(0, i-1)) * rgb_image.step[0] + MIN(j-1, rgb_image.cols - 1) * rgb_image.step[1] + 0) / 255.0f;
-            const float g2 = *(ptr+(MAX(0, i-1)) * rgb_image.step[0] + MIN(j-1, rgb_image.cols - 1) * rgb_image.step[1] + 1) / 255.0f;
-            const float b2 = *(ptr+(MAX(0, i-1)) * rgb_image.step[0] + MIN(j-1, rgb_image.cols - 1) * rgb_image.step[1] + 2) / 255.0f;
-
-            float max = std::abs(r1 - r2);
-            float maxval = r1 - r2;
-            if (std::abs(g1 - g2) > max) {
-                max = std::abs(g1 - g2);
-                maxval = g1 - g2;
-            }
-            if (std::abs(b1 - b2) > max) {
-                max = std::abs(b1 - b2);
-                maxval = b1 - b2;
-            }
-            *(result_ptr + i * result.step[0]/4 + j * result.step[1]/4) = maxval;
-        }
+        // center (1) and diagonal to the upper left (-1). The column is not
+        // clamped at the left border, the models were trained this way.
+        const uchar *row = rgb_image.ptr<uchar>(i);
+        const uchar *up = rgb_image.data + MAX(0, i-1) * rgb_image.step[0];
+        float *result_row = result.ptr<float>(i);
+        kernels.max_channel_diff(row, up - pixel_step, 1, result_row);
+        kernels.max_channel_diff(row + 3, up, rgb_image.cols - 1, result_row + 1);
     }
     return result;
 }
@@ -172,57 +102,25 @@ make_ltp(
     const cv::Mat &grad_d, 
     const cv::Mat &grad_ad)
 {
-    unsigned char *ptr = (unsigned char *) result.data;
-
-    const float *e_x_ptr  = (const float *) e_x.data;
-    const float *e_y_ptr  = (const float *) e_y.data;
-    const float *e_d_ptr  = (const float *) e_d.data;
-    const float *e_ad_ptr = (const float *) e_ad.data;
-
-    const float *grad_x_ptr  = (const float *) grad_x.data;
-    const float *grad_y_ptr  = (const float *) grad_y.data;
-    const float *grad_d_ptr  = (const float *) grad_d.data;
-    const float *grad_ad_ptr = (const float *) grad_ad.data;
+    const CpuKernels &kernels = get_cpu_kernels();
+    // the neighbours outside of the image have a gradient of 0
+    const std::vector<float> zeros(result.cols, 0.0f);
 
     #pragma omp parallel for
     for (int i = 0; i < result.rows; i++) {
-        for (int j = 0; j < result.cols; j++) {
-            {
-            bool right    = *(grad_x_ptr  + i * grad_x.step[0]/4  + j * grad_x.step[1]/4)  > *(e_x_ptr  + i * e_x.step[0]/4  + j * e_x.step[1]/4);
-            bool down     = *(grad_y_ptr  + i * grad_y.step[0]/4  + j * grad_y.step[1]/4)  > *(e_y_ptr  + i * e_y.step[0]/4  + j * e_y.step[1]/4);
-            bool upleft   = *(grad_d_ptr  + i * grad_d.step[0]/4  + j * grad_d.step[1]/4)  > *(e_d_ptr  + i * e_d.step[0]/4  + j * e_d.step[1]/4);
-            bool upright  = *(grad_ad_ptr + i * grad_ad.step[0]/4 + j * grad_ad.step[1]/4) > *(e_ad_ptr + i * e_ad.step[0]/4 + j * e_ad.step[1]/4);
-
-            bool left      = (j == 0 ? 0.0f : -*(grad_x_ptr  +     i * grad_x.step[0]/4  + (j-1) * grad_x.step[1]/4))  > *(e_x_ptr  + i * e_x.step[0]/4  + j * e_x.step[1]/4);
-            bool up        = (i == 0 ? 0.0f : -*(grad_y_ptr  + (i-1) * grad_y.step[0]/4  +     j * grad_y.step[1]/4))  > *(e_y_ptr  + i * e_y.step[0]/4  + j * e_y.step[1]/4);
-            bool downright = (i+1 >= result.rows || j+1 >= result.cols) ? 0.0f : 
-                        -*(grad_d_ptr  + (i+1) * grad_d.step[0]/4  + (j+1) * grad_d.step[1]/4)  > *(e_d_ptr  + i * e_d.step[0]/4  + j * e_d.step[1]/4);
-            bool downleft = (i+1 >= result.rows || j == 0) ? 0.0f : 
-                        -*(grad_ad_ptr + (i+1) * grad_ad.step[0]/4 + (j-1) * grad_ad.step[1]/4) > *(e_ad_ptr + i * e_ad.step[0]/4 + j * e_ad.step[1]/4);
-
-
-            unsigned char lbp = down + upleft * 2 + right * 4 + upright * 8 + up * 16 + downright * 32 + left * 64 + downleft * 128;
-            *(ptr+result.step[0] * i + result.step[1] * j + l*2) = lbp;
-            }
-            {
-            bool right    = *(grad_x_ptr  + i * grad_x.step[0]/4  + j * grad_x.step[1]/4)  < -*(e_x_ptr  + i * e_x.step[0]/4  + j * e_x.step[1]/4);
-            bool down     = *(grad_y_ptr  + i * grad_y.step[0]/4  + j * grad_y.step[1]/4)  < -*(e_y_ptr  + i * e_y.step[0]/4  + j * e_y.step[1]/4);
-            bool upleft   = *(grad_d_ptr  + i * grad_d.step[0]/4  + j * grad_d.step[1]/4)  < -*(e_d_ptr  + i * e_d.step[0]/4  + j * e_d.step[1]/4);
-            bool upright  = *(grad_ad_ptr + i * grad_ad.step[0]/4 + j * grad_ad.step[1]/4) < -*(e_ad_ptr + i * e_ad.step[0]/4 + j * e_ad.step[1]/4);
-
-            bool left      = (j == 0 ? 0.0f : -*(grad_x_ptr  + i * grad_x.step[0]/4  + (j-1) * grad_x.step[1]/4))  < -*(e_x_ptr  + i * e_x.step[0]/4  + j * e_x.step[1]/4);
-            bool up        = (i == 0 ? 0.0f : -*(grad_y_ptr  + (i-1) * grad_y.step[0]/4  + j * grad_y.step[1]/4))  < -*(e_y_ptr  + i * e_y.step[0]/4  + j * e_y.step[1]/4);
-            bool downright = (i+1 >= result.rows || j+1 >= result.cols) ? 0.0f : 
-                        -*(grad_d_ptr + (i+1) * grad_d.step[0]/4 + (j+1) * grad_d.step[1]/4) < -*(e_d_ptr + i * e_d.step[0]/4 + j * e_d.step[1]/4);
-            bool downleft = (i+1 >= result.rows || j == 0) ? 0.0f : 
-                        -*(grad_ad_ptr + (i+1) * grad_ad.step[0]/4 + (j-1) * grad_ad.step[1]/4) < -*(e_ad_ptr + i * e_ad.step[0]/4 + j * e_ad.step[1]/4);
-
-
-
-            unsigned char lbp = down + upleft * 2 + right * 4 + upright * 8 + up * 16 + downright * 32 + left * 64 + downleft * 128;
-            *(ptr+result.step[0] * i + result.step[1] * j + l*2+1) = lbp;
-            }
-        }
+        LtpRow row;
+        row.grad[0] = grad_x.ptr<float>(i);
+        row.grad[1] = grad_y.ptr<float>(i);
+        row.grad[2] = grad_d.ptr<float>(i);
+        row.grad[3] = grad_ad.ptr<float>(i);
+        row.up_y = i == 0 ? zeros.data() : grad_y.ptr<float>(i-1);
+        row.down_d = i+1 >= result.rows ? zeros.data() : grad_d.ptr<float>(i+1);
+        row.down_ad = i+1 >= result.rows ? zeros.data() : grad_ad.ptr<float>(i+1);
+        row.e[0] = e_x.ptr<float>(i);
+        row.e[1] = e_y.ptr<float>(i);
+        row.e[2] = e_d.ptr<float>(i);
+        row.e[3] = e_ad.ptr<float>(i);
+        kernels.ltp_row(row, result.cols, result.ptr<uchar>(i) + l*2, result.step[1]);
     }
 }
 
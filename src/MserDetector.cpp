@@ -17,7 +17,6 @@
  */
 #include <text_detector/MserDetector.h>
 
-#include <boost/timer/timer.hpp>
 #include <opencv2/core/operations.hpp>
 #include <opencv2/core/types_c.h>
 #include <opencv2/highgui/highgui.hpp>
@@ -32,6 +31,8 @@
 #include <string>
 
 #include <text_detector/BinaryMaskExtractor.h>
+#include <text_detector/CacheManager.h>
+#include <text_detector/ComponentDeduplicator.h>
 //#include <text_detector/CCUtils.h>
 #include <text_detector/CNN.h>
 #include <text_detector/CNNConnectedComponentClassifier.h>
@@ -40,11 +41,14 @@
 #include <text_detector/CRFLinConnectedComponentFilterer.h>
 #include <text_detector/CRFRFConnectedComponentFilterer.h>
 #include <text_detector/HardPPWordSplitter.h>
+#include <text_detector/Instrumentation.h>
 #include <text_detector/LibSVMClassifier.h>
 #include <text_detector/ModelManager.h>
 #include <text_detector/MserExtractorFast.h>
 #include <text_detector/MserExtractor.h>
+#include <text_detector/OverlapSuppression.h>
 #include <text_detector/RFConnectedComponentClassifier.h>
+#include <text_detector/ReplayBundle.h>
 #include <text_detector/RFConnectedComponentFilterer.h>
 #include <text_detector/SimpleWordSplitter.h>
 #include <text_detector/SoftPPWordSplitter.h>
@@ -54,10 +58,64 @@
 namespace TextDetector {
 
 MserDetector::MserDetector(const std::shared_ptr<ConfigurationManager> &mgr)
-: _config_manager(mgr), _model_manager(new ModelManager(mgr))
+: _context(mgr), _model_manager(new ModelManager(mgr))
 {
 }
 
+MserDetector::MserDetector(const DetectorContext &context)
+: _context(context), _model_manager(new ModelManager(context.config))
+{
+    if (_context.cache && _context.model_digest.empty())
+        _context.model_digest = compute_model_digest(*_context.config);
+}
+
+MserDetector::MserDetector(const MserDetector &detector, const std::shared_ptr<ConfigurationManager> &cfg)
+: _context(detector._context), _model_manager(detector._model_manager)
+{
+    _context.config = cfg;
+}
+
+/**
+ *  Adds the svm model file and the files it references (see 
+ *  LibSVMClassifier) to the key
+ */
+static void add_svm_model_files(CacheKey &key, const std::string &filename)
+{
+    key.add_file(filename);
+    cv::FileStorage fs(filename, cv::FileStorage::READ);
+    const char *references[] = { 
+        "libsvm_model_file", "means_file", "stds_file", "sigmoid_scale_file" 
+    };
+    for (size_t i = 0; i < sizeof (references) / sizeof (references[0]); i++) {
+        std::string path;
+        fs[references[i]] >> path;
+        key.add_file(path);
+    }
+}
+
+std::string MserDetector::compute_model_digest(const ConfigurationManager &config)
+{
+    CacheKey key;
+    int model = config.get_preclassification_model();
+    key.add(int64_t(model));
+    switch (model) {
+    case ConfigurationManager::PRE_CLASSIFICATION_MODEL_CNN:
+        key.add_file(config.get_cnn_model_file());
+        break;
+    case ConfigurationManager::PRE_CLASSIFICATION_MODEL_RANDOM_FOREST:
+        key.add_file(config.get_rf_model_file());
+        break;
+    case ConfigurationManager::PRE_CLASSIFICATION_MODEL_RF_SVM_ENSEMBLE:
+        key.add_file(config.get_rf_model_file());
+        add_svm_model_files(key, config.get_svm_model_file());
+        break;
+    case ConfigurationManager::PRE_CLASSIFICATION_MODEL_SVM:
+        add_svm_model_files(key, config.get_svm_model_file());
+        break;
+    }
+    return key.str();
+}
+
 MserDetector::~MserDetector()
 {
 }
@@ -86,10 +144,10 @@ MserDetector::get_connected_component_filter(
     const cv::Mat &grad_image,
     const cv::Mat &unary_features) const
 {
-    switch (ConfigurationManager::instance()->get_classification_model()) {
+    switch (_context.config->get_classification_model()) {
         case ConfigurationManager::CLASSIFICATION_MODEL_RANDOM_FOREST:
             return std::shared_ptr<ConnectedComponentFilterer>(
-            	new RFConnectedComponentFilterer(0, _config_manager->get_pre_classification_prob_threshold()));
+            	new RFConnectedComponentFilterer(0, _context.config->get_pre_classification_prob_threshold()));
         case ConfigurationManager::CLASSIFICATION_MODEL_CRF_LIN:
             return std::shared_ptr<ConnectedComponentFilterer>(
                 new CRFLinConnectedComponentFilterer(train_image,
@@ -110,7 +168,7 @@ MserDetector::get_connected_component_filter(
 std::shared_ptr<TextDetector::ConnectedComponentClassifier>
 MserDetector::get_connected_component_classifier() const
 {
-	switch (_config_manager->get_preclassification_model()) {
+	switch (_context.config->get_preclassification_model()) {
 	case ConfigurationManager::PRE_CLASSIFICATION_MODEL_CNN:
 		return std::make_shared<TextDetector::CNNConnectedComponentClassifier>(
             _model_manager->get_unary_cnn_classifier());
@@ -151,8 +209,14 @@ void MserDetector::extract_components_on_channels(
 {
     std::shared_ptr<TextDetector::ConnectedComponentClassifier> clf(
         get_connected_component_classifier());
+    std::shared_ptr<ComponentDeduplicator> dedup;
+    if (_context.config->deduplicate_channels() && img_channels.size() > 1)
+        dedup = std::make_shared<ComponentDeduplicator>();
+    // the feature keys of all channels contain the color image
+    std::string image_digest;
+    if (_context.cache)
+        image_digest = CacheKey().add(input_image).str();
 
-	boost::timer::cpu_timer t;
     for (int chan = 0; chan < img_channels.size(); chan++) {
         cv::Mat train_image_gray = img_channels[chan];
 
@@ -161,17 +225,19 @@ void MserDetector::extract_components_on_channels(
         std::vector<std::pair<int, std::vector<cv::Point> > > comps;
         cv::Mat unary_features;
         std::vector<MserElement> elements;
-        int start_idx = all_probs.size();
 
-        if (!_config_manager->include_binary_masks() ||
+        if (!_context.config->include_binary_masks() ||
             chan < img_channels.size() - 1) {
             TextDetector::MserExtractorFast extractor(
+                _context,
                 input_image,
                 train_image_gray,
                 detector_mask,
                 gradient_image,
                 clf,
                 all_probs.size());
+            extractor.set_deduplicator(dedup);
+            extractor.set_image_digest(image_digest);
 
             extractor.extract(
                 unary_features,
@@ -180,6 +246,7 @@ void MserDetector::extract_components_on_channels(
                 comps, elements);
         } else {
             TextDetector::BinaryMaskExtractor extractor(
+                _context,
                 input_image,
                 train_image_gray,
                 detector_mask,
@@ -194,14 +261,11 @@ void MserDetector::extract_components_on_channels(
                 comps, elements);
         }
 
-        t.start();
         append(all_unary_features, unary_features);
         append(all_probs, probs);
         append(all_per_classifier_probs, per_classifier_probs);
         append(all_comps, comps);
         append(all_elements, elements);
-        if (_config_manager->verbose())
-            std::cout << "Accumulated CCs " << all_comps.size() <<  " in " << boost::timer::format(t.elapsed(), 5, "%w") << std::endl;
         //cv::Mat img(input_image.rows, input_image.cols, CV_8UC3, cv::Scalar(255, 255, 255));
         //for (int i = 0; i < all_comps.size(); i++) {
         //
@@ -215,46 +279,21 @@ void MserDetector::extract_components_on_channels(
         //}
         //cv::imshow("Connected components", img);
         //cv::waitKey(0);
-
-        t.start();
-        if (start_idx > 0)
-            filter_overlapping_components(all_comps, all_elements, all_probs);
-        if (_config_manager->verbose())
-            std::cout << "Merged overlapping CCs: " << all_comps.size() << "  in " << boost::timer::format(t.elapsed(), 5, "%w") << std::endl;
     }
-}
 
-static float do_intersect_fast(const MserElement &el1, const MserElement &el2, bool reverse=false)
-{
-    float area1 = el1.get_bounding_rect().width * el1.get_bounding_rect().height;
-    float area2 = el2.get_bounding_rect().width * el2.get_bounding_rect().height;
-    const MserElement &smaller = area1 < area2 ? el1 : el2;
-    const MserElement &bigger = area1 >= area2 ? el1 : el2;
-    std::vector<cv::Point> px1 = smaller.get_pixels();
-    std::vector<cv::Point> px2 = bigger.get_pixels();
-    cv::Rect smaller_rect = smaller.get_bounding_rect();
-    cv::Rect bigger_rect = bigger.get_bounding_rect();
-
-    cv::Mat bitmap(smaller.get_bounding_rect().height, smaller.get_bounding_rect().width, CV_8UC1, cv::Scalar(0));
-    for (cv::Point p : px1) {
-        bitmap.at<unsigned char>(p.y - smaller_rect.y, p.x - smaller_rect.x) = 255;
+    // the components of all channels are deduplicated at once
+    if (img_channels.size() > 1) {
+        ScopedStageTimer overlap_timer("overlap");
+        filter_overlapping_components(all_comps, all_elements, all_probs);
     }
 
-    float area = 0;
-    for (cv::Point p : px2) {
-        int x = p.x - smaller_rect.x;
-        int y = p.y - smaller_rect.y;
-        if (x < 0 || y < 0 || x >= smaller_rect.width || y >= smaller_rect.height) continue;
-
-        if (bitmap.at<unsigned char>(y,x)) {
-            area += 1.0f;
-        }
-    }
-    if (reverse) {
-        return area / std::min(px1.size(), px2.size());
-    } else {
-        return area / std::max(px1.size(), px2.size());
+    // bytes held by the pixel lists of the surviving components
+    size_t pixel_bytes = 0;
+    for (size_t i = 0; i < all_comps.size(); i++) {
+        pixel_bytes += all_comps[i].second.capacity() * sizeof(cv::Point);
     }
+    set_stat("overlap_components", all_comps.size());
+    set_stat("component_bytes", pixel_bytes);
 }
 
 void MserDetector::filter_overlapping_components(
@@ -262,62 +301,51 @@ void MserDetector::filter_overlapping_components(
     const std::vector<MserElement> &all_elements,
     const std::vector<double> &probs) const
 {
-    // because of parallelism std::vector<_int_> is needed instead of std::vector<_bool_>
-    std::vector<int> remove_mask(comps.size(), 0);
-    #pragma omp parallel for
-    for (int i = 0; i < comps.size(); i++) {
-        cv::Rect bbox_i = all_elements[comps[i].first].get_bounding_rect();
-        int area_i = bbox_i.width * bbox_i.height;
-        for (int j = i+1; j < comps.size(); j++) {
-            cv::Rect bbox_j = all_elements[comps[j].first].get_bounding_rect();
-            cv::Rect intersect = bbox_i & bbox_j;
-            cv::Rect rect_union = bbox_i | bbox_j;
-            int area_intersect = intersect.width * intersect.height;
-            int area_j = bbox_j.width * bbox_j.height;
-            int area_union = rect_union.width * rect_union.height;
-
-            if (area_intersect == 0) continue;
-
-            if (float(area_intersect) / std::max(area_i, area_j) > 0.4) {
-                if (do_intersect_fast(all_elements[comps[i].first], all_elements[comps[j].first]) > 0.4) {
-                    remove_mask[probs[comps[i].first] > probs[comps[j].first] ? j : i] = true;
-                }
-            }
-        }
+    std::vector<cv::Rect> rects(comps.size());
+    std::vector<double> comp_probs(comps.size());
+    ComponentRuns runs;
+    for (size_t i = 0; i < comps.size(); i++) {
+        rects[i] = all_elements[comps[i].first].get_bounding_rect();
+        comp_probs[i] = probs[comps[i].first];
+        runs.add(comps[i].second);
     }
-
-    std::vector<std::pair<int, std::vector<cv::Point> > > result;
-    result.reserve(comps.size());
-    for (int i = 0; i < comps.size(); i++) {
-        if (!remove_mask[i])
-            result.push_back(comps[i]);
+    std::vector<unsigned char> remove_mask =
+        find_overlapping_components(rects, runs, comp_probs, 0.4);
+
+    // erase the removed components in place
+    size_t n = 0;
+    for (size_t i = 0; i < comps.size(); i++) {
+        if (remove_mask[i])
+            continue;
+        if (n != i)
+            comps[n] = std::move(comps[i]);
+        n++;
     }
-
-    comps = result;
+    comps.erase(comps.begin() + n, comps.end());
 }
 
 
 std::shared_ptr<WordSplitter>
 MserDetector::get_word_splitter() const
 {
-    switch (_config_manager->get_word_split_model()) {
+    switch (_context.config->get_word_split_model()) {
         case ConfigurationManager::MODEL_PROJECTION_PROFILE:
             return std::shared_ptr<HardPPWordSplitter>(
                 new HardPPWordSplitter(
-                    _config_manager->allow_single_letters(),
+                    _context.config->allow_single_letters(),
                     false));
                     //ConfigurationManager::instance()->verbose()));
         case ConfigurationManager::MODEL_SIMPLE:
             return std::shared_ptr<SimplePPWordSplitter>(
                 new SimplePPWordSplitter(
-                    _config_manager->allow_single_letters(),
+                    _context.config->allow_single_letters(),
                     false));
                     //ConfigurationManager::instance()->verbose()));
         case ConfigurationManager::MODEL_PROJECTION_PROFILE_SOFT:
         default:
             return std::shared_ptr<SoftPPWordSplitter>(
                 new SoftPPWordSplitter(
-                    _config_manager->allow_single_letters(),
+                    _context.config->allow_single_letters(),
                     false));
                     //ConfigurationManager::instance()->verbose()));
     }
@@ -327,12 +355,11 @@ static cv::Mat
 show_groups_color(
     const std::vector<CCGroup> &groups,
     const cv::Size &window_size,
-    const std::vector<double> &probs,
     bool show=false)
 {
     cv::Mat img(window_size.height, window_size.width, CV_8UC3, cv::Scalar(255,255,255));
-    for (CCGroup g : groups) {
-        img = g.draw(window_size, probs, img, false);
+    for (const CCGroup &g : groups) {
+        img = g.draw(window_size, img, false);
     }
     if (show) {
         cv::imshow("GROUPS", img);
@@ -346,6 +373,17 @@ std::vector<cv::Rect> MserDetector::operator()(
     cv::Mat &result_image,
     const cv::Mat &detector_mask,
     const cv::Mat &extra_bin_mask) const
+{
+    ExtractedComponents components;
+    extract_components(input_image, detector_mask, extra_bin_mask, components);
+    return detect_words(input_image, components, result_image);
+}
+
+void MserDetector::extract_components(
+    const cv::Mat &input_image,
+    const cv::Mat &detector_mask,
+    const cv::Mat &extra_bin_mask,
+    ExtractedComponents &components) const
 {
 	if (!detector_mask.empty() && detector_mask.type() != CV_8UC1) 
 		throw std::runtime_error("Unexpected detector mask type");
@@ -375,13 +413,13 @@ std::vector<cv::Rect> MserDetector::operator()(
 
     cv::Mat image_gray;
     cv::cvtColor(input_image, image_gray, CV_RGB2GRAY);
-    cv::Mat gradient_image = compute_gradient(input_image);
+    components.gradient_image = compute_gradient(input_image);
 
     std::vector<cv::Mat> img_channels;
-    if (!_config_manager->ignore_gray()) {
+    if (!_context.config->ignore_gray()) {
         img_channels.push_back(image_gray);
     }
-    if (!_config_manager->ignore_color()) {
+    if (!_context.config->ignore_color()) {
         img_channels.push_back(chans[1]);
         img_channels.push_back(chans[2]);
     }
@@ -389,79 +427,77 @@ std::vector<cv::Rect> MserDetector::operator()(
     if (!extra_bin_mask.empty())
         img_channels.push_back(extra_bin_mask);
 
-
-    std::vector<double> all_probs;
-    std::vector<std::vector<double> > all_per_classifier_probs;
-    cv::Mat all_unary_features;
-    std::vector<std::pair<int, std::vector<cv::Point> > > all_comps;
-    std::vector<MserElement> all_elements;
-
-    extract_components_on_channels(input_image, gradient_image,
+    extract_components_on_channels(input_image, components.gradient_image,
         img_channels, mask,
-    	all_probs, all_per_classifier_probs, all_unary_features,
-    	all_comps, all_elements);
-
-    boost::timer::cpu_timer t;
-    all_comps = get_connected_component_filter(
-        input_image, gradient_image, all_unary_features
-    )->filter_compontents(all_comps, all_elements, all_per_classifier_probs);
-
-    //cv::Mat img(train_image.rows, train_image.cols, CV_8UC3, cv::Scalar(255, 255, 255));
-    //for (int i = 0; i < all_comps.size(); i++) {
-    //
-    //    int idx = all_comps[i].first;
-    //    float proba = all_probs[idx];
-    //    int greenish = proba * 255;
-    //    if (proba <= 0.0) continue;
-    //    for (cv::Point pt : all_comps[i].second) {
-    //        img.at<cv::Vec3b>(pt.y, pt.x) = cv::Vec3b(0, greenish, 255-greenish);
-    //    }
-    //}
-    ////cv::imwrite("IMFG2.png", img);
-    //cv::imshow("Connected components", img);
-    //cv::waitKey(0);
-
-    if (_config_manager->verbose()) {
-        std::cout << "Filtered components in "
-        		  << boost::timer::format(t.elapsed(), 5, "%w")
-        		  << std::endl;
-    }
+    	components.probs, components.per_classifier_probs,
+    	components.unary_features, components.comps, components.elements);
+}
 
-    t.start();
-    std::vector<CCGroup> groups;
-    ConnectedComponentGrouper grouper;
-    grouper(input_image, gradient_image, all_probs,
-    		all_elements, all_comps, groups);
-    if (_config_manager->verbose()) {
-        std::cout << "Grouped components in "
-        		  << boost::timer::format(t.elapsed(), 5, "%w")
-                  << std::endl;
-    }
+void MserDetector::filter_components(
+    const cv::Mat &input_image,
+    ExtractedComponents &components) const
+{
+    ScopedStageTimer crf_timer("crf");
+    components.comps = get_connected_component_filter(
+        input_image, components.gradient_image, components.unary_features
+    )->filter_compontents(components.comps, components.elements,
+        components.per_classifier_probs);
+}
 
+void MserDetector::group_components(
+    const cv::Mat &input_image,
+    const ExtractedComponents &components,
+    std::vector<CCGroup> &groups) const
+{
+    ScopedStageTimer group_timer("grouping");
+    ConnectedComponentGrouper grouper(_context.config);
+    grouper(input_image, components.gradient_image, components.probs,
+    		components.elements, components.comps, groups);
+}
 
-    // split into words...
+std::vector<cv::Rect> MserDetector::split_words(
+    const std::vector<CCGroup> &groups) const
+{
     std::vector<cv::Rect> words;
-    if (!_config_manager->ignore_word_splitting()) {
-        t.start();
+    if (!_context.config->ignore_word_splitting()) {
+        ScopedStageTimer split_timer("splitting");
         std::shared_ptr<WordSplitter> splitter(get_word_splitter());
-        for (int i = 0; i < groups.size(); i++) {
-            std::vector<cv::Rect> w(splitter->split(groups[i]));
-            words.insert(words.begin(), w.begin(), w.end());
-        }
-        if (_config_manager->verbose()) {
-            std::cout << "Split into words in " << boost::timer::format(t.elapsed(), 5, "%w") << std::endl;
-        }
+        words = splitter->split_all(groups);
     } else {
         words.reserve(groups.size());
         for (size_t i = 0; i < groups.size(); i++) {
             words.push_back(groups[i].get_rect());
         }
     }
+    set_stat("words", words.size());
+    return words;
+}
+
+std::vector<cv::Rect> MserDetector::detect_words(
+    const cv::Mat &input_image,
+    ExtractedComponents &components,
+    cv::Mat &result_image,
+    ReplayBundle *capture) const
+{
+    if (capture) {
+        capture->image = input_image;
+        capture->components = components;
+    }
+
+    filter_components(input_image, components);
+    if (capture) {
+        capture->filtered_comps = components.comps;
+    }
+
+    std::vector<CCGroup> groups;
+    group_components(input_image, components, groups);
+
+    std::vector<cv::Rect> words(split_words(groups));
 
     result_image = show_groups_color(
         groups,
         cv::Size(input_image.cols, input_image.rows),
-        all_probs, false);
+        false);
 
 	return words;
 }
@@ -33,6 +33,7 @@
 namespace TextDetector {
 
 MserExtractor::MserExtractor(
+    const DetectorContext &context,
     const cv::Mat &image_color, 
     const cv::Mat &image_gray,
     const cv::Mat &mask, 
@@ -44,7 +45,8 @@ MserExtractor::MserExtractor(
    _mask(mask),
    _gradient_image(gradient_image),
    _classifier(clf),
-   _uid_offset(uid_offset) {}
+   _uid_offset(uid_offset),
+   _context(context) {}
 
 MserExtractor::~MserExtractor()
 {
@@ -58,28 +60,27 @@ void MserExtractor::extract_msers(const boost::timer::cpu_timer& t,
 	cv::HierarchicalMSER mser(1, 1, 14400000, 0.5, 0.1, true);
 	// load the msers from cache if available - otherwise extract them
 	bool msers_loaded = true;
-	if (!ConfigurationManager::instance()->has_cache()) {
+	if (!_mser_cache) {
 		mser(_image_gray, msers, probs, hierarchy);
 		msers_loaded = false;
-	} else if (!CacheManager::instance()->get_msers(msers, hierarchy,
-			_uid_offset)) {
+	} else if (!_mser_cache->get_msers(msers, hierarchy)) {
 		mser(_image_gray, msers, probs, hierarchy);
 		msers_loaded = false;
 	}
 
-	if (ConfigurationManager::instance()->verbose())
+	if (_context.config->verbose())
 		std::cout << "Extracted " << msers.size() << " MSERs in "
 				<< boost::timer::format(t.elapsed(), 5, "%w") << std::endl;
 
-	if (ConfigurationManager::instance()->has_cache() && !msers_loaded) {
-		CacheManager::instance()->set_msers(msers, hierarchy, _uid_offset);
+	if (_mser_cache && !msers_loaded) {
+		_mser_cache->set_msers(msers, hierarchy);
 	}
 }
 
 void MserExtractor::compute_features(const cv::Mat& swt1, const cv::Mat& swt2,
 		size_t i, MserElement& el) {
 
-	if (!ConfigurationManager::instance()->has_cache()) {
+	if (!_feature_cache) {
 		el.compute_features(_image_color, _gradient_image, swt1, swt2);
 	} else {
         #pragma omp critical
@@ -95,19 +96,18 @@ void MserExtractor::compute_features(const cv::Mat& swt1, const cv::Mat& swt2,
 			// serialized! This also implies that el.get_unary_feature()
 			// returns just garbage! We don't serialize here everything since
 			// that is just too slow.
-			if (CacheManager::instance()->has_feature_entry(i + _uid_offset)) {
-				float stroke_width = CacheManager::instance()->query_feature(
-						i + _uid_offset).at(0);
+			if (_feature_cache->has_feature_entry(i)) {
+				float stroke_width = _feature_cache->query_feature(i).at(0);
 				el.set_raw_swt_mean(stroke_width);
 			} else {
 				el.compute_features(_image_color, _gradient_image, swt1, swt2);
 				std::vector<float> f_vec(1);
 				f_vec.at(0) = el.get_raw_swt_mean();
-				CacheManager::instance()->set_feature(i + _uid_offset, f_vec);
+				_feature_cache->set_feature(i, f_vec);
 			}
 		}
 	}
-	if (ConfigurationManager::instance()->get_preclassification_model() ==
+	if (_context.config->get_preclassification_model() ==
         ConfigurationManager::PRE_CLASSIFICATION_MODEL_CNN)
         el.compute_hog_features(_image_gray);
 
@@ -125,20 +125,20 @@ void MserExtractor::compute_probs(size_t i, const MserElement &el,
     if (!bin_image.empty()) {
         bin_image = bin_image.reshape(0, 28);
     }
-    if (!ConfigurationManager::instance()->has_cache()) {
+    if (!_prob_cache) {
         _classifier->classify(f, bin_image, prob, v);
     } else {
         #pragma omp critical
         {
-        if (CacheManager::instance()->has_entry(i + _uid_offset)) {
-            v = CacheManager::instance()->query(i + _uid_offset);
+        if (_prob_cache->has_entry(i)) {
+            v = _prob_cache->query(i);
             prob = 0;
             for (int j = 0; j < v.size(); j++)
                 prob += v[j];
             prob /= v.size();
         } else {
             _classifier->classify(f, bin_image, prob, v);
-            CacheManager::instance()->set(i + _uid_offset, v);
+            _prob_cache->set(i, v);
         }
         }
     }
@@ -162,9 +162,23 @@ void MserExtractor::extract(
     comps.clear();
     all_elements.clear();
 
+    if (_context.cache) {
+        // the stages have their own names, since the hierarchical msers and
+        // the features differ from the ones of MserExtractorFast
+        CacheKey mser_key;
+        mser_key.add(_image_gray);
+        CacheKey feature_key(mser_key);
+        feature_key.add(_image_color);
+        CacheKey prob_key(feature_key);
+        prob_key.add(_context.model_digest);
+        _mser_cache = _context.cache->open("hmsers", mser_key);
+        _feature_cache = _context.cache->open("hmser_features", feature_key);
+        _prob_cache = _context.cache->open("hmser_probs", prob_key);
+    }
+
     cv::Mat swt1, swt2;
     compute_swt(_image_gray, swt1, swt2);
-    if (ConfigurationManager::instance()->verbose())
+    if (_context.config->verbose())
         std::cout << "Computed SWT in: "
                   << boost::timer::format(t.elapsed(), 5, "%w")
                   << std::endl;
@@ -174,7 +188,7 @@ void MserExtractor::extract(
     std::vector<cv::Vec4i> hierarchy;
 	extract_msers(t, msers, probs, hierarchy);
 
-    if (ConfigurationManager::instance()->keep_unary_features())
+    if (_context.config->keep_unary_features())
         unary_features = cv::Mat(msers.size(), N_UNARY_FEATURES, CV_32FC1, cv::Scalar(0.0));
 
     all_elements.resize(msers.size());
@@ -201,27 +215,36 @@ void MserExtractor::extract(
         all_elements[i] = el;
     }
 
-    if (ConfigurationManager::instance()->verbose())
+    if (_context.config->verbose())
         std::cout << "Classified CCs in " << boost::timer::format(t.elapsed(), 5, "%w") << std::endl;;
 
     // prune hierarchical by using the probabilities of the random forest
     t.start();
-    MserTree tree(msers, probs, hierarchy);//, mask, 0.01*255.0f);
+    std::vector<cv::Rect> rects(msers.size());
+    for (size_t i = 0; i < msers.size(); i++) {
+        rects[i] = all_elements[i].get_bounding_rect();
+    }
+    FlatMserTree tree(rects, probs, hierarchy);
     tree.linearize();
     tree.accumulate();
 
-    std::vector<std::vector<cv::Point> > components = tree.get_accumulated_contours();
-    std::vector<int> idxs = tree.get_accumulated_indices();
+    const std::vector<int> &idxs = tree.get_accumulated_indices();
 
-    if (ConfigurationManager::instance()->verbose()) {
-        std::cout << "Eliminated duplicates in component tree to " << components.size() << " in " << boost::timer::format(t.elapsed(), 5, "%w") << std::endl;;
+    if (_context.config->verbose()) {
+        std::cout << "Eliminated duplicates in component tree to " << idxs.size() << " in " << boost::timer::format(t.elapsed(), 5, "%w") << std::endl;;
     }
 
-    comps.reserve(components.size());
-    assert(idxs.size() == components.size());
+    comps.reserve(idxs.size());
+
+    // every region is accumulated at most once, hence the pixels can be moved
+    for (size_t i = 0; i < idxs.size(); i++) {
+        comps.push_back(std::make_pair(idxs[i] + _uid_offset, std::move(msers[idxs[i]])));
+    }
 
-    for (size_t i = 0; i < components.size(); i++) {
-        comps.push_back(std::make_pair(idxs[i] + _uid_offset, components[i]));
+    if (_context.cache) {
+        _mser_cache->save();
+        _feature_cache->save();
+        _prob_cache->save();
     }
 }
 
@@ -18,7 +18,6 @@
 #include <text_detector/MserExtractorFast.h>
 
 #include <unordered_map>
-#include <boost/timer/timer.hpp>
 #include <opencv2/core/core.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 #include <cassert>
@@ -27,13 +26,17 @@
 #include <string>
 
 #include <text_detector/config.h>
+#include <text_detector/CacheManager.h>
+#include <text_detector/ComponentDeduplicator.h>
 #include <text_detector/ConfigurationManager.h>
 #include <text_detector/ConnectedComponentClassifier.h>
+#include <text_detector/Instrumentation.h>
 #include <text_detector/mser.h>
 #include <text_detector/MserTree.h>
 
 namespace TextDetector {
 MserExtractorFast::MserExtractorFast(
+    const DetectorContext &context,
     const cv::Mat &image_color,
     const cv::Mat &image_gray,
     const cv::Mat &mask,
@@ -45,7 +48,8 @@ MserExtractorFast::MserExtractorFast(
    _mask(mask),
    _gradient_image(gradient_image),
    _classifier(clf),
-   _uid_offset(uid_offset) {}
+   _uid_offset(uid_offset),
+   _context(context) {}
 
 static inline cv::Mat get_binary_image(const cv::Mat &gray_img, const MSER::Region &region, bool inverse = false)
 {
@@ -91,7 +95,7 @@ void MserExtractorFast::create_uid_to_index_map(
 void MserExtractorFast::compute_features(const cv::Mat& swt1,
 		const cv::Mat& swt2, MserElement& el) {
 	el.compute_features(_image_color, _gradient_image, swt1, swt2);
-	if (ConfigurationManager::instance()->get_preclassification_model()
+	if (_context.config->get_preclassification_model()
 			== ConfigurationManager::PRE_CLASSIFICATION_MODEL_CNN)
 		el.compute_hog_features(_image_gray);
 }
@@ -114,6 +118,26 @@ void MserExtractorFast::compute_probs(
     per_classifier_probs[idx] = v;
 }
 
+//! Returns the index of the root of the MSER tree of every region
+static std::vector<int> find_tree_roots(const std::vector<cv::Vec4i> &hierarchy)
+{
+    std::vector<int> roots(hierarchy.size(), -1);
+    std::vector<int> path;
+    for (size_t i = 0; i < hierarchy.size(); i++) {
+        int node = i;
+        path.clear();
+        while (roots[node] < 0 && hierarchy[node][3] >= 0) {
+            path.push_back(node);
+            node = hierarchy[node][3];
+        }
+        if (roots[node] < 0)
+            roots[node] = node;
+        for (size_t j = 0; j < path.size(); j++)
+            roots[path[j]] = roots[node];
+    }
+    return roots;
+}
+
 void MserExtractorFast::extract(
     cv::Mat &unary_features, 
     std::vector<double> &probs,
@@ -122,38 +146,74 @@ void MserExtractorFast::extract(
     std::vector<MserElement> &all_elements
 )
 {
-    boost::timer::cpu_timer t; 
-    t.start(); 
-    
     probs.clear();
     per_classifier_probs.clear();
     comps.clear();
     all_elements.clear();
 
-    cv::Mat swt1, swt2;
-    compute_swt(_image_gray, swt1, swt2);
-    if (ConfigurationManager::instance()->verbose())
-        std::cout << "Computed SWT in: " << boost::timer::format(t.elapsed(), 5, "%w") << std::endl;
-    
-    t.start(); 
-
-    // this mser detector is significantly faster than the OpenCV one on
-    // large images!
-	MSER mser(false, 3, 10.0 / (_image_gray.rows * _image_gray.cols), 1.0, 0.50, 0.20);
-    std::vector<MSER::Region> regions[2];
-    cv::Mat inv_img = 255 - _image_gray;
-    mser(_image_gray.ptr<uint8_t>(0,0),
-    	_image_gray.cols, _image_gray.rows, regions[0]);
-    mser(inv_img.ptr<uint8_t>(0,0),
-    	_image_gray.cols, _image_gray.rows, regions[1]);
-
-    int region_size = regions[0].size() + regions[1].size();
-    
-    if (ConfigurationManager::instance()->verbose())
-        std::cout << "Extracted " << region_size << " MSERs in "
-        		  << boost::timer::format(t.elapsed(), 5, "%w") << std::endl;
-
-    if (ConfigurationManager::instance()->keep_unary_features())
+    // the results of each stage are cached under a key of everything they
+    // depend on: the msers only depend on the channel, the features on the
+    // channel and the color image (from which the gradient is computed) and
+    // the probabilities additionally on the unary models
+    std::shared_ptr<CacheFile> mser_cache, feature_cache, prob_cache;
+    if (_context.cache) {
+        CacheKey mser_key;
+        mser_key.add(_image_gray);
+        if (_image_digest.empty())
+            _image_digest = CacheKey().add(_image_color).str();
+        CacheKey feature_key(mser_key);
+        feature_key.add(_image_digest);
+        CacheKey prob_key(feature_key);
+        prob_key.add(_context.model_digest);
+        mser_cache = _context.cache->open("msers", mser_key);
+        feature_cache = _context.cache->open("features", feature_key);
+        prob_cache = _context.cache->open("probs", prob_key);
+    }
+
+    std::vector<std::vector<cv::Point> > pixels;
+    std::vector<cv::Vec4i> hierarchy;
+    if (mser_cache && mser_cache->get_msers(pixels, hierarchy)) {
+        count_stat("cache_mser_hits", pixels.size());
+    } else {
+        ScopedStageTimer mser_timer("mser");
+
+        // this mser detector is significantly faster than the OpenCV one on
+        // large images!
+        MSER mser(false, 3, 10.0 / (_image_gray.rows * _image_gray.cols), 1.0, 0.50, 0.20);
+        std::vector<MSER::Region> regions[2];
+        cv::Mat inv_img = 255 - _image_gray;
+        mser(_image_gray.ptr<uint8_t>(0,0),
+            _image_gray.cols, _image_gray.rows, regions[0]);
+        mser(inv_img.ptr<uint8_t>(0,0),
+            _image_gray.cols, _image_gray.rows, regions[1]);
+
+        std::unordered_map<int,int> uid_to_index[2];
+        create_uid_to_index_map(regions, uid_to_index);
+
+        pixels.resize(regions[0].size() + regions[1].size());
+        hierarchy.resize(pixels.size());
+        // black on white and white on black
+        for (int j = 0; j < 2; j++) {
+            int offset = j == 0 ? 0 : regions[0].size();
+            #pragma omp parallel for
+            for (size_t i = 0; i < regions[j].size(); i++) {
+                pixels[i+offset]    = get_pixels(_image_gray, regions[j][i], j == 0);
+                // the hierarchy has the index as first element and the parent
+                // as last
+                hierarchy[i+offset] = cv::Vec4i(
+                    uid_to_index[j][regions[j][i].uid_], -1, -1,
+                    regions[j][i].parent_uid_ == -1 ?
+                        -1 : uid_to_index[j][regions[j][i].parent_uid_]);
+            }
+        }
+        if (mser_cache)
+            mser_cache->set_msers(pixels, hierarchy);
+    }
+
+    int region_size = pixels.size();
+    count_stat("msers", region_size);
+
+    if (_context.config->keep_unary_features())
         unary_features = cv::Mat(region_size,
             N_UNARY_FEATURES, CV_32FC1, cv::Scalar(0.0));
 
@@ -161,68 +221,133 @@ void MserExtractorFast::extract(
     per_classifier_probs.resize(region_size);
     probs.resize(region_size);
 
-    t.start();
-
-    std::unordered_map<int,int> uid_to_index[2];
-	create_uid_to_index_map(regions, uid_to_index);
-    std::cout << uid_to_index[0].size() << std::endl;
-
-    std::vector<std::vector<cv::Point> > pixels(region_size);
-    std::vector<cv::Vec4i> hierarchy(region_size);
-    // black on white and white on black
-    for (int j = 0; j < 2; j++) {
-        int offset = j == 0 ? 0 : regions[0].size();
-        #pragma omp parallel for
-        for (size_t i = 0; i < regions[j].size(); i++) {
-            pixels[i+offset]    = get_pixels(_image_gray, regions[j][i], j == 0);
-            // the hierarchy has the index as first element and the parent
-            // as last
-            hierarchy[i+offset] = cv::Vec4i(
-            	uid_to_index[j][regions[j][i].uid_], -1, -1,
-            	regions[j][i].parent_uid_ == -1 ?
-            		-1 : uid_to_index[j][regions[j][i].parent_uid_]);
-            MserElement el(-1, -1, -1, pixels[i+offset]);
-
-            // really be bigger than 2x5 pixels -> otherwise it is no CC
-            if (is_component_invalid(_mask, el.get_bounding_rect())) {
-                probs[i+offset] = 0.0;
-                per_classifier_probs[i+offset] = std::vector<double> (2,0.0);
+    // really be bigger than 2x5 pixels -> otherwise it is no CC
+    std::vector<char> valid(region_size), cached_features(region_size);
+    #pragma omp parallel for
+    for (int i = 0; i < region_size; i++) {
+        all_elements[i] = MserElement(-1, -1, -1, pixels[i]);
+        valid[i] = !is_component_invalid(_mask, all_elements[i].get_bounding_rect());
+        cached_features[i] = valid[i] && feature_cache && 
+            feature_cache->has_feature_entry(i) &&
+            all_elements[i].set_raw_features(feature_cache->query_feature(i));
+    }
+
+    // near-duplicates of components of the other channels/polarities are
+    // not classified, they are copied from their representative below
+    std::vector<int> representatives(region_size, -1);
+    if (_dedup) {
+        ScopedStageTimer dedup_timer("dedup");
+        representatives = _dedup->assign(pixels, all_elements,
+            find_tree_roots(hierarchy), valid, _uid_offset);
+        int duplicates = 0;
+        for (int i = 0; i < region_size; i++) {
+            duplicates += representatives[i] >= 0;
+        }
+        count_stat("dedup_components", duplicates);
+    }
+
+    // the stroke widths are only needed for features, which are not cached
+    cv::Mat swt1, swt2;
+    bool compute_swt_images = false;
+    for (int i = 0; i < region_size; i++) {
+        compute_swt_images = compute_swt_images || 
+            (valid[i] && !cached_features[i] && representatives[i] < 0);
+    }
+    if (compute_swt_images) {
+        ScopedStageTimer swt_timer("swt");
+        compute_swt(_image_gray, swt1, swt2);
+    }
+
+    ScopedStageTimer classify_timer("classify");
+
+    std::vector<char> cached_probs(region_size);
+    #pragma omp parallel for
+    for (int i = 0; i < region_size; i++) {
+        MserElement &el = all_elements[i];
+        if (!valid[i]) {
+            probs[i] = 0.0;
+            per_classifier_probs[i] = std::vector<double> (2,0.0);
+            continue;
+        }
+        if (representatives[i] >= 0)
+            continue;
+        if (!cached_features[i]) {
+            compute_features(swt1, swt2, el);
+        } else if (_context.config->get_preclassification_model()
+                == ConfigurationManager::PRE_CLASSIFICATION_MODEL_CNN) {
+            el.compute_hog_features(_image_gray);
+        }
+        if (prob_cache && prob_cache->has_entry(i)) {
+            std::vector<double> v = prob_cache->query(i);
+            probs[i] = v[0];
+            per_classifier_probs[i].assign(v.begin() + 1, v.end());
+            cached_probs[i] = 1;
+        } else {
+            compute_probs(i, el, probs, per_classifier_probs);
+        }
+    }
+
+    if (_dedup) {
+        for (int i = 0; i < region_size; i++) {
+            if (valid[i] && representatives[i] < 0)
+                _dedup->set_result(i + _uid_offset, all_elements[i], probs[i], per_classifier_probs[i]);
+        }
+        for (int i = 0; i < region_size; i++) {
+            if (representatives[i] >= 0)
+                _dedup->get_result(representatives[i], all_elements[i], probs[i], per_classifier_probs[i]);
+        }
+    }
+    classify_timer.stop();
+
+    // the cache is not modified concurrently to the lookups above
+    if (_context.cache) {
+        int feature_hits = 0, prob_hits = 0;
+        for (int i = 0; i < region_size; i++) {
+            // duplicates carry the results of another channel, they are
+            // not exact for this channel and must not be cached
+            if (!valid[i] || representatives[i] >= 0) continue;
+            if (cached_features[i]) {
+                feature_hits++;
+            } else {
+                feature_cache->set_feature(i, all_elements[i].get_raw_features());
+            }
+            if (cached_probs[i]) {
+                prob_hits++;
             } else {
-				compute_features(swt1, swt2, el);
-				compute_probs(i + offset, el, probs, per_classifier_probs);
+                std::vector<double> v(1, probs[i]);
+                v.insert(v.end(), per_classifier_probs[i].begin(), per_classifier_probs[i].end());
+                prob_cache->set(i, v);
             }
-            all_elements[i+offset] = el;
         }
+        count_stat("cache_feature_hits", feature_hits);
+        count_stat("cache_prob_hits", prob_hits);
+        mser_cache->save();
+        feature_cache->save();
+        prob_cache->save();
     }
 
-    if (ConfigurationManager::instance()->verbose())
-        std::cout << "Classified CCs in " << boost::timer::format(t.elapsed(), 5, "%w") << std::endl;;
-
     // prune hierarchical by using the probabilities of the random forest
 
-    t.start();
-    MserTree tree(pixels, probs, hierarchy);//, mask, 0.01*255.0f);
+    ScopedStageTimer tree_timer("tree_pruning");
+    std::vector<cv::Rect> rects(region_size);
+    for (int i = 0; i < region_size; i++) {
+        rects[i] = all_elements[i].get_bounding_rect();
+    }
+    FlatMserTree tree(rects, probs, hierarchy);
     tree.linearize();
     tree.accumulate();
 
-    std::vector<std::vector<cv::Point> > components =
-        tree.get_accumulated_contours();
-    std::vector<int> idxs = tree.get_accumulated_indices();
-
-    if (ConfigurationManager::instance()->verbose()) {
-        std::cout << "Eliminated duplicates in component tree to "
-        		  << components.size() << " in "
-        		  << boost::timer::format(t.elapsed(), 5, "%w") << std::endl;
-    }
-
-    comps.reserve(components.size());
+    const std::vector<int> &idxs = tree.get_accumulated_indices();
+    tree_timer.stop();
 
-    assert(idxs.size() == components.size());
+    comps.reserve(idxs.size());
 
-    for (size_t i = 0; i < components.size(); i++) {
+    // every region is accumulated at most once, hence the pixels can be moved
+    for (size_t i = 0; i < idxs.size(); i++) {
         if (probs[idxs[i]] <= 0.0f) continue;
-        comps.push_back(std::make_pair(idxs[i] + _uid_offset, components[i]));
+        comps.push_back(std::make_pair(idxs[i] + _uid_offset, std::move(pixels[idxs[i]])));
     }
+    count_stat("tree_components", comps.size());
 }
 }
 
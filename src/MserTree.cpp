@@ -23,6 +23,7 @@
 #include <iostream>
 #include <fstream>
 #include <list>
+#include <algorithm>
 
 #include <text_detector/ConfigurationManager.h>
 
@@ -483,4 +484,158 @@ int MserTree::match_contour(const cv::Mat &other_contour, float thresh) const
     return _root->match_contour(other_contour, thresh);
 }
 
+
+FlatMserTree::FlatMserTree(const std::vector<cv::Rect> &rects, const std::vector<double> &probs, const std::vector<cv::Vec4i> &hierarchy)
+: _probs(probs), _rects(rects)
+{
+    build(hierarchy);
+}
+
+FlatMserTree::FlatMserTree(const std::vector<std::vector<cv::Point> > &contours, const std::vector<double> &probs, const std::vector<cv::Vec4i> &hierarchy)
+: _probs(probs), _rects(contours.size())
+{
+    for (size_t i = 0; i < contours.size(); i++) {
+        _rects[i] = cv::boundingRect(contours[i]);
+    }
+    build(hierarchy);
+}
+
+void FlatMserTree::build(const std::vector<cv::Vec4i> &hierarchy)
+{
+    int n = hierarchy.size();
+    _parent.assign(n, -1);
+    _first_child.assign(n, -1);
+    _next_sibling.assign(n, -1);
+    // prepending in reverse order keeps the children in increasing order of
+    // the index, like MserTree
+    for (int i = n - 1; i >= 0; i--) {
+        int parent = hierarchy[i][3];
+        _parent[i] = parent;
+        if (parent == -1) {
+            _roots.push_back(i);
+        } else {
+            _next_sibling[i] = _first_child[parent];
+            _first_child[parent] = i;
+        }
+    }
+    std::reverse(_roots.begin(), _roots.end());
+}
+
+void FlatMserTree::linearize()
+{
+    // replacement[i] is the node which takes the place of i in the child list
+    // of its parent
+    std::vector<int> replacement(_parent.size(), -1);
+    for (size_t r = 0; r < _roots.size(); r++) {
+        int root = _roots[r];
+        int node = root;
+        while (_first_child[node] >= 0)
+            node = _first_child[node];
+
+        // post-order sweep, a node is finished after all of its children.
+        // Finishing a node only relinks nodes of its own subtree, hence the
+        // sibling and parent of the node are still valid afterwards.
+        while (true) {
+            int head = -1, tail = -1, count = 0;
+            for (int child = _first_child[node]; child >= 0;) {
+                int next = _next_sibling[child];
+                int repl = replacement[child];
+                _parent[repl] = node;
+                _next_sibling[repl] = -1;
+                if (tail < 0)
+                    head = repl;
+                else
+                    _next_sibling[tail] = repl;
+                tail = repl;
+                count++;
+                child = next;
+            }
+            _first_child[node] = head;
+            replacement[node] = node;
+
+            if (count == 1) {
+                if (_probs[head] > _probs[node]) {
+                    // leave the node out -> the child takes its place
+                    replacement[node] = head;
+                } else {
+                    // drop the child -> its children become the children of the node
+                    _first_child[node] = _first_child[head];
+                    for (int child = _first_child[node]; child >= 0; child = _next_sibling[child])
+                        _parent[child] = node;
+                }
+            }
+
+            if (node == root)
+                break;
+            if (_next_sibling[node] >= 0) {
+                node = _next_sibling[node];
+                while (_first_child[node] >= 0)
+                    node = _first_child[node];
+            } else {
+                node = _parent[node];
+            }
+        }
+        _roots[r] = replacement[root];
+        _parent[_roots[r]] = -1;
+    }
+}
+
+void FlatMserTree::accumulate()
+{
+    _accumulated_indices.clear();
+    // start[i] is the offset of the accumulated children of i
+    std::vector<int> start(_parent.size(), 0);
+    std::vector<int> outliers;
+    for (size_t r = 0; r < _roots.size(); r++) {
+        int root = _roots[r];
+        int node = root;
+        while (has_multiple_children(node)) {
+            start[node] = _accumulated_indices.size();
+            node = _first_child[node];
+        }
+
+        while (true) {
+            if (!has_multiple_children(node)) {
+                _accumulated_indices.push_back(node);
+            } else {
+                // the accumulated children of the node are at the end of the list
+                // the maximum is kept as float, like the std::accumulate
+                // with the FLT_MIN initial value of MserNode::accumulate
+                float max = FLT_MIN;
+                outliers.clear();
+                for (size_t i = start[node]; i < _accumulated_indices.size(); i++) {
+                    int child = _accumulated_indices[i];
+                    max = std::max(double(max), _probs[child]);
+                    // if an child is not intersecting with the parent 
+                    // (overlap smaller than 0.2 * child-area)
+                    // then it is considered as an outlier and accumulated up
+                    cv::Rect intersect = _rects[child] & _rects[node];
+                    float intersect_area = intersect.width * intersect.height;
+                    float child_area = _rects[child].width * _rects[child].height;
+                    if (intersect_area / child_area < 0.2f) {
+                        outliers.push_back(child);
+                    }
+                }
+                if (!(max > _probs[node])) {
+                    _accumulated_indices.resize(start[node]);
+                    _accumulated_indices.push_back(node);
+                    _accumulated_indices.insert(_accumulated_indices.end(), outliers.begin(), outliers.end());
+                }
+            }
+
+            if (node == root)
+                break;
+            if (_next_sibling[node] >= 0) {
+                node = _next_sibling[node];
+                while (has_multiple_children(node)) {
+                    start[node] = _accumulated_indices.size();
+                    node = _first_child[node];
+                }
+            } else {
+                node = _parent[node];
+            }
+        }
+    }
+}
+
 }
@@ -0,0 +1,174 @@
+/**
+ *  This file is part of ltp-text-detector.
+ *  Copyright (C) 2013 Michael Opitz
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <text_detector/OverlapSuppression.h>
+
+#include <algorithm>
+
+namespace TextDetector {
+
+static bool row_major_less(const cv::Point &a, const cv::Point &b)
+{
+    return a.y < b.y || (a.y == b.y && a.x < b.x);
+}
+
+void ComponentRuns::add(const std::vector<cv::Point> &pixels)
+{
+    // the extractors return the pixels in row major order, other orders are
+    // sorted first
+    std::vector<cv::Point> sorted;
+    const std::vector<cv::Point> *px = &pixels;
+    if (!std::is_sorted(pixels.begin(), pixels.end(), row_major_less)) {
+        sorted = pixels;
+        std::sort(sorted.begin(), sorted.end(), row_major_less);
+        px = &sorted;
+    }
+
+    std::vector<PixelRun> runs = encode_pixel_runs(*px);
+    _runs.insert(_runs.end(), runs.begin(), runs.end());
+    _offsets.push_back(_runs.size());
+    _areas.push_back(pixels.size());
+}
+
+size_t ComponentRuns::intersection(int i, int j) const
+{
+    const PixelRun *a = _runs.data() + _offsets[i];
+    const PixelRun *a_end = _runs.data() + _offsets[i + 1];
+    const PixelRun *b = _runs.data() + _offsets[j];
+    const PixelRun *b_end = _runs.data() + _offsets[j + 1];
+
+    size_t n = 0;
+    while (a != a_end && b != b_end) {
+        if (a->y != b->y) {
+            if (a->y < b->y) 
+                ++a;
+            else 
+                ++b;
+            continue;
+        }
+        int32_t a_stop = a->x + int32_t(a->length);
+        int32_t b_stop = b->x + int32_t(b->length);
+        int32_t lo = std::max(a->x, b->x);
+        int32_t hi = std::min(a_stop, b_stop);
+        if (hi > lo)
+            n += hi - lo;
+        if (a_stop < b_stop)
+            ++a;
+        else
+            ++b;
+    }
+    return n;
+}
+
+RectGrid::RectGrid(const std::vector<cv::Rect> &rects, int cell_size)
+: _rects(rects), _cell_size(cell_size), _cols(1), _rows(1)
+{
+    int min_x = 0, min_y = 0, max_x = 0, max_y = 0;
+    std::vector<int> sides;
+    sides.reserve(rects.size());
+    for (size_t i = 0; i < rects.size(); i++) {
+        const cv::Rect &r = rects[i];
+        if (r.width <= 0 || r.height <= 0)
+            continue;
+        if (sides.empty()) {
+            min_x = r.x; min_y = r.y;
+            max_x = r.x + r.width; max_y = r.y + r.height;
+        } else {
+            min_x = std::min(min_x, r.x);
+            min_y = std::min(min_y, r.y);
+            max_x = std::max(max_x, r.x + r.width);
+            max_y = std::max(max_y, r.y + r.height);
+        }
+        sides.push_back(std::max(r.width, r.height));
+    }
+
+    if (_cell_size <= 0) {
+        _cell_size = 8;
+        if (!sides.empty()) {
+            std::nth_element(sides.begin(), sides.begin() + sides.size() / 2, sides.end());
+            _cell_size = std::max(_cell_size, sides[sides.size() / 2]);
+        }
+    }
+    _origin = cv::Point(min_x, min_y);
+    _cols = std::max(1, (max_x - min_x + _cell_size - 1) / _cell_size);
+    _rows = std::max(1, (max_y - min_y + _cell_size - 1) / _cell_size);
+
+    // count the rects per cell, then fill the cells
+    _cell_offsets.assign(_cols * _rows + 1, 0);
+    for (int pass = 0; pass < 2; pass++) {
+        for (size_t i = 0; i < rects.size(); i++) {
+            const cv::Rect &r = rects[i];
+            if (r.width <= 0 || r.height <= 0)
+                continue;
+            for (int cy = cell_y(r.y); cy <= cell_y(r.y + r.height - 1); cy++) {
+                for (int cx = cell_x(r.x); cx <= cell_x(r.x + r.width - 1); cx++) {
+                    int cell = cy * _cols + cx;
+                    if (pass == 0)
+                        _cell_offsets[cell + 1]++;
+                    else
+                        _cell_items[_cell_offsets[cell]++] = i;
+                }
+            }
+        }
+        if (pass == 0) {
+            for (size_t c = 1; c < _cell_offsets.size(); c++)
+                _cell_offsets[c] += _cell_offsets[c - 1];
+            _cell_items.resize(_cell_offsets.back());
+        } else {
+            // the fill moved every offset to the start of the next cell
+            for (size_t c = _cell_offsets.size() - 1; c > 0; c--)
+                _cell_offsets[c] = _cell_offsets[c - 1];
+            _cell_offsets[0] = 0;
+        }
+    }
+}
+
+std::vector<unsigned char> find_overlapping_components(
+    const std::vector<cv::Rect> &rects,
+    const ComponentRuns &runs,
+    const std::vector<double> &probs,
+    double thresh)
+{
+    int n = rects.size();
+    RectGrid grid(rects);
+    // every component only decides about its own removal, so the threads
+    // never write the same element
+    std::vector<unsigned char> remove_mask(n, 0);
+    #pragma omp parallel for schedule(dynamic, 64)
+    for (int i = 0; i < n; i++) {
+        int area_i = rects[i].width * rects[i].height;
+        grid.for_each_intersecting(i, [&] (int j) -> bool {
+            if (probs[j] < probs[i] || (probs[j] == probs[i] && j < i))
+                return false;
+            cv::Rect intersect = rects[i] & rects[j];
+            int area_intersect = intersect.width * intersect.height;
+            int area_j = rects[j].width * rects[j].height;
+            if (float(area_intersect) / std::max(area_i, area_j) <= thresh)
+                return false;
+            float overlap = float(runs.intersection(i, j)) / 
+                std::max(runs.area(i), runs.area(j));
+            if (overlap > thresh) {
+                remove_mask[i] = 1;
+                return true;
+            }
+            return false;
+        });
+    }
+    return remove_mask;
+}
+
+}
@@ -0,0 +1,146 @@
+/**
+ *  This file is part of ltp-text-detector.
+ *  Copyright (C) 2013 Michael Opitz
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <text_detector/ParameterSweep.h>
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+#include <text_detector/ConfigurationManager.h>
+#include <text_detector/ConnectedComponentExtractor.h>
+
+namespace TextDetector {
+
+std::string SweepSetting::name() const
+{
+    std::ostringstream ss;
+    ss << "t" << threshold 
+       << "_p" << pre_classification_prob_threshold
+       << "_g" << word_group_threshold
+       << "_v" << minimum_vertical_overlap
+       << "_s" << word_split_model;
+    return ss.str();
+}
+
+template <class T>
+static inline void default_value(std::vector<T> &values, T value)
+{
+    if (values.empty())
+        values.push_back(value);
+}
+
+ParameterSweep::ParameterSweep(
+    const MserDetector &detector,
+    std::vector<float> thresholds,
+    std::vector<float> pre_classification_prob_thresholds,
+    std::vector<float> word_group_thresholds,
+    std::vector<float> minimum_vertical_overlaps,
+    std::vector<int> word_split_models)
+{
+    const ConfigurationManager &config = *detector.context().config;
+    default_value(thresholds, config.get_threshold());
+    default_value(pre_classification_prob_thresholds, 
+        config.get_pre_classification_prob_threshold());
+    default_value(word_group_thresholds, config.get_word_group_threshold());
+    default_value(minimum_vertical_overlaps, config.get_minimum_vertical_overlap());
+    default_value(word_split_models, config.get_word_split_model());
+
+    _extraction_threshold = *std::min_element(thresholds.begin(), thresholds.end());
+    _rf_filter = config.get_classification_model() == 
+        ConfigurationManager::CLASSIFICATION_MODEL_RANDOM_FOREST;
+
+    // the later a stage, the further inside its parameters are varied
+    for (float t : thresholds) {
+        for (float p : pre_classification_prob_thresholds) {
+            for (float g : word_group_thresholds) {
+                for (float v : minimum_vertical_overlaps) {
+                    for (int s : word_split_models) {
+                        SweepSetting setting = { t, p, g, v, s };
+                        _settings.push_back(setting);
+
+                        std::shared_ptr<ConfigurationManager> cfg = 
+                            std::make_shared<ConfigurationManager>(config);
+                        cfg->set_threshold(t);
+                        cfg->set_pre_classification_prob_threshold(p);
+                        cfg->set_word_group_threshold(g);
+                        cfg->set_minimum_vertical_overlap(v);
+                        cfg->set_word_split_model(s);
+                        _detectors.push_back(std::make_shared<MserDetector>(detector, cfg));
+                    }
+                }
+            }
+        }
+    }
+}
+
+void ParameterSweep::operator()(
+    const cv::Mat &input_image,
+    const cv::Mat &response,
+    ExtractedComponents &components,
+    std::vector<std::vector<cv::Rect> > &words) const
+{
+    if (!response.empty() && response.type() != CV_8UC1)
+        throw std::runtime_error("Unexpected response type");
+
+    words.assign(_settings.size(), std::vector<cv::Rect>());
+
+    std::vector<std::pair<int, std::vector<cv::Point> > > all_comps;
+    std::vector<std::pair<int, std::vector<cv::Point> > > threshold_comps;
+    std::vector<std::pair<int, std::vector<cv::Point> > > filtered_comps;
+    std::vector<CCGroup> groups;
+    all_comps.swap(components.comps);
+    for (size_t i = 0; i < _settings.size(); i++) {
+        const SweepSetting &s = _settings[i];
+        const MserDetector &detector = *_detectors[i];
+
+        // a stage is only re-executed if one of its inputs changed
+        bool new_threshold = i == 0 || _settings[i-1].threshold != s.threshold;
+        bool new_filter = new_threshold || (_rf_filter &&
+            _settings[i-1].pre_classification_prob_threshold != s.pre_classification_prob_threshold);
+        bool new_groups = new_filter ||
+            _settings[i-1].word_group_threshold != s.word_group_threshold ||
+            _settings[i-1].minimum_vertical_overlap != s.minimum_vertical_overlap;
+
+        if (new_threshold) {
+            threshold_comps.clear();
+            cv::Mat mask;
+            if (!response.empty() && s.threshold != _extraction_threshold)
+                mask = response > (s.threshold * 255);
+            for (size_t j = 0; j < all_comps.size(); j++) {
+                if (mask.empty() || !ConnectedComponentExtractor::is_component_invalid(
+                        mask, components.elements[all_comps[j].first].get_bounding_rect()))
+                    threshold_comps.push_back(all_comps[j]);
+            }
+        }
+        if (new_filter) {
+            components.comps = threshold_comps;
+            detector.filter_components(input_image, components);
+            filtered_comps.swap(components.comps);
+        }
+        if (new_groups) {
+            groups.clear();
+            components.comps.swap(filtered_comps);
+            detector.group_components(input_image, components, groups);
+            components.comps.swap(filtered_comps);
+        }
+        words[i] = detector.split_words(groups);
+    }
+    components.comps.swap(all_comps);
+}
+
+}
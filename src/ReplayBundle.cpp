@@ -0,0 +1,78 @@
+/**
+ *  This file is part of ltp-text-detector.
+ *  Copyright (C) 2013 Michael Opitz
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <text_detector/ReplayBundle.h>
+#include <text_detector/Serialization.h>
+
+#include <fstream>
+#include <stdexcept>
+
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+
+namespace TextDetector {
+
+static const std::string REPLAY_MAGIC = "LTPREPLAY";
+static const int REPLAY_VERSION = 1;
+
+template <class Archive>
+static void serialize_bundle(Archive &ar, ReplayBundle &b)
+{
+    ar & b.name;
+    ar & b.image;
+    ar & b.detector_mask;
+    ar & b.extra_bin_mask;
+    ar & b.components.gradient_image;
+    ar & b.components.probs;
+    ar & b.components.per_classifier_probs;
+    ar & b.components.unary_features;
+    ar & b.components.comps;
+    ar & b.components.elements;
+    ar & b.filtered_comps;
+}
+
+void ReplayBundle::save(const std::string &filename) const
+{
+    std::ofstream ofs(filename.c_str(), std::ios::binary);
+    if (!ofs)
+        throw std::runtime_error("Could not write replay bundle " + filename);
+
+    boost::archive::binary_oarchive oa(ofs);
+    std::string magic(REPLAY_MAGIC);
+    int version = REPLAY_VERSION;
+    oa & magic;
+    oa & version;
+    serialize_bundle(oa, const_cast<ReplayBundle &>(*this));
+}
+
+void ReplayBundle::load(const std::string &filename)
+{
+    std::ifstream ifs(filename.c_str(), std::ios::binary);
+    if (!ifs)
+        throw std::runtime_error("Could not read replay bundle " + filename);
+
+    boost::archive::binary_iarchive ia(ifs);
+    std::string magic;
+    int version;
+    ia & magic;
+    ia & version;
+    if (magic != REPLAY_MAGIC || version != REPLAY_VERSION)
+        throw std::runtime_error("Unsupported replay bundle " + filename);
+    serialize_bundle(ia, *this);
+}
+
+}
@@ -32,14 +32,15 @@ SimplePPWordSplitter::split(const CCGroup &grp)
     // generate a 1D-mask where the gaps between CCs are 0 and the 
     // components are 1
     std::vector<bool> collide(bb.width, false);
-    for (int i = 0; i < grp.ccs.size(); i++) {
-        for (int j = grp.ccs[i].rect.x; j < grp.ccs[i].rect.x + grp.ccs[i].rect.width; j++) {
+    for (int i = 0; i < grp.size(); i++) {
+        const cv::Rect &r = grp.cc(i).rect;
+        for (int j = r.x; j < r.x + r.width; j++) {
             collide[j-bb.x] = true;
         }
     }
 
-    std::vector<float> heights(grp.ccs.size(), 0.0);
-    std::transform(grp.ccs.begin(), grp.ccs.end(), heights.begin(), [] (const CC &c) -> float { return c.rect.height; });
+    std::vector<float> heights(grp.size(), 0.0);
+    for (size_t i = 0; i < grp.size(); i++) heights[i] = grp.cc(i).rect.height;
     float mean_height = cv::sum(heights)[0] / heights.size();
 
     // Now find the rects from this binary mask.
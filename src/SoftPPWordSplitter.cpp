@@ -16,6 +16,7 @@
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include <text_detector/SoftPPWordSplitter.h>
+#include <text_detector/GapClusterer.h>
 
 #include <opencv2/highgui/highgui.hpp>
 
@@ -33,8 +34,8 @@ SoftPPWordSplitter::split(const CCGroup &grp)
     // generate the projection profile sums
     cv::Mat sums(1, bb.width, CV_32FC1, cv::Scalar(0));
     ProjectionProfileComputer pp_computer(cv::Size(bb.width, 1), bb.x);
-    for (int i = 0; i < grp.ccs.size(); i++) {
-        sums = pp_computer.compute(grp.ccs[i].pixels, sums);
+    for (int i = 0; i < grp.size(); i++) {
+        sums = pp_computer.compute(*grp.cc(i).pixels, sums);
     }
 
     int threshold = pp_computer.compute_threshold(sums);
@@ -44,11 +45,8 @@ SoftPPWordSplitter::split(const CCGroup &grp)
     cv::Mat gaps = sums < threshold;
 
     // now shrink each bounding rect on the border with the gaps matrix
-    std::vector<cv::Rect> original_rects(grp.ccs.size());
-    std::transform(
-        grp.ccs.begin(), grp.ccs.end(), 
-        original_rects.begin(), 
-        [](const CC &cc) -> cv::Rect { return cc.rect; });
+    std::vector<cv::Rect> original_rects(grp.size());
+    for (size_t i = 0; i < grp.size(); i++) original_rects[i] = grp.cc(i).rect;
     std::sort(
         original_rects.begin(),
         original_rects.end(), 
@@ -79,12 +77,8 @@ SoftPPWordSplitter::split(const CCGroup &grp)
     //    }
     //}
 
-    std::vector<float> heights(grp.ccs.size(), 0.0);
-    std::transform(
-        grp.ccs.begin(),
-        grp.ccs.end(), 
-        heights.begin(),
-        [] (const CC &c) -> float { return c.rect.height; });
+    std::vector<float> heights(grp.size(), 0.0);
+    for (size_t i = 0; i < grp.size(); i++) heights[i] = grp.cc(i).rect.height;
     float mean_height = cv::sum(heights)[0] / heights.size();
 
     // Now find the rects from this binary mask.
@@ -121,27 +115,13 @@ SoftPPWordSplitter::split(const CCGroup &grp)
         dists.push_back(rects[i].tl().x - rects[i-1].br().x);
     }
 
-    //  kmeans
-    cv::Mat dist_mat(dists.size(), 1, CV_32FC1);
-    for (size_t i = 0; i < dists.size(); i++) {
-        dist_mat.at<float>(i,0) = dists[i];
-    }
-    cv::Mat centers;
-    cv::Mat labels;//(dists.size(),1, CV_32SC1, cv::Scalar(0));
-    /*
-    float min = *std::min_element(dists.begin(), dists.end());
-    float max = *std::max_element(dists.begin(), dists.end());
-    for (size_t i = 0; i < dists.size(); i++) {
-        labels.at<int>(i,0) = std::abs(dists[i] - min) < std::abs(dists[i] - max) ? 0 : 1;
-    }
-    */
-
-    if (_verbose) 
-        std::cout << dist_mat << std::endl;
-    kmeans(dist_mat, 2, labels, cv::TermCriteria(CV_TERMCRIT_EPS+CV_TERMCRIT_ITER, 100, .01), 5, cv::KMEANS_PP_CENTERS, centers);
+    //  exact 2-means on the gaps
+    float centers[2];
+    std::vector<int> labels;
+    GapClusterer().cluster(dists, labels, centers);
 
     if (_verbose)
-        std::cout << centers << std::endl;
+        std::cout << centers[0] << " " << centers[1] << std::endl;
 
     std::vector<float> cpy(dists);
     std::sort(cpy.begin(), cpy.end());
@@ -152,8 +132,8 @@ SoftPPWordSplitter::split(const CCGroup &grp)
     }
     float medval = median;
 
-    float height = std::abs(centers.at<float>(0,0) - centers.at<float>(1,0)) / mean_height;
-    median = std::abs(centers.at<float>(0,0) - centers.at<float>(1,0)) / (median + 1e-10);
+    float height = std::abs(centers[0] - centers[1]) / mean_height;
+    median = std::abs(centers[0] - centers[1]) / (median + 1e-10);
     if (_verbose) {
         std::cout << dists.size() << " " << medval << " " << median << " " << height << std::endl;
     }
@@ -168,13 +148,13 @@ SoftPPWordSplitter::split(const CCGroup &grp)
         return result;
     }
 
-    // get the index of the smallest center
-    int small_center = centers.at<float>(0,0) < centers.at<float>(1,0) ? 0 : 1;
+    // the first center is always the smallest one
+    const int small_center = 0;
 
     // count the distance to cluster assignments
     int cnt[2] = {0,0};
-    for (int i = 0; i < labels.rows; i++) {
-        cnt[labels.at<int>(i,0)]++;
+    for (size_t i = 0; i < labels.size(); i++) {
+        cnt[labels[i]]++;
     }
     // we have more word gaps than letter gaps -> don't split!
     if (cnt[small_center] < cnt[1-small_center]) {
@@ -189,7 +169,7 @@ SoftPPWordSplitter::split(const CCGroup &grp)
     std::vector<cv::Rect> word_candidates;
     for (int i = 1; i < rects.size(); i++) {
         if (_allow_single_letters) {
-            if (labels.at<int>(i-1,0) == small_center) {
+            if (labels[i-1] == small_center) {
                 // extend the last rect
                 last_rect = last_rect | rects[i];
             } else {
@@ -198,10 +178,10 @@ SoftPPWordSplitter::split(const CCGroup &grp)
                 last_rect = rects[i];
             }
         } else {
-            if (labels.at<int>(i-1,0) == small_center) {
+            if (labels[i-1] == small_center) {
                 // extend the last rect
                 last_rect = last_rect | rects[i];
-            } else if (i < labels.rows && labels.at<int>(i,0) == small_center) {
+            } else if (i < labels.size() && labels[i] == small_center) {
                 // do not extend it!
                 word_candidates.push_back(last_rect);
                 last_rect = rects[i];
@@ -216,10 +196,11 @@ SoftPPWordSplitter::split(const CCGroup &grp)
     std::vector<cv::Rect> words;
     for (cv::Rect candidate : word_candidates) {
         std::vector<cv::Rect> word;
-        for (size_t i = 0; i < grp.ccs.size(); i++) {
-            cv::Rect intersect(grp.ccs[i].rect & candidate);
-            if (float (intersect.width * intersect.height) / float (grp.ccs[i].rect.width * grp.ccs[i].rect.height) >= 0.8f) {
-                cv::Rect r = grp.ccs[i].rect;
+        for (size_t i = 0; i < grp.size(); i++) {
+            const cv::Rect &cc_rect = grp.cc(i).rect;
+            cv::Rect intersect(cc_rect & candidate);
+            if (float (intersect.width * intersect.height) / float (cc_rect.width * cc_rect.height) >= 0.8f) {
+                cv::Rect r = cc_rect;
                 // set the text height correctly
                 r.y = bb.y;
                 r.height = bb.height;
@@ -0,0 +1,374 @@
+/**
+ *  This file is part of ltp-text-detector.
+ *  Copyright (C) 2013 Michael Opitz
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <text_detector/TrainingDataset.h>
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+namespace ipc = boost::interprocess;
+
+/*
+ *  Layout of a packed dataset (all values in host byte order):
+ *
+ *  DatasetHeader
+ *  PixelRun data of all components
+ *  n_images  x (uint32 length, char[length])      image names
+ *  n_samples x TrainingSample                     index
+ */
+namespace {
+
+const char DATASET_MAGIC[8] = { 'L', 'T', 'P', 'D', 'S', 'E', 'T', '\0' };
+const uint32_t DATASET_VERSION = 1;
+
+struct DatasetHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t n_images;
+    uint64_t n_samples;
+    uint64_t image_offset;
+    uint64_t sample_offset;
+};
+
+//! Reads one uid per line
+std::vector<int> read_uids(const fs::path &path)
+{
+    std::vector<int> uids;
+    std::ifstream ifs(path.generic_string().c_str());
+    std::string line;
+    while (std::getline(ifs, line)) {
+        int uid;
+        if (std::stringstream(line) >> uid)
+            uids.push_back(uid);
+    }
+    return uids;
+}
+
+//! Reads the uid,text line pairs of text_lines.txt
+std::map<int, int> read_textline_ids(const fs::path &path)
+{
+    std::map<int, int> result;
+    std::ifstream ifs(path.generic_string().c_str());
+    std::string line;
+    while (std::getline(ifs, line)) {
+        std::stringstream ss(line);
+        std::string str_uid, str_line_id;
+        std::getline(ss, str_uid, ',');
+        std::getline(ss, str_line_id, ',');
+        int uid, line_id;
+        if ((std::stringstream(str_uid) >> uid) && (std::stringstream(str_line_id) >> line_id))
+            result[uid] = line_id;
+    }
+    return result;
+}
+
+template <class T>
+void write_value(std::ofstream &ofs, const T &value)
+{
+    ofs.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+}
+
+namespace TextDetector {
+
+/**
+ *  A read-only mapping of a packed dataset. All reads are bounds checked.
+ */
+struct TrainingDataset::MappedFile
+{
+    MappedFile(const std::string &filename)
+    : mapping(filename.c_str(), ipc::read_only),
+      region(mapping, ipc::read_only),
+      data(static_cast<const char *>(region.get_address())),
+      size(region.get_size())
+    {}
+
+    void check(uint64_t offset, uint64_t length) const
+    {
+        if (offset > size || length > size - offset)
+            throw std::runtime_error("Truncated dataset");
+    }
+
+    template <class T>
+    T read(uint64_t offset) const
+    {
+        check(offset, sizeof(T));
+        T value;
+        std::memcpy(&value, data + offset, sizeof(T));
+        return value;
+    }
+
+    ipc::file_mapping mapping;
+    ipc::mapped_region region;
+    const char *data;
+    uint64_t size;
+};
+
+TrainingDataset::TrainingDataset(const std::string &path)
+{
+    if (fs::is_directory(path)) {
+        load_directory(path);
+        return;
+    }
+    if (!fs::exists(path) || fs::file_size(path) == 0)
+        throw std::runtime_error("Dataset " + path + " does not exist");
+
+    _mapped.reset(new MappedFile(path));
+    DatasetHeader header = _mapped->read<DatasetHeader>(0);
+    if (std::memcmp(header.magic, DATASET_MAGIC, sizeof(DATASET_MAGIC)) != 0 ||
+        header.version != DATASET_VERSION)
+        throw std::runtime_error("Invalid dataset " + path);
+
+    uint64_t offset = header.image_offset;
+    _images.resize(header.n_images);
+    for (uint32_t i = 0; i < header.n_images; i++) {
+        uint32_t length = _mapped->read<uint32_t>(offset);
+        _mapped->check(offset + sizeof(uint32_t), length);
+        _images[i].assign(_mapped->data + offset + sizeof(uint32_t), length);
+        offset += sizeof(uint32_t) + length;
+    }
+
+    _mapped->check(header.sample_offset, header.n_samples * sizeof(TrainingSample));
+    _samples.resize(header.n_samples);
+    if (!_samples.empty())
+        std::memcpy(&_samples[0], _mapped->data + header.sample_offset, 
+            _samples.size() * sizeof(TrainingSample));
+
+    _image_samples.resize(_images.size());
+    for (size_t i = 0; i < _samples.size(); i++) {
+        if (_samples[i].image < 0 || size_t(_samples[i].image) >= _images.size())
+            throw std::runtime_error("Corrupt dataset " + path);
+        _image_samples[_samples[i].image].push_back(i);
+    }
+}
+
+TrainingDataset::~TrainingDataset()
+{}
+
+void TrainingDataset::load_directory(const std::string &directory)
+{
+    _directory = directory;
+
+    std::vector<fs::path> image_dirs;
+    for (fs::directory_iterator it(directory), end; it != end; ++it) {
+        if (fs::is_directory(it->path()))
+            image_dirs.push_back(it->path());
+    }
+    std::sort(image_dirs.begin(), image_dirs.end());
+
+    for (size_t i = 0; i < image_dirs.size(); i++) {
+        _images.push_back(image_dirs[i].filename().generic_string());
+        _image_samples.push_back(std::vector<size_t>());
+
+        std::map<int, int> textline_ids;
+        fs::path textline_path = image_dirs[i] / "text_lines.txt";
+        if (fs::exists(textline_path))
+            textline_ids = read_textline_ids(textline_path);
+
+        std::vector<int> tree_ids;
+        for (fs::directory_iterator it(image_dirs[i]), end; it != end; ++it) {
+            int tree_id;
+            if (fs::is_directory(it->path()) && 
+                (std::stringstream(it->path().filename().generic_string()) >> tree_id))
+                tree_ids.push_back(tree_id);
+        }
+        std::sort(tree_ids.begin(), tree_ids.end());
+
+        for (int tree_id : tree_ids) {
+            std::stringstream tree_name;
+            tree_name << tree_id;
+            fs::path tree_path = image_dirs[i] / tree_name.str();
+            for (int label : { 1, -1 }) {
+                fs::path uid_path = tree_path / (label > 0 ? "letters.txt" : "negatives.txt");
+                if (!fs::exists(uid_path))
+                    continue;
+                for (int uid : read_uids(uid_path)) {
+                    auto line = textline_ids.find(uid);
+                    TrainingSample sample = { int32_t(i), tree_id, uid, label,
+                        line != textline_ids.end() ? line->second : -1, 0, 0, 0 };
+                    _image_samples.back().push_back(_samples.size());
+                    _samples.push_back(sample);
+                }
+            }
+        }
+    }
+}
+
+std::vector<int> TrainingDataset::get_tree_ids(size_t image) const
+{
+    std::vector<int> tree_ids;
+    for (size_t i : _image_samples.at(image)) {
+        tree_ids.push_back(_samples[i].tree_id);
+    }
+    std::sort(tree_ids.begin(), tree_ids.end());
+    tree_ids.erase(std::unique(tree_ids.begin(), tree_ids.end()), tree_ids.end());
+    return tree_ids;
+}
+
+std::vector<MserElement> TrainingDataset::get_elements(size_t image, int tree_id, int label) const
+{
+    int imgid = -1;
+    std::stringstream(_images.at(image)) >> imgid;
+
+    std::vector<MserElement> result;
+    for (size_t i : _image_samples[image]) {
+        const TrainingSample &s = _samples[i];
+        if (s.tree_id != tree_id || s.label != label)
+            continue;
+        result.push_back(MserElement(imgid, s.uid, label, get_pixels(i)));
+    }
+    return result;
+}
+
+std::vector<int> TrainingDataset::get_textline_ids(size_t image) const
+{
+    int max_uid = -1;
+    for (size_t i : _image_samples.at(image)) {
+        max_uid = std::max(max_uid, int(_samples[i].uid));
+    }
+    std::vector<int> result(max_uid + 1, -1);
+    for (size_t i : _image_samples[image]) {
+        if (_samples[i].uid >= 0)
+            result[_samples[i].uid] = _samples[i].textline_id;
+    }
+    return result;
+}
+
+std::vector<cv::Point> TrainingDataset::get_pixels(size_t sample) const
+{
+    const TrainingSample &s = _samples.at(sample);
+    if (!_mapped) {
+        std::stringstream path;
+        path << _directory << "/" << _images[s.image] << "/" << s.tree_id 
+             << "/node" << s.uid << "_contour.csv";
+        return load_pixels(path.str());
+    }
+
+    _mapped->check(s.data_offset, uint64_t(s.n_runs) * sizeof(PixelRun));
+    std::vector<cv::Point> pixels;
+    pixels.reserve(s.n_points);
+    for (uint32_t i = 0; i < s.n_runs; i++) {
+        PixelRun run = _mapped->read<PixelRun>(s.data_offset + i * sizeof(PixelRun));
+        if (pixels.size() + run.length > s.n_points)
+            throw std::runtime_error("Corrupt dataset record");
+        for (uint32_t k = 0; k < run.length; k++) {
+            pixels.push_back(cv::Point(run.x + k, run.y));
+        }
+    }
+    return pixels;
+}
+
+TrainingDatasetWriter::TrainingDatasetWriter(const std::string &filename)
+: _filename(filename), _tmp_filename(filename + ".tmp")
+{
+    _ofs.open(_tmp_filename.c_str(), std::ios::binary);
+    if (!_ofs)
+        throw std::runtime_error("Could not write dataset " + _tmp_filename);
+    // the header is rewritten by close()
+    DatasetHeader header = DatasetHeader();
+    write_value(_ofs, header);
+}
+
+TrainingDatasetWriter::~TrainingDatasetWriter()
+{
+    if (_ofs.is_open()) {
+        _ofs.close();
+        boost::system::error_code ec;
+        fs::remove(_tmp_filename, ec);
+    }
+}
+
+size_t TrainingDatasetWriter::add_image(const std::string &name)
+{
+    _images.push_back(name);
+    return _images.size() - 1;
+}
+
+void TrainingDatasetWriter::add(size_t image, int tree_id, int uid, int label, 
+    int textline_id, const std::vector<cv::Point> &pixels)
+{
+    if (image >= _images.size())
+        throw std::out_of_range("Unknown image");
+
+    TrainingSample sample = { int32_t(image), tree_id, uid, label, textline_id, 0, 0, 0 };
+    auto stored = _stored.find(std::make_pair(image, uid));
+    if (stored != _stored.end()) {
+        const TrainingSample &first = _samples[stored->second];
+        sample.n_points = first.n_points;
+        sample.n_runs = first.n_runs;
+        sample.data_offset = first.data_offset;
+    } else {
+        std::vector<PixelRun> runs(encode_pixel_runs(pixels));
+        sample.n_points = pixels.size();
+        sample.n_runs = runs.size();
+        sample.data_offset = _ofs.tellp();
+        if (!runs.empty())
+            _ofs.write(reinterpret_cast<const char *>(&runs[0]), runs.size() * sizeof(PixelRun));
+        _stored[std::make_pair(image, uid)] = _samples.size();
+    }
+    _samples.push_back(sample);
+}
+
+void TrainingDatasetWriter::close()
+{
+    DatasetHeader header;
+    std::memcpy(header.magic, DATASET_MAGIC, sizeof(DATASET_MAGIC));
+    header.version = DATASET_VERSION;
+    header.n_images = _images.size();
+    header.n_samples = _samples.size();
+
+    header.image_offset = _ofs.tellp();
+    for (size_t i = 0; i < _images.size(); i++) {
+        write_value(_ofs, uint32_t(_images[i].size()));
+        _ofs.write(_images[i].data(), _images[i].size());
+    }
+    header.sample_offset = _ofs.tellp();
+    if (!_samples.empty())
+        _ofs.write(reinterpret_cast<const char *>(&_samples[0]), 
+            _samples.size() * sizeof(TrainingSample));
+    _ofs.seekp(0);
+    write_value(_ofs, header);
+    _ofs.close();
+    if (!_ofs)
+        throw std::runtime_error("Could not write dataset " + _tmp_filename);
+    fs::rename(_tmp_filename, _filename);
+}
+
+void pack_training_dataset(const std::string &directory, const std::string &filename)
+{
+    TrainingDataset dataset(directory);
+    TrainingDatasetWriter writer(filename);
+    for (size_t i = 0; i < dataset.get_image_count(); i++) {
+        writer.add_image(dataset.get_image_name(i));
+    }
+    const std::vector<TrainingSample> &samples = dataset.get_samples();
+    for (size_t i = 0; i < samples.size(); i++) {
+        const TrainingSample &s = samples[i];
+        writer.add(s.image, s.tree_id, s.uid, s.label, s.textline_id, dataset.get_pixels(i));
+    }
+    writer.close();
+}
+
+}
@@ -0,0 +1,42 @@
+/**
+ *  This file is part of ltp-text-detector.
+ *  Copyright (C) 2013 Michael Opitz
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <text_detector/WordSplitter.h>
+
+namespace TextDetector {
+
+std::vector<cv::Rect> WordSplitter::split_all(const std::vector<CCGroup> &groups)
+{
+    std::vector<std::vector<cv::Rect> > group_words(groups.size());
+    #pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < groups.size(); i++) {
+        group_words[i] = split(groups[i]);
+    }
+
+    size_t n_words = 0;
+    for (size_t i = 0; i < group_words.size(); i++) 
+        n_words += group_words[i].size();
+
+    std::vector<cv::Rect> words;
+    words.reserve(n_words);
+    for (size_t i = 0; i < group_words.size(); i++) {
+        words.insert(words.end(), group_words[i].begin(), group_words[i].end());
+    }
+    return words;
+}
+
+}
@@ -24,13 +24,20 @@
 
 #include <dirent.h>
 #include <getopt.h>
-#include <list>
+#include <omp.h>
 
+#include <cstdint>
+#include <cstdlib>
 #include <fstream>
 #include <memory>
+#include <random>
+#include <thread>
+#include <unordered_map>
 
 #include <text_detector/utils.h>
 #include <text_detector/config.h>
+#include <text_detector/BoundedQueue.h>
+#include <text_detector/FeatureStore.h>
 
 #include <boost/filesystem.hpp>
 #include <boost/archive/text_iarchive.hpp>
@@ -38,14 +45,142 @@
 
 namespace fs = boost::filesystem;
 
+/**
+ *  A reservoir sample of the false positive windows of one scale. A window
+ *  which overlaps a window of the reservoir is suppressed when it is 
+ *  inserted; the overlapping windows are found with a spatial hash with 
+ *  cells of the window size. The memory is bounded by the capacity, no 
+ *  matter how many windows are above the threshold.
+ *
+ *  The rows of a scale are classified in parallel, each row fills its own 
+ *  reservoir and the reservoirs are merged in row order, so the sample only
+ *  depends on the seed and not on the thread schedule.
+ */
+class FalsePositiveReservoir
+{
+public:
+    struct Window
+    {
+        int x, y;
+        float score;
+    };
+
+    FalsePositiveReservoir(size_t capacity, const cv::Size &window_size, unsigned seed)
+    : _capacity(capacity), _window_size(window_size), _seed(seed), _seen(0), _rng(seed)
+    {
+        _windows.reserve(capacity);
+    }
+
+    void insert(int x, int y, float score)
+    {
+        Window window = { x, y, score };
+        insert(window, 1);
+    }
+
+    /**
+     *  Inserts the windows of another reservoir, each of them stands for
+     *  its share of the windows the other reservoir has seen.
+     */
+    void merge(const FalsePositiveReservoir &other)
+    {
+        size_t n = other._windows.size();
+        if (n == 0) {
+            _seen += other._seen;
+            return;
+        }
+        for (size_t i = 0; i < n; i++) {
+            insert(other._windows[i], other._seen / n + (i < other._seen % n ? 1 : 0));
+        }
+    }
+
+    //! Returns an empty reservoir for a row of windows with a seed derived from the row
+    FalsePositiveReservoir *create_row_reservoir(int row) const
+    {
+        std::seed_seq row_seed = { _seed, unsigned(row) };
+        std::mt19937 rng(row_seed);
+        return new FalsePositiveReservoir(_capacity, _window_size, rng());
+    }
+
+    const std::vector<Window> &get_windows() const { return _windows; }
+private:
+    void insert(const Window &window, size_t weight)
+    {
+        _seen += weight;
+        if (_windows.size() < _capacity) {
+            if (!overlaps(window, -1)) {
+                _windows.push_back(window);
+                add_to_hash(_windows.size() - 1);
+            }
+            return;
+        }
+        // the window replaces a random window with probability 
+        // capacity * weight / seen
+        size_t slot = std::uniform_int_distribution<size_t>(0, _seen - 1)(_rng);
+        if (slot < _capacity * weight && !overlaps(window, slot % _capacity)) {
+            slot %= _capacity;
+            remove_from_hash(slot);
+            _windows[slot] = window;
+            add_to_hash(slot);
+        }
+    }
+
+    int64_t cell_key(int cx, int cy) const 
+    { 
+        return (int64_t(cy) << 32) ^ uint32_t(cx);
+    }
+
+    //! Returns true if the window overlaps a window of the reservoir except the ignored slot
+    bool overlaps(const Window &window, int ignore) const
+    {
+        int cx = window.x / _window_size.width;
+        int cy = window.y / _window_size.height;
+        for (int dy = -1; dy <= 1; dy++) {
+            for (int dx = -1; dx <= 1; dx++) {
+                auto it = _cells.find(cell_key(cx + dx, cy + dy));
+                if (it == _cells.end()) continue;
+                for (int slot : it->second) {
+                    if (slot == ignore) continue;
+                    if (std::abs(_windows[slot].x - window.x) < _window_size.width &&
+                        std::abs(_windows[slot].y - window.y) < _window_size.height)
+                        return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    void add_to_hash(int slot)
+    {
+        const Window &w = _windows[slot];
+        _cells[cell_key(w.x / _window_size.width, w.y / _window_size.height)].push_back(slot);
+    }
+
+    void remove_from_hash(int slot)
+    {
+        const Window &w = _windows[slot];
+        auto it = _cells.find(cell_key(w.x / _window_size.width, w.y / _window_size.height));
+        it->second.erase(std::find(it->second.begin(), it->second.end(), slot));
+        if (it->second.empty())
+            _cells.erase(it);
+    }
+
+    size_t _capacity;
+    cv::Size _window_size;
+    unsigned _seed;
+    size_t _seen;
+    std::mt19937 _rng;
+    std::vector<Window> _windows;
+    std::unordered_map<int64_t, std::vector<int> > _cells;
+};
+
 static cv::Mat 
 classify_single_scale(
         const cv::Mat &image,
         const std::shared_ptr<Detector::Adaboost> &trees,
         const cv::Size &window_size,
         const cv::Size &shift_size,
-        bool sample_false_positives,
-        std::list<cv::Mat> &false_positives,
+        FalsePositiveReservoir *reservoir,
+        std::vector<cv::Mat> &false_positives,
         float thresh,
         int scale
 )
@@ -71,6 +206,10 @@ classify_single_scale(
     cv::Mat result_image(image.rows, image.cols, CV_32FC1, cv::Scalar(0.0f));
     cv::Mat norm_image(image.rows, image.cols, CV_32FC1, cv::Scalar(0.0));
 
+    // each row samples into its own reservoir, which is created for the
+    // first window above the threshold
+    std::vector<std::unique_ptr<FalsePositiveReservoir> > row_reservoirs(n_height_shifts);
+
     // go through all shifts
     #pragma omp parallel for
     for (int i = 0; i < n_height_shifts; ++i) {
@@ -95,21 +234,33 @@ classify_single_scale(
             norm_image.rowRange(actual_y, actual_y + win_height).colRange(actual_x, actual_x + win_width) += cv::Scalar(1.0);
             if (result > 0) {
                 result_image.rowRange(actual_y, actual_y + win_height).colRange(actual_x, actual_x + win_width) += cv::Scalar(result);
-                
-                if (sample_false_positives && result > thresh) {
-                    cv::Mat f = ltp.get_vector<double>(ltp_maps, actual_x, actual_y, actual_x + win_width, actual_y + win_height);
-                    cv::Mat fps_vec(1, f.cols + 5, CV_32FC1, cv::Scalar(0.0f));
-                    cv::Mat sub = fps_vec.colRange(5,fps_vec.cols);
-                    f.copyTo(sub);
-
-                    fps_vec.at<float>(0, 1) = result;
-                    fps_vec.at<float>(0, 2) = scale;
-                    fps_vec.at<float>(0, 3) = actual_x;
-                    fps_vec.at<float>(0, 4) = actual_y;
-                    false_positives.push_back(fps_vec);
-                }
             }
             }
+
+            if (reservoir && result > thresh) {
+                if (!row_reservoirs[i])
+                    row_reservoirs[i].reset(reservoir->create_row_reservoir(i));
+                row_reservoirs[i]->insert(actual_x, actual_y, result);
+            }
+        }
+    }
+
+    // the features are only extracted for the sampled windows
+    if (reservoir) {
+        for (const std::unique_ptr<FalsePositiveReservoir> &row : row_reservoirs) {
+            if (row) reservoir->merge(*row);
+        }
+        for (const FalsePositiveReservoir::Window &w : reservoir->get_windows()) {
+            cv::Mat f = ltp.get_vector<double>(ltp_maps, w.x, w.y, w.x + win_width, w.y + win_height);
+            cv::Mat fps_vec(1, f.cols + 5, CV_32FC1, cv::Scalar(0.0f));
+            cv::Mat sub = fps_vec.colRange(5,fps_vec.cols);
+            f.copyTo(sub);
+
+            fps_vec.at<float>(0, 1) = w.score;
+            fps_vec.at<float>(0, 2) = scale;
+            fps_vec.at<float>(0, 3) = w.x;
+            fps_vec.at<float>(0, 4) = w.y;
+            false_positives.push_back(fps_vec);
         }
     }
 
@@ -128,13 +279,15 @@ bootstrap_image(
         const std::string &image_path, 
         const std::string &result_path, 
         const std::shared_ptr<Detector::Adaboost> &trees,
-        std::list<cv::Mat> &false_positives, 
+        std::vector<cv::Mat> &false_positives, 
         float thresh, 
         const cv::Size &window_size, 
         const cv::Size &shift_size,
         float scale_ratio, 
         int num_scales,
-        bool sample_false_positives)
+        bool sample_false_positives,
+        int max_per_scale,
+        unsigned seed)
 {
     cv::Mat image = cv::imread(image_path);
     std::vector<std::string> parts = split(image_path, '/');
@@ -149,11 +302,12 @@ bootstrap_image(
         std::cout << "scale: " << i << std::endl;
         if (image.rows <= window_size.height || image.cols <= window_size.width) break;
 
+        FalsePositiveReservoir reservoir(max_per_scale, window_size, seed + i);
         cv::Mat result = classify_single_scale(
             image, 
             trees, 
             window_size, shift_size, 
-            sample_false_positives,
+            sample_false_positives ? &reservoir : 0,
             false_positives, 
             thresh, 
             i);
@@ -200,40 +354,19 @@ bootstrap_image(
     }
 }
 
-static bool
-is_intersection(const cv::Mat &a, const cv::Mat &b)
-{
-    if (a.at<float>(0, 2) != b.at<float>(0,2))
-        return false;
-
-    cv::Rect x(a.at<float>(0,3), a.at<float>(0,4), 24, 12);
-    cv::Rect y(b.at<float>(0,3), b.at<float>(0,4), 24, 12);
-    cv::Rect intersect = x & y;
-    cv::Rect u = x | y;
-    return float(intersect.width * intersect.height) / float(u.width *u.height) > 0.0f;
-}
-static 
-std::vector<cv::Mat> filter_false_positives(const std::vector<cv::Mat> &false_positives, int max)
+/**
+ *  Keeps a random subset of at most max false positives (the windows of a 
+ *  scale do not overlap, see FalsePositiveReservoir)
+ */
+static void
+subsample_false_positives(std::vector<cv::Mat> &false_positives, size_t max, std::mt19937 &rng)
 {
-    std::vector<bool> suppressed(false_positives.size(), 0);
-    std::vector<int> scale_counter(50,0);
-    int max_per_scale = 50;
-    std::vector<cv::Mat> result;
-    result.reserve(max);
-
-    for (size_t i = 0; i < false_positives.size() && result.size() < max; i++) {
-        if (suppressed[i]) continue;
-        if (scale_counter[int(false_positives[i].at<float>(0,2))] > max_per_scale) continue;
-        result.push_back(false_positives[i]);
-        scale_counter[int(false_positives[i].at<float>(0,2))]++;
-
-        for (size_t j = i+1; j < false_positives.size(); j++) {
-            if (is_intersection(false_positives[i], false_positives[j])) {
-                suppressed[j] = true;
-            }
-        }
+    for (size_t i = 0; i < false_positives.size() && i < max; i++) {
+        size_t j = std::uniform_int_distribution<size_t>(i, false_positives.size() - 1)(rng);
+        std::swap(false_positives[i], false_positives[j]);
     }
-    return result;
+    if (false_positives.size() > max)
+        false_positives.resize(max);
 }
 
 int main(int argc, char *argv[])
@@ -244,8 +377,11 @@ int main(int argc, char *argv[])
     std::string samples_path;
     std::string model_path;
     std::string result_path;
+    std::string binary_result_path;
     int batch_size = 10000;
     int max_per_image = 100;
+    int max_per_scale = 50;
+    int njobs = 1;
 
     int window_width = 24;
     int window_height = 12;
@@ -260,7 +396,7 @@ int main(int argc, char *argv[])
     std::vector<int> excludes;
 
 
-    while ((c = getopt(argc, argv, "u:t:g:r:m:i:b:n:d:v:f:w:s:h")) != -1) {
+    while ((c = getopt(argc, argv, "u:t:g:r:m:i:b:n:d:v:f:o:j:w:s:h")) != -1) {
         switch (c) {
             case 't':
                 train_paths = split(optarg,',');
@@ -289,6 +425,12 @@ int main(int argc, char *argv[])
                     result_path = optarg;
                 }
                 break;
+            case 'o':
+                binary_result_path = optarg;
+                break;
+            case 'j':
+                std::stringstream(optarg) >> njobs;
+                break;
             case 'w':
                 {
                 std::vector<int> tmp(spliti(optarg, 'x'));
@@ -309,6 +451,8 @@ int main(int argc, char *argv[])
                     << "\t -e <excludes>" << std::endl
                     << "\t -m <model file>" << std::endl
                     << "\t -f <false positive result file>" << std::endl
+                    << "\t -o <binary false positive row file, appended to>" << std::endl
+                    << "\t -j <number of images processed in parallel>" << std::endl
                     << "\t -d <maximum depth of trees>" << std::endl
                     << "\t -u <upper limit>" << std::endl
                     << "\t -s <shift_width>x<shift_height>" << std::endl
@@ -333,7 +477,7 @@ int main(int argc, char *argv[])
     //    return 1;
     //}
 
-    bool sample_false_positives = result_path != "";
+    bool sample_false_positives = result_path != "" || binary_result_path != "";
     if (train_paths.size() != result_paths.size()) {
         std::cout << train_paths.size() << " " << result_paths.size() << " " << std::endl;
         std::cerr << "need to have as many result paths as training paths as gt paths" << std::endl;
@@ -348,12 +492,9 @@ int main(int argc, char *argv[])
     //rtrees->load(model_path);
 
     float thresh = 0.1f;
-    std::list<cv::Mat> false_positives;
-
-    std::ofstream ofs;
-    if (sample_false_positives)
-        ofs.open(result_path);
 
+    struct job { std::string image, result_path; int idx; };
+    std::vector<job> jobs;
     for (unsigned int i = 0; i < train_paths.size(); ++i) {
         std::string train_path = train_paths[0];
         if (!fs::is_directory(train_path)) {
@@ -377,41 +518,79 @@ int main(int argc, char *argv[])
                 continue;
             }
             if (upper_limit != -1 && idx > upper_limit) continue;
-            std::string image = file.generic_string();
-
-            std::cout << "bootstrapping: " << image << std::endl;
-            boost::timer::cpu_timer t;
-            bootstrap_image(
-                image, result_paths[i],
-                rtrees,
-                false_positives,
-                thresh,
-                cv::Size(window_width, window_height),
-                cv::Size(shift_width, shift_height),
-                scale_ratio,
-                num_scales,
-                sample_false_positives);
-            std::cout << "bootstrapped in: " << boost::timer::format(t.elapsed(), 5, "%w") << std::endl;
-            std::vector<cv::Mat> v(false_positives.begin(), false_positives.end());
-            for (size_t j = 0; j < v.size(); j++) {
-                int idx = std::min(int (v.size()-1), std::max(0, int(rand() % v.size())));
-                std::swap(v[j], v[idx]);
-            }
-            v = filter_false_positives(v, max_per_image);
-            std::cout << "False Positives: " <<  v.size() << std::endl;
-            for (size_t j = 0; j < v.size() && j < max_per_image; j++) {
-                v[j].at<float>(0,0) = idx;
-                ofs << v[j].at<float>(0,0);
-                for (int k = 1; k < v[j].cols; k++) {
-                    ofs << "," << v[j].at<float>(0,k);
+            job j = { file.generic_string(), result_paths[i], idx };
+            jobs.push_back(j);
+        }
+    }
+
+    // the false positives of the images are written by a single thread
+    njobs = std::max(1, njobs);
+    TextDetector::BoundedQueue<cv::Mat> fp_queue(2 * njobs);
+    // set by the writer, read after it is joined
+    bool failed = false;
+    std::thread writer([&]() {
+        std::ofstream ofs;
+        if (result_path != "")
+            ofs.open(result_path);
+        std::unique_ptr<TextDetector::FeatureRowWriter> row_writer;
+        cv::Mat rows;
+        while (fp_queue.pop(rows)) {
+            if (failed) continue;
+            try {
+                if (ofs.is_open()) {
+                    for (int j = 0; j < rows.rows; j++) {
+                        ofs << rows.at<float>(j,0);
+                        for (int k = 1; k < rows.cols; k++) {
+                            ofs << "," << rows.at<float>(j,k);
+                        }
+                        ofs << std::endl;
+                    }
                 }
-                ofs << std::endl;
+                if (binary_result_path != "") {
+                    if (!row_writer)
+                        row_writer.reset(new TextDetector::FeatureRowWriter(binary_result_path, rows.cols));
+                    row_writer->write(rows);
+                    row_writer->flush();
+                }
+            } catch (const std::exception &e) {
+                std::cerr << "Error: " << e.what() << std::endl;
+                failed = true;
             }
-            false_positives.clear();
-            v.clear();
+        }
+    });
+
+    #pragma omp parallel for schedule(dynamic) num_threads(njobs)
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        const job &j = jobs[i];
+        std::vector<cv::Mat> false_positives;
+
+        std::cout << "bootstrapping: " << j.image << std::endl;
+        boost::timer::cpu_timer t;
+        bootstrap_image(
+            j.image, j.result_path,
+            rtrees,
+            false_positives,
+            thresh,
+            cv::Size(window_width, window_height),
+            cv::Size(shift_width, shift_height),
+            scale_ratio,
+            num_scales,
+            sample_false_positives,
+            max_per_scale,
+            unsigned(j.idx) * num_scales);
+        std::cout << "bootstrapped in: " << boost::timer::format(t.elapsed(), 5, "%w") << std::endl;
+
+        std::mt19937 rng(j.idx);
+        subsample_false_positives(false_positives, max_per_image, rng);
+        std::cout << "False Positives: " <<  false_positives.size() << std::endl;
+        if (!false_positives.empty()) {
+            cv::Mat rows;
+            cv::vconcat(false_positives, rows);
+            rows.col(0).setTo(cv::Scalar(j.idx));
+            fp_queue.push(rows);
         }
     }
-    
-    ofs.close();
-    return 0;
+    fp_queue.close();
+    writer.join();
+    return failed ? 1 : 0;
 }
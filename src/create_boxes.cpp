@@ -20,9 +20,11 @@
 #include <boost/program_options.hpp>
 #include <boost/timer/timer.hpp>
 
+#include <fstream>
 #include <string>
 #include <iostream>
 #include <utility>
+#include <vector>
 
 #include <opencv2/core/core.hpp>
 #include <opencv2/ml/ml.hpp>
@@ -48,6 +50,7 @@
 #include <text_detector/SoftPPWordSplitter.h>
 #include <text_detector/HardPPWordSplitter.h>
 #include <text_detector/CacheManager.h>
+#include <text_detector/Instrumentation.h>
 #include <text_detector/SimpleWordSplitter.h>
 #include <text_detector/BinaryMaskExtractor.h>
 #include <text_detector/CNNConnectedComponentClassifier.h>
@@ -56,6 +59,7 @@
 #include <text_detector/SVMRFConnectedComponentClassifier.h>
 
 #include <text_detector/MserDetector.h>
+#include <text_detector/ParameterSweep.h>
 
 #include <signal.h>
 
@@ -69,6 +73,23 @@ terminate (int sig)
     exit(0);
 }
 
+template <class T>
+static std::vector<T> get_values(const po::variables_map &vm, const std::string &key)
+{
+    if (!vm.count(key))
+        return std::vector<T>();
+    return vm[key].as<std::vector<T> >();
+}
+
+static void write_boxes(const std::string &filename, const std::vector<cv::Rect> &words)
+{
+    std::ofstream ofs(filename);
+    for (size_t i = 0; i < words.size(); i++) {
+        const cv::Rect &r = words[i];
+        ofs << r.x << "," << r.y << "," << r.width << "," << r.height << std::endl;
+    }
+}
+
 int main(int argc, const char *argv[])
 {
     signal(SIGINT, terminate);
@@ -77,6 +98,18 @@ int main(int argc, const char *argv[])
         desc.add_options()
             ("help,h", "print this help message")
             ("config,c", po::value<std::string>()->required(), "path to config file")
+            ("sweep-threshold", po::value<std::vector<float> >()->multitoken(), 
+             "response thresholds of a parameter sweep")
+            ("sweep-pre-classification-prob-threshold", po::value<std::vector<float> >()->multitoken(), 
+             "pre classification probability thresholds of a parameter sweep")
+            ("sweep-word-group-threshold", po::value<std::vector<float> >()->multitoken(), 
+             "word group thresholds of a parameter sweep")
+            ("sweep-minimum-vertical-overlap", po::value<std::vector<float> >()->multitoken(), 
+             "minimum vertical overlaps of a parameter sweep")
+            ("sweep-word-split-model", po::value<std::vector<std::string> >()->multitoken(), 
+             "word split models (e.g. MODEL_SIMPLE) of a parameter sweep")
+            ("sweep-output", po::value<std::string>(), 
+             "output directory of a parameter sweep (default: <responses_directory>/sweep)")
         ;
 
         po::variables_map vm;
@@ -92,13 +125,12 @@ int main(int argc, const char *argv[])
         std::shared_ptr<TextDetector::ConfigurationManager> config(
         	new TextDetector::ConfigurationManager(
         		vm["config"].as<std::string>()));
-        TextDetector::ConfigurationManager::set_instance(config);
 
 
         float threshold = config->get_threshold();
+        std::shared_ptr<CacheManager> cache;
         if (config->has_cache()) {
-            CacheManager::set_instance(
-                std::shared_ptr<CacheManager>((new CacheManager(config->get_cache_directory()))));
+            cache.reset(new CacheManager(config->get_cache_directory()));
         }
 
         srand(config->get_random_seed());
@@ -122,7 +154,53 @@ int main(int argc, const char *argv[])
             std::back_inserter(directories));
         std::sort(directories.begin(), directories.end());
 
-        TextDetector::MserDetector detector(config);
+        TextDetector::MserDetector detector(TextDetector::DetectorContext(config, cache));
+
+        // the sweep extracts the components once and writes the boxes of
+        // every setting to <sweep-output>/<setting>/
+        std::shared_ptr<TextDetector::ParameterSweep> sweep;
+        fs::path sweep_dir;
+        if (vm.count("sweep-threshold") || 
+            vm.count("sweep-pre-classification-prob-threshold") ||
+            vm.count("sweep-word-group-threshold") || 
+            vm.count("sweep-minimum-vertical-overlap") ||
+            vm.count("sweep-word-split-model")) {
+            std::vector<int> split_models;
+            if (vm.count("sweep-word-split-model")) {
+                for (const std::string &name : vm["sweep-word-split-model"].as<std::vector<std::string> >()) {
+                    if (name != "MODEL_PROJECTION_PROFILE" && name != "MODEL_PROJECTION_PROFILE_SOFT" &&
+                        name != "MODEL_SIMPLE")
+                        throw std::runtime_error("Unknown word split model " + name);
+                    split_models.push_back(config->get_word_split_model(name));
+                }
+            }
+            sweep.reset(new TextDetector::ParameterSweep(
+                detector,
+                get_values<float>(vm, "sweep-threshold"),
+                get_values<float>(vm, "sweep-pre-classification-prob-threshold"),
+                get_values<float>(vm, "sweep-word-group-threshold"),
+                get_values<float>(vm, "sweep-minimum-vertical-overlap"),
+                split_models));
+            threshold = sweep->extraction_threshold();
+
+            sweep_dir = vm.count("sweep-output") ? 
+                fs::path(vm["sweep-output"].as<std::string>()) : 
+                fs::path(config->get_responses_directory()) / "sweep";
+            fs::create_directories(sweep_dir);
+            std::ofstream settings_file((sweep_dir / "settings.txt").generic_string());
+            settings_file << "name,threshold,pre_classification_prob_threshold,"
+                          << "word_group_threshold,minimum_vertical_overlap,word_split_model" << std::endl;
+            for (const TextDetector::SweepSetting &s : sweep->settings()) {
+                fs::create_directories(sweep_dir / s.name());
+                settings_file << s.name() << "," << s.threshold << "," 
+                              << s.pre_classification_prob_threshold << ","
+                              << s.word_group_threshold << "," 
+                              << s.minimum_vertical_overlap << ","
+                              << s.word_split_model << std::endl;
+            }
+            std::cout << "Sweeping " << sweep->settings().size() << " settings" << std::endl;
+        }
+
         for (auto it = directories.begin(); it != directories.end(); ++it) {
             fs::path p(*it);
             //p = "../train_icdar_2005/332.jpg";
@@ -150,10 +228,6 @@ int main(int argc, const char *argv[])
             std::cout << "Processing: " << p.filename() << " " 
                       << number << " " << response << std::endl;
 
-            if (CacheManager::instance()) {
-                CacheManager::instance()->load_image(number.generic_string());
-            }
-            
             cv::Mat response_image;
             if (fs::exists(response)) {
                 response_image = cv::imread(response.generic_string());
@@ -180,8 +254,29 @@ int main(int argc, const char *argv[])
                 }
                 gt_mask = cv::imread(mask_path);
             }
+            if (sweep) {
+                TextDetector::ImageStats stats(number.generic_string(), config->verbose());
+                TextDetector::ScopedImageStats scope(&stats);
+                TextDetector::ExtractedComponents components;
+                detector.extract_components(train_image, mask, gt_mask, components);
+                std::vector<std::vector<cv::Rect> > setting_words;
+                (*sweep)(train_image, config->ignore_responses() ? cv::Mat() : response_image,
+                    components, setting_words);
+                for (size_t i = 0; i < setting_words.size(); i++) {
+                    fs::path out_name = sweep_dir / sweep->settings()[i].name() / 
+                        (number.generic_string() + "_boxes.txt");
+                    write_boxes(out_name.generic_string(), setting_words[i]);
+                }
+                continue;
+            }
+
             cv::Mat result_image;
-            std::vector<cv::Rect> words = detector(train_image, result_image, mask, gt_mask);
+            std::vector<cv::Rect> words;
+            {
+            TextDetector::ImageStats stats(number.generic_string(), config->verbose());
+            TextDetector::ScopedImageStats scope(&stats);
+            words = detector(train_image, result_image, mask, gt_mask);
+            }
 
             fs::path out_name(config->get_responses_directory());
             std::string box_name = number.generic_string() + "_boxes.txt";
@@ -202,9 +297,6 @@ int main(int argc, const char *argv[])
             fs::path out_img_name(config->get_responses_directory());
             out_img_name += "/"; out_img_name += box_img_name;
             cv::imwrite(out_img_name.generic_string(), result_image);
-
-            if (CacheManager::instance())
-                CacheManager::instance()->save_image(number.generic_string());
         }
         
     } catch (const std::exception &e) {
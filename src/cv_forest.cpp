@@ -18,9 +18,19 @@
 #include <opencv2/core/core.hpp>
 #include <opencv2/ml/ml.hpp>
 
+#include <text_detector/FeatureStore.h>
+#include <text_detector/ForestCrossValidation.h>
+
+#include <algorithm>
+#include <cstdlib>
 #include <iostream>
+#include <fstream>
 #include <getopt.h>
 #include <sstream>
+#include <set>
+#include <tuple>
+
+#include <omp.h>
 
 static std::vector<std::string> &split(const std::string &s, char delim, std::vector<std::string> &elems) {
     std::stringstream ss(s);
@@ -64,16 +74,64 @@ static void parse_steps(const std::string &arg, int &start, int &step, int &end)
     }
 }
 
+//! A point of the parameter grid: ntrees, nvars, ndepth
+typedef std::tuple<int, int, int> grid_point;
+
+/**
+ *  Reads the grid points which are already in the result file of an 
+ *  interrupted sweep. Only complete lines (all 8 fields and the newline) 
+ *  count, a line cut off by a crash is computed again. unterminated is set
+ *  if the last line has no newline.
+ */
+static std::set<grid_point> read_finished(const std::string &output_file, bool &unterminated)
+{
+    std::set<grid_point> finished;
+    unterminated = false;
+    std::ifstream ifs(output_file.c_str());
+    std::string line;
+    while (std::getline(ifs, line)) {
+        if (ifs.eof()) {
+            unterminated = true;
+            break;
+        }
+        if (line.empty() || line[0] == '#')
+            continue;
+        std::stringstream ss(line);
+        int ntrees, nvars, ndepth;
+        if (!(ss >> ntrees >> nvars >> ndepth))
+            continue;
+        // error fp fn precision recall, which may be nan
+        std::vector<std::string> values;
+        std::string value;
+        while (ss >> value) values.push_back(value);
+        bool complete = values.size() == 5;
+        for (size_t i = 0; i < values.size() && complete; i++) {
+            char *end;
+            std::strtod(values[i].c_str(), &end);
+            complete = *end == '\0';
+        }
+        if (complete)
+            finished.insert(grid_point(ntrees, nvars, ndepth));
+    }
+    return finished;
+}
+
 /**
  * This is a helper program for cross-validating random forests.
  * The training file should be randomized. Note: cross-validation is actually
  * not really necessary to do when using Random Forests, since they have 
  * an own cross-validation like error-measure: oob-error
+ *
+ * All (grid point, fold) jobs run concurrently on the same data (-j caps the
+ * number of jobs). The result of a grid point is written to the output file 
+ * (-o) as soon as all of its folds are done; rerunning the sweep with the
+ * same file and random seed skips the grid points already in it.
  */
 int main(int argc, char *argv[])
 {
     int c;
-    std::string train_file;
+    std::string train_file, output_file;
+    int njobs = omp_get_max_threads();
     int ntrees_start = 10;
     int ntrees_end = 100;
     int ntrees_step = 10;
@@ -90,7 +148,7 @@ int main(int argc, char *argv[])
     float prior = 1.0;
 
     int random_seed = 42;
-    while ((c = getopt(argc, argv, "p:r:i:n:d:v:f:t:h")) != -1) {
+    while ((c = getopt(argc, argv, "p:r:i:n:d:v:f:t:j:o:h")) != -1) {
         switch (c) {
             case 'f':
                 std::stringstream (optarg) >> nfolds;
@@ -116,16 +174,24 @@ int main(int argc, char *argv[])
             case 'r':
                 std::stringstream(optarg) >> random_seed;
                 break;
+            case 'j':
+                std::stringstream(optarg) >> njobs;
+                break;
+            case 'o':
+                output_file = optarg;
+                break;
             case 'h':
             default:
                 std::cerr << "Usage: train_forest OPTIONS" << std::endl 
-                    << "\t -i <train.csv>" << std::endl 
+                    << "\t -i <train.csv or packed feature file>" << std::endl 
                     << "\t -f <folds>" << std::endl 
                     << "\t -t <threshold>" << std::endl 
                     << "\t -p <prior>" << std::endl 
                     << "\t -n <number of trees start>:<number of trees step>:<number of trees end>" << std::endl 
                     << "\t -v <number of active variables start>:<number of active vars step>:<number of active vars end>" << std::endl 
-                    << "\t -d <depth of trees start>:<depth of trees step>:<depth of trees end>" << std::endl;
+                    << "\t -d <depth of trees start>:<depth of trees step>:<depth of trees end>" << std::endl
+                    << "\t -j <number of concurrent jobs>" << std::endl
+                    << "\t -o <result file, an existing file is resumed>" << std::endl;
                 return 1;
         }
     }
@@ -142,6 +208,10 @@ int main(int argc, char *argv[])
         std::cerr << "Error - need at least 1 variable" << std::endl;
         return 1;
     }
+    if (nfolds < 2) {
+        std::cerr << "Error - need at least 2 folds" << std::endl;
+        return 1;
+    }
     if (train_file == "") {
         std::cerr << "Error - need a training file" << std::endl;
         return 1;
@@ -152,12 +222,7 @@ int main(int argc, char *argv[])
               << nvars_start << " " << nvars_step << " " << nvars_end << std::endl
               << ndepth_start << " " << ndepth_step << " " << ndepth_end << std::endl;
 
-    cv::TrainData data;
-    data.read_csv(train_file.c_str());
-    data.set_response_idx(0);
-    data.set_delimiter(',');
-
-    cv::Mat values = cv::Mat(data.get_values());
+    cv::Mat values = TextDetector::load_features(train_file);
 
     // randomly permute them
     for (int i = 0; i < values.rows; i++) {
@@ -173,137 +238,97 @@ int main(int argc, char *argv[])
         tmp.copyTo(row_j);
     }
 
-    cv::Mat samples = values.colRange(1, values.cols);
-    cv::Mat labels = values.colRange(0, 1);
+    // contiguous copies, which are shared read-only by all jobs
+    cv::Mat samples = values.colRange(1, values.cols).clone();
+    cv::Mat labels = values.colRange(0, 1).clone();
+    values.release();
 
     std::cout << labels.rows << " " << labels.cols << std::endl;
     std::cout << samples.rows << " " << samples.cols << std::endl;
     std::cout << samples.at<float>(0,0) << std::endl;
 
-    int chunk_size = labels.rows / nfolds;
-    std::cout << "CHUNK SIZE: "  << chunk_size << " " << labels.rows << std::endl;
-
+    std::set<grid_point> finished;
+    bool unterminated = false;
+    if (output_file != "")
+        finished = read_finished(output_file, unterminated);
+    std::vector<grid_point> grid;
     for (int ndepth = ndepth_start; ndepth <= ndepth_end; ndepth += ndepth_step) {
         for (int nvars = nvars_start; nvars <= nvars_end; nvars += nvars_step) {
             for (int ntrees = ntrees_start; ntrees <= ntrees_end; ntrees += ntrees_step) {
+                grid_point point(ntrees, nvars, ndepth);
+                if (finished.find(point) == finished.end())
+                    grid.push_back(point);
+            }
+        }
+    }
+    std::cout << "GRID POINTS: " << grid.size() << " (" << finished.size() 
+              << " already done)" << std::endl;
+
+    std::ofstream ofs;
+    if (output_file != "") {
+        ofs.open(output_file.c_str(), std::ios::app);
+        // the new results must not be appended to a cut off line
+        if (unterminated)
+            ofs << std::endl;
+        if (finished.empty())
+            ofs << "# ntrees nvars ndepth error fp fn precision recall" << std::endl;
+    }
+
+    int n_jobs = grid.size() * nfolds;
+    std::vector<TextDetector::ForestFoldResult> fold_results(n_jobs);
+    std::vector<int> folds_done(grid.size(), 0);
+    #pragma omp parallel for schedule(dynamic) num_threads(std::max(1, njobs))
+    for (int job = 0; job < n_jobs; job++) {
+        const grid_point &point = grid[job / nfolds];
+        int chunk = job % nfolds;
+        cv::Range holdout = TextDetector::get_holdout_range(labels.rows, nfolds, chunk);
+        TextDetector::ForestParams params(
+            std::get<0>(point), std::get<2>(point), std::get<1>(point), prior);
+        TextDetector::ForestFoldResult result = TextDetector::cross_validate_forest_fold(
+            samples, labels, holdout, params, thresh, 
+            TextDetector::get_fold_seed(random_seed, params, chunk));
+
+        #pragma omp critical
+        {
+            std::cout << "ntrees: " << params.ntrees << " nvars: " << params.nvars 
+                      << " ndepth: " << params.depth << " fold: " << chunk 
+                      << " (" << holdout.start << " - " << holdout.end << ")" 
+                      << " train error: " << result.train_error() 
+                      << " err: " << result.error() 
+                      << " precision: " << result.precision() 
+                      << " recall: " << result.recall() << std::endl;
+
+            fold_results[job] = result;
+            if (++folds_done[job / nfolds] == nfolds) {
                 float err = 0;
                 float fp_err = 0;
                 float fn_err = 0;
                 float precision = 0;
                 float recall = 0;
-                for (int chunk = 0; chunk < nfolds; ++chunk) {
-                    cv::RandomTrees trees;
-                    float priors[] = { 1.0f,prior };
-                    cv::Mat vartype(samples.cols+1, 1, CV_8U);
-                    vartype.setTo(cv::Scalar(CV_VAR_NUMERICAL));
-                    vartype.at<uchar>(samples.cols, 0) = CV_VAR_CATEGORICAL;
-                    int idx_start = chunk * chunk_size;
-                    int idx_end = std::min(labels.rows - 1, idx_start + chunk_size - 1);
-
-                    std::cout << idx_start << " - " << idx_end << std::endl;
-                    cv::Mat holdout = samples.rowRange(idx_start, idx_end);
-                    cv::Mat holdout_labels = labels.rowRange(idx_start, idx_end);
-                    //cv::Mat holdout = cv::Mat(samples, cv::Range(idx_start, idx_end),cv::Range::all());
-                    //cv::Mat holdout_labels = cv::Mat(labels, cv::Range(idx_start, idx_end),cv::Range::all());
-
-                    cv::Mat train_set = cv::Mat(samples.rows - holdout.rows, samples.cols, CV_32F);
-                    cv::Mat train_labels = cv::Mat(samples.rows - holdout.rows, labels.cols, CV_32F);
-                    int idx = 0;
-                    for (int r = 0; r < labels.rows; ++r) {
-                        if (r < idx_start || r >= idx_end) {
-                            for (int c = 0; c < train_set.cols; ++c) {
-                                 train_set.at<float>(idx, c) = samples.at<float>(r, c);
-                            }
-                            train_labels.at<float>(idx, 0) = labels.at<float>(r,0);
-
-                            ++idx;
-                        }
-                    }
-                    
-                    std::cout << "holdout rows: " << holdout.rows << std::endl;
-                    std::cout << "TRAINING " << idx << " " << train_labels.rows << std::endl;
-                    trees.train(train_set, CV_ROW_SAMPLE, train_labels, cv::Mat(), cv::Mat(), vartype, cv::Mat(), CvRTParams(
-                        ndepth, // max depth
-                        5,      // min sample count
-                        0,      // rgression accuracy
-                        false,  // use surrogates
-                        15,     // max categories?!
-                        priors, // priors
-                        false,  // calc var importace
-                        nvars,  // nactiv vars?!
-                        ntrees, // max. no of trees
-                        0.01f,  // forest accuracy,
-                        CV_TERMCRIT_ITER | CV_TERMCRIT_EPS));
-
-                    int nmissclass_train = 0;
-                    for (int i = 0; i < train_set.rows; ++i) {
-                        float res = trees.predict_prob(train_set.row(i));
-                        res = res < thresh ? -1.0f : 1.0f;
-                        if (res != train_labels.at<float>(i, 0)) {
-                            ++nmissclass_train;
-                        }
-                    }
-                    std::cout << "Train Error: " << 
-                        float (nmissclass_train) / float(train_labels.rows) << std::endl;
-                    int nmissclass = 0; 
-                    int nfalse_pos = 0; 
-                    int nfalse_neg = 0; 
-                    int real_neg = 0;
-                    int real_pos = 0;
-                    int true_pos = 0;
-                    int true_neg = 0;
-                    for (int i = 0; i < holdout.rows; ++i) {
-                        float res = trees.predict_prob(holdout.row(i));
-                        // text
-                        res = res < thresh ? -1.0f : 1.0f;
-                        if (holdout_labels.at<float>(i,0) > 0) {
-                            real_pos++;
-                            if (res > 0) {
-                                true_pos++;
-                            }
-                        } else {
-                            real_neg++;
-                            if (res <= 0) {
-                                true_neg++;
-                            }
-                        }
-                        if (res != holdout_labels.at<float>(i, 0)) {
-                            ++nmissclass;
-                            if (res == 1 && holdout_labels.at<float>(i,0) == -1) {
-                                ++nfalse_pos;
-                            } else {
-                                ++nfalse_neg;
-                            }
-                        }
-                    }
-
-                    err += float (nmissclass) / float (holdout_labels.rows);
-                    fp_err += float (nfalse_pos) / float (nfalse_pos + real_neg);
-                    fn_err += float (nfalse_neg) / float (nfalse_neg + real_neg);
-                    precision += float (true_pos) / (nfalse_pos + true_pos);
-                    recall += float (true_pos) / (nfalse_neg + true_pos);
-                    std::cout << "err: " << 
-                        float (nmissclass) / float (holdout_labels.rows) << std::endl;
-                    std::cout << "precision: " << 
-                        float (true_pos) / (nfalse_pos + true_pos) << std::endl;
-                    std::cout << "recall: " << 
-                        float (true_pos) / (nfalse_neg + true_pos) << std::endl;
+                for (int k = job / nfolds * nfolds; k < (job / nfolds + 1) * nfolds; k++) {
+                    err += fold_results[k].error();
+                    fp_err += fold_results[k].fp_error();
+                    fn_err += fold_results[k].fn_error();
+                    precision += fold_results[k].precision();
+                    recall += fold_results[k].recall();
                 }
-
                 err = err / nfolds;
                 fp_err = fp_err / nfolds;
                 fn_err = fn_err / nfolds;
                 precision = precision / nfolds;
                 recall = recall / nfolds;
-                std::cout << "CV Error for ntrees: " << ntrees << " nvars: " 
-                          << nvars << " ndepth: " << ndepth << " error: " 
+                std::cout << "CV Error for ntrees: " << params.ntrees << " nvars: " 
+                          << params.nvars << " ndepth: " << params.depth << " error: " 
                           << err << " (fp: " << fp_err << " fn: " 
                           << fn_err << " p: " << precision << " r: " 
                           << recall << ")" << std::endl;
+                if (ofs.is_open()) {
+                    ofs << params.ntrees << " " << params.nvars << " " << params.depth << " " 
+                        << err << " " << fp_err << " " << fn_err << " " 
+                        << precision << " " << recall << std::endl;
+                }
             }
         }
     }
     return 0;
-
-
 }
@@ -18,11 +18,17 @@
 #include <opencv2/core/core.hpp>
 #include <opencv2/ml/ml.hpp>
 
+#include <text_detector/FeatureStore.h>
+#include <text_detector/ForestCrossValidation.h>
+
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <getopt.h>
 #include <sstream>
 
+#include <omp.h>
+
 static std::vector<std::string> &split(const std::string &s, char delim, std::vector<std::string> &elems) {
     std::stringstream ss(s);
     std::string item;
@@ -70,6 +76,8 @@ static void parse_steps(const std::string &arg, int &start, int &step, int &end)
  * The training file should be randomized. Note: cross-validation is actually
  * not really necessary to do when using Random Forests, since they have 
  * an own cross-validation like error-measure: oob-error
+ *
+ * The folds are trained concurrently (-j caps the number of jobs).
  */
 int main(int argc, char *argv[])
 {
@@ -80,7 +88,8 @@ int main(int argc, char *argv[])
     int depth = 10;
     int nvars = 10;
     int nfolds = 5;
-    while ((c = getopt(argc, argv, "r:i:n:d:v:f:o:h")) != -1) {
+    int njobs = omp_get_max_threads();
+    while ((c = getopt(argc, argv, "r:i:n:d:v:f:o:j:h")) != -1) {
         switch (c) {
             case 'r':
                 std::stringstream(optarg) >> random_seed;
@@ -103,16 +112,20 @@ int main(int argc, char *argv[])
             case 'o':
                 output_file = optarg;
                 break;
+            case 'j':
+                std::stringstream(optarg) >> njobs;
+                break;
             case 'h':
             default:
                 std::cerr << "Usage: train_forest OPTIONS" << std::endl 
-                    << "\t -i <train.csv>" << std::endl 
+                    << "\t -i <train.csv or packed feature file>" << std::endl 
                     << "\t -f <folds>" << std::endl 
                     << "\t -r <random_seed>" << std::endl 
                     << "\t -n <number of trees>" << std::endl 
                     << "\t -v <number of active>" << std::endl 
                     << "\t -o <out file>" << std::endl 
-                    << "\t -d <depth of trees start>" << std::endl;
+                    << "\t -d <depth of trees start>" << std::endl
+                    << "\t -j <number of concurrent jobs>" << std::endl;
                 return 1;
         }
     }
@@ -129,6 +142,10 @@ int main(int argc, char *argv[])
         std::cerr << "Error - need at least 1 variable" << std::endl;
         return 1;
     }
+    if (nfolds < 2) {
+        std::cerr << "Error - need at least 2 folds" << std::endl;
+        return 1;
+    }
     if (train_file == "" || output_file == "") {
         std::cerr << "Error - need a training/output file" << std::endl;
         return 1;
@@ -139,12 +156,7 @@ int main(int argc, char *argv[])
               << nvars << std::endl
               << depth << std::endl;
 
-    cv::TrainData data;
-    data.read_csv(train_file.c_str());
-    data.set_response_idx(0);
-    data.set_delimiter(',');
-
-    cv::Mat values = cv::Mat(data.get_values());
+    cv::Mat values = TextDetector::load_features(train_file);
     cv::Mat result_labels(values.rows, 1.0, CV_32FC1, cv::Scalar(0.0f));
     std::vector<int> indices(values.rows);
     for (size_t i = 0; i < indices.size(); i++) indices[i] = i;
@@ -165,134 +177,62 @@ int main(int argc, char *argv[])
         std::swap(indices[i], indices[j]);
     }
 
-    cv::Mat samples = values.colRange(1, values.cols);
-    cv::Mat labels = values.colRange(0, 1);
+    // contiguous copies, which are shared read-only by all folds
+    cv::Mat samples = values.colRange(1, values.cols).clone();
+    cv::Mat labels = values.colRange(0, 1).clone();
+    values.release();
 
     std::cout << labels.rows << " " << labels.cols << std::endl;
     std::cout << samples.rows << " " << samples.cols << std::endl;
     std::cout << samples.at<float>(0,0) << std::endl;
 
-    int chunk_size = labels.rows / nfolds;
-    std::cout << "CHUNK SIZE: "  << chunk_size << " " << labels.rows << std::endl;
-
-                float err = 0;
-                float fp_err = 0;
-                float fn_err = 0;
-                float precision = 0;
-                float recall = 0;
-                for (int chunk = 0; chunk < nfolds; ++chunk) {
-                    cv::RandomTrees trees;
-                    float priors[] = { 1.0f,1.0f };
-                    cv::Mat vartype(samples.cols+1, 1, CV_8U);
-                    vartype.setTo(cv::Scalar(CV_VAR_NUMERICAL));
-                    vartype.at<uchar>(samples.cols, 0) = CV_VAR_CATEGORICAL;
-                    int idx_start = chunk * chunk_size;
-                    int idx_end = std::min(labels.rows - 1, idx_start + chunk_size - 1);
-
-                    std::cout << idx_start << " - " << idx_end << std::endl;
-                    cv::Mat holdout = samples.rowRange(idx_start, idx_end);
-                    cv::Mat holdout_labels = labels.rowRange(idx_start, idx_end);
-                    //cv::Mat holdout = cv::Mat(samples, cv::Range(idx_start, idx_end),cv::Range::all());
-                    //cv::Mat holdout_labels = cv::Mat(labels, cv::Range(idx_start, idx_end),cv::Range::all());
-
-                    cv::Mat train_set = cv::Mat(samples.rows - holdout.rows, samples.cols, CV_32F);
-                    cv::Mat train_labels = cv::Mat(samples.rows - holdout.rows, labels.cols, CV_32F);
-                    int idx = 0;
-                    for (int r = 0; r < labels.rows; ++r) {
-                        if (r < idx_start || r >= idx_end) {
-                            for (int c = 0; c < train_set.cols; ++c) {
-                                 train_set.at<float>(idx, c) = samples.at<float>(r, c);
-                            }
-                            train_labels.at<float>(idx, 0) = labels.at<float>(r,0);
-
-                            ++idx;
-                        }
-                    }
-                    
-                    std::cout << "holdout rows: " << holdout.rows << std::endl;
-                    std::cout << "TRAINING " << idx << " " << train_labels.rows << std::endl;
-                    trees.train(train_set, CV_ROW_SAMPLE, train_labels, cv::Mat(), cv::Mat(), vartype, cv::Mat(), CvRTParams(
-                        depth,  // max depth
-                        5,      // min sample count
-                        0,      // rgression accuracy
-                        false,  // use surrogates
-                        15,     // max categories?!
-                        NULL, // priors
-                        false,  // calc var importace
-                        nvars,  // nactiv vars?!
-                        ntrees, // max. no of trees
-                        0.01f,  // forest accuracy,
-                        CV_TERMCRIT_ITER | CV_TERMCRIT_EPS));
-
-                    int nmissclass_train = 0;
-                    for (int i = 0; i < train_set.rows; ++i) {
-                        float res = trees.predict_prob(train_set.row(i));
-                        res = res < 0.5f ? -1.0f : 1.0f;
-                        if (res != train_labels.at<float>(i, 0)) {
-                            ++nmissclass_train;
-                        }
-                    }
-                    std::cout << "Train Error: " << float (nmissclass_train) / float(train_labels.rows) << std::endl;
-                    int nmissclass = 0; 
-                    int nfalse_pos = 0; 
-                    int nfalse_neg = 0; 
-                    int real_neg = 0;
-                    int real_pos = 0;
-                    int true_pos = 0;
-                    int true_neg = 0;
-                    for (int i = 0; i < holdout.rows; ++i) {
-                        float res = trees.predict_prob(holdout.row(i));
-                        // store the result
-                        result_labels.at<float>(indices[i + idx_start], 0) = res;
-                        // text
-                        res = res < 0.5f ? -1.0f : 1.0f;
-                        if (holdout_labels.at<float>(i,0) > 0) {
-                            real_pos++;
-                            if (res > 0) {
-                                true_pos++;
-                            }
-                        } else {
-                            real_neg++;
-                            if (res <= 0) {
-                                true_neg++;
-                            }
-                        }
-                        if (res != holdout_labels.at<float>(i, 0)) {
-                            ++nmissclass;
-                            if (res == 1 && holdout_labels.at<float>(i,0) == -1) {
-                                ++nfalse_pos;
-                            } else {
-                                ++nfalse_neg;
-                            }
-                        }
-                    }
-
-                    err += float (nmissclass) / float (holdout_labels.rows);
-                    fp_err += float (nfalse_pos) / float (nfalse_pos + real_neg);
-                    fn_err += float (nfalse_neg) / float (nfalse_neg + real_neg);
-                    precision += float (true_pos) / (nfalse_pos + true_pos);
-                    recall += float (true_pos) / (nfalse_neg + true_pos);
-                    std::cout << "err: " << float (nmissclass) / float (holdout_labels.rows) << std::endl;
-                    std::cout << "false pos: " << float (nfalse_pos) / float (nfalse_pos + real_neg) << std::endl;
-                    std::cout << "false neg: " << float (nfalse_neg) / float (nfalse_neg + real_neg) << std::endl;
-                }
-
-                err = err / nfolds;
-                fp_err = fp_err / nfolds;
-                fn_err = fn_err / nfolds;
-                precision = precision / nfolds;
-                recall = recall / nfolds;
-                std::cout << "CV Error for ntrees: " << ntrees << " nvars: " 
-                          << nvars << " depth: " << depth << " error: " << err << " (fp: " << fp_err << " fn: " << fn_err << " p: " << precision << " r: " << recall << ")" << std::endl;
-
+    TextDetector::ForestParams params(ntrees, depth, nvars);
+    std::vector<TextDetector::ForestFoldResult> fold_results(nfolds);
+    #pragma omp parallel for schedule(dynamic) num_threads(std::max(1, njobs))
+    for (int chunk = 0; chunk < nfolds; ++chunk) {
+        cv::Range holdout = TextDetector::get_holdout_range(labels.rows, nfolds, chunk);
+        std::vector<float> probs;
+        TextDetector::ForestFoldResult result = TextDetector::cross_validate_forest_fold(
+            samples, labels, holdout, params, 0.5f, 
+            TextDetector::get_fold_seed(random_seed, params, chunk), &probs);
+        // store the results, the holdout rows of the folds are disjoint
+        for (size_t i = 0; i < probs.size(); i++) {
+            result_labels.at<float>(indices[i + holdout.start], 0) = probs[i];
+        }
+        fold_results[chunk] = result;
+
+        #pragma omp critical
+        std::cout << "fold: " << chunk << " (" << holdout.start << " - " << holdout.end << ")" 
+                  << " train error: " << result.train_error() 
+                  << " err: " << result.error() 
+                  << " false pos: " << result.fp_error() 
+                  << " false neg: " << result.fn_error() << std::endl;
+    }
 
-                std::ofstream ofs(output_file.c_str());
-                for (int i = 0; i < result_labels.rows; i++) {
-                    ofs << result_labels.at<float>(i, 0) << std::endl;
-                }
-                ofs.close();
+    float err = 0;
+    float fp_err = 0;
+    float fn_err = 0;
+    float precision = 0;
+    float recall = 0;
+    for (int chunk = 0; chunk < nfolds; ++chunk) {
+        err += fold_results[chunk].error();
+        fp_err += fold_results[chunk].fp_error();
+        fn_err += fold_results[chunk].fn_error();
+        precision += fold_results[chunk].precision();
+        recall += fold_results[chunk].recall();
+    }
+    err = err / nfolds;
+    fp_err = fp_err / nfolds;
+    fn_err = fn_err / nfolds;
+    precision = precision / nfolds;
+    recall = recall / nfolds;
+    std::cout << "CV Error for ntrees: " << ntrees << " nvars: " 
+              << nvars << " depth: " << depth << " error: " << err << " (fp: " << fp_err << " fn: " << fn_err << " p: " << precision << " r: " << recall << ")" << std::endl;
+
+    std::ofstream ofs(output_file.c_str());
+    for (int i = 0; i < result_labels.rows; i++) {
+        ofs << result_labels.at<float>(i, 0) << std::endl;
+    }
+    ofs.close();
     return 0;
-
-
 }
-
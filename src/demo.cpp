@@ -26,6 +26,7 @@
 #include <boost/archive/text_iarchive.hpp>
 #include <boost/program_options.hpp>
 
+#include <text_detector/Instrumentation.h>
 #include <text_detector/MserDetector.h>
 
 namespace po = boost::program_options;
@@ -55,7 +56,6 @@ int main(int argc, const char *argv[])
         std::shared_ptr<TextDetector::ConfigurationManager> config(
         	new TextDetector::ConfigurationManager(
         		vm["config"].as<std::string>()));
-        TextDetector::ConfigurationManager::set_instance(config);
 
         float threshold = config->get_threshold();
 
@@ -82,6 +82,8 @@ int main(int argc, const char *argv[])
 
         clf.detect(image, mask);
         cv::Mat result_image;
+        TextDetector::ImageStats stats(input, config->verbose());
+        TextDetector::ScopedImageStats scope(&stats);
         std::vector<cv::Rect> words = detector(image, result_image, mask > (255 * threshold));
 
         for (size_t i = 0; i < words.size(); i++) {
@@ -0,0 +1,351 @@
+/**
+ *  This file is part of ltp-text-detector.
+ *  Copyright (C) 2013 Michael Opitz
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+#include <boost/timer/timer.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include <text_detector/AdaboostClassifier.h>
+#include <text_detector/CacheManager.h>
+#include <text_detector/ConfigurationManager.h>
+#include <text_detector/CpuDispatch.h>
+#include <text_detector/Instrumentation.h>
+#include <text_detector/MserDetector.h>
+#include <text_detector/Pipeline.h>
+#include <text_detector/ReplayBundle.h>
+
+namespace po = boost::program_options;
+namespace fs = boost::filesystem;
+
+/**
+ * Writes the intermediate response maps in the same format as bin/classify
+ */
+static void
+write_debug_responses(
+    const fs::path &output_dir,
+    const std::string &name,
+    const cv::Mat &response,
+    TextDetector::AdaboostResponses &debug)
+{
+    {
+    std::stringstream ss;
+    ss << output_dir.generic_string() << "/" << name << "_response.png";
+    cv::imwrite(ss.str(), response);
+    }
+    {
+    std::stringstream ss;
+    ss << output_dir.generic_string() << "/" << name << "_scale.txt";
+    std::ofstream ofs(ss.str().c_str());
+    ofs << debug.min << "," << debug.max << std::endl;
+    }
+    for (unsigned int i = 0; i < debug.scale_responses.size(); ++i) {
+        std::stringstream ss;
+        ss << output_dir.generic_string() << "/" << name << "_response_all_" << i << ".png";
+        cv::Mat scaled;
+        cv::multiply(debug.scale_responses[i], cv::Scalar::all(255.0), scaled);
+        cv::imwrite(ss.str(), scaled);
+    }
+}
+
+/**
+ * The state of a single image while it is passed through the pipeline
+ */
+struct ImageJob
+{
+    fs::path path;
+    std::string name;
+    cv::Mat image;
+    cv::Mat mask;
+    cv::Mat gt_mask;
+    TextDetector::ExtractedComponents components;
+    cv::Mat result_image;
+    std::vector<cv::Rect> words;
+    boost::timer::cpu_timer timer;
+    TextDetector::ImageStats stats;
+};
+typedef std::shared_ptr<ImageJob> ImageJobPtr;
+
+int main(int argc, const char *argv[])
+{
+    try {
+        po::options_description desc("Allowed options");
+        desc.add_options()
+            ("help,h", "print this help message")
+            ("print-cpu-dispatch", "print the instruction set variants of the kernels and the selected one")
+            ("config,c", po::value<std::string>()->required(), "path to config file")
+            ("model,m", po::value<std::string>()->required(), "path to model file")
+            ("input,i", po::value<std::string>(), "input directory (defaults to input_directory of the config)")
+            ("output,o", po::value<std::string>(), "output directory (defaults to responses_directory of the config)")
+            ("debug,d", "write the response maps and the box images")
+            ("queue-size", po::value<int>()->default_value(2), "capacity of the queue in front of each stage")
+            ("decode-workers", po::value<int>()->default_value(1), "number of threads reading images")
+            ("response-workers", po::value<int>()->default_value(1), "number of threads computing response maps")
+            ("cc-workers", po::value<int>()->default_value(1), "number of threads extracting connected components")
+            ("group-workers", po::value<int>()->default_value(1), "number of threads filtering, grouping and splitting")
+            ("write-workers", po::value<int>()->default_value(1), "number of threads writing results")
+            ("omp-threads", po::value<int>()->default_value(0), "number of OpenMP threads per worker (0 = cores / workers)")
+            ("stats", po::value<std::string>(), "write per image stage timings and counters to this file")
+            ("stats-format", po::value<std::string>()->default_value("jsonl"), "format of the stats file (jsonl or csv)")
+            ("summary", "print p50/p95/p99 of all stages and counters after the batch")
+            ("capture", po::value<std::string>(), "write replay bundles (see bin/replay_stage) to this directory")
+            ("capture-min-ms", po::value<double>()->default_value(0.0), "only capture images, whose detection took longer")
+        ;
+
+        po::variables_map vm;
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+
+        if (vm.count("help")) {
+            std::cout << desc << std::endl;
+            return 0;
+        }
+
+        if (vm.count("print-cpu-dispatch")) {
+            std::cout << TextDetector::describe_cpu_dispatch();
+            return 0;
+        }
+
+        po::notify(vm);
+
+        std::shared_ptr<TextDetector::ConfigurationManager> config(
+        	new TextDetector::ConfigurationManager(
+        		vm["config"].as<std::string>()));
+
+        std::shared_ptr<CacheManager> cache;
+        if (config->has_cache()) {
+            cache.reset(new CacheManager(config->get_cache_directory()));
+        }
+
+        srand(config->get_random_seed());
+
+        const fs::path input_dir(vm.count("input") ?
+            vm["input"].as<std::string>() : config->get_input_directory());
+        const fs::path output_dir(vm.count("output") ?
+            vm["output"].as<std::string>() : config->get_responses_directory());
+        const bool debug = vm.count("debug") > 0;
+        const bool capture = vm.count("capture") > 0;
+        const double capture_min_ms = vm["capture-min-ms"].as<double>();
+        const fs::path capture_dir(capture ? vm["capture"].as<std::string>() : "");
+        if (capture && !fs::is_directory(capture_dir)) {
+            fs::create_directories(capture_dir);
+        }
+
+        if (!fs::is_directory(input_dir)) {
+            std::cerr << "Error: input directory does not exist" << std::endl;
+            return 1;
+        }
+        if (!fs::is_directory(output_dir)) {
+            fs::create_directories(output_dir);
+        }
+
+        std::ofstream stats_file;
+        TextDetector::StatsCollector::Format stats_format = TextDetector::StatsCollector::JSON_LINES;
+        if (vm["stats-format"].as<std::string>() == "csv") {
+            stats_format = TextDetector::StatsCollector::CSV;
+        } else if (vm["stats-format"].as<std::string>() != "jsonl") {
+            std::cerr << "Error: unknown stats format" << std::endl;
+            return 1;
+        }
+        if (vm.count("stats")) {
+            stats_file.open(vm["stats"].as<std::string>().c_str());
+        }
+        TextDetector::StatsCollector collector(
+            stats_file.is_open() ? &stats_file : 0, stats_format);
+
+        int cc_workers = vm["cc-workers"].as<int>();
+
+        // the heavy stages share the cores
+        int omp_threads = vm["omp-threads"].as<int>();
+        if (omp_threads <= 0) {
+            int n_workers = vm["response-workers"].as<int>() + cc_workers + 
+                vm["group-workers"].as<int>();
+            omp_threads = std::max(1, int(std::thread::hardware_concurrency()) / std::max(1, n_workers));
+        }
+        TextDetector::Pipeline<ImageJobPtr>::WorkerInit init_omp = [omp_threads] () {
+#ifdef _OPENMP
+            omp_set_num_threads(omp_threads);
+#endif
+        };
+
+        // the models are loaded once for the whole batch
+        TextDetector::MserDetector detector(TextDetector::DetectorContext(config, cache));
+        TextDetector::AdaboostClassifier clf(vm["model"].as<std::string>());
+
+        if (config->verbose())
+            std::cout << "Read models" << std::endl;
+
+        std::vector<fs::path> files;
+        std::copy(fs::directory_iterator(input_dir),
+            fs::directory_iterator(), 
+            std::back_inserter(files));
+        std::sort(files.begin(), files.end());
+
+        std::vector<ImageJobPtr> jobs;
+        for (const fs::path &p : files) {
+            if (p.extension() != ".jpg" && p.extension() != ".png") {
+                continue;
+            }
+            // skip our own outputs and the gt masks
+            std::string number = p.stem().generic_string();
+            if (number.find("_mask") != std::string::npos ||
+                number.find("_response") != std::string::npos ||
+                number.find("_boxes") != std::string::npos) {
+                continue;
+            }
+            ImageJobPtr job(new ImageJob());
+            job->path = p;
+            job->name = number;
+            job->stats = TextDetector::ImageStats(number, config->verbose());
+            jobs.push_back(job);
+        }
+
+        TextDetector::Pipeline<ImageJobPtr> pipeline(vm["queue-size"].as<int>());
+
+        // records the time of each pipeline stage and makes the stats of the 
+        // job reachable for the stages inside the detector
+        auto instrumented = [] (const std::string &stage, 
+            const TextDetector::Pipeline<ImageJobPtr>::StageFunction &f) {
+            return [stage, f] (ImageJobPtr &job) -> bool {
+                TextDetector::ScopedImageStats scope(&job->stats);
+                TextDetector::ScopedStageTimer timer("stage_" + stage);
+                return f(job);
+            };
+        };
+
+        pipeline.add_stage("decode", vm["decode-workers"].as<int>(), instrumented("decode", [&] (ImageJobPtr &job) -> bool {
+            job->timer.start();
+            job->image = cv::imread(job->path.generic_string());
+            if (job->image.empty()) {
+                std::cerr << "Error, could not read " << job->path << " -> skipping!" << std::endl;
+                return false;
+            }
+            if (config->include_binary_masks()) {
+                fs::path mask_path(input_dir);
+                mask_path /= job->name + "_mask.png";
+                if (!fs::exists(mask_path)) {
+                    std::cout << "Skipping: " << mask_path << " due to missing mask!" << std::endl;
+                    return false;
+                }
+                job->gt_mask = cv::imread(mask_path.generic_string(), 0);
+            }
+            return true;
+        }));
+
+        pipeline.add_stage("response", vm["response-workers"].as<int>(), instrumented("response", [&] (ImageJobPtr &job) -> bool {
+            if (config->ignore_responses()) {
+                job->mask = cv::Mat(job->image.rows, job->image.cols, CV_8UC1, cv::Scalar(255));
+                return true;
+            }
+            cv::Mat response;
+            if (debug) {
+                TextDetector::AdaboostResponses responses;
+                clf.detect(job->image, response, &responses);
+                write_debug_responses(output_dir, job->name, response, responses);
+            } else {
+                clf.detect(job->image, response);
+            }
+            job->mask = response > (config->get_threshold() * 255);
+            return true;
+        }), init_omp);
+
+        pipeline.add_stage("cc", cc_workers, instrumented("cc", [&] (ImageJobPtr &job) -> bool {
+            detector.extract_components(job->image, job->mask, job->gt_mask, job->components);
+            return true;
+        }), init_omp);
+
+        pipeline.add_stage("group", vm["group-workers"].as<int>(), instrumented("group", [&] (ImageJobPtr &job) -> bool {
+            if (!capture) {
+                job->words = detector.detect_words(job->image, job->components, job->result_image);
+            } else {
+                TextDetector::ReplayBundle bundle;
+                bundle.name = job->name;
+                bundle.detector_mask = job->mask;
+                bundle.extra_bin_mask = job->gt_mask;
+                job->words = detector.detect_words(job->image, job->components, 
+                    job->result_image, &bundle);
+                if (job->timer.elapsed().wall / 1.0e6 >= capture_min_ms) {
+                    fs::path bundle_path(capture_dir);
+                    bundle_path /= job->name + ".replay";
+                    bundle.save(bundle_path.generic_string());
+                }
+            }
+            // the components are not needed anymore
+            job->components = TextDetector::ExtractedComponents();
+            return true;
+        }), init_omp);
+
+        pipeline.add_stage("write", vm["write-workers"].as<int>(), instrumented("write", [&] (ImageJobPtr &job) -> bool {
+            const std::vector<cv::Rect> &words = job->words;
+            fs::path out_name(output_dir);
+            out_name /= job->name + "_boxes.txt";
+            std::ofstream ofs(out_name.generic_string());
+            for (size_t i = 0; i < words.size(); i++) {
+                const cv::Rect &r = words[i];
+                ofs << r.x << "," << r.y << "," << r.width << "," << r.height << std::endl;
+            }
+            ofs.close();
+
+            if (debug) {
+                for (size_t i = 0; i < words.size(); i++) {
+                    cv::rectangle(job->result_image, words[i].tl(), words[i].br(), cv::Scalar(0, 0, 255), 4);
+                }
+                fs::path out_img_name(output_dir);
+                out_img_name /= job->name + "_boxes.png";
+                cv::imwrite(out_img_name.generic_string(), job->result_image);
+            }
+
+            std::cout << "Detected " << words.size() << " words in " << job->path.filename()
+                      << " in " << boost::timer::format(job->timer.elapsed(), 5, "%w") << std::endl;
+            return true;
+        }));
+
+        // the last stage hands the finished jobs to the collector
+        pipeline.add_stage("stats", 1, [&] (ImageJobPtr &job) -> bool {
+            job->stats.add_time("total", job->timer.elapsed().wall / 1.0e6);
+            collector.add(job->stats);
+            // release the images of this job
+            job.reset();
+            return true;
+        });
+
+        pipeline.run(jobs);
+        collector.finish();
+        if (vm.count("summary")) {
+            collector.write_summary(std::cout);
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
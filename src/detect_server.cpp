@@ -0,0 +1,249 @@
+/**
+ *  This file is part of ltp-text-detector.
+ *  Copyright (C) 2013 Michael Opitz
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/program_options.hpp>
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <dlib/server.h>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include <text_detector/ConfigurationManager.h>
+#include <text_detector/CpuDispatch.h>
+#include <text_detector/DetectionService.h>
+
+namespace po = boost::program_options;
+
+/**
+ * Reads an integer query parameter, returns def if it is not given
+ */
+static int
+query_int(const dlib::incoming_things &incoming, const std::string &key, int def)
+{
+    dlib::key_value_map::const_iterator it = incoming.queries.find(key);
+    if (it == incoming.queries.end() || it->second.empty())
+        return def;
+    return std::atoi(it->second.c_str());
+}
+
+/**
+ * Returns the image of the request. Encoded images (png, jpg, ...) are 
+ * decoded, raw buffers are wrapped without copying them if they are BGR.
+ */
+static cv::Mat
+request_image(const dlib::incoming_things &incoming)
+{
+    if (incoming.body.empty())
+        throw std::runtime_error("Empty request body");
+
+    int width = query_int(incoming, "width", 0);
+    int height = query_int(incoming, "height", 0);
+    if (width <= 0 && height <= 0) {
+        std::vector<uchar> buffer(incoming.body.begin(), incoming.body.end());
+        cv::Mat image = cv::imdecode(buffer, 1);
+        if (image.empty())
+            throw std::runtime_error("Could not decode the image");
+        return image;
+    }
+
+    int channels = query_int(incoming, "channels", 3);
+    if (width <= 0 || height <= 0 || (channels != 1 && channels != 3 && channels != 4))
+        throw std::runtime_error("Invalid raw image size");
+    if (incoming.body.size() != size_t(width) * height * channels)
+        throw std::runtime_error("The size of the raw image does not match the body");
+
+    // the body outlives the detection, the detector does not modify its input
+    cv::Mat raw(height, width, CV_8UC(channels), 
+        const_cast<char *>(incoming.body.data()));
+    if (channels == 3)
+        return raw;
+    cv::Mat image;
+    cv::cvtColor(raw, image, channels == 1 ? CV_GRAY2BGR : CV_BGRA2BGR);
+    return image;
+}
+
+/**
+ * Writes the words and stats of a detection as JSON object
+ */
+static std::string
+result_json(const TextDetector::DetectionResult &result)
+{
+    std::ostringstream os;
+    os << "{\"words\":[";
+    for (size_t i = 0; i < result.words.size(); i++) {
+        const TextDetector::DetectedWord &w = result.words[i];
+        os << (i ? "," : "") << "{\"x\":" << w.box.x << ",\"y\":" << w.box.y
+           << ",\"width\":" << w.box.width << ",\"height\":" << w.box.height
+           << ",\"score\":" << std::fixed << std::setprecision(4) << w.score << "}";
+    }
+    // write_json terminates the line
+    std::ostringstream stats;
+    result.stats.write_json(stats);
+    std::string stats_json = stats.str();
+    stats_json.erase(stats_json.find_last_not_of("\n") + 1);
+    os << "],\"stats\":" << stats_json << "}" << std::endl;
+    return os.str();
+}
+
+static std::string
+error_json(const std::string &message)
+{
+    std::string escaped;
+    for (char c : message) {
+        if (c == '"' || c == '\\') escaped += '\\';
+        escaped += (c == '\n' ? ' ' : c);
+    }
+    return "{\"error\":\"" + escaped + "\"}\n";
+}
+
+/**
+ * HTTP frontend of the DetectionService. 
+ *
+ *   POST /detect                 body: an encoded image (png, jpg, ...)
+ *   POST /detect?width=W&height=H[&channels=C]
+ *                                body: raw 8 bit BGR (C=3), gray (C=1) or
+ *                                BGRA (C=4) pixels, row by row
+ *   GET  /health                 number of served and pending requests
+ *
+ * Every connection is handled by a thread of dlib's server, the detection
+ * itself runs on the workers of the service.
+ */
+class DetectionServer : public dlib::server_http
+{
+public:
+    DetectionServer(TextDetector::DetectionService &service) 
+        : _service(service) {}
+
+private:
+    const std::string on_request(
+        const dlib::incoming_things &incoming,
+        dlib::outgoing_things &outgoing)
+    {
+        outgoing.headers["Content-Type"] = "application/json";
+        // dlib keeps the query string in the path
+        const std::string path = incoming.path.substr(0, incoming.path.find('?'));
+        if (path == "/health") {
+            std::ostringstream os;
+            os << "{\"served\":" << _service.served() 
+               << ",\"pending\":" << _service.pending() << "}" << std::endl;
+            return os.str();
+        }
+        if (path != "/detect") {
+            outgoing.http_return = 404;
+            outgoing.http_return_status = "Not Found";
+            return error_json("Unknown path " + path);
+        }
+        if (incoming.request_type != "POST") {
+            outgoing.http_return = 405;
+            outgoing.http_return_status = "Method Not Allowed";
+            return error_json("Images must be posted");
+        }
+
+        cv::Mat image;
+        try {
+            image = request_image(incoming);
+        } catch (const std::exception &e) {
+            outgoing.http_return = 400;
+            outgoing.http_return_status = "Bad Request";
+            return error_json(e.what());
+        }
+
+        try {
+            dlib::key_value_map::const_iterator name = incoming.queries.find("name");
+            return result_json(_service.detect(image, 
+                name != incoming.queries.end() ? name->second : ""));
+        } catch (const std::exception &e) {
+            outgoing.http_return = 500;
+            outgoing.http_return_status = "Internal Server Error";
+            return error_json(e.what());
+        }
+    }
+
+    TextDetector::DetectionService &_service;
+};
+
+int main(int argc, const char *argv[])
+{
+    try {
+        po::options_description desc("Allowed options");
+        desc.add_options()
+            ("help,h", "print this help message")
+            ("print-cpu-dispatch", "print the instruction set variants of the kernels and the selected one")
+            ("config,c", po::value<std::string>()->required(), "path to config file")
+            ("model,m", po::value<std::string>()->required(), "path to model file")
+            ("port,p", po::value<int>()->default_value(8080), "port to listen on")
+            ("listen", po::value<std::string>()->default_value("127.0.0.1"), "ip address to listen on")
+            ("workers", po::value<int>()->default_value(1), "number of detection threads")
+            ("queue-size", po::value<int>()->default_value(4), "number of requests waiting for a worker")
+            ("omp-threads", po::value<int>()->default_value(0), "number of OpenMP threads per worker (0 = cores / workers)")
+            ("max-connections", po::value<int>()->default_value(64), "number of concurrent connections")
+            ("max-body-mb", po::value<int>()->default_value(64), "maximum size of a request in MB")
+        ;
+
+        po::variables_map vm;
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+
+        if (vm.count("help")) {
+            std::cout << desc << std::endl;
+            return 0;
+        }
+
+        if (vm.count("print-cpu-dispatch")) {
+            std::cout << TextDetector::describe_cpu_dispatch();
+            return 0;
+        }
+
+        po::notify(vm);
+
+        std::shared_ptr<TextDetector::ConfigurationManager> config(
+        	new TextDetector::ConfigurationManager(
+        		vm["config"].as<std::string>()));
+
+        srand(config->get_random_seed());
+
+        // the models are loaded once for the lifetime of the server
+        TextDetector::DetectionService service(config, 
+            vm["model"].as<std::string>(),
+            vm["workers"].as<int>(), 
+            vm["queue-size"].as<int>(),
+            vm["omp-threads"].as<int>());
+
+        DetectionServer server(service);
+        server.set_listening_ip(vm["listen"].as<std::string>());
+        server.set_listening_port(vm["port"].as<int>());
+        server.set_max_connections(vm["max-connections"].as<int>());
+        server.set_max_content_length(
+            (unsigned long)vm["max-body-mb"].as<int>() * 1024 * 1024);
+
+        std::cout << "Listening on " << vm["listen"].as<std::string>() 
+                  << ":" << vm["port"].as<int>() << std::endl;
+        server.start();
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,322 @@
+/**
+ *  This file is part of ltp-text-detector.
+ *  Copyright (C) 2013 Michael Opitz
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <text_detector/Evaluation.h>
+#include <text_detector/Instrumentation.h>
+
+namespace po = boost::program_options;
+namespace fs = boost::filesystem;
+
+/**
+ *  Returns the raw value of "key": in a single line JSON object (strings
+ *  without the quotes). Sufficient for the files written by this project.
+ */
+static bool find_json_value(const std::string &line, const std::string &key, std::string &value)
+{
+    const std::string pattern = "\"" + key + "\":";
+    size_t pos = line.find(pattern);
+    if (pos == std::string::npos) return false;
+    pos += pattern.size();
+    if (pos < line.size() && line[pos] == '"') {
+        size_t end = line.find('"', pos + 1);
+        if (end == std::string::npos) return false;
+        value = line.substr(pos + 1, end - pos - 1);
+    } else {
+        size_t end = line.find_first_of(",}", pos);
+        value = line.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+    }
+    return true;
+}
+
+/**
+ *  Reads the total runtime per image from the stats file of bin/detect 
+ *  (JSON lines or CSV).
+ */
+static std::map<std::string, double> read_runtimes(const std::string &filename)
+{
+    std::ifstream ifs(filename.c_str());
+    if (!ifs) 
+        throw std::runtime_error("Could not read " + filename);
+
+    std::map<std::string, double> result;
+    std::string line;
+    int image_col = -1, total_col = -1;
+    while (std::getline(ifs, line)) {
+        if (line.empty()) continue;
+        if (line[0] == '{') {
+            std::string image, total;
+            if (find_json_value(line, "image", image) && 
+                find_json_value(line, "total", total)) {
+                result[image] = std::stod(total);
+            }
+            continue;
+        }
+
+        std::vector<std::string> cols;
+        std::stringstream ss(line);
+        std::string col;
+        while (std::getline(ss, col, ',')) cols.push_back(col);
+        if (image_col < 0) {
+            // the header
+            for (size_t i = 0; i < cols.size(); i++) {
+                if (cols[i] == "image") image_col = i;
+                if (cols[i] == "total_ms") total_col = i;
+            }
+            if (image_col < 0 || total_col < 0)
+                throw std::runtime_error("No image/total_ms columns in " + filename);
+            continue;
+        }
+        if (int(cols.size()) > std::max(image_col, total_col) && !cols[total_col].empty())
+            result[cols[image_col]] = std::stod(cols[total_col]);
+    }
+    return result;
+}
+
+/**
+ *  Reads a value of the summary line written with --json
+ */
+static bool read_summary_value(const std::string &summary, const std::string &key, double &value)
+{
+    std::string raw;
+    if (!find_json_value(summary, key, raw))
+        return false;
+    value = std::stod(raw);
+    return true;
+}
+
+struct ImageEvaluation
+{
+    std::string name;
+    TextDetector::EvaluationResult result;
+    double runtime_ms;
+    bool missing;
+    //! The error message if the files of the image could not be read
+    std::string error;
+};
+
+int main(int argc, const char *argv[])
+{
+    try {
+        po::options_description desc("Allowed options");
+        desc.add_options()
+            ("help,h", "print this help message")
+            ("detections,d", po::value<std::string>()->required(), "directory with the <image>_boxes.txt files")
+            ("gt,g", po::value<std::string>()->required(), "directory with gt_<image>.txt files or a DetEval xml file")
+            ("stats,s", po::value<std::string>(), "stats file of bin/detect (--stats) for the runtimes")
+            ("per-image", "print the result of every image")
+            ("json", po::value<std::string>(), "write the summary as a JSON line to this file")
+            ("baseline", po::value<std::string>(), "summary (--json) of a previous run to compare against")
+            ("max-f-drop", po::value<double>()->default_value(0.005), "maximum allowed drop of the DetEval F against the baseline")
+            ("area-recall", po::value<float>()->default_value(0.8f), "DetEval area recall threshold")
+            ("area-precision", po::value<float>()->default_value(0.4f), "DetEval area precision threshold")
+        ;
+
+        po::variables_map vm;
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+
+        if (vm.count("help")) {
+            std::cout << desc << std::endl;
+            return 0;
+        }
+
+        po::notify(vm);
+
+        TextDetector::DetEvalParameters params;
+        params.area_recall = vm["area-recall"].as<float>();
+        params.area_precision = vm["area-precision"].as<float>();
+
+        const fs::path det_dir(vm["detections"].as<std::string>());
+        const fs::path gt_path(vm["gt"].as<std::string>());
+
+        // the ground truth decides which images are evaluated
+        std::map<std::string, std::vector<cv::Rect> > xml_gt;
+        std::vector<std::string> names;
+        if (fs::is_directory(gt_path)) {
+            for (fs::directory_iterator it(gt_path); it != fs::directory_iterator(); ++it) {
+                std::string stem = it->path().stem().generic_string();
+                if (it->path().extension() == ".txt" && stem.compare(0, 3, "gt_") == 0)
+                    names.push_back(stem.substr(3));
+            }
+        } else {
+            xml_gt = TextDetector::read_deteval_gt(gt_path.generic_string());
+            for (const auto &entry : xml_gt) names.push_back(entry.first);
+        }
+        std::sort(names.begin(), names.end());
+
+        std::map<std::string, double> runtimes;
+        if (vm.count("stats"))
+            runtimes = read_runtimes(vm["stats"].as<std::string>());
+
+        std::vector<ImageEvaluation> evaluations(names.size());
+        #pragma omp parallel for schedule(dynamic)
+        for (int i = 0; i < int(names.size()); i++) {
+            ImageEvaluation &e = evaluations[i];
+            e.name = names[i];
+
+            // exceptions must not leave the parallel region
+            try {
+                std::vector<cv::Rect> gt;
+                if (xml_gt.empty()) {
+                    fs::path p(gt_path);
+                    p /= "gt_" + e.name + ".txt";
+                    gt = TextDetector::read_icdar_gt(p.generic_string());
+                } else {
+                    gt = xml_gt.at(e.name);
+                }
+
+                fs::path det_path(det_dir);
+                det_path /= e.name + "_boxes.txt";
+                std::vector<cv::Rect> detections;
+                e.missing = !fs::exists(det_path);
+                if (!e.missing)
+                    detections = TextDetector::read_detection_boxes(det_path.generic_string());
+
+                e.result = TextDetector::evaluate_image(gt, detections, params);
+                std::map<std::string, double>::const_iterator it = runtimes.find(e.name);
+                e.runtime_ms = it == runtimes.end() ? -1.0 : it->second;
+            } catch (const std::exception &ex) {
+                e.error = ex.what();
+            }
+        }
+
+        int n_errors = 0;
+        for (const ImageEvaluation &e : evaluations) {
+            if (e.error.empty()) continue;
+            std::cerr << "Error: " << e.name << ": " << e.error << std::endl;
+            n_errors++;
+        }
+        if (n_errors > 0)
+            return 1;
+
+        TextDetector::EvaluationResult total;
+        std::vector<double> times;
+        int n_missing = 0;
+        std::cout << std::fixed << std::setprecision(4);
+        if (vm.count("per-image")) {
+            std::cout << std::left << std::setw(24) << "image" << std::right 
+                      << std::setw(6) << "gt" << std::setw(6) << "det"
+                      << std::setw(10) << "P" << std::setw(10) << "R" << std::setw(10) << "F"
+                      << std::setw(12) << "time [ms]" << std::endl;
+        }
+        for (const ImageEvaluation &e : evaluations) {
+            total.add(e.result);
+            n_missing += e.missing;
+            if (e.runtime_ms >= 0.0) times.push_back(e.runtime_ms);
+            if (vm.count("per-image")) {
+                std::cout << std::left << std::setw(24) << e.name << std::right 
+                          << std::setw(6) << e.result.n_gt << std::setw(6) << e.result.n_detections
+                          << std::setw(10) << e.result.deteval_precision() 
+                          << std::setw(10) << e.result.deteval_recall()
+                          << std::setw(10) << e.result.deteval_f()
+                          << std::setw(12) << std::setprecision(1) << e.runtime_ms 
+                          << std::setprecision(4) << std::endl;
+            }
+        }
+        if (n_missing > 0)
+            std::cerr << "Warning: no detections for " << n_missing << " images" << std::endl;
+
+        std::sort(times.begin(), times.end());
+        double time_sum = 0.0;
+        for (double t : times) time_sum += t;
+
+        std::stringstream summary;
+        summary << std::fixed << std::setprecision(4)
+                << "{\"images\":" << evaluations.size()
+                << ",\"gt\":" << total.n_gt
+                << ",\"detections\":" << total.n_detections
+                << ",\"deteval_precision\":" << total.deteval_precision()
+                << ",\"deteval_recall\":" << total.deteval_recall()
+                << ",\"deteval_f\":" << total.deteval_f()
+                << ",\"icdar2003_precision\":" << total.icdar2003_precision()
+                << ",\"icdar2003_recall\":" << total.icdar2003_recall()
+                << ",\"icdar2003_f\":" << total.icdar2003_f()
+                << std::setprecision(2)
+                << ",\"runtime_images\":" << times.size()
+                << ",\"runtime_total_ms\":" << time_sum
+                << ",\"runtime_mean_ms\":" << (times.empty() ? 0.0 : time_sum / times.size())
+                << ",\"runtime_p50_ms\":" << TextDetector::percentile(times, 50)
+                << ",\"runtime_p95_ms\":" << TextDetector::percentile(times, 95)
+                << ",\"runtime_p99_ms\":" << TextDetector::percentile(times, 99)
+                << "}";
+
+        std::cout << "Images: " << evaluations.size() 
+                  << " (GT: " << total.n_gt << ", detections: " << total.n_detections << ")" << std::endl
+                  << std::setprecision(4)
+                  << "DetEval:   P=" << total.deteval_precision() << " R=" << total.deteval_recall() 
+                  << " F=" << total.deteval_f() << std::endl
+                  << "ICDAR2003: P=" << total.icdar2003_precision() << " R=" << total.icdar2003_recall() 
+                  << " F=" << total.icdar2003_f() << std::endl;
+        if (!times.empty()) {
+            std::cout << std::setprecision(1)
+                      << "Runtime:   mean=" << time_sum / times.size() 
+                      << "ms p50=" << TextDetector::percentile(times, 50)
+                      << "ms p95=" << TextDetector::percentile(times, 95)
+                      << "ms p99=" << TextDetector::percentile(times, 99) 
+                      << "ms (" << times.size() << " images)" << std::endl;
+        }
+
+        if (vm.count("json")) {
+            std::ofstream ofs(vm["json"].as<std::string>().c_str());
+            ofs << summary.str() << std::endl;
+        }
+
+        if (vm.count("baseline")) {
+            std::ifstream ifs(vm["baseline"].as<std::string>().c_str());
+            std::string baseline;
+            std::getline(ifs, baseline);
+
+            double base_f, base_p50, base_mean;
+            if (!read_summary_value(baseline, "deteval_f", base_f)) {
+                std::cerr << "Error: invalid baseline" << std::endl;
+                return 1;
+            }
+            double delta_f = total.deteval_f() - base_f;
+            std::cout << std::setprecision(4) << "Baseline:  F=" << base_f 
+                      << " (" << std::showpos << delta_f << std::noshowpos << ")";
+            if (!times.empty() && 
+                read_summary_value(baseline, "runtime_p50_ms", base_p50) && 
+                read_summary_value(baseline, "runtime_mean_ms", base_mean) && base_mean > 0.0) {
+                std::cout << std::setprecision(1) << " p50=" << base_p50 << "ms mean=" << base_mean 
+                          << "ms (speedup " << std::setprecision(2) 
+                          << base_mean / (time_sum / times.size()) << "x)";
+            }
+            std::cout << std::endl;
+
+            if (delta_f < -vm["max-f-drop"].as<double>()) {
+                std::cout << "FAILED: DetEval F dropped by " << std::setprecision(4) << -delta_f << std::endl;
+                return 2;
+            }
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -30,6 +30,7 @@
 #include <opencv2/ml/ml.hpp>
 
 #include <text_detector/CCUtils.h>
+#include <text_detector/TrainingDataset.h>
 #include <text_detector/config.h>
 
 namespace po = boost::program_options;
@@ -41,42 +42,13 @@ struct my_edge {
     float dist;
 };
 
-static std::vector<TextDetector::MserElement> load_data(const fs::path &file, int label)
-{
-    fs::path dirname(file.parent_path());
-    std::string imgid_path = dirname.parent_path().stem().generic_string();
-    int imgid;
-    std::stringstream(imgid_path) >> imgid;
-    dirname += "/";
-    std::vector<TextDetector::MserElement> result;
-    std::ifstream ifs(file.generic_string().c_str());
-    std::string line;
-
-    while (std::getline(ifs, line)) {
-        std::stringstream filename;
-        filename << "node" << line << "_contour.csv";
-        std::string fname(filename.str());
-        fs::path contour_path = dirname;
-        contour_path += fname;
-
-        std::vector<cv::Point> pixels(TextDetector::load_pixels(contour_path));
-
-        int uid;
-        std::stringstream(line) >> uid;
-
-        result.push_back(TextDetector::MserElement(imgid, uid, label, pixels));
-    }
-
-    return result;
-}
-
 int main(int argc, const char *argv[])
 {
     po::options_description desc("Allowed options");
     desc.add_options()
         ("help,h", "print this help message")
         ("directory,i", po::value<std::string>(), "directory of the image files")
-        ("gt-directory,g", po::value<std::string>(), "directory of the ground truth files")
+        ("gt-directory,g", po::value<std::string>(), "directory or packed file (see pack_dataset) of the ground truth files")
         ("output,o", po::value<std::string>(), "output file of the features")
         ("pairwise-output,p", po::value<std::string>(), "output file of the pairwise-features")
         ("filter-overlapping,f", "filter overlapping features")
@@ -125,7 +97,7 @@ int main(int argc, const char *argv[])
               << pairwise_output << " filter overlapping: " << filter_overlapping << std::endl;
 
     std::vector<std::string> dirs;
-    dirs.push_back(directory); dirs.push_back(gt_directory); 
+    dirs.push_back(directory);
     for (auto it = dirs.begin(); it != dirs.end(); ++it) {
         if (!fs::is_directory(*it)) {
             std::cerr << *it << " is not a directory" << std::endl;
@@ -133,19 +105,17 @@ int main(int argc, const char *argv[])
         }
     }
 
-    fs::path labelled_data_root(gt_directory);
+    if (!fs::exists(gt_directory)) {
+        std::cerr << gt_directory << " does not exist" << std::endl;
+        return 1;
+    }
+
+    TextDetector::TrainingDataset dataset(gt_directory);
     std::vector<TextDetector::MserElement> elements;
     std::vector<cv::Mat> pairwise_features;
 
-    for (fs::directory_iterator it(labelled_data_root); it != fs::directory_iterator(); ++it) {
-        fs::path labelled_image_path(*it);
-        
-        if (!fs::is_directory(labelled_image_path)) {
-            std::cout << "Skipping: " << labelled_image_path << std::endl;
-            continue;
-        }
-
-        fs::path train_img_no = fs::path(*it).filename();
+    for (size_t image = 0; image < dataset.get_image_count(); image++) {
+        fs::path train_img_no = dataset.get_image_name(image);
         fs::path train_path = directory;
         train_path += "/";
         train_path += train_img_no;
@@ -165,14 +135,9 @@ int main(int argc, const char *argv[])
         TextDetector::compute_swt(train_img_gray, swt1, swt2);
 
         std::vector<TextDetector::MserElement> image_elements;
-        for (fs::directory_iterator img_it(labelled_image_path); img_it != fs::directory_iterator(); ++img_it) {
-            fs::path mser_root_element(*img_it);
-
-            fs::path letters_path = mser_root_element;
-            letters_path += "/letters.txt";
-
-            if (fs::exists(letters_path)) {
-                std::vector<TextDetector::MserElement> tmp(load_data(letters_path, 1));
+        for (int tree_id : dataset.get_tree_ids(image)) {
+            std::vector<TextDetector::MserElement> tmp(dataset.get_elements(image, tree_id, 1));
+            if (!tmp.empty()) {
                 for (size_t i = 0; i < tmp.size(); i++) {
                     tmp[i].compute_features(train_img, gradient_img, swt1, swt2);
                 }
@@ -200,11 +165,8 @@ int main(int argc, const char *argv[])
                 image_elements.insert(image_elements.end(), tmp.begin(), tmp.end());
             }
 
-            fs::path neg_path = mser_root_element;
-            neg_path += "/negatives.txt";
-
-            if (fs::exists(neg_path)) {
-                std::vector<TextDetector::MserElement> tmp(load_data(neg_path, -1));
+            tmp = dataset.get_elements(image, tree_id, -1);
+            if (!tmp.empty()) {
                 for (size_t i = 0; i < tmp.size(); i++) {
                     //tmp[i].compute_features(train_img, gradient_img, hog_computer, swt1, swt2);
                     tmp[i].compute_features(train_img, gradient_img, swt1, swt2);
@@ -30,6 +30,7 @@
 #include <opencv2/ml/ml.hpp>
 
 #include <text_detector/CCUtils.h>
+#include <text_detector/TrainingDataset.h>
 #include <text_detector/ProjectionProfileComputer.h>
 #include <text_detector/RectShrinker.h>
 
@@ -70,57 +71,13 @@ static std::vector<cv::Rect> load_boxes(const fs::path &file)
     return result;
 }
 
-std::vector<int> load_textline_ids(const fs::path &file)
-{
-    cv::TrainData data;
-    data.read_csv(file.generic_string().c_str());
-    data.set_delimiter(',');
-    cv::Mat line_idxs = cv::Mat(data.get_values()).clone();
-
-    std::vector<int> results;
-    results.resize(line_idxs.rows);
-    for (int i = 0; i < line_idxs.rows; i++) {
-        results[line_idxs.at<float>(i,0)] = line_idxs.at<float>(i,1);
-    }
-    return results;
-}
-
-static std::vector<TextDetector::MserElement> load_data(const fs::path &file, int label)
-{
-    fs::path dirname(file.parent_path());
-    std::string imgid_path = dirname.parent_path().stem().generic_string();
-    int imgid;
-    std::stringstream(imgid_path) >> imgid;
-    dirname += "/";
-    std::vector<TextDetector::MserElement> result;
-    std::ifstream ifs(file.generic_string().c_str());
-    std::string line;
-
-    while (std::getline(ifs, line)) {
-        std::stringstream filename;
-        filename << "node" << line << "_contour.csv";
-        std::string fname(filename.str());
-        fs::path contour_path = dirname;
-        contour_path += fname;
-
-        std::vector<cv::Point> pixels(TextDetector::load_pixels(contour_path));
-
-        int uid;
-        std::stringstream(line) >> uid;
-
-        result.push_back(TextDetector::MserElement(imgid, uid, label, pixels));
-    }
-
-    return result;
-}
-
 int main(int argc, const char *argv[])
 {
     po::options_description desc("Allowed options");
     desc.add_options()
         ("help,h", "print this help message")
         ("directory,i", po::value<std::string>(), "directory of the image files")
-        ("gt-directory,g", po::value<std::string>(), "directory of the ground truth files")
+        ("gt-directory,g", po::value<std::string>(), "directory or packed file (see pack_dataset) of the ground truth files")
         ("box-directory,b", po::value<std::string>(), "directory of the ground truth boxes")
         ("output,o", po::value<std::string>(), "output file of the features")
         ("show,s", "show training images")
@@ -152,7 +109,7 @@ int main(int argc, const char *argv[])
               << output_file << " Boxes: " << box_directory << std::endl;
 
     std::vector<std::string> dirs;
-    dirs.push_back(directory); dirs.push_back(gt_directory);  dirs.push_back(box_directory);
+    dirs.push_back(directory); dirs.push_back(box_directory);
     for (auto it = dirs.begin(); it != dirs.end(); ++it) {
         if (!fs::is_directory(*it)) {
             std::cerr << *it << " is not a directory" << std::endl;
@@ -160,19 +117,16 @@ int main(int argc, const char *argv[])
         }
     }
 
-    fs::path labelled_data_root(gt_directory);
+    if (!fs::exists(gt_directory)) {
+        std::cerr << gt_directory << " does not exist" << std::endl;
+        return 1;
+    }
+
+    TextDetector::TrainingDataset dataset(gt_directory);
     std::vector<TextDetector::MserElement> elements;
     std::vector<cv::Mat> pairwise_features;
-    for (fs::directory_iterator it(labelled_data_root); it != fs::directory_iterator(); ++it) {
-        fs::path labelled_image_path(*it);
-        //labelled_image_path = "../train_icdar_2005_mser_cc/180";
-        
-        if (!fs::is_directory(labelled_image_path)) {
-            std::cout << "Skipping: " << labelled_image_path << std::endl;
-            continue;
-        }
-
-        fs::path train_img_no = labelled_image_path.filename();
+    for (size_t image = 0; image < dataset.get_image_count(); image++) {
+        fs::path train_img_no = dataset.get_image_name(image);
         fs::path train_path = directory;
         train_path += "/";
         train_path += train_img_no;
@@ -191,13 +145,9 @@ int main(int argc, const char *argv[])
 
         std::vector<TextDetector::MserElement> image_elements;
         std::vector<cv::Mat> image_pairwise_features;
-        for (fs::directory_iterator img_it(labelled_image_path); img_it != fs::directory_iterator(); ++img_it) {
-            fs::path mser_root_element(*img_it);
-
-            fs::path letters_path = mser_root_element;
-            letters_path += "/letters.txt";
-            if (fs::exists(letters_path)) {
-                std::vector<TextDetector::MserElement> tmp(load_data(letters_path, 1));
+        for (int tree_id : dataset.get_tree_ids(image)) {
+            std::vector<TextDetector::MserElement> tmp(dataset.get_elements(image, tree_id, 1));
+            if (!tmp.empty()) {
                 for (size_t i = 0; i < tmp.size(); i++) {
                     tmp[i].compute_features(train_img, gradient_img, swt1, swt2);
                 }
@@ -222,10 +172,8 @@ int main(int argc, const char *argv[])
                 image_elements.insert(image_elements.end(), tmp.begin(), tmp.end());
             }
 
-            fs::path neg_path = mser_root_element;
-            neg_path += "/negatives.txt";
-            if (fs::exists(neg_path)) {
-                std::vector<TextDetector::MserElement> tmp(load_data(neg_path, -1));
+            tmp = dataset.get_elements(image, tree_id, -1);
+            if (!tmp.empty()) {
                 for (size_t i = 0; i < tmp.size(); i++) {
                     tmp[i].compute_features(train_img, gradient_img, swt1, swt2);
                 }
@@ -243,12 +191,9 @@ int main(int argc, const char *argv[])
             return el1.get_uid() < el2.get_uid();
         });
 
-        std::vector<int> text_line_ids;
+        std::vector<int> text_line_ids(dataset.get_textline_ids(image));
         std::map<int,std::vector<int> > inverted_text_line_ids;
-        fs::path textline_id_path = labelled_image_path;
-        textline_id_path += "/text_lines.txt";
-        if (fs::exists(textline_id_path)) {
-            text_line_ids = load_textline_ids(textline_id_path);
+        if (std::find_if(text_line_ids.begin(), text_line_ids.end(), [](int id) { return id >= 0; }) != text_line_ids.end()) {
             // create an inverted index from the text lines
             for (int i = 0; i < text_line_ids.size(); i++) {
                 int text_line_id = text_line_ids[i];
@@ -268,11 +213,6 @@ int main(int argc, const char *argv[])
                 }
                 inverted_text_line_ids[text_line_id].push_back(id);
             }
-        } else {
-            std::vector<int> uids(image_elements.size());
-            std::transform(image_elements.begin(), image_elements.end(), uids.begin(), [](const TextDetector::MserElement &el) { return el.get_uid(); });
-            int the_max = *std::max_element(uids.begin(), uids.end());
-            text_line_ids = std::vector<int>(the_max + 1, -1);
         }
 
         // do the pairwise stuff
@@ -18,12 +18,12 @@
 #include <text_detector/HierarchicalMSER.h>
 #include <text_detector/MserTree.h>
 #include <text_detector/LabelWidget.h>
+#include <text_detector/TrainingDataset.h>
 
 #include <vector>
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 #include <opencv2/core/core.hpp>
-#include <opencv2/ml/ml.hpp>
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -37,46 +37,6 @@
 namespace po = boost::program_options;
 namespace fs = boost::filesystem;
 
-static std::vector<int> read_gt(const std::string &path)
-{
-    std::vector<int> result;
-    std::cout << path << std::endl;
-    std::ifstream ifs(path.c_str());
-    std::string line;
-    while (std::getline(ifs, line)) {
-        int tmp;
-        std::stringstream(line) >> tmp;
-        result.push_back(tmp);
-    }
-    return result;
-}
-
-static std::vector<std::vector<cv::Point> > load_contours(const std::string &path, const std::vector<int> &ids)
-{
-    std::vector<std::vector<cv::Point> > result;
-    for (size_t i = 0; i < ids.size(); i++) {
-        std::stringstream ss;
-        ss << path << "/node" << ids[i] << "_contour.csv";
-
-        std::string s(ss.str());
-
-        cv::TrainData data;
-        data.read_csv(s.c_str());
-        std::cout << s << std::endl;
-        data.set_delimiter(',');
-        cv::Mat vals = data.get_values();
-        std::cout << "Loaded mat with: " << vals.rows << " " << vals.cols << std::endl;
-
-        std::vector<cv::Point> contour;
-        contour.reserve(vals.rows);
-        for (int j = 0; j < vals.rows; j++) {
-            contour.push_back(cv::Point(int (vals.at<float>(j,0)), int (vals.at<float>(j,1))));
-        }
-        result.push_back(contour);
-    }
-    return result;
-}
-
 static void write_letters(const std::string &path, const std::vector<int> &uids)
 {
     std::ofstream ofs(path);
@@ -95,11 +55,21 @@ static cv::Mat to_mat(const std::vector<cv::Point> &contour, const cv::Size &siz
     return result;
 }
 
-static void fixup_msers(const std::string &train_directory, const std::string &output_directory)
+/**
+ *  Matches the letters of the labelled components against the MSER trees of
+ *  the training images and rewrites letters.txt of each tree in the output 
+ *  directory with the uids of the matching MSERs. The labelled components 
+ *  are read from dataset_path, which is either the output directory itself
+ *  or a packed dataset of it.
+ */
+static void fixup_msers(const std::string &train_directory, const std::string &output_directory,
+    const std::string &dataset_path)
 {
+    TextDetector::TrainingDataset dataset(dataset_path);
+
     bool skip = true;
-    for (fs::directory_iterator it = fs::directory_iterator(output_directory); it != fs::directory_iterator(); ++it) {
-        std::string number = fs::path(*it).stem().generic_string();
+    for (size_t image = 0; image < dataset.get_image_count(); image++) {
+        std::string number = dataset.get_image_name(image);
         std::cout << "Processing: " << number << std::endl;
         if (number == "111") {
             skip = false;
@@ -107,7 +77,6 @@ static void fixup_msers(const std::string &train_directory, const std::string &o
         }
 
         if (skip) continue;
-        if (!fs::is_directory(fs::path(*it))) continue;
         
         fs::path train_image_path = train_directory;
         train_image_path += "/";
@@ -126,16 +95,14 @@ static void fixup_msers(const std::string &train_directory, const std::string &o
         TextDetector::MserTree tree(msers, vars, hierarchy);
 
         // search each gt-letter thing
-        for (fs::directory_iterator subit = fs::directory_iterator(*it); subit != fs::directory_iterator(); ++subit) {
-            fs::path letters_path = fs::path(*subit);
-            letters_path += "/letters.txt";
-            if (!fs::exists(letters_path)) continue;
+        std::vector<int> tree_ids = dataset.get_tree_ids(image);
+        for (size_t t = 0; t < tree_ids.size(); t++) {
+            std::vector<TextDetector::MserElement> letters = dataset.get_elements(image, tree_ids[t], 1);
+            if (letters.empty()) continue;
 
-            std::vector<int> label_list = read_gt(letters_path.generic_string());
-            std::vector<std::vector<cv::Point> > contour_list = load_contours(fs::path(*subit).generic_string(), label_list);
             std::vector<int> new_ids;
-            for (size_t i = 0; i < contour_list.size(); i++) {
-                cv::Mat mask = to_mat(contour_list[i], cv::Size(train_image.cols, train_image.rows));
+            for (size_t i = 0; i < letters.size(); i++) {
+                cv::Mat mask = to_mat(letters[i].get_pixels(), cv::Size(train_image.cols, train_image.rows));
                 int new_id = tree.match_contour(mask);
                 std::cout << "Matched contour -> new idx: " << new_id << std::endl;
                 if (new_id >= 0) {
@@ -143,7 +110,9 @@ static void fixup_msers(const std::string &train_directory, const std::string &o
                 }
             }
 
-            write_letters(letters_path.generic_string(), new_ids);
+            std::stringstream letters_path;
+            letters_path << output_directory << "/" << number << "/" << tree_ids[t] << "/letters.txt";
+            write_letters(letters_path.str(), new_ids);
         }
     }
 }
@@ -158,6 +127,7 @@ int main(int argc, char *argv[])
         ("gt-directory,g", po::value<std::string>(), "directory of the ground truth files")
         ("output,o", po::value<std::string>(), "output directory of the mser ccs")
         ("fixup,f", "fixup gt msers by stored contours")
+        ("dataset,d", po::value<std::string>(), "packed dataset of the output directory for --fixup (default: the output directory)")
     ;
 
     po::variables_map vm;
@@ -169,7 +139,7 @@ int main(int argc, char *argv[])
     }
 
     bool fixup = false;
-    std::string directory, gt_directory, output_directory;
+    std::string directory, gt_directory, output_directory, dataset_path;
     if (vm.count("directory")) 
         directory = vm["directory"].as<std::string>();
     if (vm.count("gt-directory")) 
@@ -178,6 +148,10 @@ int main(int argc, char *argv[])
         output_directory = vm["output"].as<std::string>();
     if (vm.count("fixup")) 
         fixup = true;
+    if (vm.count("dataset")) 
+        dataset_path = vm["dataset"].as<std::string>();
+    else
+        dataset_path = output_directory;
 
     if (directory == "" || gt_directory == "" || output_directory == "") {
         std::cout << desc << std::endl;
@@ -197,7 +171,12 @@ int main(int argc, char *argv[])
 
     if (fixup) {
         std::cout << "Fixing GT, please wait" << std::endl;
-        fixup_msers(directory, output_directory);
+        try {
+            fixup_msers(directory, output_directory, dataset_path);
+        } catch (const std::exception &e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
     }
 
     QApplication app(argc, argv);
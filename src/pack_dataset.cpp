@@ -0,0 +1,66 @@
+/**
+ *  This file is part of ltp-text-detector.
+ *  Copyright (C) 2013 Michael Opitz
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/program_options.hpp>
+
+#include <iostream>
+#include <string>
+
+#include <text_detector/TrainingDataset.h>
+
+namespace po = boost::program_options;
+
+/**
+ *  Packs a labelled directory (written by bin/extract_mser_cc) into a single
+ *  dataset file, which can be passed to the extract_* tools instead of the
+ *  directory:
+ *
+ *      $ ./bin/pack_dataset -g gt_train -o gt_train.ltpd
+ *      $ ./bin/extract_cc_features -i train -g gt_train.ltpd -o f.csv -p pw.csv
+ */
+int main(int argc, const char *argv[])
+{
+    try {
+        po::options_description desc("Allowed options");
+        desc.add_options()
+            ("help,h", "print this help message")
+            ("gt-directory,g", po::value<std::string>()->required(), "directory of the ground truth files")
+            ("output,o", po::value<std::string>()->required(), "output file of the packed dataset")
+        ;
+
+        po::variables_map vm;
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+
+        if (vm.count("help")) {
+            std::cout << desc << std::endl;
+            return 0;
+        }
+
+        po::notify(vm);
+
+        const std::string output = vm["output"].as<std::string>();
+        TextDetector::pack_training_dataset(vm["gt-directory"].as<std::string>(), output);
+
+        TextDetector::TrainingDataset dataset(output);
+        std::cout << "Packed " << dataset.get_samples().size() << " components of " 
+                  << dataset.get_image_count() << " images into " << output << std::endl;
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,67 @@
+/**
+ *  This file is part of ltp-text-detector.
+ *  Copyright (C) 2013 Michael Opitz
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/program_options.hpp>
+
+#include <iostream>
+#include <string>
+
+#include <text_detector/FeatureStore.h>
+
+namespace po = boost::program_options;
+
+/**
+ *  Converts a csv feature file (written by the extract_* tools) into a packed
+ *  feature file, which is loaded much faster by train_crf2, predict_crf2 and
+ *  the forest and svm tools:
+ *
+ *      $ ./bin/pack_features -i pairwise.csv -o pairwise.ltpf
+ *      $ ./bin/train_crf2 -i features.ltpf -p pairwise.ltpf -o crf.dat
+ */
+int main(int argc, const char *argv[])
+{
+    try {
+        po::options_description desc("Allowed options");
+        desc.add_options()
+            ("help,h", "print this help message")
+            ("input,i", po::value<std::string>()->required(), "the input csv file")
+            ("output,o", po::value<std::string>()->required(), "output file of the packed features")
+        ;
+
+        po::variables_map vm;
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+
+        if (vm.count("help")) {
+            std::cout << desc << std::endl;
+            return 0;
+        }
+
+        po::notify(vm);
+
+        const std::string output = vm["output"].as<std::string>();
+        TextDetector::FeatureStore::write(
+            TextDetector::read_feature_csv(vm["input"].as<std::string>()), output);
+
+        TextDetector::FeatureStore features(output);
+        std::cout << "Packed " << features.rows() << " x " << features.cols() 
+                  << " features into " << output << std::endl;
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -25,6 +25,7 @@
 #include <opencv2/core/core.hpp>
 
 #include <text_detector/config.h>
+#include <text_detector/FeatureStore.h>
 typedef dlib::matrix<double,0,1> vector_type;
 
 
@@ -58,40 +59,13 @@ static void construct_maps(
     }
 }
 
-static cv::Mat read_csv(const std::string &filename)
-{
-    std::ifstream ifs(filename.c_str());
-    std::string line;
-    std::vector<std::vector<float> > data;
-
-    while (std::getline(ifs, line)) {
-        std::stringstream ss(line);
-        std::string part;
-        std::vector<float> row;
-        while (std::getline(ss, part, ',')) {
-            float val;
-            std::stringstream(part) >> val;
-            row.push_back(val);
-        }
-        data.push_back(row);
-    }
-
-    cv::Mat result(data.size(), data[0].size(), CV_32FC1);
-    for (int i = 0; i < result.rows; i++) {
-        for (int j = 0; j < result.cols; j++) {
-            result.at<float>(i,j) = data[i][j];
-        }
-    }
-    return result;
-}
-
 int main(int argc, const char *argv[])
 {
     srand(time(NULL));
     po::options_description desc("Allowed options");
     desc.add_options()
         ("help,h", "print this help message")
-        ("input,i", po::value<std::string>(), "the input csv file")
+        ("input,i", po::value<std::string>(), "the input csv or packed feature file")
         ("input-pairwise,p", po::value<std::string>(), "the pairwise-input file")
         ("model,m", po::value<std::string>(), "the model file")
         ("output,o", po::value<std::string>(), "output file of the model")
@@ -124,8 +98,8 @@ int main(int argc, const char *argv[])
     dlib::graph_labeler<vector_type> labeler;
     dlib::deserialize(labeler, ifs);
 
-    cv::Mat input = read_csv(input_file);
-    cv::Mat pairwise = read_csv(input_pairwise_file);
+    cv::Mat input = TextDetector::load_features(input_file);
+    cv::Mat pairwise = TextDetector::load_features(input_pairwise_file);
 
     std::cout << "read: " << input.rows << " unary features and " << pairwise.rows << " pairwise features" << std::endl;
     std::cout << "unary dimension: " << input.cols << " " << " pw dimension: " << pairwise.cols << std::endl;
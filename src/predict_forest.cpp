@@ -18,6 +18,8 @@
 #include <opencv2/core/core.hpp>
 #include <opencv2/ml/ml.hpp>
 
+#include <text_detector/FeatureStore.h>
+
 #include <iostream>
 #include <fstream>
 #include <getopt.h>
@@ -91,7 +93,7 @@ int main(int argc, char *argv[])
             case 'h':
             default:
                 std::cerr << "Usage: train_forest OPTIONS" << std::endl 
-                    << "\t -i <train.csv>" << std::endl 
+                    << "\t -i <train.csv or packed feature file>" << std::endl 
                     << "\t -o <out.csv>" << std::endl 
                     << "\t -m <model-file.yml>" << std::endl ;
                 return 1;
@@ -103,12 +105,7 @@ int main(int argc, char *argv[])
     }
     std::cout << train_file << " " << model_file << " " << out_file << std::endl;
 
-    cv::TrainData data;
-    data.read_csv(train_file.c_str());
-    data.set_response_idx(0);
-    data.set_delimiter(',');
-
-    cv::Mat values = cv::Mat(data.get_values());
+    cv::Mat values = TextDetector::load_features(train_file);
 
     cv::RandomTrees rf;
     cv::FileStorage fs(model_file.c_str(), cv::FileStorage::READ);
@@ -0,0 +1,136 @@
+/**
+ *  This file is part of ltp-text-detector.
+ *  Copyright (C) 2013 Michael Opitz
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/program_options.hpp>
+
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include <text_detector/CCGroup.h>
+#include <text_detector/ConfigurationManager.h>
+#include <text_detector/Instrumentation.h>
+#include <text_detector/MserDetector.h>
+#include <text_detector/ReplayBundle.h>
+
+namespace po = boost::program_options;
+
+/**
+ *  Re-executes a single stage of the MserDetector from a replay bundle 
+ *  (captured with bin/detect --capture), e.g. to profile a slow image:
+ *
+ *      $ perf record ./bin/replay_stage -c config_11.yml -b 42.replay -s crf -n 10
+ */
+int main(int argc, const char *argv[])
+{
+    try {
+        po::options_description desc("Allowed options");
+        desc.add_options()
+            ("help,h", "print this help message")
+            ("config,c", po::value<std::string>()->required(), "path to config file")
+            ("bundle,b", po::value<std::string>()->required(), "path to the replay bundle")
+            ("stage,s", po::value<std::string>()->required(), "stage to replay: extract, crf, group, split or words")
+            ("repeat,n", po::value<int>()->default_value(1), "number of repetitions")
+            ("stats", "print the timings of the sub-stages of every repetition as JSON lines")
+        ;
+
+        po::variables_map vm;
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+
+        if (vm.count("help")) {
+            std::cout << desc << std::endl;
+            return 0;
+        }
+
+        po::notify(vm);
+
+        std::shared_ptr<TextDetector::ConfigurationManager> config(
+        	new TextDetector::ConfigurationManager(
+        		vm["config"].as<std::string>()));
+
+        TextDetector::ReplayBundle bundle;
+        bundle.load(vm["bundle"].as<std::string>());
+        std::cout << "Loaded " << bundle.name << ": " 
+                  << bundle.image.cols << "x" << bundle.image.rows << ", "
+                  << bundle.components.comps.size() << " components, "
+                  << bundle.filtered_comps.size() << " after filtering" << std::endl;
+
+        TextDetector::MserDetector detector(config);
+        const std::string stage = vm["stage"].as<std::string>();
+        if (stage != "extract" && stage != "crf" && stage != "group" &&
+            stage != "split" && stage != "words") {
+            std::cerr << "Error: unknown stage " << stage << std::endl;
+            return 1;
+        }
+
+        // the input of the splitter is not part of the bundle, the groups 
+        // point to the pixels of split_components, which must outlive them
+        TextDetector::ExtractedComponents split_components;
+        std::vector<TextDetector::CCGroup> groups;
+        if (stage == "split") {
+            split_components = bundle.components;
+            split_components.comps = bundle.filtered_comps;
+            detector.group_components(bundle.image, split_components, groups);
+        }
+
+        TextDetector::StatsCollector collector(vm.count("stats") ? &std::cout : 0);
+        for (int i = 0; i < vm["repeat"].as<int>(); i++) {
+            // copy the inputs before starting the timer
+            TextDetector::ExtractedComponents components;
+            if (stage != "extract" && stage != "split") {
+                components = bundle.components;
+                if (stage == "group")
+                    components.comps = bundle.filtered_comps;
+            }
+
+            std::stringstream ss;
+            ss << bundle.name << "#" << i;
+            TextDetector::ImageStats stats(ss.str(), config->verbose());
+            {
+                TextDetector::ScopedImageStats scope(&stats);
+                TextDetector::ScopedStageTimer timer(stage);
+
+                if (stage == "extract") {
+                    detector.extract_components(bundle.image, bundle.detector_mask, 
+                        bundle.extra_bin_mask, components);
+                } else if (stage == "crf") {
+                    detector.filter_components(bundle.image, components);
+                    TextDetector::set_stat("crf_components", components.comps.size());
+                } else if (stage == "group") {
+                    std::vector<TextDetector::CCGroup> result;
+                    detector.group_components(bundle.image, components, result);
+                } else if (stage == "split") {
+                    detector.split_words(groups);
+                } else {
+                    cv::Mat result_image;
+                    detector.detect_words(bundle.image, components, result_image);
+                }
+            }
+            collector.add(stats);
+        }
+        collector.write_summary(std::cout);
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,225 @@
+/**
+ *  This file is part of ltp-text-detector.
+ *  Copyright (C) 2013 Michael Opitz
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <text_detector/text_detector_c.h>
+
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include <text_detector/AdaboostClassifier.h>
+#include <text_detector/CacheManager.h>
+#include <text_detector/ConfigurationManager.h>
+#include <text_detector/DetectionService.h>
+#include <text_detector/MserDetector.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace TextDetector;
+
+struct td_context
+{
+    td_context(const std::shared_ptr<ConfigurationManager> &config, const std::string &model_file)
+        : config(config),
+          detector(DetectorContext(config, config->has_cache() ? 
+              std::make_shared<CacheManager>(config->get_cache_directory()) : 
+              std::shared_ptr<CacheManager>())),
+          clf(model_file),
+          threads(0)
+    {}
+
+    std::shared_ptr<ConfigurationManager> config;
+    MserDetector detector;
+    AdaboostClassifier clf;
+    int threads;
+    //! The converted image of non-BGR formats, reused for the next images
+    cv::Mat converted;
+    std::mutex mutex;
+};
+
+static thread_local std::string last_error;
+
+static td_status fail(td_status status, const std::string &message)
+{
+    last_error = message;
+    return status;
+}
+
+static bool is_readable(const char *filename)
+{
+    std::ifstream ifs(filename);
+    return ifs.good();
+}
+
+/**
+ *  Wraps the pixels of the caller in a CV_8UC3 BGR image, converting them 
+ *  into buffer if the image has another format
+ */
+static td_status wrap_image(const td_image &image, cv::Mat &buffer, cv::Mat &bgr)
+{
+    int type, code;
+    switch (image.format) {
+    case TD_FORMAT_GRAY8:  type = CV_8UC1; code = CV_GRAY2BGR; break;
+    case TD_FORMAT_BGR24:  type = CV_8UC3; code = -1; break;
+    case TD_FORMAT_RGB24:  type = CV_8UC3; code = CV_RGB2BGR; break;
+    case TD_FORMAT_BGRA32: type = CV_8UC4; code = CV_BGRA2BGR; break;
+    case TD_FORMAT_RGBA32: type = CV_8UC4; code = CV_RGBA2BGR; break;
+    default:
+        return fail(TD_ERROR_UNSUPPORTED_FORMAT, "Unsupported pixel format");
+    }
+    if (!image.data || image.width <= 0 || image.height <= 0)
+        return fail(TD_ERROR_INVALID_ARGUMENT, "Expected a non-empty image");
+    size_t row_size = size_t(image.width) * CV_ELEM_SIZE(type);
+    size_t stride = image.stride ? image.stride : row_size;
+    if (stride < row_size)
+        return fail(TD_ERROR_INVALID_ARGUMENT, "The stride is smaller than a row");
+
+    // the image is only read, cv::Mat has no const constructor
+    cv::Mat wrapped(image.height, image.width, type, 
+        const_cast<unsigned char *>(image.data), stride);
+    if (code < 0) {
+        bgr = wrapped;
+    } else {
+        cv::cvtColor(wrapped, buffer, code);
+        bgr = buffer;
+    }
+    return TD_OK;
+}
+
+#ifdef _OPENMP
+//! Sets the number of OpenMP threads of the calling thread and restores it
+class ScopedOmpThreads
+{
+public:
+    explicit ScopedOmpThreads(int threads) 
+        : _previous(omp_get_max_threads()), _set(threads > 0)
+    { 
+        if (_set) omp_set_num_threads(threads); 
+    }
+    ~ScopedOmpThreads() 
+    { 
+        if (_set) omp_set_num_threads(_previous); 
+    }
+private:
+    int _previous;
+    bool _set;
+};
+#endif
+
+extern "C" {
+
+int td_api_version(void)
+{
+    return TD_API_VERSION;
+}
+
+td_context *td_create(const char *config_file, const char *model_file)
+{
+    if (!config_file || !model_file) {
+        fail(TD_ERROR_INVALID_ARGUMENT, "Expected a config and a model file");
+        return 0;
+    }
+    if (!is_readable(config_file)) {
+        fail(TD_ERROR_INVALID_ARGUMENT, std::string("Could not read ") + config_file);
+        return 0;
+    }
+    if (!is_readable(model_file)) {
+        fail(TD_ERROR_INVALID_ARGUMENT, std::string("Could not read ") + model_file);
+        return 0;
+    }
+    try {
+        std::shared_ptr<ConfigurationManager> config(
+            new ConfigurationManager(config_file));
+        return new td_context(config, model_file);
+    } catch (const std::exception &e) {
+        fail(TD_ERROR_DETECTION, e.what());
+    } catch (...) {
+        fail(TD_ERROR_DETECTION, "Unknown error while loading the models");
+    }
+    return 0;
+}
+
+td_status td_set_threads(td_context *ctx, int threads)
+{
+    if (!ctx || threads < 0)
+        return fail(TD_ERROR_INVALID_ARGUMENT, "Expected a context and threads >= 0");
+    std::lock_guard<std::mutex> lock(ctx->mutex);
+    ctx->threads = threads;
+    return TD_OK;
+}
+
+td_status td_detect(
+    td_context *ctx,
+    const td_image *image,
+    td_box *boxes,
+    size_t max_boxes,
+    size_t *n_boxes)
+{
+    if (!ctx || !image || !n_boxes || (max_boxes > 0 && !boxes))
+        return fail(TD_ERROR_INVALID_ARGUMENT, "Expected a context, an image and the result arrays");
+    *n_boxes = 0;
+
+    try {
+        std::lock_guard<std::mutex> lock(ctx->mutex);
+        cv::Mat bgr;
+        td_status status = wrap_image(*image, ctx->converted, bgr);
+        if (status != TD_OK)
+            return status;
+
+#ifdef _OPENMP
+        ScopedOmpThreads omp_threads(ctx->threads);
+#endif
+        std::vector<DetectedWord> words = run_detection(*ctx->config, ctx->clf, ctx->detector, bgr);
+        std::stable_sort(words.begin(), words.end(), 
+            [] (const DetectedWord &a, const DetectedWord &b) { return a.score > b.score; });
+
+        size_t n = std::min(words.size(), max_boxes);
+        for (size_t i = 0; i < n; i++) {
+            boxes[i].x = words[i].box.x;
+            boxes[i].y = words[i].box.y;
+            boxes[i].width = words[i].box.width;
+            boxes[i].height = words[i].box.height;
+            boxes[i].score = float(words[i].score);
+        }
+        *n_boxes = words.size();
+        return TD_OK;
+    } catch (const std::exception &e) {
+        return fail(TD_ERROR_DETECTION, e.what());
+    } catch (...) {
+        return fail(TD_ERROR_DETECTION, "Unknown error during the detection");
+    }
+}
+
+void td_destroy(td_context *ctx)
+{
+    delete ctx;
+}
+
+const char *td_last_error(void)
+{
+    return last_error.c_str();
+}
+
+}
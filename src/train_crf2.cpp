@@ -18,6 +18,9 @@
 #include <vector>
 #include <iostream>
 #include <fstream>
+#include <algorithm>
+
+#include <omp.h>
 
 #include <boost/filesystem.hpp>
 #include <boost/program_options.hpp>
@@ -25,6 +28,7 @@
 #include <opencv2/core/core.hpp>
 
 #include <text_detector/config.h>
+#include <text_detector/FeatureStore.h>
 
 
 namespace po = boost::program_options;
@@ -57,28 +61,220 @@ static void construct_maps(
     }
 }
 
-static cv::Mat read_csv(const std::string &filename)
+//! The counts of the cross-validation of one fold
+struct fold_result {
+    fold_result(): num_pos(0), num_pos_correct(0), num_neg(0), num_neg_correct(0), num_retrieved(0) {}
+    void add(const fold_result &other)
+    {
+        num_pos += other.num_pos;
+        num_pos_correct += other.num_pos_correct;
+        num_neg += other.num_neg;
+        num_neg_correct += other.num_neg_correct;
+        num_retrieved += other.num_retrieved;
+    }
+    double precision() const { return num_retrieved > 0 ? num_pos_correct / num_retrieved : 0; }
+    double recall() const { return num_pos > 0 ? num_pos_correct / num_pos : 0; }
+    double fmeasure() const 
+    { 
+        double p = precision(), r = recall();
+        return p + r > 0 ? 2 * p * r / (p + r) : 0; 
+    }
+
+    double num_pos, num_pos_correct, num_neg, num_neg_correct, num_retrieved;
+};
+
+static void configure_trainer(
+    dlib::structural_graph_labeling_trainer<vector_type> &trainer, 
+    double c, double loss_pos, int num_threads)
 {
-    std::ifstream ifs(filename.c_str());
-    std::string line;
-    std::vector<std::vector<float> > data;
-
-    while (std::getline(ifs, line)) {
-        std::stringstream ss(line);
-        std::string part;
-        std::vector<float> row;
-        while (std::getline(ss, part, ',')) {
-            float val;
-            std::stringstream(part) >> val;
-            row.push_back(val);
+    trainer.set_loss_on_positive_class(loss_pos);
+    trainer.set_loss_on_negative_class(1);
+    trainer.set_c(c);
+    trainer.set_num_threads(num_threads);
+}
+
+/**
+ *  The structural SVM problem of dlib::structural_graph_labeling_trainer on
+ *  the subset of the samples given by their indices. The samples are only
+ *  referenced, so the concurrent folds of the cross-validation share a 
+ *  single read-only copy of the graphs instead of copying their training set.
+ */
+class IndexedGraphLabelingProblem : dlib::noncopyable,
+    public dlib::structural_svm_problem_threaded<vector_type, vector_type>
+{
+public:
+    IndexedGraphLabelingProblem(
+        const dlib::array<graph_type> &samples,
+        const std::vector<std::vector<bool> > &labels,
+        const std::vector<long> &indices,
+        unsigned long num_threads)
+    : dlib::structural_svm_problem_threaded<vector_type, vector_type>(num_threads),
+      _samples(samples), _labels(labels), _indices(indices), 
+      _node_dims(0), _edge_dims(0), _loss_pos(1.0), _loss_neg(1.0)
+    {
+        for (size_t i = 0; i < _indices.size(); i++) {
+            const graph_type &g = _samples[_indices[i]];
+            for (unsigned long j = 0; j < g.number_of_nodes(); j++) {
+                _node_dims = std::max(_node_dims, long(dlib::max_index_plus_one(g.node(j).data)));
+                for (unsigned long n = 0; n < g.node(j).number_of_neighbors(); n++) {
+                    _edge_dims = std::max(_edge_dims, long(dlib::max_index_plus_one(g.node(j).edge(n))));
+                }
+            }
         }
-        data.push_back(row);
     }
 
-    cv::Mat result(data.size(), data[0].size(), CV_32FC1);
-    for (int i = 0; i < result.rows; i++) {
-        for (int j = 0; j < result.cols; j++) {
-            result.at<float>(i,j) = data[i][j];
+    void set_losses(double loss_pos, double loss_neg) 
+    { 
+        _loss_pos = loss_pos; 
+        _loss_neg = loss_neg; 
+    }
+
+    long get_num_edge_weights() const { return _edge_dims; }
+private:
+    virtual long get_num_dimensions() const { return _edge_dims + _node_dims; }
+    virtual long get_num_samples() const { return _indices.size(); }
+
+    //! The edge weights come first, then the node weights
+    void get_joint_feature_vector(const graph_type &sample, const std::vector<bool> &label,
+        vector_type &psi) const
+    {
+        psi.set_size(get_num_dimensions());
+        psi = 0;
+        for (unsigned long i = 0; i < sample.number_of_nodes(); i++) {
+            if (label[i])
+                dlib::set_rowm(psi, dlib::range(_edge_dims, psi.size() - 1)) += sample.node(i).data;
+            for (unsigned long n = 0; n < sample.node(i).number_of_neighbors(); n++) {
+                const unsigned long j = sample.node(i).neighbor(n).index();
+                // every edge is counted once, and only if the labels disagree
+                if (i < j && label[i] != label[j])
+                    dlib::set_rowm(psi, dlib::range(0, _edge_dims - 1)) -= sample.node(i).edge(n);
+            }
+        }
+    }
+
+    virtual void get_truth_joint_feature_vector(long idx, vector_type &psi) const
+    {
+        get_joint_feature_vector(_samples[_indices[idx]], _labels[_indices[idx]], psi);
+    }
+
+    double get_loss(bool true_label, bool predicted_label) const
+    {
+        if (true_label == predicted_label) return 0;
+        return true_label ? _loss_pos : _loss_neg;
+    }
+
+    virtual void separation_oracle(const long idx, const vector_type &current_solution,
+        double &loss, vector_type &psi) const
+    {
+        const graph_type &sample = _samples[_indices[idx]];
+        const std::vector<bool> &label = _labels[_indices[idx]];
+
+        // the potts graph of the sample with the loss augmented node potentials
+        dlib::graph<double, double>::kernel_1a g;
+        dlib::copy_graph_structure(sample, g);
+        for (unsigned long i = 0; i < g.number_of_nodes(); i++) {
+            g.node(i).data = dlib::dot(
+                dlib::rowm(current_solution, dlib::range(_edge_dims, current_solution.size() - 1)),
+                sample.node(i).data);
+            if (label[i])
+                g.node(i).data -= get_loss(label[i], !label[i]);
+            else
+                g.node(i).data += get_loss(label[i], !label[i]);
+
+            for (unsigned long n = 0; n < g.node(i).number_of_neighbors(); n++) {
+                const unsigned long j = g.node(i).neighbor(n).index();
+                if (i < j) {
+                    g.node(i).edge(n) = dlib::dot(
+                        dlib::rowm(current_solution, dlib::range(0, _edge_dims - 1)),
+                        sample.node(i).edge(n));
+                }
+            }
+        }
+
+        std::vector<dlib::node_label> labeling;
+        dlib::find_max_factor_graph_potts(g, labeling);
+
+        std::vector<bool> predicted(labeling.size());
+        loss = 0;
+        for (size_t i = 0; i < labeling.size(); i++) {
+            predicted[i] = labeling[i] != 0;
+            loss += get_loss(label[i], predicted[i]);
+        }
+        get_joint_feature_vector(sample, predicted, psi);
+    }
+
+    const dlib::array<graph_type> &_samples;
+    const std::vector<std::vector<bool> > &_labels;
+    const std::vector<long> &_indices;
+    long _node_dims;
+    long _edge_dims;
+    double _loss_pos;
+    double _loss_neg;
+};
+
+/**
+ *  Trains a labeler with the settings of the trainer on the samples with
+ *  the given indices, the same as trainer.train on a copy of those samples.
+ */
+static dlib::graph_labeler<vector_type> train_on_subset(
+    const dlib::structural_graph_labeling_trainer<vector_type> &trainer,
+    const dlib::array<graph_type> &samples, 
+    const std::vector<std::vector<bool> > &labels, 
+    const std::vector<long> &indices)
+{
+    IndexedGraphLabelingProblem prob(samples, labels, indices, trainer.get_num_threads());
+    prob.set_c(trainer.get_c());
+    prob.set_epsilon(trainer.get_epsilon());
+    prob.set_max_cache_size(trainer.get_max_cache_size());
+    prob.set_losses(trainer.get_loss_on_positive_class(), trainer.get_loss_on_negative_class());
+
+    vector_type w;
+    trainer.get_oca()(prob, w, prob.get_num_edge_weights());
+
+    const long split = prob.get_num_edge_weights();
+    vector_type edge_weights = dlib::rowm(w, dlib::range(0, split - 1));
+    vector_type node_weights = dlib::rowm(w, dlib::range(split, w.size() - 1));
+    return dlib::graph_labeler<vector_type>(edge_weights, node_weights);
+}
+
+/**
+ *  Trains on all but the fold-th part of the samples and tests on the 
+ *  fold-th part (with the same split as dlib::cross_validate_graph_labeling_trainer).
+ *  The folds only keep the indices of their training samples, the graphs 
+ *  are shared.
+ */
+static fold_result cross_validate_fold(
+    const dlib::structural_graph_labeling_trainer<vector_type> &trainer,
+    const dlib::array<graph_type> &samples, 
+    const std::vector<std::vector<bool> > &labels, 
+    int folds, int fold)
+{
+    const long num_in_test = samples.size() / folds;
+    const long num_in_train = samples.size() - num_in_test;
+    const long first_test = fold * num_in_test;
+
+    std::vector<long> train_indices;
+    train_indices.reserve(num_in_train);
+    for (long cnt = 0, next = first_test + num_in_test; cnt < num_in_train; ++cnt, ++next) {
+        train_indices.push_back(next % samples.size());
+    }
+
+    dlib::graph_labeler<vector_type> labeler = train_on_subset(trainer, samples, labels, train_indices);
+
+    fold_result result;
+    std::vector<bool> temp;
+    for (long cnt = 0; cnt < num_in_test; ++cnt) {
+        size_t i = (first_test + cnt) % samples.size();
+        labeler(samples[i], temp);
+        for (size_t j = 0; j < labels[i].size(); ++j) {
+            if (temp[j]) result.num_retrieved += 1;
+            if (labels[i][j]) {
+                result.num_pos += 1;
+                if (temp[j]) result.num_pos_correct += 1;
+            } else {
+                result.num_neg += 1;
+                if (!temp[j]) result.num_neg_correct += 1;
+            }
         }
     }
     return result;
@@ -90,9 +286,13 @@ int main(int argc, const char *argv[])
     po::options_description desc("Allowed options");
     desc.add_options()
         ("help,h", "print this help message")
-        ("input,i", po::value<std::string>(), "the input csv file")
+        ("input,i", po::value<std::string>(), "the input csv or packed feature file")
         ("input-pairwise,p", po::value<std::string>(), "the pairwise-input file")
         ("output,o", po::value<std::string>(), "output file of the model")
+        ("svm-c,c", po::value<std::vector<double> >()->multitoken(), "the C values of the grid (default 1)")
+        ("loss-pos,l", po::value<std::vector<double> >()->multitoken(), "the losses on the positive class of the grid (default 1000)")
+        ("folds,f", po::value<int>()->default_value(10), "the number of cross-validation folds (0 to skip the cross-validation)")
+        ("threads,t", po::value<int>()->default_value(omp_get_max_threads()), "the number of threads")
     ;
 
     po::variables_map vm;
@@ -105,8 +305,15 @@ int main(int argc, const char *argv[])
         input_pairwise_file = vm["input-pairwise"].as<std::string>();
     if (vm.count("output")) 
         output_file = vm["output"].as<std::string>();
-
-    if (input_file == "" || input_pairwise_file == "" || output_file == "") {
+    std::vector<double> cs(1, 1.0), losses_pos(1, 1000.0);
+    if (vm.count("svm-c"))
+        cs = vm["svm-c"].as<std::vector<double> >();
+    if (vm.count("loss-pos"))
+        losses_pos = vm["loss-pos"].as<std::vector<double> >();
+    int folds = vm["folds"].as<int>();
+    int num_threads = std::max(1, vm["threads"].as<int>());
+
+    if (input_file == "" || input_pairwise_file == "" || output_file == "" || cs.empty() || losses_pos.empty()) {
         std::cout << desc << std::endl;
         return 1;
     }
@@ -116,8 +323,8 @@ int main(int argc, const char *argv[])
         return 1;
     }
 
-    cv::Mat input = read_csv(input_file);
-    cv::Mat pairwise = read_csv(input_pairwise_file);
+    cv::Mat input = TextDetector::load_features(input_file);
+    cv::Mat pairwise = TextDetector::load_features(input_pairwise_file);
 
     std::cout << "read: " << input.rows << " unary features and " << pairwise.rows << " pairwise features" << std::endl;
     std::cout << "unary dimension: " << input.cols << " " << " pw dimension: " << pairwise.cols << std::endl;
@@ -211,18 +418,65 @@ int main(int argc, const char *argv[])
         }
     }
 
-    typedef dlib::matrix<double,0,1> vector_type;
+    // the grid of (C, loss on positive class) settings, the first one is 
+    // used if there is no cross-validation
+    std::vector<std::pair<double, double> > settings;
+    for (size_t i = 0; i < cs.size(); i++) {
+        for (size_t j = 0; j < losses_pos.size(); j++) {
+            settings.push_back(std::make_pair(cs[i], losses_pos[j]));
+        }
+    }
+    size_t best_setting = 0;
+
+    if (folds > 1) {
+        if (size_t(folds) > samples.size()) {
+            std::cout << "Error, more folds than training images" << std::endl;
+            return 1;
+        }
+        // all folds of all settings are trained concurrently on the shared
+        // samples, the remaining threads are used by the separation oracle 
+        // of the trainers
+        int n_jobs = settings.size() * folds;
+        int parallel_jobs = std::min(n_jobs, num_threads);
+        int oracle_threads = std::max(1, num_threads / parallel_jobs);
+        std::cout << "training " << settings.size() << " settings with " << folds 
+                  << "-fold cross-validation (" << parallel_jobs << " jobs with " 
+                  << oracle_threads << " threads each)..." << std::endl;
+
+        std::vector<fold_result> fold_results(n_jobs);
+        #pragma omp parallel for schedule(dynamic) num_threads(parallel_jobs)
+        for (int job = 0; job < n_jobs; job++) {
+            const std::pair<double, double> &setting = settings[job / folds];
+            dlib::structural_graph_labeling_trainer<vector_type> trainer;
+            configure_trainer(trainer, setting.first, setting.second, oracle_threads);
+            fold_results[job] = cross_validate_fold(trainer, samples, labels, folds, job % folds);
+        }
+
+        double best_fmeasure = -1;
+        for (size_t i = 0; i < settings.size(); i++) {
+            fold_result result;
+            for (int fold = 0; fold < folds; fold++) {
+                result.add(fold_results[i * folds + fold]);
+            }
+            double acc_pos = result.num_pos > 0 ? result.num_pos_correct / result.num_pos : 1;
+            double acc_neg = result.num_neg > 0 ? result.num_neg_correct / result.num_neg : 1;
+            std::cout << folds << "-fold cross-validation C: " << settings[i].first 
+                      << " loss-pos: " << settings[i].second << ": "
+                      << acc_pos << " " << acc_neg << " " << result.precision() << " " 
+                      << result.recall() << " f: " << result.fmeasure() << std::endl;
+            if (result.fmeasure() > best_fmeasure) {
+                best_fmeasure = result.fmeasure();
+                best_setting = i;
+            }
+        }
+    }
+
+    std::cout << "training with C: " << settings[best_setting].first 
+              << " loss-pos: " << settings[best_setting].second << "..." << std::endl;
     dlib::structural_graph_labeling_trainer<vector_type> trainer;
-    trainer.set_loss_on_positive_class(1000);
-    trainer.set_loss_on_negative_class(1);
-    trainer.set_c(1);
-    trainer.be_verbose();
-    std::cout << "training..." << std::endl;
-    std::cout << "10-fold cross-validation: " << dlib::cross_validate_graph_labeling_trainer(trainer, samples, labels, 10) << std::endl;
-    trainer.be_quiet();
+    configure_trainer(trainer, settings[best_setting].first, settings[best_setting].second, num_threads);
     dlib::graph_labeler<vector_type> labeler = trainer.train(samples, labels);
 
-
     std::ofstream ofs(output_file.c_str());
     dlib::serialize(labeler, ofs);
     return 0;
@@ -18,6 +18,8 @@
 #include <opencv2/core/core.hpp>
 #include <opencv2/ml/ml.hpp>
 
+#include <text_detector/FeatureStore.h>
+
 #include <iostream>
 #include <getopt.h>
 #include <sstream>
@@ -79,7 +81,7 @@ int main(int argc, char *argv[])
             case 'h':
             default:
                 std::cerr << "Usage: train_forest OPTIONS" << std::endl 
-                    << "\t -i <train.csv>" << std::endl 
+                    << "\t -i <train.csv or packed feature file>" << std::endl 
                     << "\t -o <out.txt>" << std::endl 
                     << "\t -r <random seed>" << std::endl 
                     << "\t -n <number of trees>" << std::endl 
@@ -122,12 +124,7 @@ int main(int argc, char *argv[])
     std::cout << output_file << std::endl;
     std::cout << ntrees << " " << ndepth << " " << nvars << std::endl;
 
-    cv::TrainData data;
-    data.read_csv(train_file.c_str());
-    data.set_response_idx(0);
-    data.set_delimiter(',');
-
-    cv::Mat values = cv::Mat(data.get_values());
+    cv::Mat values = TextDetector::load_features(train_file);
     cv::Mat samples = values.colRange(1, values.cols);
     cv::Mat labels = values.colRange(0, 1);
 
@@ -0,0 +1,122 @@
+/**
+ *  This file is part of ltp-text-detector.
+ *  Copyright (C) 2013 Michael Opitz
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/filesystem.hpp>
+
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include <text_detector/CacheManager.h>
+
+namespace fs = boost::filesystem;
+
+#define CHECK(cond) \
+    if (!(cond)) \
+        throw std::runtime_error("check failed: " #cond)
+
+/**
+ *  Runs the cache lookups of a detection (msers, features, probabilities of
+ *  a channel): the entries are taken from the cache if they are there and 
+ *  are computed and stored otherwise. Returns the number of cache hits.
+ */
+static int cached_detection(const CacheManager &cache, const CacheKey &key,
+    const std::vector<std::vector<cv::Point> > &expected_msers)
+{
+    std::shared_ptr<CacheFile> file = cache.open("msers", key);
+    int hits = 0;
+
+    std::vector<std::vector<cv::Point> > msers;
+    std::vector<cv::Vec4i> hierarchy;
+    if (file->get_msers(msers, hierarchy)) {
+        hits++;
+    } else {
+        msers = expected_msers;
+        hierarchy.assign(msers.size(), cv::Vec4i(-1, -1, -1, -1));
+        file->set_msers(msers, hierarchy);
+    }
+    if (msers != expected_msers)
+        throw std::runtime_error("Wrong msers");
+
+    for (size_t i = 0; i < msers.size(); i++) {
+        std::vector<float> feature(4, float(i));
+        std::vector<double> prob(1, 0.5);
+        if (file->has_feature_entry(i) && file->has_entry(i)) {
+            hits++;
+            if (file->query_feature(i) != feature || file->query(i) != prob)
+                throw std::runtime_error("Wrong cache entry");
+        } else {
+            file->set_feature(i, feature);
+            file->set(i, prob);
+        }
+    }
+    file->save();
+    return hits;
+}
+
+/**
+ *  A truncated or corrupt cache file must be a cache miss: the detection 
+ *  recomputes the entries and replaces the file.
+ */
+int main(int argc, const char *argv[])
+{
+    fs::path dir = fs::temp_directory_path() / fs::unique_path("ltp-cache-test-%%%%-%%%%");
+    CacheManager cache(dir.generic_string());
+
+    CacheKey key;
+    key.add(std::string("image"));
+    std::vector<std::vector<cv::Point> > msers(3);
+    for (int i = 0; i < 3; i++) {
+        for (int x = 0; x < 10 + i; x++) {
+            msers[i].push_back(cv::Point(x, i));
+            msers[i].push_back(cv::Point(x, i + 1));
+        }
+    }
+
+    int result = 0;
+    try {
+        CHECK(cached_detection(cache, key, msers) == 0);
+        CHECK(cached_detection(cache, key, msers) == 4);
+
+        fs::path filename;
+        for (fs::recursive_directory_iterator it(dir), end; it != end; ++it) {
+            if (it->path().extension() == ".cache") filename = it->path();
+        }
+        CHECK(!filename.empty());
+
+        // truncated in the pixel runs, the intact entries are still used
+        fs::resize_file(filename, fs::file_size(filename) - 8);
+        CHECK(cached_detection(cache, key, msers) < 4);
+        CHECK(cached_detection(cache, key, msers) == 4);
+
+        // truncated in the header
+        fs::resize_file(filename, 5);
+        CHECK(cached_detection(cache, key, msers) == 0);
+        CHECK(cached_detection(cache, key, msers) == 4);
+
+        std::cout << "OK" << std::endl;
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        result = 1;
+    }
+    fs::remove_all(dir);
+    return result;
+}
@@ -25,6 +25,21 @@
 
 
 namespace TextDetector {
+
+/**
+ * Intermediate results of the texture classifier which are only
+ * needed for debugging purposes
+ */
+struct AdaboostResponses
+{
+    //! The blurred response of each scale
+    std::vector<cv::Mat> scale_responses;
+    //! Minimum of the accumulated response before normalization
+    double min;
+    //! Maximum of the accumulated response before normalization
+    double max;
+};
+
 class AdaboostClassifier 
 {
 public:
@@ -33,9 +48,10 @@ public:
         int window_width = 24, int window_height = 12, 
         int shift_width = 4, int shift_height = 4);
 
-    void detect(const cv::Mat &image, cv::Mat &response);
+    //! Detects text, if debug is given it receives the intermediate results
+    void detect(const cv::Mat &image, cv::Mat &response, AdaboostResponses *debug = 0);
     void detect_single_scale(const cv::Mat &image, cv::Mat &response);
-    void bootstrap(const cv::Mat &image, cv::Mat &response, std::list<cv::Mat> &false_positives, float thresh=0.1f, bool sample_fps=true);
+    void bootstrap(const cv::Mat &image, cv::Mat &response, std::list<cv::Mat> &false_positives, float thresh=0.1f, bool sample_fps=true, AdaboostResponses *debug=0);
     void bootstrap_single_scale(
         const cv::Mat &image,
         cv::Mat &response,
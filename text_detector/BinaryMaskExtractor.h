@@ -26,6 +26,7 @@
 
 #include "CCUtils.h"
 #include "ConnectedComponentExtractor.h"
+#include "DetectorContext.h"
 
 namespace TextDetector {
 class ConnectedComponentClassifier;
@@ -38,6 +39,7 @@ namespace TextDetector {
 class BinaryMaskExtractor : public ConnectedComponentExtractor {
 public:
     BinaryMaskExtractor(
+        const DetectorContext &context,
         const cv::Mat &image_color,
         const cv::Mat &image_gray,
         const cv::Mat &mask,
@@ -103,6 +105,8 @@ public:
     std::shared_ptr<ConnectedComponentClassifier> _classifier;
     //! UID offset - used for multiple channels of images
     int _uid_offset;
+    //! The configuration and the cache of the detector
+    DetectorContext _context;
 };
 
 }
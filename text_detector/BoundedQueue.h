@@ -0,0 +1,98 @@
+/**
+ *  This file is part of ltp-text-detector.
+ *  Copyright (C) 2013 Michael Opitz
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BOUNDEDQUEUE_H
+
+#define BOUNDEDQUEUE_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+namespace TextDetector {
+
+/**
+ *  A thread-safe FIFO queue with a fixed capacity. 
+ *  push() blocks while the queue is full, pop() blocks while the queue 
+ *  is empty. After close() was called, pop() drains the remaining elements 
+ *  and returns false afterwards.
+ */
+template <class T>
+class BoundedQueue 
+{
+public:
+    BoundedQueue(size_t capacity) 
+    : _capacity(capacity > 0 ? capacity : 1), _closed(false) {}
+    ~BoundedQueue() {}
+
+    /**
+     *  Pushes the element into the queue. Returns false if the queue 
+     *  was closed.
+     */
+    bool push(T element)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _not_full.wait(lock, [this] () { return _closed || _queue.size() < _capacity; });
+        if (_closed) return false;
+        _queue.push_back(std::move(element));
+        _not_empty.notify_one();
+        return true;
+    }
+
+    /**
+     *  Pops the next element from the queue. Returns false if the queue 
+     *  is closed and empty.
+     */
+    bool pop(T &element)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _not_empty.wait(lock, [this] () { return _closed || !_queue.empty(); });
+        if (_queue.empty()) return false;
+        element = std::move(_queue.front());
+        _queue.pop_front();
+        _not_full.notify_one();
+        return true;
+    }
+
+    //! Closes the queue, no further elements can be pushed
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _closed = true;
+        _not_empty.notify_all();
+        _not_full.notify_all();
+    }
+
+    size_t size() const
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _queue.size();
+    }
+
+private:
+    size_t _capacity;
+    bool _closed;
+    std::deque<T> _queue;
+    mutable std::mutex _mutex;
+    std::condition_variable _not_empty;
+    std::condition_variable _not_full;
+};
+
+}
+
+#endif /* end of include guard: BOUNDEDQUEUE_H */
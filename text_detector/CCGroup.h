@@ -21,6 +21,7 @@
 
 #include <vector>
 #include <iostream>
+#include <memory>
 
 #include <opencv2/core/core.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
@@ -32,47 +33,64 @@
 namespace TextDetector {
 
 /**
- * This class represents a connected component. It stores a pixel-list, the id into the 
- * comps vector, and an index into the feature vector/matrix.
+ * This class represents a connected component. It stores a pointer to the
+ * pixel-list, the id into the comps vector, and an index into the feature
+ * vector/matrix.
  * From the pixel list a bounding rectangle and a centroid vector is computed.
+ * The pixel list is not copied, it has to outlive the component.
  */
 class CC
 {
 public:
-    CC(int idx, int feature_idx, const std::vector<cv::Point> &img);
+    CC(int idx, int feature_idx, const std::vector<cv::Point> &img, double p = 0.0);
 
-    bool can_link(const CC &rhs) const;
+    //! Returns true if the components may be part of the same text line
+    bool can_link(const CC &rhs, const ConfigurationManager &config) const;
     float distance(const CC &rhs) const;
     void draw(cv::Mat img) const;
 
     int id;
     int feature_id;
-    std::vector<cv::Point> pixels;
+    const std::vector<cv::Point> *pixels;
     cv::Vec2f centroid;
     cv::Rect rect;
+    //! the (unary) probability of the component
+    double prob;
 };
 
+//! The component store shared by all groups of an image
+typedef std::vector<CC> CCStore;
+
 /**
  *  This class manages a list of connected components. 
+ *  The group only stores indices into a shared CCStore, the bounding rect,
+ *  the bounding box area and the probability sum are cached and updated 
+ *  on each link.
  */
 class CCGroup 
 {
 public:
-    CCGroup() {}
+    CCGroup() : _bounding_box_area(0.0f), _prob_sum(0.0) {}
+    /**
+     *  Creates a group consisting of the single component store[idx]
+     */
+    CCGroup(const std::shared_ptr<const CCStore> &store, int idx);
     ~CCGroup() {}
 
     /**
      * Draws the group
      */
-    cv::Mat draw(const cv::Size &image_size, const std::vector<double> &probs, const cv::Mat &result = cv::Mat(), bool show=false) const; 
+    cv::Mat draw(const cv::Size &image_size, const cv::Mat &result = cv::Mat(), bool show=false) const; 
 
     /**
      *  Computes the single-linkage distance to the elements from the other 
-     *  group `grp` using the given distance matrix.
+     *  group `grp` using the given distance matrix. Only components, which 
+     *  can be linked according to the config, are considered.
      */
-    float distance(const CCGroup &grp, const cv::Mat &distance_matrix) const;
+    float distance(const CCGroup &grp, const cv::Mat &distance_matrix,
+        const ConfigurationManager &config) const;
     /**
-     *  This this group with the given group grp
+     *  Links this group with the given group grp
      */
     void link(const CCGroup &grp);
     /**
@@ -83,7 +101,7 @@ public:
      *  Returns the sum of the bounding box areas of each individual 
      *  connected component
      */
-    float get_bounding_box_area() const;
+    float get_bounding_box_area() const { return _bounding_box_area; }
     /**
      *  Returns the sum of the intersection bounding box areas of 
      *  each individual connected component
@@ -92,7 +110,7 @@ public:
     /**
      *  Returns the bounding rectangle of the whole group
      */
-    cv::Rect get_rect() const;
+    cv::Rect get_rect() const { return _rect; }
     /**
      *  Returns true if the connected component with the given index 
      *  contributes 'much' to 'support' the bounding box.
@@ -124,12 +142,10 @@ public:
     cv::Mat get_image(const cv::Size &size) const;
 
     /**
-     *  Sums up the probabilities in probs which correspond to the connected components in this group.
-     *
-     *  @param probs is the global list of probabilities
-     *  @returns the average probability that the components of this group are text
+     *  Returns the average probability that the components of this group are text.
+     *  The probabilities are taken from the component store.
      */
-    float calculate_probability(const std::vector<double> &probs) const;
+    float calculate_probability() const { return _prob_sum / ccs.size(); }
     
     /**
      *  Returns true if the other_group is overlapping this group with the given threshold
@@ -144,7 +160,18 @@ public:
     bool is_overlapping_component_bbx(const CCGroup &other_group, float thresh=0.8) const;
     bool share_elements(const CCGroup &grp) const;
 
-    std::vector<CC> ccs;
+    //! Returns the number of components in this group
+    size_t size() const { return ccs.size(); }
+    //! Returns the i-th component of this group
+    const CC &cc(size_t i) const { return (*_store)[ccs[i]]; }
+
+    //! Indices into the component store
+    std::vector<int> ccs;
+private:
+    std::shared_ptr<const CCStore> _store;
+    cv::Rect _rect;
+    float _bounding_box_area;
+    double _prob_sum;
 };
 
 }
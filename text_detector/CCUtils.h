@@ -21,6 +21,7 @@
 #define MIN_HOLE_SIZE 10.0
 #define MIN_HOLE_RATIO 0.05
 
+#include <cstdint>
 #include <vector>
 #include <boost/filesystem.hpp>
 
@@ -95,6 +96,15 @@ public:
     cv::Mat get_hog_features() const { return _hog_features; }
     cv::Mat get_binary_image() const { return _binary_image; }
     void set_raw_swt_mean(float s) { _swt_mean = s; }
+
+    //! Returns the values computed by compute_features (used by the cache)
+    std::vector<float> get_raw_features() const;
+    //! Restores the values of get_raw_features, returns false if f has the wrong size
+    bool set_raw_features(const std::vector<float> &f);
+
+    //! Serializes the pixels and all computed features (see Serialization.h)
+    template <class Archive>
+    void serialize(Archive &ar, const unsigned int version);
 private:
     void compute_bounding_rect();
     void compute_centroid();
@@ -134,7 +144,49 @@ private:
     cv::Mat _binary_image;
 };
 
+template <class Archive>
+void MserElement::serialize(Archive &ar, const unsigned int version)
+{
+    ar & _pixels;
+    ar & _imgid;
+    ar & _uid;
+    ar & _label;
+    ar & _bounding_rect;
+    ar & _ellipse;
+    ar & _centroid;
+    ar & _aspect;
+    ar & _area_ratio;
+    ar & _gradient;
+    ar & _compactness;
+    ar & _ellipse_compactness;
+    ar & _bb_compactness;
+    ar & _euler;
+    ar & _hull_ratio;
+    ar & _crossings_top;
+    ar & _crossings_middle;
+    ar & _crossings_bottom;
+    ar & _swt_stddev;
+    ar & _swt_mean;
+    ar & _hull_perimeter_ratio;
+    ar & _ellipse_area_ratio;
+    ar & _ellipse_ratio;
+    ar & _hole_area_ratio;
+    ar & _hog_features;
+    ar & _binary_image;
+}
+
 std::vector<cv::Point> load_pixels(const fs::path &path);
+
+//! A run of horizontally adjacent pixels (used by the binary file formats)
+struct PixelRun
+{
+    int32_t x;
+    int32_t y;
+    uint32_t length;
+};
+
+//! Encodes the pixels as runs, which preserve the order of the pixels
+std::vector<PixelRun> encode_pixel_runs(const std::vector<cv::Point> &pixels);
 cv::Mat compute_gradient(const cv::Mat &img);
 cv::Mat compute_gradient_single_chan(const cv::Mat &img);
 cv::Mat compute_swt(const cv::Mat &img);
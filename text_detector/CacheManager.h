@@ -19,47 +19,60 @@
 
 #define CACHEMANAGER_H
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
 #include <opencv2/core/core.hpp>
 
-namespace boost {
-    namespace serialization {
-        template<class Archive >
-        inline void serialize(
-            Archive &ar,
-            cv::Point &p,
-            const unsigned int file_version){
-            ar & p.x;
-            ar & p.y;
-        }
+/**
+ *  An incremental 64 bit FNV-1a hash of everything the result of a cached
+ *  stage depends on: the input pixels, the relevant configuration values and 
+ *  the digests of the model files.
+ */
+class CacheKey
+{
+public:
+    CacheKey() : _hash(14695981039346656037ULL) {}
 
-        template<class Archive>
-        inline void serialize(
-            Archive & ar,
-            cv::Vec4i &v,
-            const unsigned int file_version) {
-            ar & v[0];
-            ar & v[1];
-            ar & v[2];
-            ar & v[3];
-        }
-    }
-}
+    CacheKey &add(const void *data, size_t size);
+    CacheKey &add(const std::string &s);
+    //! Adds the type, the size and the pixels of the matrix
+    CacheKey &add(const cv::Mat &m);
+    CacheKey &add(int64_t value) { return add(&value, sizeof(value)); }
+    CacheKey &add(double value) { return add(&value, sizeof(value)); }
+    /**
+     *  Adds the content of the file. Directories add the names and contents
+     *  of all files in them, missing files only add their name.
+     */
+    CacheKey &add_file(const std::string &path);
 
+    //! Returns the hash as 16 hex digits
+    std::string str() const;
+private:
+    uint64_t _hash;
+};
 
-class CacheManager {
+/**
+ *  The cached entries of a single stage for a single key.
+ *
+ *  The entries are stored in a binary file: fixed width records for the
+ *  probabilities and features, an index of the MSERs with the offset of 
+ *  their run-length encoded pixels, and the pixel runs (see CacheManager.cpp
+ *  for the layout). An existing file is only mapped into memory, the entries
+ *  are decoded when they are queried. The file is only meant to be read by 
+ *  the same build on the same platform.
+ *
+ *  Lookups are thread-safe, modifications are not.
+ */
+class CacheFile {
 public:
-    CacheManager(const std::string &dirname);
-    ~CacheManager() {}
-    //! Sets the global cache instance
-    static void set_instance(std::shared_ptr<CacheManager> instance) { CacheManager::_instance = instance; }
-    //! Retuns the global cache instance
-    static std::shared_ptr<CacheManager> instance() { return CacheManager::_instance; }
-
-    void load_image(const std::string &image_name);
-    void save_image(const std::string &image_name);
+    /**
+     *  Maps the file (if it exists). A truncated or corrupt file is removed
+     *  and treated as empty, corrupt entries are misses.
+     */
+    CacheFile(const std::string &filename);
+    ~CacheFile();
 
     bool has_entry(int cc_id) const;
     bool has_feature_entry(int cc_id) const;
@@ -67,38 +80,23 @@ public:
     std::vector<float> query_feature(int cc_id) const;
     void set(int cc_id, const std::vector<double> &v);
     void set_feature(int cc_id, const std::vector<float> &f);
-    void set_msers(const std::vector<std::vector<cv::Point> > &msers, const std::vector<cv::Vec4i> &hierarchy, int uid_offset) 
-    {
-        auto it = std::find(_uid_offsets.begin(), _uid_offsets.end(), uid_offset);
-        if (it == _uid_offsets.end()) {
-            _uid_offsets.push_back(uid_offset);
-            _msers.push_back(msers);
-            _hierarchy.push_back(hierarchy);
-        } else {
-            int idx = std::distance(_uid_offsets.begin(), it);
-            _msers[idx] = msers;
-            _hierarchy[idx] = hierarchy;
-        }
-    }
-    bool get_msers(std::vector<std::vector<cv::Point> > &msers, std::vector<cv::Vec4i> &hierarchy, int uid_offset)
-    {
-        if (_msers.empty()) return false;
-        auto it = std::find(_uid_offsets.begin(), _uid_offsets.end(), uid_offset);
-        if (it == _uid_offsets.end())
-            return false;
-        int idx = std::distance(_uid_offsets.begin(), it);
-        msers = _msers[idx];
-        hierarchy = _hierarchy[idx];
-        return true;
-    }
+    void set_msers(const std::vector<std::vector<cv::Point> > &msers, const std::vector<cv::Vec4i> &hierarchy, int uid_offset = 0);
+    bool get_msers(std::vector<std::vector<cv::Point> > &msers, std::vector<cv::Vec4i> &hierarchy, int uid_offset = 0) const;
+
+    //! Writes the mapped and the new entries, iff. entries were added
+    void save();
 private:
-    static std::shared_ptr<CacheManager> _instance;
-    std::string _dirname;
-    //! Stroke-Width cache for unary features
+    struct MappedFile;
+
+    std::string _filename;
+    bool _modified;
+    //! The mapped file (or 0)
+    std::unique_ptr<MappedFile> _mapped;
+    //! Probabilities, which are not in the mapped file
     std::vector<std::vector<double> > _cache;
-    //! Stroke-Width cache for unary features
+    //! Features, which are not in the mapped file
     std::vector<std::vector<float> > _feature_cache;
-    //! Msers
+    //! Msers, which are not in the mapped file
     std::vector<std::vector<std::vector<cv::Point> > > _msers;
     //! hierarchy
     std::vector<std::vector<cv::Vec4i> > _hierarchy;
@@ -106,4 +104,24 @@ private:
     std::vector<int> _uid_offsets;
 };
 
+/**
+ *  A content-addressed cache of the intermediate results of the detector.
+ *  The entries of a stage are stored under <dirname>/<stage>/<xx>/<key>.cache, 
+ *  where <xx> are the first two digits of the key and the key covers
+ *  everything the stage depends on. Thus changing the image, the 
+ *  configuration or a model only invalidates the stages that depend on it,
+ *  and stale entries are never reused.
+ *  This class is thread-safe.
+ */
+class CacheManager {
+public:
+    CacheManager(const std::string &dirname);
+    ~CacheManager() {}
+
+    //! Opens the entries of the stage with the given key
+    std::shared_ptr<CacheFile> open(const std::string &stage, const CacheKey &key) const;
+private:
+    std::string _dirname;
+};
+
 #endif /* end of include guard: CACHEMANAGER_H */
@@ -0,0 +1,121 @@
+/**
+ *  This file is part of ltp-text-detector.
+ *  Copyright (C) 2013 Michael Opitz
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef COMPONENTDEDUPLICATOR_H
+
+#define COMPONENTDEDUPLICATOR_H
+
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include <text_detector/CCUtils.h>
+
+namespace TextDetector {
+
+/**
+ *  A coarse description of a component: the bounding rect quantized to 
+ *  2 pixels, the fill ratio of the rect in 1/8 and a 4x4 occupancy 
+ *  pattern of the rect. Near-identical MSERs of different channels have 
+ *  the same signature.
+ */
+struct ComponentSignature
+{
+    int x0, y0, x1, y1;
+    int fill;
+    uint16_t pattern;
+
+    bool operator==(const ComponentSignature &o) const
+    {
+        return x0 == o.x0 && y0 == o.y0 && x1 == o.x1 && y1 == o.y1 &&
+            fill == o.fill && pattern == o.pattern;
+    }
+};
+
+struct ComponentSignatureHash
+{
+    size_t operator()(const ComponentSignature &s) const;
+};
+
+/**
+ *  Collapses near-duplicate components of the channels and polarities of 
+ *  an image before their features are computed. The first component with 
+ *  a signature becomes the representative, later components with the same
+ *  signature of another MSER tree (i.e. another channel or polarity)
+ *  take over its features and probabilities. Components of the same tree
+ *  are nested and left to the tree pruning.
+ *
+ *  Components are identified by their uid (the index into the
+ *  probabilities of all channels). Not thread-safe.
+ */
+class ComponentDeduplicator
+{
+public:
+    //! Returns the signature of the given pixels
+    static ComponentSignature signature(const std::vector<cv::Point> &pixels, const cv::Rect &rect);
+
+    /**
+     *  Assigns the components of one extraction to representatives.
+     *
+     *  @param pixels are the pixels of the components of the extraction
+     *  @param elements are the components of the extraction
+     *  @param trees is the index of the root of the MSER tree of every component
+     *  @param valid is zero for components which are not classified
+     *  @param uid_offset is the uid of the first component
+     *  @return the uid of the representative for every duplicate, -1 otherwise
+     */
+    std::vector<int> assign(
+        const std::vector<std::vector<cv::Point> > &pixels,
+        const std::vector<MserElement> &elements,
+        const std::vector<int> &trees,
+        const std::vector<char> &valid,
+        int uid_offset);
+
+    //! Stores the features and probabilities of a component, if it is a representative
+    void set_result(int uid, const MserElement &el, double prob,
+        const std::vector<double> &per_classifier_probs);
+    //! Copies the features and probabilities of the representative (set_result must have been called)
+    void get_result(int representative, MserElement &el, double &prob,
+        std::vector<double> &per_classifier_probs) const;
+
+    //! Returns the uid of the representative of every collapsed component
+    const std::unordered_map<int, int> &get_duplicates() const { return _duplicates; }
+
+private:
+    struct Representative
+    {
+        int uid;
+        //! uid of the root of the MSER tree
+        int tree;
+    };
+    struct Result
+    {
+        std::vector<float> features;
+        double prob;
+        std::vector<double> per_classifier_probs;
+    };
+
+    std::unordered_map<ComponentSignature, Representative, ComponentSignatureHash> _representatives;
+    std::unordered_map<int, Result> _results;
+    std::unordered_map<int, int> _duplicates;
+};
+
+}
+
+#endif /* end of include guard: COMPONENTDEDUPLICATOR_H */
@@ -122,11 +122,6 @@ public:
     //! Returns true if responses should be used
     bool ignore_responses() const { return _ignore_responses; }
 
-    //! Sets the global configuration instance
-    static void set_instance(std::shared_ptr<ConfigurationManager> instance) { ConfigurationManager::_instance = instance; }
-    //! Retuns the global configuration instance
-    static std::shared_ptr<ConfigurationManager> instance() { return ConfigurationManager::_instance; }
-
     //! Returns true if color channels should be excluded
     bool ignore_color() const { return _ignore_color; }
     //! Returns true if the graychannel should be ignored
@@ -137,14 +132,27 @@ public:
 
     //! Returns true if GT mask segmentation should be used
     bool include_binary_masks() const { return _include_binary_masks; }
+    //! Returns true if near-duplicate components of the channels share their features
+    bool deduplicate_channels() const { return _deduplicate_channels; }
     //! Get the minimum grouping size
     int get_min_group_size() const { return _min_group_size; }
 
     bool get_set_gt_prop_to_one() const { return _set_gt_prop_to_one; }
-private:
-    static std::shared_ptr<ConfigurationManager> _instance;
 
+    //! Overrides the threshold used for the classifier masks
+    void set_threshold(float t) { _threshold = t; }
+    //! Overrides the threshold for the RFConnectedComponentFilterer
+    void set_pre_classification_prob_threshold(float t) { _pre_classification_prob_threshold = t; }
+    //! Overrides the threshold used for the word groups
+    void set_word_group_threshold(float t) { _word_group_threshold = t; }
+    //! Overrides the minimum overlap height ratio
+    void set_minimum_vertical_overlap(float o) { _minimum_vertical_overlap = o; }
+    //! Overrides the model used for splitting words
+    void set_word_split_model(int model) { _word_split_model = model; }
+
+    //! Returns the word split model of the given name (e.g. MODEL_SIMPLE)
     int get_word_split_model(const std::string &key) const;
+private:
     int get_classification_model(const std::string &key) const;
     int get_pre_classification_model(const std::string &key) const;
 
@@ -187,6 +195,7 @@ private:
     bool _ignore_word_splitting;
     bool _include_binary_masks;
     bool _ignore_grouping_svm;
+    bool _deduplicate_channels;
     bool _set_gt_prop_to_one;
     std::string _cache_dir;
 };
@@ -61,7 +61,7 @@ public:
         std::vector<std::vector<double> > &per_classifier_probs,
         std::vector<std::pair<int, std::vector<cv::Point> > > &comps,
         std::vector<MserElement> &all_elements) = 0;
-protected:
+
     /**
      * Returns true if the given connected component is invalid. Otherwise
      * false is returned.
@@ -69,12 +69,12 @@ protected:
      * @param mask is the detector mask
      * @param rect is the bounding box of the connected component
      */
-    inline bool
-    is_component_invalid(const cv::Mat &mask, const cv::Rect &rect) const;
+    static inline bool
+    is_component_invalid(const cv::Mat &mask, const cv::Rect &rect);
 };
 
 bool ConnectedComponentExtractor::is_component_invalid(
-	const cv::Mat &mask, const cv::Rect &rect) const
+	const cv::Mat &mask, const cv::Rect &rect)
 {
     float mask_sum = cv::sum(mask.colRange(rect.x, rect.x + rect.width
     	).rowRange(rect.y, rect.y + rect.height))[0];
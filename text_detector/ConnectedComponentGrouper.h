@@ -31,9 +31,11 @@ namespace TextDetector {
 class ConnectedComponentGrouper {
 public:
 	ConnectedComponentGrouper(
+		const std::shared_ptr<ConfigurationManager> &config,
 		float overlap_threshold=0.6f,
 		float distance_threshold=0.0f)
-    : _overlap_threshold(overlap_threshold),
+    : _config(config),
+      _overlap_threshold(overlap_threshold),
       _distance_threshold(distance_threshold) {}
 	~ConnectedComponentGrouper() = default;
 
@@ -46,7 +48,8 @@ public:
 	 * @param all_elements is a list of mser probabilities
 	 * @param comps is a list of tuples [(idx, pixels)] where idx is the
 	 *        index into probs and all_elements and pixels is the list
-	 *        of image pixels
+	 *        of image pixels. The groups reference the pixel lists, so
+	 *        comps has to outlive the groups.
 	 * @param groups [OUT] is the list of connected components
 	 */
 	void operator()(
@@ -59,27 +62,26 @@ public:
 private:
 
 private:
+	//! the configuration of the detector
+	std::shared_ptr<ConfigurationManager> _config;
 	//! overlap threshold
 	float _overlap_threshold;
 	//! distance threshold
 	float _distance_threshold;
 
-	void create_initial_groups(
+	std::shared_ptr<const CCStore> create_initial_groups(
 			const std::vector<std::pair<int, std::vector<cv::Point> > >& comps,
-			const std::vector<MserElement>& all_elements, std::vector<CC>& ccs,
-			std::vector<CCGroup>& groups,
-			std::vector<MserElement>& elements) const;
-	void fill_distance_matrix(const std::vector<CC>& ccs,
-			const std::vector<MserElement>& elements,
+			const std::vector<double> &probs,
+			std::vector<CCGroup>& groups) const;
+	void fill_distance_matrix(const CCStore& ccs,
+			const std::vector<MserElement>& all_elements,
 			const cv::Mat& train_image, const cv::Mat& gradient_image,
 			cv::Mat& distance_matrix) const;
 	void merge_components(const cv::Mat& distance_matrix,
 			std::vector<CCGroup>& groups) const;
 	void prune_low_probability_groups(
-			const std::vector<double> &probs,
 			std::vector<CCGroup> &groups) const;
 	void prune_overlapping_groups(
-        const std::vector<double> &probs,
 		std::vector<CCGroup> &groups) const;
 };
 
@@ -0,0 +1,86 @@
+/**
+ *  This file is part of ltp-text-detector.
+ *  Copyright (C) 2013 Michael Opitz
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CPUDISPATCH_H
+
+#define CPUDISPATCH_H
+
+#include <cstddef>
+#include <string>
+
+namespace TextDetector {
+
+/**
+ *  The arguments of the LTP kernel for one row i of a map: the directional
+ *  gradients of row i (x, y, d, ad), the y gradients of row i-1, the d and
+ *  ad gradients of row i+1 (rows of zeros at the border) and the smoothed
+ *  gradient magnitudes of row i scaled by the level of the map.
+ */
+struct LtpRow
+{
+    const float *grad[4];
+    const float *up_y;
+    const float *down_d;
+    const float *down_ad;
+    const float *e[4];
+};
+
+/**
+ *  The hot kernels of the detector. They only work on raw rows, the 
+ *  variants are compiled for different instruction sets (see 
+ *  CpuKernelsImpl.h) and compute exactly the same results.
+ */
+struct CpuKernels
+{
+    const char *name;
+    //! out[k] = the signed difference of the channels of the 3 channel
+    //! pixels a[k] and b[k] with the largest absolute value, divided by 255
+    void (*max_channel_diff)(const unsigned char *a, const unsigned char *b, int n, float *out);
+    //! Central difference gradient magnitude of n pixels of a 3 channel
+    //! image (largest magnitude of the channels), cur[-3] and cur[3*n] must be valid
+    void (*gradient_magnitude_c3)(const unsigned char *prev, const unsigned char *cur, const unsigned char *next, int n, float *out);
+    //! Central difference gradient magnitude of n pixels of a single channel
+    //! image, cur[-1] and cur[n] must be valid
+    void (*gradient_magnitude_c1)(const unsigned char *prev, const unsigned char *cur, const unsigned char *next, int n, float *out);
+    //! Computes the two LTP bytes of n pixels of a row, the bytes of pixel j
+    //! are written to out[j*stride] and out[j*stride+1]
+    void (*ltp_row)(const LtpRow &row, int n, unsigned char *out, size_t stride);
+    //! y[k] += a * x[k]
+    void (*axpy)(float a, const float *x, float *y, int n);
+};
+
+/**
+ *  Returns the kernels for the best instruction set the cpu supports,
+ *  selected once at the first call. The environment variable 
+ *  TEXT_DETECTOR_CPU_DISPATCH (generic, sse4.2, avx2 or avx512) limits the
+ *  instruction set.
+ */
+const CpuKernels &get_cpu_kernels();
+
+//! Returns a description of the compiled and supported variants and the
+//! selected one (--print-cpu-dispatch)
+std::string describe_cpu_dispatch();
+
+//! The kernels of the variants, 0 if a variant was not compiled
+extern const CpuKernels *const cpu_kernels_generic;
+extern const CpuKernels *const cpu_kernels_sse42;
+extern const CpuKernels *const cpu_kernels_avx2;
+extern const CpuKernels *const cpu_kernels_avx512;
+
+}
+
+#endif /* end of include guard: CPUDISPATCH_H */
@@ -0,0 +1,179 @@
+/**
+ *  This file is part of ltp-text-detector.
+ *  Copyright (C) 2013 Michael Opitz
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CPUKERNELSIMPL_H
+
+#define CPUKERNELSIMPL_H
+
+/**
+ *  The implementation of the kernels of CpuDispatch.h. This file is
+ *  included by one translation unit per instruction set, which are 
+ *  compiled with different flags (see CMakeLists.txt). Everything here 
+ *  must have internal linkage and must not call inline functions of other
+ *  headers (e.g. OpenCV), otherwise the linker could pick the code of a
+ *  variant the cpu does not support.
+ */
+
+#include <math.h>
+
+#include <text_detector/CpuDispatch.h>
+
+namespace TextDetector {
+namespace {
+
+void max_channel_diff(const unsigned char *a, const unsigned char *b, int n, float *out)
+{
+    for (int k = 0; k < n; k++) {
+        const float r1 = a[3*k+0] / 255.0f;
+        const float g1 = a[3*k+1] / 255.0f;
+        const float b1 = a[3*k+2] / 255.0f;
+        const float r2 = b[3*k+0] / 255.0f;
+        const float g2 = b[3*k+1] / 255.0f;
+        const float b2 = b[3*k+2] / 255.0f;
+
+        float max = fabsf(r1 - r2);
+        float maxval = r1 - r2;
+        if (fabsf(g1 - g2) > max) {
+            max = fabsf(g1 - g2);
+            maxval = g1 - g2;
+        }
+        if (fabsf(b1 - b2) > max) {
+            max = fabsf(b1 - b2);
+            maxval = b1 - b2;
+        }
+        out[k] = maxval;
+    }
+}
+
+void gradient_magnitude_c3(const unsigned char *prev, const unsigned char *cur, const unsigned char *next, int n, float *out)
+{
+    for (int k = 0; k < n; k++) {
+        const unsigned char *p2 = cur + 3*k + 3;
+        const unsigned char *p0 = cur + 3*k - 3;
+        const int x1 = 3*k;
+
+        float dx0, dy0, dx, dy, mag0, mag;
+
+        dx0 = p2[2] - p0[2];
+        dy0 = next[x1+2] - prev[x1+2];
+        mag0 = dx0*dx0 + dy0*dy0;
+
+        dx = p2[1] - p0[1];
+        dy = next[x1+1] - prev[x1+1];
+        mag = dx * dx + dy * dy;
+        if (mag0 < mag) {
+            mag0 = mag;
+            dx0 = dx;
+            dy0 = dy;
+        }
+
+        dx = p2[0] - p0[0];
+        dy = next[x1+0] - prev[x1+0];
+        mag = dx * dx + dy * dy;
+        if (mag0 < mag) {
+            mag0 = mag;
+            dx0 = dx;
+            dy0 = dy;
+        }
+
+        out[k] = sqrtf(dx0*dx0 + dy0*dy0);
+    }
+}
+
+void gradient_magnitude_c1(const unsigned char *prev, const unsigned char *cur, const unsigned char *next, int n, float *out)
+{
+    for (int k = 0; k < n; k++) {
+        const float dx = static_cast<float>(cur[k+1]) - static_cast<float>(cur[k-1]);
+        const float dy = static_cast<float>(next[k]) - static_cast<float>(prev[k]);
+        out[k] = sqrtf(dx*dx + dy*dy);
+    }
+}
+
+/**
+ *  The LTP bytes of a single pixel from its gradients, the gradients of 
+ *  its neighbours (0 outside of the image) and the thresholds e
+ */
+inline void ltp_pixel(
+    float gx, float gy, float gd, float gad,
+    float gx_left, float gy_up, float gd_downright, float gad_downleft,
+    float ex, float ey, float ed, float ead,
+    unsigned char *out)
+{
+    {
+    bool right     = gx > ex;
+    bool down      = gy > ey;
+    bool upleft    = gd > ed;
+    bool upright   = gad > ead;
+    bool left      = -gx_left > ex;
+    bool up        = -gy_up > ey;
+    bool downright = -gd_downright > ed;
+    bool downleft  = -gad_downleft > ead;
+    out[0] = down + upleft * 2 + right * 4 + upright * 8 + up * 16 + downright * 32 + left * 64 + downleft * 128;
+    }
+    {
+    bool right     = gx < -ex;
+    bool down      = gy < -ey;
+    bool upleft    = gd < -ed;
+    bool upright   = gad < -ead;
+    bool left      = -gx_left < -ex;
+    bool up        = -gy_up < -ey;
+    bool downright = -gd_downright < -ed;
+    bool downleft  = -gad_downleft < -ead;
+    out[1] = down + upleft * 2 + right * 4 + upright * 8 + up * 16 + downright * 32 + left * 64 + downleft * 128;
+    }
+}
+
+void ltp_row(const LtpRow &row, int n, unsigned char *out, size_t stride)
+{
+    const float *gx = row.grad[0], *gy = row.grad[1], *gd = row.grad[2], *gad = row.grad[3];
+    const float *ex = row.e[0], *ey = row.e[1], *ed = row.e[2], *ead = row.e[3];
+    if (n <= 0)
+        return;
+    if (n == 1) {
+        ltp_pixel(gx[0], gy[0], gd[0], gad[0], 0.0f, row.up_y[0], 0.0f, 0.0f,
+                  ex[0], ey[0], ed[0], ead[0], out);
+        return;
+    }
+
+    ltp_pixel(gx[0], gy[0], gd[0], gad[0], 0.0f, row.up_y[0], row.down_d[1], 0.0f,
+              ex[0], ey[0], ed[0], ead[0], out);
+    for (int j = 1; j < n - 1; j++) {
+        ltp_pixel(gx[j], gy[j], gd[j], gad[j], 
+                  gx[j-1], row.up_y[j], row.down_d[j+1], row.down_ad[j-1],
+                  ex[j], ey[j], ed[j], ead[j], out + j * stride);
+    }
+    const int j = n - 1;
+    ltp_pixel(gx[j], gy[j], gd[j], gad[j], gx[j-1], row.up_y[j], 0.0f, row.down_ad[j-1],
+              ex[j], ey[j], ed[j], ead[j], out + j * stride);
+}
+
+void axpy(float a, const float *x, float *y, int n)
+{
+    for (int k = 0; k < n; k++) {
+        y[k] += a * x[k];
+    }
+}
+
+}
+}
+
+//! The initializer of the CpuKernels of a variant. The tables are
+//! initialized statically, no code of a variant runs before it is selected.
+#define CPU_KERNELS(name) { name, &max_channel_diff, &gradient_magnitude_c3, \
+    &gradient_magnitude_c1, &ltp_row, &axpy }
+
+#endif /* end of include guard: CPUKERNELSIMPL_H */
@@ -0,0 +1,136 @@
+/**
+ *  This file is part of ltp-text-detector.
+ *  Copyright (C) 2013 Michael Opitz
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef DETECTIONSERVICE_H
+
+#define DETECTIONSERVICE_H
+
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "AdaboostClassifier.h"
+#include "BoundedQueue.h"
+#include "Instrumentation.h"
+#include "MserDetector.h"
+
+namespace TextDetector {
+
+class ConfigurationManager;
+
+//! A detected word with its score
+struct DetectedWord
+{
+    cv::Rect box;
+    //! The mean detector response inside of the box in [0,1]
+    double score;
+};
+
+//! The result of DetectionService::detect
+struct DetectionResult
+{
+    std::vector<DetectedWord> words;
+    //! The stage timings and counters of the request
+    ImageStats stats;
+};
+
+/**
+ *  Detects the words of a CV_8UC3 image in the calling thread. The stages
+ *  are timed in the ImageStats of the thread (see ScopedImageStats). The
+ *  score of a word is the mean detector response inside of its box.
+ */
+std::vector<DetectedWord> run_detection(
+    const ConfigurationManager &config,
+    AdaboostClassifier &clf,
+    const MserDetector &detector,
+    const cv::Mat &image);
+
+/**
+ *  Keeps the detector models in memory and runs the detection of 
+ *  concurrent requests on a fixed number of worker threads. Requests wait 
+ *  in a bounded queue in front of the workers, thus callers are blocked 
+ *  while the queue is full instead of oversubscribing the cores.
+ *
+ *  If the configuration has a cache, the extraction results of repeated
+ *  images are reused across requests.
+ */
+class DetectionService
+{
+public:
+    /**
+     *  Loads the models.
+     *
+     *  @param config the configuration of the detector
+     *  @param model_file the path of the adaboost model
+     *  @param workers the number of detection threads
+     *  @param queue_size the number of requests waiting for a worker
+     *  @param omp_threads the number of OpenMP threads per worker 
+     *         (0 = cores / workers)
+     */
+    DetectionService(
+        const std::shared_ptr<ConfigurationManager> &config,
+        const std::string &model_file,
+        int workers = 1,
+        int queue_size = 4,
+        int omp_threads = 0);
+    //! Finishes the queued requests and stops the workers
+    ~DetectionService();
+
+    /**
+     *  Detects the words of the image on one of the workers and blocks 
+     *  until the result is available. This method is thread-safe.
+     *
+     *  @param image a CV_8UC3 image, which must stay valid until the call 
+     *         returns (it is not copied)
+     *  @param name the name of the request in the stats
+     *  @throws std::runtime_error
+     */
+    DetectionResult detect(const cv::Mat &image, const std::string &name = "");
+
+    //! Returns the number of requests waiting for a worker
+    size_t pending() const { return _queue.size(); }
+    //! Returns the number of finished requests
+    unsigned long long served() const;
+private:
+    struct Request
+    {
+        cv::Mat image;
+        std::string name;
+        boost::timer::cpu_timer timer;
+        std::promise<DetectionResult> result;
+    };
+    typedef std::shared_ptr<Request> RequestPtr;
+
+    void work(int omp_threads);
+
+    std::shared_ptr<ConfigurationManager> _config;
+    MserDetector _detector;
+    AdaboostClassifier _clf;
+    BoundedQueue<RequestPtr> _queue;
+    std::vector<std::thread> _workers;
+    mutable std::mutex _mutex;
+    unsigned long long _served;
+};
+
+}
+
+#endif /* end of include guard: DETECTIONSERVICE_H */
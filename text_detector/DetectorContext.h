@@ -0,0 +1,53 @@
+/**
+ *  This file is part of ltp-text-detector.
+ *  Copyright (C) 2013 Michael Opitz
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef DETECTORCONTEXT_H
+
+#define DETECTORCONTEXT_H
+
+#include <memory>
+#include <string>
+
+class CacheManager;
+
+namespace TextDetector {
+
+class ConfigurationManager;
+
+/**
+ *  The configuration and the cache of a single detector. The detector 
+ *  passes its context down to the stages, thus several detectors with 
+ *  different configurations can run concurrently in one process.
+ */
+struct DetectorContext
+{
+    DetectorContext() {}
+    DetectorContext(
+        const std::shared_ptr<ConfigurationManager> &config_,
+        const std::shared_ptr<CacheManager> &cache_ = std::shared_ptr<CacheManager>())
+        : config(config_), cache(cache_) {}
+
+    std::shared_ptr<ConfigurationManager> config;
+    //! The content-addressed cache of the intermediate results (may be null)
+    std::shared_ptr<CacheManager> cache;
+    //! Digest of the unary classifiers, part of the keys of cached probabilities
+    std::string model_digest;
+};
+
+}
+
+#endif /* end of include guard: DETECTORCONTEXT_H */
@@ -0,0 +1,102 @@
+/**
+ *  This file is part of ltp-text-detector.
+ *  Copyright (C) 2013 Michael Opitz
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef EVALUATION_H
+
+#define EVALUATION_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+namespace TextDetector {
+
+/**
+ *  Parameters of the DetEval protocol (Wolf & Jolion 2006) with the 
+ *  defaults of the ICDAR 2011/2013 robust reading competitions.
+ */
+struct DetEvalParameters
+{
+    DetEvalParameters()
+        : area_recall(0.8f), area_precision(0.4f), 
+          split_penalty(0.8f), merge_penalty(1.0f) {}
+
+    //! Minimum fraction of a ground truth box covered by the detection(s)
+    float area_recall;
+    //! Minimum fraction of a detection covered by the ground truth box(es)
+    float area_precision;
+    //! Score of one-to-many matches (a ground truth box split into several detections)
+    float split_penalty;
+    //! Score of many-to-one matches (several ground truth boxes in a detection)
+    float merge_penalty;
+};
+
+/**
+ *  Accumulated matches of one or more images. Precision and recall are 
+ *  computed over all boxes, not averaged over the images.
+ */
+struct EvaluationResult
+{
+    EvaluationResult() 
+        : n_gt(0), n_detections(0), 
+          deteval_recall_sum(0.0), deteval_precision_sum(0.0),
+          icdar2003_recall_sum(0.0), icdar2003_precision_sum(0.0) {}
+
+    int n_gt;
+    int n_detections;
+    double deteval_recall_sum;
+    double deteval_precision_sum;
+    double icdar2003_recall_sum;
+    double icdar2003_precision_sum;
+
+    void add(const EvaluationResult &other);
+
+    double deteval_recall() const;
+    double deteval_precision() const;
+    double deteval_f() const;
+    double icdar2003_recall() const;
+    double icdar2003_precision() const;
+    double icdar2003_f() const;
+};
+
+/**
+ *  Evaluates the detections of a single image against its ground truth with
+ *  the DetEval protocol and the ICDAR 2003 best-match measure.
+ */
+EvaluationResult evaluate_image(
+    const std::vector<cv::Rect> &gt,
+    const std::vector<cv::Rect> &detections,
+    const DetEvalParameters &params = DetEvalParameters());
+
+//! Reads the x,y,width,height boxes written by bin/detect and bin/create_boxes
+std::vector<cv::Rect> read_detection_boxes(const std::string &filename);
+
+//! Reads an ICDAR 2011 ground truth file (x1, y1, x2, y2, "word" per line)
+std::vector<cv::Rect> read_icdar_gt(const std::string &filename);
+
+/**
+ *  Reads the ground truth of all images from a DetEval XML file 
+ *  (e.g. test-gt-textloc-wolf.xml). The keys are the image names without 
+ *  directory and extension.
+ */
+std::map<std::string, std::vector<cv::Rect> > read_deteval_gt(const std::string &filename);
+
+}
+
+#endif /* end of include guard: EVALUATION_H */
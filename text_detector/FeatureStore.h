@@ -0,0 +1,114 @@
+/**
+ *  This file is part of ltp-text-detector.
+ *  Copyright (C) 2013 Michael Opitz
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef FEATURESTORE_H
+
+#define FEATURESTORE_H
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+namespace TextDetector {
+
+/**
+ *  A matrix of float features with one sample per row, as written by the 
+ *  extract_* tools. 
+ *
+ *  The features are read either from a csv file or from a packed feature 
+ *  file (see FeatureStore::write and bin/pack_features). A packed file 
+ *  stores the matrix column by column behind a small header. It is mapped 
+ *  into memory, so opening it does not parse or copy anything and the 
+ *  columns (e.g. the image ids and uids of the CRF tools) can be read 
+ *  without touching the remaining features.
+ *  Csv files are parsed with all OpenMP threads. Row files (see 
+ *  FeatureRowWriter) are read as well.
+ */
+class FeatureStore
+{
+public:
+    //! Opens a packed feature file or parses a csv file, throws std::runtime_error
+    FeatureStore(const std::string &filename);
+    ~FeatureStore();
+
+    int rows() const { return _rows; }
+    int cols() const { return _cols; }
+    //! Returns the rows() values of a column
+    const float *column(int col) const;
+    //! Returns a row major CV_32FC1 copy of the features
+    cv::Mat to_mat() const;
+
+    //! Returns true if the file is a packed feature file
+    static bool is_packed(const std::string &filename);
+    //! Writes a CV_32FC1 matrix as packed feature file, throws std::runtime_error
+    static void write(const cv::Mat &features, const std::string &filename);
+private:
+    struct MappedFile;
+
+    std::unique_ptr<MappedFile> _mapped;
+    //! The columns of a csv file
+    std::vector<float> _columns;
+    const float *_data;
+    int _rows;
+    int _cols;
+};
+
+/**
+ *  Appends feature rows to a row file: a small header with the number of 
+ *  columns, followed by the rows. The number of rows follows from the file
+ *  size, so an existing file is continued (a partially written last row is
+ *  dropped) and rows can be written as they are produced.
+ *  Not thread-safe.
+ */
+class FeatureRowWriter
+{
+public:
+    //! Creates or continues a row file, throws std::runtime_error
+    FeatureRowWriter(const std::string &filename, int cols);
+
+    //! Appends the rows of a CV_32FC1 matrix with cols() columns
+    void write(const cv::Mat &rows);
+    void flush();
+
+    int cols() const { return _cols; }
+    //! Returns true if the file is a row file
+    static bool is_row_file(const std::string &filename);
+private:
+    std::string _filename;
+    std::ofstream _ofs;
+    int _cols;
+};
+
+//! Reads a row file into a CV_32FC1 matrix, throws std::runtime_error
+cv::Mat read_feature_rows(const std::string &filename);
+
+/**
+ *  Parses a csv file of floats into a CV_32FC1 matrix. The lines are parsed
+ *  in parallel; all lines must have the same number of values.
+ *  Throws std::runtime_error.
+ */
+cv::Mat read_feature_csv(const std::string &filename);
+
+//! Reads a packed feature file, a row file or a csv file into a CV_32FC1 matrix
+cv::Mat load_features(const std::string &filename);
+
+}
+
+#endif /* end of include guard: FEATURESTORE_H */
@@ -0,0 +1,100 @@
+/**
+ *  This file is part of ltp-text-detector.
+ *  Copyright (C) 2013 Michael Opitz
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef FORESTCROSSVALIDATION_H
+
+#define FORESTCROSSVALIDATION_H
+
+#include <cstdint>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+namespace TextDetector {
+
+//! The parameters of a random forest of the cross-validation tools
+struct ForestParams
+{
+    ForestParams(int n, int d, int v, float p = 1.0f)
+    : ntrees(n), depth(d), nvars(v), prior(p) {}
+
+    int ntrees;
+    int depth;
+    int nvars;
+    //! The prior of the positive class (the negative class has 1)
+    float prior;
+};
+
+//! The counts of one fold of a random forest cross-validation
+struct ForestFoldResult
+{
+    ForestFoldResult();
+
+    float train_error() const { return float(nmissclass_train) / ntrain; }
+    float error() const { return float(nmissclass) / nholdout; }
+    float fp_error() const { return float(nfalse_pos) / (nfalse_pos + real_neg); }
+    float fn_error() const { return float(nfalse_neg) / (nfalse_neg + real_neg); }
+    float precision() const { return float(true_pos) / (nfalse_pos + true_pos); }
+    float recall() const { return float(true_pos) / (nfalse_neg + true_pos); }
+
+    int ntrain;
+    int nmissclass_train;
+    int nholdout;
+    int nmissclass;
+    int nfalse_pos;
+    int nfalse_neg;
+    int real_pos;
+    int real_neg;
+    int true_pos;
+    int true_neg;
+};
+
+/**
+ *  Returns the holdout rows of a fold. The split is the one cv_forest has 
+ *  always used, so results stay comparable to older sweeps.
+ */
+cv::Range get_holdout_range(int rows, int nfolds, int fold);
+
+/**
+ *  Returns the seed of the random forest of a fold, which only depends on
+ *  the random seed of the sweep, the forest parameters and the fold.
+ */
+uint64_t get_fold_seed(int random_seed, const ForestParams &params, int fold);
+
+/**
+ *  Trains a random forest on the rows of samples outside of holdout and 
+ *  evaluates it on the holdout rows (labels are -1 and 1). 
+ *
+ *  samples and labels are only read (the training rows are selected with a 
+ *  sample index instead of being copied), so the folds of a sweep can be 
+ *  run concurrently on the same matrices. The random number generator of
+ *  the calling thread is reset to seed before the training, so the result
+ *  does not depend on the order in which the folds are run. If 
+ *  holdout_probs is given, it receives the probability of each holdout row.
+ */
+ForestFoldResult cross_validate_forest_fold(
+    const cv::Mat &samples, 
+    const cv::Mat &labels, 
+    const cv::Range &holdout, 
+    const ForestParams &params, 
+    float thresh,
+    uint64_t seed,
+    std::vector<float> *holdout_probs = 0);
+
+}
+
+#endif /* end of include guard: FORESTCROSSVALIDATION_H */
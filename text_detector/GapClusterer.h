@@ -0,0 +1,58 @@
+/**
+ *  This file is part of ltp-text-detector.
+ *  Copyright (C) 2013 Michael Opitz
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GAPCLUSTERER_H
+
+#define GAPCLUSTERER_H
+
+#include <vector>
+
+namespace TextDetector {
+
+/**
+ *  This class is responsible for clustering the gaps between characters 
+ *  into letter gaps and word gaps. 
+ *  It solves the 1D k-means problem with two clusters exactly by sorting 
+ *  the values and sweeping over all split points with prefix sums. 
+ *  In contrast to cv::kmeans the result is deterministic.
+ */
+class GapClusterer 
+{
+public:
+    GapClusterer() {}
+    ~GapClusterer() {}
+
+    /**
+     *  Clusters the given values into two clusters.
+     *
+     *  @param values is the list of values which should be clustered
+     *  @param labels (OUT) is the cluster index (0 or 1) for each value
+     *  @param centers (OUT) are the two cluster centers. centers[0] is 
+     *         the center of the smaller values. If all values are equal, 
+     *         both centers are equal and all labels are 0.
+     *  @returns the sum of squared distances to the assigned centers
+     */
+    float cluster(
+        const std::vector<float> &values,
+        std::vector<int> &labels,
+        float centers[2]) const;
+};
+
+}
+
+#endif /* end of include guard: GAPCLUSTERER_H */
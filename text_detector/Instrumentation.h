@@ -0,0 +1,168 @@
+/**
+ *  This file is part of ltp-text-detector.
+ *  Copyright (C) 2013 Michael Opitz
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef INSTRUMENTATION_H
+
+#define INSTRUMENTATION_H
+
+#include <boost/timer/timer.hpp>
+
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace TextDetector {
+
+/**
+ *  Timings (in milliseconds, wall clock) and counters of a single image.
+ *
+ *  The statistics of the image currently processed by a thread are 
+ *  reachable through ImageStats::current(), such that the stages deep in 
+ *  the detector can record their values without threading a context 
+ *  through every call. Timers and counters must only be recorded from the 
+ *  thread owning the stats and outside of OpenMP parallel regions.
+ */
+class ImageStats
+{
+public:
+    /**
+     *  @param name the name of the image
+     *  @param verbose print every recorded stage time as well
+     */
+    ImageStats(const std::string &name = "", bool verbose = false) 
+        : _name(name), _verbose(verbose) {}
+    ~ImageStats() {}
+
+    //! Returns the stats of the image processed by this thread (or 0)
+    static ImageStats *current();
+    //! Sets the stats of the image processed by this thread
+    static void set_current(ImageStats *stats);
+
+    //! Adds the time in ms to the stage (stages run per channel are summed)
+    void add_time(const std::string &stage, double ms);
+    //! Adds the value to the counter
+    void add_count(const std::string &counter, long long value);
+    //! Overwrites the value of the counter
+    void set_count(const std::string &counter, long long value);
+
+    const std::string &name() const { return _name; }
+    bool verbose() const { return _verbose; }
+    const std::vector<std::pair<std::string, double> > &times() const { return _times; }
+    const std::vector<std::pair<std::string, long long> > &counts() const { return _counts; }
+
+    //! Writes the stats as a single line JSON object
+    void write_json(std::ostream &os) const;
+private:
+    std::string _name;
+    bool _verbose;
+    std::vector<std::pair<std::string, double> > _times;
+    std::vector<std::pair<std::string, long long> > _counts;
+};
+
+/**
+ *  Makes the given stats the current stats of this thread for the 
+ *  lifetime of this object.
+ */
+class ScopedImageStats
+{
+public:
+    ScopedImageStats(ImageStats *stats) 
+        : _previous(ImageStats::current())
+    {
+        ImageStats::set_current(stats);
+    }
+    ~ScopedImageStats() { ImageStats::set_current(_previous); }
+private:
+    ImageStats *_previous;
+};
+
+/**
+ *  Measures the wall time between construction and destruction and adds it
+ *  to the stage of the current image stats. If the current stats are 
+ *  verbose, the time is printed as well.
+ */
+class ScopedStageTimer
+{
+public:
+    ScopedStageTimer(const std::string &stage) : _stage(stage) {}
+    ~ScopedStageTimer() { stop(); }
+
+    //! Stops the timer before the end of the scope
+    void stop();
+private:
+    std::string _stage;
+    boost::timer::cpu_timer _timer;
+};
+
+//! Adds the value to the counter of the current image stats (if any)
+inline void count_stat(const std::string &counter, long long value)
+{
+    ImageStats *stats = ImageStats::current();
+    if (stats) stats->add_count(counter, value);
+}
+
+//! Sets the counter of the current image stats (if any)
+inline void set_stat(const std::string &counter, long long value)
+{
+    ImageStats *stats = ImageStats::current();
+    if (stats) stats->set_count(counter, value);
+}
+
+//! Nearest-rank percentile (p in [0,100]) of sorted values, 0 if empty
+double percentile(const std::vector<double> &sorted, double p);
+
+/**
+ *  Collects the stats of all images of a batch. Every image is streamed to
+ *  the output as a JSON line as soon as it is added, CSV output is written
+ *  at the end of the batch since the columns are only known then.
+ *  This class is thread-safe.
+ */
+class StatsCollector
+{
+public:
+    enum Format { JSON_LINES, CSV };
+
+    /**
+     *  @param os the stream the per image stats are written to (or 0)
+     *  @param format the format of the per image stats
+     */
+    StatsCollector(std::ostream *os = 0, Format format = JSON_LINES)
+        : _os(os), _format(format) {}
+    ~StatsCollector() {}
+
+    void add(const ImageStats &stats);
+
+    //! Writes the CSV rows, does nothing for JSON lines
+    void finish();
+
+    /**
+     *  Writes the p50/p95/p99/max of every stage and counter over all 
+     *  images of the batch as a table.
+     */
+    void write_summary(std::ostream &os) const;
+private:
+    std::ostream *_os;
+    Format _format;
+    std::vector<ImageStats> _stats;
+    mutable std::mutex _mutex;
+};
+
+}
+
+#endif /* end of include guard: INSTRUMENTATION_H */
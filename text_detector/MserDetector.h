@@ -21,30 +21,66 @@
 
 #include <opencv2/core/core.hpp>
 #include <memory>
+#include <string>
 #include <utility>
 #include <vector>
 
 #include "CCGroup.h"
 #include "CCUtils.h"
+#include "DetectorContext.h"
 
 namespace TextDetector {
 class ConnectedComponentClassifier;
 class ConnectedComponentFilterer;
 class ModelManager;
 class WordSplitter;
+struct ReplayBundle;
 } /* namespace TextDetector */
 
 namespace TextDetector {
 
+/**
+ * The connected components extracted from all channels of an image. 
+ * This is the intermediate result between MserDetector::extract_components 
+ * and MserDetector::detect_words.
+ */
+struct ExtractedComponents
+{
+    //! The gradient image of the input image
+    cv::Mat gradient_image;
+    //! The (average) probability of each element
+    std::vector<double> probs;
+    //! The probabilities of each classifier for each element
+    std::vector<std::vector<double> > per_classifier_probs;
+    //! The unary features, iff. ConfigurationManager::keep_unary_features
+    cv::Mat unary_features;
+    //! List of (index into elements, pixel-list) tuples
+    std::vector<std::pair<int, std::vector<cv::Point> > > comps;
+    //! All extracted elements
+    std::vector<MserElement> elements;
+};
+
 /**
  * This class is responsible for detection text with maximally stable
  * extremal regions.
  */
 class MserDetector {
 public:
+	//! Creates a detector without a cache
 	MserDetector(const std::shared_ptr<ConfigurationManager> &cfg);
+	//! Creates a detector, which uses the configuration and cache of the context
+	MserDetector(const DetectorContext &context);
+	//! Creates a detector with another configuration, which shares the
+	//! loaded models and the cache of detector
+	MserDetector(const MserDetector &detector, const std::shared_ptr<ConfigurationManager> &cfg);
 	~MserDetector();
 
+	//! Returns the configuration and the cache of this detector
+	const DetectorContext &context() const { return _context; }
+
+	//! Returns a digest of the unary classifier models used by the configuration
+	static std::string compute_model_digest(const ConfigurationManager &config);
+
 	/**
 	 * Detects text from a given detector mask and a given input image.
 	 *
@@ -59,6 +95,53 @@ public:
         cv::Mat &result_image,
         const cv::Mat &detector_mask  = cv::Mat(),
         const cv::Mat &extra_bin_mask = cv::Mat()) const;
+
+    /**
+     * The first stage of operator(): Extracts and classifies the
+     * connected components of all channels.
+     *
+     * @param input_image is a CV_8UC3 image
+     * @param detector_mask is a CV_8UC1 image
+     * @param extra_bin_mask is a CV_8UC1 image, which is represents a
+     * 						 extra binary mask used for segmentation
+     * @param components (OUT) are the extracted components
+     * @throws std::runtime_error
+     */
+    void extract_components(
+        const cv::Mat &input_image,
+        const cv::Mat &detector_mask,
+        const cv::Mat &extra_bin_mask,
+        ExtractedComponents &components) const;
+
+    /**
+     * The second stage of operator(): Filters the extracted components,
+     * groups them into text lines and splits the lines into words.
+     *
+     * @param input_image is a CV_8UC3 image
+     * @param components are the components from extract_components. 
+     *        The component list is replaced by the filtered one.
+     * @param result_image (OUT) is an image of the text lines
+     * @param capture (OUT) if given, receives the input image and the 
+     *        components before and after filtering
+     */
+    std::vector<cv::Rect> detect_words(
+        const cv::Mat &input_image,
+        ExtractedComponents &components,
+        cv::Mat &result_image,
+        ReplayBundle *capture = 0) const;
+
+    //! Filters the components with the configured (CRF) model in place
+    void filter_components(
+        const cv::Mat &input_image,
+        ExtractedComponents &components) const;
+    //! Groups the (filtered) components into text lines
+    void group_components(
+        const cv::Mat &input_image,
+        const ExtractedComponents &components,
+        std::vector<CCGroup> &groups) const;
+    //! Splits the text lines into words
+    std::vector<cv::Rect> split_words(
+        const std::vector<CCGroup> &groups) const;
 private:
     std::shared_ptr<TextDetector::ConnectedComponentClassifier>
     get_connected_component_classifier() const;
@@ -78,20 +161,13 @@ private:
         const cv::Mat &train_image,
         const cv::Mat &grad_image,
         const cv::Mat &unary_features) const;
-    void group_components(
-        const cv::Mat &train_image,
-        const cv::Mat &gradient_image,
-        const std::vector<double> &probs,
-        const std::vector<MserElement> &all_elements,
-        std::vector<CCGroup> &groups,
-        const std::vector<std::pair<int, std::vector<cv::Point> > > &comps) const;
     void filter_overlapping_components(
         std::vector<std::pair<int, std::vector<cv::Point> > > &comps,
         const std::vector<MserElement> &all_elements,
         const std::vector<double> &probs) const;
     std::shared_ptr<WordSplitter> get_word_splitter() const;
 
-	std::shared_ptr<ConfigurationManager> _config_manager;
+	DetectorContext _context;
 	std::shared_ptr<ModelManager> _model_manager;
 };
 
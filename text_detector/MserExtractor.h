@@ -28,6 +28,9 @@
 
 #include "CCUtils.h"
 #include "ConnectedComponentExtractor.h"
+#include "DetectorContext.h"
+
+class CacheFile;
 
 namespace TextDetector {
 class ConnectedComponentClassifier;
@@ -45,6 +48,7 @@ public:
     /**
      *  Constructs the mser extractor.
      *
+     *  @param context is the configuration and the cache of the detector
      *  @param image_color is the color image from thich the components are extracted
      *  @param image_gray is the grayscale image on which the mser algorithm is applied
      *  @param gradient_image is the gradient image
@@ -55,6 +59,7 @@ public:
      *         multiple image sources
      */
     MserExtractor(
+        const DetectorContext &context,
         const cv::Mat &image_color, 
         const cv::Mat &image_gray,
         const cv::Mat &gradient_image, 
@@ -119,6 +124,12 @@ private:
     std::shared_ptr<ConnectedComponentClassifier> _classifier;
     //! UID offset - used for multiple channels of images
     int _uid_offset;
+    //! The configuration and the cache of the detector
+    DetectorContext _context;
+    //! The cached entries of the channel (or 0 without a cache)
+    std::shared_ptr<CacheFile> _mser_cache;
+    std::shared_ptr<CacheFile> _feature_cache;
+    std::shared_ptr<CacheFile> _prob_cache;
 };
 } /* namespace TextDetector */
 
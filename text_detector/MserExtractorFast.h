@@ -29,9 +29,11 @@
 
 #include "CCUtils.h"
 #include "ConnectedComponentExtractor.h"
+#include "DetectorContext.h"
 #include "mser.h"
 
 namespace TextDetector {
+class ComponentDeduplicator;
 class ConnectedComponentClassifier;
 } /* namespace TextDetector */
 
@@ -46,6 +48,7 @@ public:
     /**
      *  Constructs the mser extractor.
      *
+     *  @param context is the configuration and the cache of the detector
      *  @param image_color is the color image from thich the components are extracted
      *  @param image_gray is the grayscale image on which the mser algorithm is applied
      *  @param gradient_image is the gradient image
@@ -55,6 +58,7 @@ public:
      *         multiple image sources
      */
     MserExtractorFast(
+        const DetectorContext &context,
         const cv::Mat &image_color,
         const cv::Mat &image_gray,
         const cv::Mat &gradient_image,
@@ -64,6 +68,20 @@ public:
     );
     ~MserExtractorFast() = default;
 
+    /**
+     *  Shares the features and probabilities of near-duplicate components
+     *  with the other extractors of the deduplicator (e.g. the other
+     *  channels of the image). Duplicates are not classified again.
+     */
+    void set_deduplicator(const std::shared_ptr<ComponentDeduplicator> &dedup) { _dedup = dedup; }
+
+    /**
+     *  Sets the digest of the color image (CacheKey::str), which is part of
+     *  the cache keys of the features. The extractors of the channels of an 
+     *  image share it, so the color image is hashed only once.
+     */
+    void set_image_digest(const std::string &digest) { _image_digest = digest; }
+
     /**
      *  Extracts the MSER features and applies the appropriate classifier.
      *
@@ -122,6 +140,12 @@ private:
     std::shared_ptr<ConnectedComponentClassifier> _classifier;
     //! UID offset - used for multiple channels of images
     int _uid_offset;
+    //! Collapses near-duplicates across channels, may be empty
+    std::shared_ptr<ComponentDeduplicator> _dedup;
+    //! Digest of the color image, computed by extract if it is empty
+    std::string _image_digest;
+    //! The configuration and the cache of the detector
+    DetectorContext _context;
 };
 
 }
@@ -123,6 +123,53 @@ public:
     std::vector<std::vector<int> > _accumulated_indices;
 };
 
+/**
+ * Index based mser tree for the detection pipeline. The tree is stored as
+ * arrays (parent, first child and next sibling index, probability and
+ * bounding rect per region) and linearize/accumulate are iterative post-order
+ * sweeps, so neither the pixels are copied nor the recursion depth is bounded
+ * by the stack. The result is the list of the indices of the accumulated
+ * regions in the same order as MserTree::get_accumulated_indices().
+ */
+class FlatMserTree
+{
+public:
+    //! Builds the tree from the bounding rects of the regions
+    FlatMserTree(
+        const std::vector<cv::Rect> &rects,
+        const std::vector<double> &probs,
+        const std::vector<cv::Vec4i> &hierarchy);
+    //! Builds the tree from the pixels of the regions
+    FlatMserTree(
+        const std::vector<std::vector<cv::Point> > &contours,
+        const std::vector<double> &probs,
+        const std::vector<cv::Vec4i> &hierarchy);
+
+    //! Removes single children (see MserNode::linearize)
+    void linearize();
+    //! Accumulates the children of every root (see MserNode::accumulate)
+    void accumulate();
+
+    //! Returns the indices of the accumulated regions
+    const std::vector<int> &get_accumulated_indices() const { return _accumulated_indices; }
+
+private:
+    void build(const std::vector<cv::Vec4i> &hierarchy);
+    bool has_multiple_children(int node) const
+    {
+        return _first_child[node] >= 0 && _next_sibling[_first_child[node]] >= 0;
+    }
+
+    std::vector<int> _parent;
+    std::vector<int> _first_child;
+    std::vector<int> _next_sibling;
+    std::vector<double> _probs;
+    std::vector<cv::Rect> _rects;
+    //! Stores the roots of the tree in increasing order of the index
+    std::vector<int> _roots;
+    std::vector<int> _accumulated_indices;
+};
+
 }
 
 
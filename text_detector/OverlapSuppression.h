@@ -0,0 +1,132 @@
+/**
+ *  This file is part of ltp-text-detector.
+ *  Copyright (C) 2013 Michael Opitz
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef OVERLAPSUPPRESSION_H
+
+#define OVERLAPSUPPRESSION_H
+
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include <text_detector/CCUtils.h>
+
+namespace TextDetector {
+
+/**
+ *  The pixels of a set of components as runs sorted by row and column,
+ *  stored in a single array. The number of common pixels of two
+ *  components is computed by merging their runs, without allocating.
+ */
+class ComponentRuns
+{
+public:
+    ComponentRuns() : _offsets(1, 0) {}
+
+    //! Adds the pixels of the next component
+    void add(const std::vector<cv::Point> &pixels);
+
+    int size() const { return _areas.size(); }
+    //! Returns the number of pixels of the i-th component
+    size_t area(int i) const { return _areas[i]; }
+    //! Returns the number of pixels the i-th and the j-th component share
+    size_t intersection(int i, int j) const;
+
+private:
+    std::vector<PixelRun> _runs;
+    std::vector<size_t> _offsets;
+    std::vector<size_t> _areas;
+};
+
+/**
+ *  Bins bounding rects into a uniform grid. Every rect is stored in all
+ *  cells it covers, so the rects intersecting a rect are found in the
+ *  cells of the rect.
+ */
+class RectGrid
+{
+public:
+    //! Bins the rects, by default the cell size is the median of the
+    //! longer side of the rects
+    RectGrid(const std::vector<cv::Rect> &rects, int cell_size = 0);
+
+    /**
+     *  Calls f(j) exactly once for every rect j != i intersecting the i-th 
+     *  rect, until f returns true.
+     */
+    template <typename F>
+    void for_each_intersecting(int i, F f) const
+    {
+        const cv::Rect &r = _rects[i];
+        if (r.width <= 0 || r.height <= 0)
+            return;
+        int cx0 = cell_x(r.x), cx1 = cell_x(r.x + r.width - 1);
+        int cy0 = cell_y(r.y), cy1 = cell_y(r.y + r.height - 1);
+        for (int cy = cy0; cy <= cy1; cy++) {
+            for (int cx = cx0; cx <= cx1; cx++) {
+                int cell = cy * _cols + cx;
+                for (int k = _cell_offsets[cell]; k < _cell_offsets[cell + 1]; k++) {
+                    int j = _cell_items[k];
+                    if (j == i)
+                        continue;
+                    cv::Rect intersect = r & _rects[j];
+                    if (intersect.width <= 0 || intersect.height <= 0)
+                        continue;
+                    // a pair shares several cells, it is only reported in 
+                    // the cell of the top left corner of the intersection
+                    if (cell_x(intersect.x) != cx || cell_y(intersect.y) != cy)
+                        continue;
+                    if (f(j))
+                        return;
+                }
+            }
+        }
+    }
+
+private:
+    int cell_x(int x) const { return (x - _origin.x) / _cell_size; }
+    int cell_y(int y) const { return (y - _origin.y) / _cell_size; }
+
+    std::vector<cv::Rect> _rects;
+    cv::Point _origin;
+    int _cell_size;
+    int _cols;
+    int _rows;
+    //! The rects of cell c are _cell_items[_cell_offsets[c].._cell_offsets[c+1]]
+    std::vector<int> _cell_offsets;
+    std::vector<int> _cell_items;
+};
+
+/**
+ *  Marks every component which overlaps with a more probable component
+ *  (on equal probability: with a later one). Two components overlap if 
+ *  both the intersection of their bounding rects and their common pixels
+ *  are larger than thresh times the larger of the two. Only the pairs of 
+ *  the grid cells are compared, and the result does not depend on the
+ *  number of threads.
+ *
+ *  @return 1 for every removed component, 0 otherwise
+ */
+std::vector<unsigned char> find_overlapping_components(
+    const std::vector<cv::Rect> &rects,
+    const ComponentRuns &runs,
+    const std::vector<double> &probs,
+    double thresh = 0.4);
+
+}
+
+#endif /* end of include guard: OVERLAPSUPPRESSION_H */
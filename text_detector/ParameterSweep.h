@@ -0,0 +1,114 @@
+/**
+ *  This file is part of ltp-text-detector.
+ *  Copyright (C) 2013 Michael Opitz
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef PARAMETERSWEEP_H
+
+#define PARAMETERSWEEP_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "MserDetector.h"
+
+namespace TextDetector {
+
+/**
+ *  A combination of the downstream parameters of the detector.
+ */
+struct SweepSetting
+{
+    float threshold;
+    float pre_classification_prob_threshold;
+    float word_group_threshold;
+    float minimum_vertical_overlap;
+    int word_split_model;
+
+    //! Returns a unique name of the setting, usable as directory name
+    std::string name() const;
+};
+
+/**
+ *  Evaluates a grid of downstream parameters (the response threshold, the
+ *  threshold of the RFConnectedComponentFilterer, the grouping thresholds
+ *  and the word split model) on components, which are extracted only once.
+ *
+ *  The components have to be extracted with the most permissive response
+ *  threshold (see extraction_threshold()). For stricter thresholds the
+ *  components, which do not overlap the stricter mask, are dropped 
+ *  afterwards. The MSER tree and the overlap suppression are thus computed
+ *  at the most permissive threshold, which might slightly differ from a
+ *  full run at the stricter threshold.
+ *
+ *  The settings are ordered such that the result of a stage is reused by 
+ *  all following settings, which only differ in parameters of later 
+ *  stages: the CRF is evaluated once per threshold, the grouping once per
+ *  grouping parameters.
+ */
+class ParameterSweep
+{
+public:
+    /**
+     *  Creates the settings of the grid. An empty parameter list uses the
+     *  value of the configuration of the detector.
+     *
+     *  @param detector is the detector, whose models are shared
+     */
+    ParameterSweep(
+        const MserDetector &detector,
+        std::vector<float> thresholds,
+        std::vector<float> pre_classification_prob_thresholds,
+        std::vector<float> word_group_thresholds,
+        std::vector<float> minimum_vertical_overlaps,
+        std::vector<int> word_split_models);
+
+    //! Returns all combinations of the grid
+    const std::vector<SweepSetting> &settings() const { return _settings; }
+    //! Returns the response threshold, which has to be used for the extraction
+    float extraction_threshold() const { return _extraction_threshold; }
+
+    /**
+     *  Detects the words of every setting.
+     *
+     *  @param input_image is a CV_8UC3 image
+     *  @param response is the CV_8UC1 response image of the detector or an
+     *         empty matrix if the responses are ignored
+     *  @param components are the components from MserDetector::extract_components
+     *         with the extraction_threshold(). The component list is 
+     *         replaced during the sweep and restored afterwards.
+     *  @param words (OUT) receives the words of settings()[i] in words[i]
+     *  @throws std::runtime_error
+     */
+    void operator()(
+        const cv::Mat &input_image,
+        const cv::Mat &response,
+        ExtractedComponents &components,
+        std::vector<std::vector<cv::Rect> > &words) const;
+private:
+    std::vector<SweepSetting> _settings;
+    //! A detector with the configuration of each setting
+    std::vector<std::shared_ptr<MserDetector> > _detectors;
+    float _extraction_threshold;
+    //! True if the filtering depends on pre_classification_prob_threshold
+    bool _rf_filter;
+};
+
+}
+
+#endif /* end of include guard: PARAMETERSWEEP_H */
@@ -0,0 +1,159 @@
+/**
+ *  This file is part of ltp-text-detector.
+ *  Copyright (C) 2013 Michael Opitz
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PIPELINE_H
+
+#define PIPELINE_H
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BoundedQueue.h"
+
+namespace TextDetector {
+
+/**
+ *  A staged pipeline executor. 
+ *  Each stage runs with its own pool of worker threads and the stages are 
+ *  connected with bounded queues, such that a slow stage applies backpressure 
+ *  on the stages in front of it. Several items (e.g. images) are in flight
+ *  at the same time, so I/O and sequential parts of one item overlap with 
+ *  the parallel parts of another one.
+ *
+ *  Items are processed in order within a stage with a single worker, but may
+ *  be reordered by stages having multiple workers.
+ */
+template <class T>
+class Pipeline 
+{
+public:
+    /**
+     *  A stage processes the item in place. If it returns false, the item is 
+     *  dropped and not passed on to the next stage.
+     */
+    typedef std::function<bool (T &)> StageFunction;
+    /**
+     *  A worker initialization function, which is called once in each worker 
+     *  thread of a stage before the first item is processed
+     */
+    typedef std::function<void ()> WorkerInit;
+
+    /**
+     *  @param queue_size is the capacity of the queue in front of each stage
+     */
+    Pipeline(size_t queue_size = 2) : _queue_size(queue_size) {}
+    ~Pipeline() {}
+
+    /**
+     *  Appends a stage to the pipeline.
+     *
+     *  @param name is the name of the stage used for error messages
+     *  @param n_workers is the number of worker threads of this stage
+     *  @param f is the function applied to each item
+     *  @param init is called once in each worker thread
+     */
+    void add_stage(const std::string &name, int n_workers, 
+        const StageFunction &f, const WorkerInit &init = WorkerInit())
+    {
+        Stage s;
+        s.name = name;
+        s.n_workers = std::max(1, n_workers);
+        s.f = f;
+        s.init = init;
+        _stages.push_back(s);
+    }
+
+    /**
+     *  Runs all items through the pipeline and blocks until the 
+     *  last stage has processed every item. Exceptions thrown by a stage 
+     *  are reported and the corresponding item is dropped.
+     */
+    void run(std::vector<T> items)
+    {
+        if (_stages.empty()) return;
+
+        std::vector<std::shared_ptr<BoundedQueue<T> > > queues;
+        for (size_t i = 0; i < _stages.size(); i++) {
+            queues.push_back(std::make_shared<BoundedQueue<T> >(_queue_size));
+        }
+        std::vector<std::shared_ptr<std::atomic<int> > > running;
+        for (size_t i = 0; i < _stages.size(); i++) {
+            running.push_back(std::make_shared<std::atomic<int> >(_stages[i].n_workers));
+        }
+
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < _stages.size(); i++) {
+            for (int w = 0; w < _stages[i].n_workers; w++) {
+                threads.push_back(std::thread([this, i, &queues, &running] () {
+                    const Stage &stage = _stages[i];
+                    if (stage.init) stage.init();
+
+                    T item;
+                    while (queues[i]->pop(item)) {
+                        bool pass_on = false;
+                        try {
+                            pass_on = stage.f(item);
+                        } catch (const std::exception &e) {
+                            std::cerr << "Error in stage " << stage.name 
+                                      << ": " << e.what() << std::endl;
+                        }
+                        if (pass_on && i + 1 < queues.size()) {
+                            queues[i+1]->push(std::move(item));
+                        }
+                    }
+                    // the last worker of a stage closes the next queue
+                    if (--(*running[i]) == 0 && i + 1 < queues.size()) {
+                        queues[i+1]->close();
+                    }
+                }));
+            }
+        }
+
+        for (size_t i = 0; i < items.size(); i++) {
+            queues[0]->push(std::move(items[i]));
+        }
+        queues[0]->close();
+
+        for (size_t i = 0; i < threads.size(); i++) {
+            threads[i].join();
+        }
+    }
+
+private:
+    struct Stage 
+    {
+        std::string name;
+        int n_workers;
+        StageFunction f;
+        WorkerInit init;
+    };
+
+    size_t _queue_size;
+    std::vector<Stage> _stages;
+};
+
+}
+
+#endif /* end of include guard: PIPELINE_H */
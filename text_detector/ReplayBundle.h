@@ -0,0 +1,63 @@
+/**
+ *  This file is part of ltp-text-detector.
+ *  Copyright (C) 2013 Michael Opitz
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef REPLAYBUNDLE_H
+
+#define REPLAYBUNDLE_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "MserDetector.h"
+
+namespace TextDetector {
+
+/**
+ *  The inputs of the stages of MserDetector for a single image, such that 
+ *  a single stage can be re-executed without running the stages in front 
+ *  of it (see bin/replay_stage).
+ *
+ *  Bundles are stored as boost binary archives and are only meant to be 
+ *  read by the same build on the same platform.
+ */
+struct ReplayBundle
+{
+    //! The name of the image
+    std::string name;
+    //! The CV_8UC3 input image
+    cv::Mat image;
+    //! The (thresholded) response mask of the detector
+    cv::Mat detector_mask;
+    //! The extra binary mask (may be empty)
+    cv::Mat extra_bin_mask;
+    //! The components after the extraction (the input of the CRF)
+    ExtractedComponents components;
+    //! The components after the CRF (the input of the grouping)
+    std::vector<std::pair<int, std::vector<cv::Point> > > filtered_comps;
+
+    //! Writes the bundle, throws std::runtime_error on failure
+    void save(const std::string &filename) const;
+    //! Reads the bundle, throws std::runtime_error on failure
+    void load(const std::string &filename);
+};
+
+}
+
+#endif /* end of include guard: REPLAYBUNDLE_H */
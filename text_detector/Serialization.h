@@ -0,0 +1,131 @@
+/**
+ *  This file is part of ltp-text-detector.
+ *  Copyright (C) 2013 Michael Opitz
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SERIALIZATION_H
+
+#define SERIALIZATION_H
+
+#include <opencv2/core/core.hpp>
+
+#include <boost/serialization/binary_object.hpp>
+#include <boost/serialization/split_free.hpp>
+#include <boost/serialization/utility.hpp>
+#include <boost/serialization/vector.hpp>
+#include <boost/serialization/string.hpp>
+
+/**
+ *  Boost serialization of the OpenCV types used by the cache and 
+ *  the replay bundles.
+ */
+namespace boost {
+    namespace serialization {
+        template<class Archive >
+        inline void serialize(
+            Archive &ar,
+            cv::Point &p,
+            const unsigned int file_version){
+            ar & p.x;
+            ar & p.y;
+        }
+
+        template<class Archive>
+        inline void serialize(
+            Archive & ar,
+            cv::Vec4i &v,
+            const unsigned int file_version) {
+            ar & v[0];
+            ar & v[1];
+            ar & v[2];
+            ar & v[3];
+        }
+
+        template<class Archive>
+        inline void serialize(
+            Archive & ar,
+            cv::Vec2f &v,
+            const unsigned int file_version) {
+            ar & v[0];
+            ar & v[1];
+        }
+
+        template<class Archive>
+        inline void serialize(
+            Archive & ar,
+            cv::Rect &r,
+            const unsigned int file_version) {
+            ar & r.x;
+            ar & r.y;
+            ar & r.width;
+            ar & r.height;
+        }
+
+        template<class Archive>
+        inline void serialize(
+            Archive & ar,
+            cv::RotatedRect &r,
+            const unsigned int file_version) {
+            ar & r.center.x;
+            ar & r.center.y;
+            ar & r.size.width;
+            ar & r.size.height;
+            ar & r.angle;
+        }
+
+        template<class Archive>
+        inline void save(
+            Archive & ar,
+            const cv::Mat &m,
+            const unsigned int file_version) {
+            int rows = m.rows;
+            int cols = m.cols;
+            int type = m.type();
+            ar & rows;
+            ar & cols;
+            ar & type;
+            // row by row since m may be a non-continuous sub-matrix
+            const size_t row_size = cols * m.elemSize();
+            for (int i = 0; i < rows; i++) {
+                ar & boost::serialization::make_binary_object(
+                    const_cast<uchar *>(m.ptr(i)), row_size);
+            }
+        }
+
+        template<class Archive>
+        inline void load(
+            Archive & ar,
+            cv::Mat &m,
+            const unsigned int file_version) {
+            int rows, cols, type;
+            ar & rows;
+            ar & cols;
+            ar & type;
+            if (rows == 0 || cols == 0) {
+                m = cv::Mat();
+                return;
+            }
+            m.create(rows, cols, type);
+            const size_t row_size = cols * m.elemSize();
+            for (int i = 0; i < rows; i++) {
+                ar & boost::serialization::make_binary_object(m.ptr(i), row_size);
+            }
+        }
+    }
+}
+
+BOOST_SERIALIZATION_SPLIT_FREE(cv::Mat)
+
+#endif /* end of include guard: SERIALIZATION_H */
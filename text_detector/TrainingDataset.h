@@ -0,0 +1,142 @@
+/**
+ *  This file is part of ltp-text-detector.
+ *  Copyright (C) 2013 Michael Opitz
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef TRAININGDATASET_H
+
+#define TRAININGDATASET_H
+
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "CCUtils.h"
+
+namespace TextDetector {
+
+/**
+ *  A labelled component of a training dataset. This is also the record of
+ *  the index of a packed dataset.
+ */
+struct TrainingSample
+{
+    //! Index of the image in the dataset
+    int32_t image;
+    //! Index of the MSER tree (the sub-directory of the image)
+    int32_t tree_id;
+    int32_t uid;
+    //! 1 for letters, -1 for negatives
+    int32_t label;
+    //! The text line of the component or -1
+    int32_t textline_id;
+    uint32_t n_points;
+    uint32_t n_runs;
+    //! Offset of the pixel runs in the packed file
+    uint64_t data_offset;
+};
+
+/**
+ *  The labelled components of a set of images, read either from a 
+ *  labelled directory or from a packed dataset.
+ *
+ *  A labelled directory (written by LabelWidget) has a sub-directory per 
+ *  image and per MSER tree with letters.txt, negatives.txt and a 
+ *  node<uid>_contour.csv file for each component. 
+ *  A packed dataset (see TrainingDatasetWriter) stores all images in a single
+ *  file: the run-length encoded pixels of the components, the image names and 
+ *  an index of TrainingSample records. It is mapped into memory and the 
+ *  pixels are decoded when they are requested.
+ */
+class TrainingDataset
+{
+public:
+    //! Opens a labelled directory or a packed dataset, throws std::runtime_error
+    TrainingDataset(const std::string &path);
+    ~TrainingDataset();
+
+    size_t get_image_count() const { return _images.size(); }
+    //! Returns the name of the image (the stem of the image file)
+    std::string get_image_name(size_t image) const { return _images.at(image); }
+    //! Returns the (sorted) ids of the MSER trees of the image
+    std::vector<int> get_tree_ids(size_t image) const;
+    /**
+     *  Returns the components of an MSER tree with the given label in the 
+     *  order of letters.txt or negatives.txt. The image id of the elements
+     *  is the number of the image name.
+     */
+    std::vector<MserElement> get_elements(size_t image, int tree_id, int label) const;
+    //! Returns the text line of each uid of the image (-1 for none)
+    std::vector<int> get_textline_ids(size_t image) const;
+
+    const std::vector<TrainingSample> &get_samples() const { return _samples; }
+    std::vector<cv::Point> get_pixels(size_t sample) const;
+private:
+    struct MappedFile;
+
+    void load_directory(const std::string &directory);
+
+    std::unique_ptr<MappedFile> _mapped;
+    std::string _directory;
+    std::vector<std::string> _images;
+    std::vector<TrainingSample> _samples;
+    //! The indices of the samples of each image
+    std::vector<std::vector<size_t> > _image_samples;
+};
+
+/**
+ *  Writes a packed dataset. The file is written to a temporary file, which
+ *  is renamed by close().
+ */
+class TrainingDatasetWriter
+{
+public:
+    //! Throws std::runtime_error if the file can not be created
+    TrainingDatasetWriter(const std::string &filename);
+    //! Discards the dataset if close() was not called
+    ~TrainingDatasetWriter();
+
+    //! Adds an image and returns its index
+    size_t add_image(const std::string &name);
+    /**
+     *  Adds a component of an image. The pixels of a uid of an image are
+     *  only stored once, even if the component is in several trees.
+     */
+    void add(size_t image, int tree_id, int uid, int label, int textline_id,
+        const std::vector<cv::Point> &pixels);
+    //! Writes the index and renames the file, throws std::runtime_error
+    void close();
+private:
+    std::string _filename;
+    std::string _tmp_filename;
+    std::ofstream _ofs;
+    std::vector<std::string> _images;
+    std::vector<TrainingSample> _samples;
+    //! (image, uid) -> index of the first sample with the pixels
+    std::map<std::pair<size_t, int>, size_t> _stored;
+};
+
+//! Packs a labelled directory into a packed dataset
+void pack_training_dataset(const std::string &directory, const std::string &filename);
+
+}
+
+#endif /* end of include guard: TRAININGDATASET_H */
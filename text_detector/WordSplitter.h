@@ -39,6 +39,12 @@ public:
      *  Splits the given group into a list of words represented as rectangles.
      */
     virtual std::vector<cv::Rect> split(const CCGroup &grp) = 0;
+
+    /**
+     *  Splits all given groups into words. The groups are split in parallel,
+     *  the resulting words are returned in the order of the groups.
+     */
+    std::vector<cv::Rect> split_all(const std::vector<CCGroup> &groups);
 private:
 };
 
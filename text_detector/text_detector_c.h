@@ -0,0 +1,150 @@
+/**
+ *  This file is part of ltp-text-detector.
+ *  Copyright (C) 2013 Michael Opitz
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef TEXT_DETECTOR_C_H
+
+#define TEXT_DETECTOR_C_H
+
+/**
+ *  C interface of the text detector for embedding it into other programs.
+ *
+ *  A td_context holds the configuration and the models, it is created once
+ *  and reused for every image:
+ *
+ *      td_context *ctx = td_create("config_11.yml", "models/model_boost.txt");
+ *      if (!ctx) { fprintf(stderr, "%s\n", td_last_error()); ... }
+ *
+ *      td_image image = { pixels, width, height, stride, TD_FORMAT_BGR24 };
+ *      td_box boxes[256];
+ *      size_t n;
+ *      if (td_detect(ctx, &image, boxes, 256, &n) != TD_OK) ...
+ *
+ *      td_destroy(ctx);
+ *
+ *  The pixels stay owned by the caller. BGR images are used in place, the 
+ *  other formats are converted into a buffer of the context, which is 
+ *  reused for the following images.
+ *
+ *  Contexts are independent, thus several threads can detect text at the
+ *  same time with separate contexts. Calls on the same context are 
+ *  serialized.
+ */
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//! Incremented on incompatible changes of this interface
+#define TD_API_VERSION 1
+
+typedef struct td_context td_context;
+
+typedef enum td_status
+{
+    TD_OK = 0,
+    TD_ERROR_INVALID_ARGUMENT = 1,
+    TD_ERROR_UNSUPPORTED_FORMAT = 2,
+    TD_ERROR_DETECTION = 3
+} td_status;
+
+typedef enum td_pixel_format
+{
+    //! 8 bit gray
+    TD_FORMAT_GRAY8 = 0,
+    //! 8 bit blue, green, red (the native format, used without copying)
+    TD_FORMAT_BGR24 = 1,
+    //! 8 bit red, green, blue
+    TD_FORMAT_RGB24 = 2,
+    //! 8 bit blue, green, red, alpha (alpha is ignored)
+    TD_FORMAT_BGRA32 = 3,
+    //! 8 bit red, green, blue, alpha (alpha is ignored)
+    TD_FORMAT_RGBA32 = 4
+} td_pixel_format;
+
+//! An image in memory owned by the caller
+typedef struct td_image
+{
+    const unsigned char *data;
+    int width;
+    int height;
+    //! Bytes between the starts of two rows, 0 if the rows are packed
+    size_t stride;
+    //! One of td_pixel_format
+    int format;
+} td_image;
+
+//! A detected word
+typedef struct td_box
+{
+    int x;
+    int y;
+    int width;
+    int height;
+    //! The mean detector response inside of the box in [0,1]
+    float score;
+} td_box;
+
+//! Returns TD_API_VERSION of the library
+int td_api_version(void);
+
+/**
+ *  Loads the configuration and the models. Returns NULL on errors, see 
+ *  td_last_error.
+ *
+ *  @param config_file the path of the configuration (e.g. config_11.yml),
+ *         the model paths of the configuration are relative to the working
+ *         directory
+ *  @param model_file the path of the adaboost model
+ */
+td_context *td_create(const char *config_file, const char *model_file);
+
+/**
+ *  Limits the number of OpenMP threads td_detect uses (0 = the OpenMP
+ *  default). With many contexts working concurrently, the threads should
+ *  be split between them.
+ */
+td_status td_set_threads(td_context *ctx, int threads);
+
+/**
+ *  Detects the words of an image. The image is only accessed during the 
+ *  call.
+ *
+ *  @param boxes receives up to max_boxes words, sorted by decreasing score
+ *  @param n_boxes receives the number of detected words, if it is larger 
+ *         than max_boxes only the first max_boxes words were written
+ *  @return TD_OK or an error, see td_last_error
+ */
+td_status td_detect(
+    td_context *ctx,
+    const td_image *image,
+    td_box *boxes,
+    size_t max_boxes,
+    size_t *n_boxes);
+
+//! Frees the context, ctx may be NULL
+void td_destroy(td_context *ctx);
+
+//! Returns the message of the last error of the calling thread
+const char *td_last_error(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* end of include guard: TEXT_DETECTOR_C_H */